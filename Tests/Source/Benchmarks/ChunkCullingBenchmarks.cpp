@@ -0,0 +1,140 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/LegacyChunk.h"
+#include "Game/ChunkMesher.h"
+
+using namespace DirectX;
+
+static void BenchmarkCulling(const char* name, Chunk& chunk)
+{
+	LegacyChunk legacy;
+	legacy.CopyFrom(chunk);
+
+	// Both cull against empty neighbors, so they agree on every face
+	UNTITLED_ASSERT(legacy.CullFaces() == chunk.CountVisibleFaces());
+
+	const double legacyTime = Benchmarking::Measure([&]()
+	{
+		Benchmarking::KeepAlive(legacy.CullFaces());
+	});
+
+	const double columnTime = Benchmarking::Measure([&]()
+	{
+		chunk.CullFaces();
+		Benchmarking::KeepAlive(chunk.faceColumns[0][GetColumnIndex(32, 32)]);
+	});
+
+	// Deriving the columns from the block types is part of every load and generation
+	const double rebuildTime = Benchmarking::Measure([&]()
+	{
+		chunk.RebuildColumns();
+		chunk.CullFaces();
+		Benchmarking::KeepAlive(chunk.faceColumns[0][GetColumnIndex(32, 32)]);
+	});
+
+	char metric[64];
+	snprintf(metric, sizeof(metric), "%s, per-voxel culling", name);
+	Benchmarking::Report(metric, legacyTime / 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, column culling", name);
+	Benchmarking::Report(metric, columnTime / 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, columns and culling", name);
+	Benchmarking::Report(metric, rebuildTime / 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, column culling speedup", name);
+	Benchmarking::Report(metric, legacyTime / columnTime, "x");
+}
+
+UNTITLED_BENCHMARK(ChunkCulling)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	BenchmarkCulling("Hills", *chunk);
+	ChunkFixtures::FillRandom(*chunk, 1, 0.4f, 0.2f);
+	BenchmarkCulling("Random", *chunk);
+	ChunkFixtures::Fill(*chunk, [](int, int, int) { return FillType::Solid; });
+	BenchmarkCulling("Solid", *chunk);
+}
+
+// Columns of two chunks across the world, the surface runs through the upper layer and the lower layer is mostly solid
+constexpr XMINT3 NEIGHBOR_CULLING_WORLD { 16, 2, 16 };
+
+static uint32_t CountGreedyTriangles(eastl::span<const eastl::unique_ptr<Chunk>> chunks)
+{
+	uint32_t numTriangles = 0;
+	for (const auto& chunk : chunks)
+	{
+		ChunkMesher::GenerateMesh(*chunk, MeshingMode::Greedy, 0);
+		for (const MeshSection& section : chunk->mesh.sections)
+		{
+			numTriangles += section.quadCount * 2;
+		}
+	}
+	return numTriangles;
+}
+
+static uint32_t CountNaiveTriangles(eastl::span<const eastl::unique_ptr<Chunk>> chunks)
+{
+	uint32_t numTriangles = 0;
+	for (const auto& chunk : chunks)
+	{
+		numTriangles += chunk->CountVisibleFaces() * 2;
+	}
+	return numTriangles;
+}
+
+UNTITLED_BENCHMARK(NeighborCulling)
+{
+	// Hills continuing across the chunk borders, the chunks are culled against empty neighbors at first
+	eastl::vector<eastl::unique_ptr<Chunk>> chunks;
+	for (int z = 0; z < NEIGHBOR_CULLING_WORLD.z; ++z)
+	{
+		for (int y = 0; y < NEIGHBOR_CULLING_WORLD.y; ++y)
+		{
+			for (int x = 0; x < NEIGHBOR_CULLING_WORLD.x; ++x)
+			{
+				const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+				const XMINT3 position { x * width, (y - 1) * width, z * width };
+				auto& chunk = chunks.emplace_back(eastl::make_unique<Chunk>(position, chunks.size()));
+				ChunkFixtures::FillWorldHills(*chunk);
+			}
+		}
+	}
+	const uint32_t naiveWithout = CountNaiveTriangles(chunks);
+	const uint32_t greedyWithout = CountGreedyTriangles(chunks);
+
+	// Every chunk takes the border slabs of its neighbors, like ChunkManager::PullNeighborBorders
+	const auto GetChunk = [&](int x, int y, int z) -> Chunk*
+	{
+		if (x < 0 || y < 0 || z < 0 || x >= NEIGHBOR_CULLING_WORLD.x || y >= NEIGHBOR_CULLING_WORLD.y || z >= NEIGHBOR_CULLING_WORLD.z) return nullptr;
+		return chunks[x + NEIGHBOR_CULLING_WORLD.x * (y + NEIGHBOR_CULLING_WORLD.y * z)].get();
+	};
+	const XMINT3 offsets[NUM_FACE_DIRECTIONS] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 } };
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> slab;
+	for (int z = 0; z < NEIGHBOR_CULLING_WORLD.z; ++z)
+	{
+		for (int y = 0; y < NEIGHBOR_CULLING_WORLD.y; ++y)
+		{
+			for (int x = 0; x < NEIGHBOR_CULLING_WORLD.x; ++x)
+			{
+				for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+				{
+					const XMINT3 offset = offsets[GetFaceIndex(static_cast<VisibleFaces>(face))];
+					const Chunk* neighbor = GetChunk(x + offset.x, y + offset.y, z + offset.z);
+					if (!neighbor) continue;
+
+					neighbor->GetBorderSlab(GetOppositeFace(static_cast<VisibleFaces>(face)), slab);
+					GetChunk(x, y, z)->SetNeighborSlab(static_cast<VisibleFaces>(face), slab);
+				}
+			}
+		}
+	}
+	const uint32_t naiveWith = CountNaiveTriangles(chunks);
+	const uint32_t greedyWith = CountGreedyTriangles(chunks);
+
+	Benchmarking::Report("Naive, without neighbor borders", naiveWithout, "triangles");
+	Benchmarking::Report("Naive, with neighbor borders", naiveWith, "triangles");
+	Benchmarking::Report("Naive, reduction", static_cast<double>(naiveWithout) / naiveWith, "x");
+	Benchmarking::Report("Greedy, without neighbor borders", greedyWithout, "triangles");
+	Benchmarking::Report("Greedy, with neighbor borders", greedyWith, "triangles");
+	Benchmarking::Report("Greedy, reduction", static_cast<double>(greedyWithout) / greedyWith, "x");
+}
@@ -0,0 +1,92 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Core/JobSystem.h"
+#include "Game/ChunkStreamer.h"
+
+using namespace DirectX;
+
+// Surface chunks within this many chunks of a camera at the origin, every chunk is meshed at the LOD of its ring
+constexpr int LOD_WORLD_RADIUS = 16;
+constexpr XMFLOAT3A LOD_CAMERA_POSITION { 32.0f, 48.0f, 32.0f };
+
+// LOD the streamer picks for a chunk that isn't meshed at any level yet, see ChunkStreamer::SelectLOD
+static uint32_t GetRingLOD(XMINT3 position)
+{
+	auto GetAxisDistance = [](float camera, int start)
+	{
+		return eastl::max(eastl::max(start - camera, camera - (start + static_cast<int>(VOXEL_CHUNK_WIDTH))), 0.0f);
+	};
+	const float dx = GetAxisDistance(LOD_CAMERA_POSITION.x, position.x);
+	const float dy = GetAxisDistance(LOD_CAMERA_POSITION.y, position.y);
+	const float dz = GetAxisDistance(LOD_CAMERA_POSITION.z, position.z);
+	const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	uint32_t lod = 0;
+	for (uint32_t level = 0; level < OccupancyPyramid::NUM_LEVELS; ++level)
+	{
+		if (distance > STREAMING_LOD_DISTANCES[level]) lod = level + 1;
+	}
+	return lod;
+}
+
+UNTITLED_BENCHMARK(LODRings)
+{
+	JobSystem jobSystem;
+	ChunkManager chunkManager(nullptr, &jobSystem);
+
+	// Everything is meshed at full resolution first, the rings are then switched to their LOD one after another
+	eastl::array<eastl::vector<XMINT3>, OccupancyPyramid::NUM_LEVELS + 1> rings;
+	for (int z = -LOD_WORLD_RADIUS; z <= LOD_WORLD_RADIUS; ++z)
+	{
+		for (int x = -LOD_WORLD_RADIUS; x <= LOD_WORLD_RADIUS; ++x)
+		{
+			if (x * x + z * z > LOD_WORLD_RADIUS * LOD_WORLD_RADIUS) continue;
+
+			const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+			const XMINT3 position { x * width, 0, z * width };
+			rings[GetRingLOD(position)].push_back(position);
+			chunkManager.AddChunk(position);
+		}
+	}
+	jobSystem.WaitForAll();
+	chunkManager.UploadGeneratedChunks();
+	chunkManager.RemeshDirtyChunks(eastl::numeric_limits<uint32_t>::max());
+
+	const size_t fullTriangles = chunkManager.GetStats().numTriangles;
+	eastl::array<size_t, OccupancyPyramid::NUM_LEVELS + 1> ringFullTriangles {};
+	for (uint32_t lod = 0; lod <= OccupancyPyramid::NUM_LEVELS; ++lod)
+	{
+		for (const XMINT3& position : rings[lod])
+		{
+			for (const MeshSection& section : chunkManager.GetChunkAt(position)->mesh.sections)
+			{
+				ringFullTriangles[lod] += section.quadCount * 2;
+			}
+		}
+	}
+
+	// Coarser rings also change the border faces of the finer rings next to them
+	for (uint32_t lod = 1; lod <= OccupancyPyramid::NUM_LEVELS; ++lod)
+	{
+		for (const XMINT3& position : rings[lod])
+		{
+			chunkManager.SetChunkLOD(position, lod);
+		}
+	}
+	chunkManager.RemeshDirtyChunks(eastl::numeric_limits<uint32_t>::max());
+
+	const ChunkStats stats = chunkManager.GetStats();
+	char metric[64];
+	for (uint32_t lod = 0; lod <= OccupancyPyramid::NUM_LEVELS; ++lod)
+	{
+		snprintf(metric, sizeof(metric), "LOD %u ring, chunks", lod);
+		Benchmarking::Report(metric, stats.numChunksPerLOD[lod], "chunks");
+		snprintf(metric, sizeof(metric), "LOD %u ring, triangles", lod);
+		Benchmarking::Report(metric, static_cast<double>(stats.numTrianglesPerLOD[lod]), "triangles");
+		snprintf(metric, sizeof(metric), "LOD %u ring, triangles at LOD 0", lod);
+		Benchmarking::Report(metric, static_cast<double>(ringFullTriangles[lod]), "triangles");
+	}
+	Benchmarking::Report("All rings, triangles", static_cast<double>(stats.numTriangles), "triangles");
+	Benchmarking::Report("All rings, triangles at LOD 0", static_cast<double>(fullTriangles), "triangles");
+	Benchmarking::Report("Triangle reduction", static_cast<double>(fullTriangles) / stats.numTriangles, "x");
+}
@@ -0,0 +1,130 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/Random.h"
+#include "Game/ChunkMap.h"
+
+using namespace DirectX;
+
+// 100,000 resident chunks, a world of 100 x 10 x 100 chunks centered on the origin
+constexpr int MAP_WIDTH = 100;
+constexpr int MAP_HEIGHT = 10;
+constexpr uint32_t MAP_NUM_CHUNKS = MAP_WIDTH * MAP_HEIGHT * MAP_WIDTH;
+constexpr uint32_t MAP_NUM_LOOKUPS = 1 << 20;
+
+static XMINT3 GetMapCoordinate(uint32_t i)
+{
+	return XMINT3 { static_cast<int>(i % MAP_WIDTH) - MAP_WIDTH / 2, static_cast<int>((i / MAP_WIDTH) % MAP_HEIGHT) - MAP_HEIGHT / 2,
+		static_cast<int>(i / (MAP_WIDTH * MAP_HEIGHT)) - MAP_WIDTH / 2 };
+}
+
+struct CoordinateHash
+{
+	size_t operator()(XMINT3 coordinate) const
+	{
+		return static_cast<size_t>(coordinate.x) * 73856093 ^ static_cast<size_t>(coordinate.y) * 19349663 ^ static_cast<size_t>(coordinate.z) * 83492791;
+	}
+};
+
+struct CoordinateEqual
+{
+	bool operator()(XMINT3 a, XMINT3 b) const
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+};
+
+UNTITLED_BENCHMARK(ChunkMapLookup)
+{
+	ChunkMap map;
+	eastl::hash_map<XMINT3, uint32_t, CoordinateHash, CoordinateEqual> hashMap;
+	for (uint32_t i = 0; i < MAP_NUM_CHUNKS; ++i)
+	{
+		map.Insert(GetMapCoordinate(i), i);
+		hashMap[GetMapCoordinate(i)] = i;
+	}
+
+	// Lookups in random order, so the probes don't benefit from the insertion order. Voxels are
+	// spread over the whole world, misses lie just outside of it.
+	Random random(1);
+	eastl::vector<XMINT3> hits(MAP_NUM_LOOKUPS);
+	eastl::vector<XMINT3> misses(MAP_NUM_LOOKUPS);
+	eastl::vector<XMINT3> voxels(MAP_NUM_LOOKUPS);
+	for (uint32_t i = 0; i < MAP_NUM_LOOKUPS; ++i)
+	{
+		hits[i] = GetMapCoordinate(random.Below(MAP_NUM_CHUNKS));
+		misses[i] = XMINT3 { hits[i].x, hits[i].y + MAP_HEIGHT, hits[i].z };
+		voxels[i] = XMINT3 { hits[i].x * static_cast<int>(VOXEL_CHUNK_WIDTH) + static_cast<int>(random.Below(VOXEL_CHUNK_WIDTH)),
+			hits[i].y * static_cast<int>(VOXEL_CHUNK_WIDTH) + static_cast<int>(random.Below(VOXEL_CHUNK_WIDTH)),
+			hits[i].z * static_cast<int>(VOXEL_CHUNK_WIDTH) + static_cast<int>(random.Below(VOXEL_CHUNK_WIDTH)) };
+	}
+
+	const double hitTime = Benchmarking::Measure([&]()
+	{
+		uint64_t sum = 0;
+		for (XMINT3 coordinate : hits)
+		{
+			sum += map.Find(coordinate);
+		}
+		Benchmarking::KeepAlive(sum);
+	});
+
+	const double missTime = Benchmarking::Measure([&]()
+	{
+		uint64_t sum = 0;
+		for (XMINT3 coordinate : misses)
+		{
+			sum += map.Find(coordinate);
+		}
+		Benchmarking::KeepAlive(sum);
+	});
+
+	const double voxelTime = Benchmarking::Measure([&]()
+	{
+		uint64_t sum = 0;
+		for (XMINT3 voxel : voxels)
+		{
+			sum += map.Find(GetChunkCoordinate(voxel));
+		}
+		Benchmarking::KeepAlive(sum);
+	});
+
+	const double neighborTime = Benchmarking::Measure([&]()
+	{
+		uint64_t sum = 0;
+		eastl::array<uint32_t, NUM_FACE_DIRECTIONS> neighbors;
+		for (XMINT3 coordinate : hits)
+		{
+			map.FindNeighbors(coordinate, neighbors);
+			sum += neighbors[0] + neighbors[5];
+		}
+		Benchmarking::KeepAlive(sum);
+	});
+
+	const double hashMapTime = Benchmarking::Measure([&]()
+	{
+		uint64_t sum = 0;
+		for (XMINT3 coordinate : hits)
+		{
+			sum += hashMap.find(coordinate)->second;
+		}
+		Benchmarking::KeepAlive(sum);
+	});
+
+	// Chunks streaming in and out, every removal is followed by an insertion somewhere else
+	const double churnTime = Benchmarking::Measure([&]()
+	{
+		for (uint32_t i = 0; i < MAP_NUM_LOOKUPS; ++i)
+		{
+			map.Remove(hits[i]);
+			map.Insert(hits[i], i);
+		}
+		Benchmarking::KeepAlive(map.GetSize());
+	});
+
+	Benchmarking::Report("Hit", hitTime / MAP_NUM_LOOKUPS, "ns/lookup");
+	Benchmarking::Report("Miss", missTime / MAP_NUM_LOOKUPS, "ns/lookup");
+	Benchmarking::Report("World voxel to chunk", voxelTime / MAP_NUM_LOOKUPS, "ns/lookup");
+	Benchmarking::Report("Six neighbors", neighborTime / MAP_NUM_LOOKUPS, "ns/chunk");
+	Benchmarking::Report("eastl::hash_map hit", hashMapTime / MAP_NUM_LOOKUPS, "ns/lookup");
+	Benchmarking::Report("Remove and insert", churnTime / MAP_NUM_LOOKUPS, "ns/pair");
+}
@@ -0,0 +1,142 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/LegacyChunk.h"
+#include "Game/ChunkMesher.h"
+
+using namespace DirectX;
+
+static uint32_t CountQuads(const Chunk& chunk)
+{
+	uint32_t numQuads = 0;
+	for (const MeshSection& section : chunk.mesh.sections)
+	{
+		numQuads += section.quadCount;
+	}
+	return numQuads;
+}
+
+static void BenchmarkMeshing(const char* name, Chunk& chunk)
+{
+	double times[2];
+	uint32_t quads[2];
+	const MeshingMode modes[2] = { MeshingMode::Naive, MeshingMode::Greedy };
+	for (int i = 0; i < 2; ++i)
+	{
+		times[i] = Benchmarking::Measure([&]()
+		{
+			ChunkMesher::GenerateMesh(chunk, modes[i], 0);
+			Benchmarking::KeepAlive(chunk.mesh.vertices.size());
+		});
+		quads[i] = CountQuads(chunk);
+	}
+
+	// The naive mesher emits a quad per visible face, the greedy mesher merges them
+	UNTITLED_ASSERT(quads[0] == chunk.CountVisibleFaces() && quads[1] <= quads[0]);
+
+	char metric[64];
+	const char* const modeNames[2] = { "naive", "greedy" };
+	for (int i = 0; i < 2; ++i)
+	{
+		snprintf(metric, sizeof(metric), "%s, %s triangles", name, modeNames[i]);
+		Benchmarking::Report(metric, quads[i] * 2.0, "triangles");
+		snprintf(metric, sizeof(metric), "%s, %s vertices", name, modeNames[i]);
+		Benchmarking::Report(metric, quads[i] * 4.0, "vertices");
+		snprintf(metric, sizeof(metric), "%s, %s meshing", name, modeNames[i]);
+		Benchmarking::Report(metric, times[i] / 1000.0, "us");
+	}
+	snprintf(metric, sizeof(metric), "%s, greedy triangle reduction", name);
+	Benchmarking::Report(metric, static_cast<double>(quads[0]) / eastl::max(quads[1], 1u), "x");
+}
+
+UNTITLED_BENCHMARK(ChunkMeshing)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	BenchmarkMeshing("Hills", *chunk);
+	ChunkFixtures::FillRandom(*chunk, 1, 0.4f, 0.2f);
+	BenchmarkMeshing("Random", *chunk);
+	ChunkFixtures::Fill(*chunk, [](int, int y, int) { return y < 32 ? FillType::Solid : FillType::Empty; });
+	BenchmarkMeshing("Flat", *chunk);
+}
+
+UNTITLED_BENCHMARK(MeshVertices)
+{
+	// The naive mesh of a random chunk is about the largest a single chunk produces
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillRandom(*chunk, 1, 0.4f, 0.2f);
+	ChunkMesher::GenerateMesh(*chunk, MeshingMode::Naive, 0);
+	const size_t numVertices = chunk->mesh.vertices.size();
+
+	// Both layouts are written from the same decoded vertices, like the meshers emit them
+	eastl::vector<XMINT3> positions(numVertices);
+	eastl::vector<VisibleFaces> faces(numVertices);
+	eastl::vector<FillType> types(numVertices);
+	for (size_t i = 0; i < numVertices; ++i)
+	{
+		const Vertex& vertex = chunk->mesh.vertices[i];
+		positions[i] = GetVertexPosition(vertex);
+		faces[i] = static_cast<VisibleFaces>(1u << GetVertexFaceIndex(vertex));
+		types[i] = GetVertexBlockType(vertex);
+	}
+
+	eastl::vector<Vertex> packed(numVertices);
+	eastl::vector<LegacyVertex> legacy(numVertices);
+	const double packedWrite = Benchmarking::Measure([&]()
+	{
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			packed[i] = PackVertex(positions[i], faces[i], types[i]);
+		}
+		Benchmarking::KeepAlive(packed[numVertices / 2].positionXY);
+	});
+
+	const double legacyWrite = Benchmarking::Measure([&]()
+	{
+		for (size_t i = 0; i < numVertices; ++i)
+		{
+			const XMINT3 position = positions[i];
+			legacy[i] = LegacyVertex {
+				XMVectorSet(static_cast<float>(position.x), static_cast<float>(position.y), static_cast<float>(position.z), 1.0f),
+				LEGACY_FACE_NORMALS[GetFaceIndex(faces[i])]
+			};
+		}
+		Benchmarking::KeepAlive(static_cast<uint64_t>(XMVectorGetX(legacy[numVertices / 2].position)));
+	});
+
+	// Reading the positions back is what the BLAS builds and the hit shaders do with every vertex
+	const double packedRead = Benchmarking::Measure([&]()
+	{
+		int64_t sum = 0;
+		for (const Vertex& vertex : packed)
+		{
+			const XMINT3 position = GetVertexPosition(vertex);
+			sum += position.x + position.y + position.z;
+		}
+		Benchmarking::KeepAlive(static_cast<uint64_t>(sum));
+	});
+
+	const double legacyRead = Benchmarking::Measure([&]()
+	{
+		XMVECTOR sum = XMVectorZero();
+		for (const LegacyVertex& vertex : legacy)
+		{
+			sum = XMVectorAdd(sum, vertex.position);
+		}
+		Benchmarking::KeepAlive(static_cast<uint64_t>(XMVectorGetX(sum) + XMVectorGetY(sum) + XMVectorGetZ(sum)));
+	});
+
+	Benchmarking::Report("Packed vertex", sizeof(Vertex), "bytes");
+	Benchmarking::Report("Legacy vertex", sizeof(LegacyVertex), "bytes");
+	Benchmarking::Report("Random chunk mesh, packed", static_cast<double>(numVertices * sizeof(Vertex)), "bytes");
+	Benchmarking::Report("Random chunk mesh, legacy", static_cast<double>(numVertices * sizeof(LegacyVertex)), "bytes");
+
+	const auto report = [numVertices](const char* metric, double nanoseconds)
+	{
+		Benchmarking::Report(metric, numVertices / nanoseconds * 1000.0, "Mvertices/s");
+	};
+	report("Packed write", packedWrite);
+	report("Legacy write", legacyWrite);
+	report("Packed read", packedRead);
+	report("Legacy read", legacyRead);
+}
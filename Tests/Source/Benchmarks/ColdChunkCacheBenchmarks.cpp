@@ -0,0 +1,91 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Core/JobSystem.h"
+#include "Game/ChunkManager.h"
+
+using namespace DirectX;
+
+// Chunks leaving and coming back per run, the middle layer holds the surface and the layers around it are mostly uniform
+constexpr XMINT3 COLD_BLOCK { 12, 3, 12 };
+constexpr uint32_t COLD_BLOCK_CHUNKS = COLD_BLOCK.x * COLD_BLOCK.y * COLD_BLOCK.z;
+
+template<typename Function>
+static void ForEachColdBlockChunk(Function&& function)
+{
+	for (int z = 0; z < COLD_BLOCK.z; ++z)
+	{
+		for (int y = 0; y < COLD_BLOCK.y; ++y)
+		{
+			for (int x = 0; x < COLD_BLOCK.x; ++x)
+			{
+				const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+				function(XMINT3 { x * width, (y - 1) * width, z * width });
+			}
+		}
+	}
+}
+
+static void LoadColdBlock(ChunkManager& chunkManager, JobSystem& jobSystem)
+{
+	ForEachColdBlockChunk([&](XMINT3 position) { chunkManager.AddChunk(position); });
+	jobSystem.WaitForAll();
+	chunkManager.UploadGeneratedChunks();
+}
+
+static void BenchmarkColdChunks(const char* name, JobSystem& jobSystem, TerrainMode terrainMode)
+{
+	// Regenerating the block with a new chunk manager every run, nothing is loaded or cached
+	const double generationTime = Benchmarking::Measure([&]()
+	{
+		ChunkManager chunkManager(nullptr, &jobSystem, terrainMode);
+		LoadColdBlock(chunkManager, jobSystem);
+		Benchmarking::KeepAlive(chunkManager.GetStats().numTriangles);
+	}, 3, 1.0);
+
+	// Every run the block leaves the range, which compresses it into the cold cache, and comes back
+	ChunkManager chunkManager(nullptr, &jobSystem, terrainMode);
+	LoadColdBlock(chunkManager, jobSystem);
+	const ChunkStats generatedStats = chunkManager.GetStats();
+	uint32_t numColdRuns = 0;
+	const double coldTime = Benchmarking::Measure([&]()
+	{
+		numColdRuns++;
+		ForEachColdBlockChunk([&](XMINT3 position) { chunkManager.RemoveChunk(position); });
+		LoadColdBlock(chunkManager, jobSystem);
+		Benchmarking::KeepAlive(chunkManager.GetStats().numTriangles);
+	}, 3, 1.0);
+	const ChunkStats coldStats = chunkManager.GetStats();
+	UNTITLED_ASSERT(coldStats.numChunks == COLD_BLOCK_CHUNKS && coldStats.coldHitRate > 0.0f);
+
+	// Worker time of the chunks restored from the cold cache, averaged over the runs after the block was generated
+	const double coldWorkerMs = (static_cast<double>(coldStats.averageGenerationMs) * (numColdRuns + 1) - generatedStats.averageGenerationMs) / numColdRuns;
+
+	char metric[64];
+	snprintf(metric, sizeof(metric), "%s, regenerated", name);
+	Benchmarking::Report(metric, COLD_BLOCK_CHUNKS / generationTime * 1e9, "chunks/s");
+	snprintf(metric, sizeof(metric), "%s, from cold cache", name);
+	Benchmarking::Report(metric, COLD_BLOCK_CHUNKS / coldTime * 1e9, "chunks/s");
+	snprintf(metric, sizeof(metric), "%s, speedup", name);
+	Benchmarking::Report(metric, generationTime / coldTime, "x");
+	snprintf(metric, sizeof(metric), "%s, regenerate and mesh", name);
+	Benchmarking::Report(metric, generatedStats.averageGenerationMs * 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, decompress and mesh", name);
+	Benchmarking::Report(metric, coldWorkerMs * 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, decompress", name);
+	Benchmarking::Report(metric, coldStats.averageDecompressUs, "us");
+	// Both paths mesh the same voxels, so what's left of the difference is the cost of generating them
+	snprintf(metric, sizeof(metric), "%s, regenerate", name);
+	Benchmarking::Report(metric, (generatedStats.averageGenerationMs - coldWorkerMs) * 1000.0 + coldStats.averageDecompressUs, "us");
+	// The misses are the chunks of the first generation
+	snprintf(metric, sizeof(metric), "%s, hit rate", name);
+	Benchmarking::Report(metric, coldStats.coldHitRate * 100.0, "%");
+	snprintf(metric, sizeof(metric), "%s, compression ratio", name);
+	Benchmarking::Report(metric, coldStats.coldCompressionRatio, "x");
+}
+
+UNTITLED_BENCHMARK(ColdChunkCache)
+{
+	JobSystem jobSystem;
+	BenchmarkColdChunks("Heightmap", jobSystem, TerrainMode::Heightmap);
+	BenchmarkColdChunks("Density", jobSystem, TerrainMode::Density);
+}
@@ -0,0 +1,84 @@
+#include "PCH.h"
+#include "Core/DirtyRanges.h"
+#include "Framework/Benchmark.h"
+#include "Framework/Random.h"
+#include "Graphics/Raytracing/AccelerationStructureManager.h"
+
+// The instance descriptors of the TLAS at their maximum count, copied into one of the per-frame copies of the
+// upload buffer like BuildTLAS does. Copying everything is what every frame did before the ranges were tracked.
+UNTITLED_BENCHMARK(DirtyInstanceUpload)
+{
+	constexpr uint32_t numInstances = static_cast<uint32_t>(MAX_NUM_TOTAL_BLAS_INSTANCES);
+	eastl::vector<D3D12_RAYTRACING_INSTANCE_DESC> descriptors(numInstances);
+	eastl::vector<D3D12_RAYTRACING_INSTANCE_DESC> mapped(numInstances);
+	auto ranges = eastl::make_unique<DirtyRanges<MAX_NUM_TOTAL_BLAS_INSTANCES, MAX_FRAMES_IN_FLIGHT, MAX_INSTANCE_UPLOAD_GAP>>();
+
+	const double fullCopy = Benchmarking::Measure([&]()
+	{
+		memcpy(mapped.data(), descriptors.data(), numInstances * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+		Benchmarking::KeepAlive(reinterpret_cast<const uint8_t*>(mapped.data())[numInstances / 2 * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)]);
+	});
+	Benchmarking::Report("Full copy", fullCopy / 1000.0, "us");
+	Benchmarking::Report("Full copy size", static_cast<double>(numInstances * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)), "bytes");
+
+	// Frames mark the instances that changed, then the copy of the frame is brought up to date. All copies are
+	// consumed in turn, so every frame copies the changes of the last frames in flight.
+	const auto measure = [&](const char* name, const eastl::vector<uint32_t>& changed)
+	{
+		uint64_t copiedBytes = 0;
+		uint32_t numRuns = 0;
+		uint32_t copyIndex = 0;
+		const double nanoseconds = Benchmarking::Measure([&]()
+		{
+			copiedBytes = 0;
+			numRuns = 0;
+			for (uint32_t index : changed)
+			{
+				ranges->Mark(index);
+			}
+			ranges->Consume(copyIndex, [&](uint32_t first, uint32_t count)
+			{
+				memcpy(mapped.data() + first, descriptors.data() + first, count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+				copiedBytes += count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC);
+				numRuns++;
+			});
+			copyIndex = (copyIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+		}, 64);
+
+		char metric[64];
+		Benchmarking::Report(name, nanoseconds / 1000.0, "us");
+		snprintf(metric, sizeof(metric), "%s speedup", name);
+		Benchmarking::Report(metric, fullCopy / nanoseconds, "x");
+		snprintf(metric, sizeof(metric), "%s copied", name);
+		Benchmarking::Report(metric, static_cast<double>(copiedBytes), "bytes");
+		snprintf(metric, sizeof(metric), "%s runs", name);
+		Benchmarking::Report(metric, numRuns, "runs");
+	};
+
+	Random random(23);
+	const auto randomInstances = [&](uint32_t count)
+	{
+		eastl::vector<uint32_t> indices(count);
+		for (uint32_t& index : indices)
+		{
+			index = random.Below(numInstances);
+		}
+		return indices;
+	};
+
+	// A camera standing still, a brush stroke editing a few chunks, chunks streaming in all over the range,
+	// a block of newly added instances, and every transform changing
+	eastl::vector<uint32_t> block;
+	eastl::vector<uint32_t> all;
+	for (uint32_t i = 0; i < numInstances; ++i)
+	{
+		if (i >= numInstances / 2 && i < numInstances / 2 + 512) block.push_back(i);
+		all.push_back(i);
+	}
+
+	measure("Idle", {});
+	measure("Edit of 8", randomInstances(8));
+	measure("Scattered 1%", randomInstances(numInstances / 100));
+	measure("Block of 512", block);
+	measure("All changed", all);
+}
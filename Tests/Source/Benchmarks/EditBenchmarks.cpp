@@ -0,0 +1,135 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/Random.h"
+#include "Core/JobSystem.h"
+#include "Game/ChunkManager.h"
+
+using namespace DirectX;
+
+// Chunks around the edits, far from the chunks the other benchmarks generate
+constexpr int EDIT_CHUNK_WIDTH = static_cast<int>(VOXEL_CHUNK_WIDTH);
+constexpr XMINT3 EDIT_WORLD_ORIGIN { 64 * EDIT_CHUNK_WIDTH, -EDIT_CHUNK_WIDTH, 64 * EDIT_CHUNK_WIDTH };
+constexpr XMINT3 EDIT_WORLD_CHUNKS { 8, 3, 8 };
+constexpr uint32_t EDITS_PER_SCENARIO = 200;
+
+// Edited chunks are saved when the chunk manager is destroyed, their region files are removed
+// so every run starts out from the generated terrain
+static void RemoveEditRegions()
+{
+	const XMINT3 first = GetRegionCoordinate(GetChunkCoordinate(EDIT_WORLD_ORIGIN));
+	const XMINT3 last = GetRegionCoordinate(GetChunkCoordinate({ EDIT_WORLD_ORIGIN.x + EDIT_WORLD_CHUNKS.x * EDIT_CHUNK_WIDTH - 1,
+		EDIT_WORLD_ORIGIN.y + EDIT_WORLD_CHUNKS.y * EDIT_CHUNK_WIDTH - 1, EDIT_WORLD_ORIGIN.z + EDIT_WORLD_CHUNKS.z * EDIT_CHUNK_WIDTH - 1 }));
+	for (int z = first.z; z <= last.z; ++z)
+	{
+		for (int y = first.y; y <= last.y; ++y)
+		{
+			for (int x = first.x; x <= last.x; ++x)
+			{
+				remove(GetRegionPath({ x, y, z }).c_str());
+			}
+		}
+	}
+}
+
+// Generates the chunks around the edits headless and waits until they are all resident with their borders culled
+static void LoadEditWorld(ChunkManager& chunkManager, JobSystem& jobSystem)
+{
+	RemoveEditRegions();
+	for (int z = 0; z < EDIT_WORLD_CHUNKS.z; ++z)
+	{
+		for (int y = 0; y < EDIT_WORLD_CHUNKS.y; ++y)
+		{
+			for (int x = 0; x < EDIT_WORLD_CHUNKS.x; ++x)
+			{
+				chunkManager.AddChunk({ EDIT_WORLD_ORIGIN.x + x * EDIT_CHUNK_WIDTH, EDIT_WORLD_ORIGIN.y + y * EDIT_CHUNK_WIDTH,
+					EDIT_WORLD_ORIGIN.z + z * EDIT_CHUNK_WIDTH });
+			}
+		}
+	}
+	jobSystem.WaitForAll();
+	chunkManager.UploadGeneratedChunks();
+	chunkManager.RemeshDirtyChunks(eastl::numeric_limits<uint32_t>::max());
+	chunkManager.RebuildUpdatedChunks();
+}
+
+// Random voxel of the surface band of the heightmap terrain, away from the sides of the edited world
+static XMINT3 GetRandomEditVoxel(Random& random, int margin)
+{
+	const int width = EDIT_WORLD_CHUNKS.x * EDIT_CHUNK_WIDTH - 2 * margin;
+	const int depth = EDIT_WORLD_CHUNKS.z * EDIT_CHUNK_WIDTH - 2 * margin;
+	return XMINT3 {
+		EDIT_WORLD_ORIGIN.x + margin + static_cast<int>(random.Below(width)),
+		static_cast<int>(random.Below(EDIT_CHUNK_WIDTH)),
+		EDIT_WORLD_ORIGIN.z + margin + static_cast<int>(random.Below(depth))
+	};
+}
+
+// Applies one edit per frame like the game does and reports how long the edits took to become
+// visible and how many bytes of vertex data each of them uploaded
+template<typename MakeBrush>
+static void BenchmarkEdits(const char* name, MakeBrush&& makeBrush)
+{
+	JobSystem jobSystem;
+	ChunkManager chunkManager(nullptr, &jobSystem);
+	LoadEditWorld(chunkManager, jobSystem);
+	const ChunkStats initialStats = chunkManager.GetStats();
+
+	Random random(7);
+	for (uint32_t i = 0; i < EDITS_PER_SCENARIO; ++i)
+	{
+		chunkManager.QueueEdit(makeBrush(random, i));
+		chunkManager.ApplyEdits();
+		chunkManager.RemeshDirtyChunks();
+		chunkManager.RebuildUpdatedChunks();
+	}
+
+	const ChunkStats stats = chunkManager.GetStats();
+	char metric[64];
+	snprintf(metric, sizeof(metric), "%s, latency average", name);
+	Benchmarking::Report(metric, stats.averageEditLatencyMs, "ms");
+	snprintf(metric, sizeof(metric), "%s, latency max", name);
+	Benchmarking::Report(metric, stats.maxEditLatencyMs, "ms");
+	snprintf(metric, sizeof(metric), "%s, upload per edit", name);
+	Benchmarking::Report(metric, static_cast<double>(stats.averageEditUploadBytes), "bytes");
+	snprintf(metric, sizeof(metric), "%s, voxels per edit", name);
+	Benchmarking::Report(metric, static_cast<double>(stats.numEditedVoxels) / stats.numEdits, "voxels");
+	snprintf(metric, sizeof(metric), "%s, section remeshes", name);
+	Benchmarking::Report(metric, stats.numSectionRemeshes - initialStats.numSectionRemeshes, "sections");
+	snprintf(metric, sizeof(metric), "%s, full remeshes", name);
+	Benchmarking::Report(metric, stats.numFullRemeshes - initialStats.numFullRemeshes, "chunks");
+}
+
+UNTITLED_BENCHMARK(Edits)
+{
+	// Destroying and placing single voxels, like clicking does
+	BenchmarkEdits("Single voxels", [](Random& random, uint32_t i)
+	{
+		const XMINT3 voxel = GetRandomEditVoxel(random, 0);
+		return VoxelBrush { BrushShape::Box, voxel, voxel, 0, (i & 1) ? FillType::Solid : FillType::Empty };
+	});
+
+	// Small spheres often cross a section or chunk border
+	BenchmarkEdits("Spheres of radius 4", [](Random& random, uint32_t i)
+	{
+		const XMINT3 voxel = GetRandomEditVoxel(random, 4);
+		return VoxelBrush { BrushShape::Sphere, voxel, voxel, 4, (i & 1) ? FillType::Solid : FillType::Empty };
+	});
+}
+
+UNTITLED_BENCHMARK(SphereCarve)
+{
+	// Spheres of about 10k voxels carved out below the surface on a grid, so every voxel they cover is still solid
+	constexpr int radius = 13;
+	constexpr int spacing = 32;
+	constexpr int spheresPerRow = (EDIT_WORLD_CHUNKS.x * EDIT_CHUNK_WIDTH - spacing) / spacing;
+	static_assert(2 * radius < spacing && EDITS_PER_SCENARIO <= spheresPerRow * spheresPerRow);
+	BenchmarkEdits("Spheres of radius 13", [](Random&, uint32_t i)
+	{
+		const XMINT3 voxel {
+			EDIT_WORLD_ORIGIN.x + spacing / 2 + static_cast<int>(i % spheresPerRow) * spacing,
+			-EDIT_CHUNK_WIDTH / 2,
+			EDIT_WORLD_ORIGIN.z + spacing / 2 + static_cast<int>(i / spheresPerRow) * spacing
+		};
+		return VoxelBrush { BrushShape::Sphere, voxel, voxel, radius, FillType::Empty };
+	});
+}
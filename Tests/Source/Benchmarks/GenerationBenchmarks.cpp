@@ -0,0 +1,311 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Core/JobSystem.h"
+#include "Core/ScratchArena.h"
+#include "Game/ChunkManager.h"
+#include "Game/ChunkMesher.h"
+
+using namespace DirectX;
+
+// Chunks generated per run, the middle layer holds the surface and the layers around it are mostly uniform
+constexpr XMINT3 GENERATION_BLOCK { 12, 3, 12 };
+constexpr uint32_t GENERATION_BLOCK_CHUNKS = GENERATION_BLOCK.x * GENERATION_BLOCK.y * GENERATION_BLOCK.z;
+
+// Staging buffers the chunk manager shared between all meshing before the meshers wrote into scratch arenas,
+// sized for the largest mesh of a chunk with the 32 byte vertices of the time
+constexpr size_t LEGACY_STAGING_BYTES = 4'100'000 * 32 + 16'400'000 * sizeof(uint32_t);
+
+static void AddGenerationBlock(ChunkManager& chunkManager)
+{
+	for (int z = 0; z < GENERATION_BLOCK.z; ++z)
+	{
+		for (int y = 0; y < GENERATION_BLOCK.y; ++y)
+		{
+			for (int x = 0; x < GENERATION_BLOCK.x; ++x)
+			{
+				const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+				chunkManager.AddChunk({ x * width, (y - 1) * width, z * width });
+			}
+		}
+	}
+}
+
+// Generates and meshes the block of chunks from scratch with a new chunk manager, so nothing is loaded or cached.
+// Freeing the chunks again is part of every run, but small next to generating them.
+static double MeasureGeneration(JobSystem& jobSystem, TerrainMode terrainMode)
+{
+	return Benchmarking::Measure([&]()
+	{
+		ChunkManager chunkManager(nullptr, &jobSystem, terrainMode);
+		AddGenerationBlock(chunkManager);
+		jobSystem.WaitForAll();
+		chunkManager.UploadGeneratedChunks();
+		Benchmarking::KeepAlive(chunkManager.GetStats().numTriangles);
+	}, 3, 1.0);
+}
+
+UNTITLED_BENCHMARK(GenerationScaling)
+{
+	// The calling thread helps the workers while it waits for them, so every run has one thread more than workers
+	const uint32_t numThreads = eastl::max(std::thread::hardware_concurrency(), 2u);
+	double singleWorkerTime[2] = {};
+	for (uint32_t numWorkers = 1; numWorkers < numThreads; numWorkers = eastl::min(numWorkers * 2, numThreads - 1))
+	{
+		JobSystem jobSystem(numWorkers);
+		const TerrainMode terrainModes[2] = { TerrainMode::Heightmap, TerrainMode::Density };
+		const char* const terrainNames[2] = { "Heightmap", "Density" };
+		for (int i = 0; i < 2; ++i)
+		{
+			const double time = MeasureGeneration(jobSystem, terrainModes[i]);
+			if (numWorkers == 1) singleWorkerTime[i] = time;
+
+			char metric[64];
+			snprintf(metric, sizeof(metric), "%s, %u workers", terrainNames[i], numWorkers);
+			Benchmarking::Report(metric, GENERATION_BLOCK_CHUNKS / time * 1e9, "chunks/s");
+			snprintf(metric, sizeof(metric), "%s, %u workers speedup", terrainNames[i], numWorkers);
+			Benchmarking::Report(metric, singleWorkerTime[i] / time, "x");
+		}
+		if (numWorkers == numThreads - 1) break;
+	}
+}
+
+UNTITLED_BENCHMARK(ScratchMemory)
+{
+	const char* const modeNames[2] = { "naive", "greedy" };
+	for (int i = 0; i < 2; ++i)
+	{
+		// The arenas of the main thread may have grown in other benchmarks, it only picks up the finished chunks here
+		// while the workers of a new job system generate and mesh them
+		const size_t initialCapacity = ScratchArena::GetTotalCapacity();
+		JobSystem jobSystem;
+		ChunkManager chunkManager(nullptr, &jobSystem, TerrainMode::Density);
+		chunkManager.SetMeshingMode(i == 0 ? MeshingMode::Naive : MeshingMode::Greedy);
+		AddGenerationBlock(chunkManager);
+		while (chunkManager.GetNumGeneratingChunks() > 0)
+		{
+			chunkManager.UploadGeneratedChunks();
+			std::this_thread::yield();
+		}
+		const size_t capacity = ScratchArena::GetTotalCapacity() - initialCapacity;
+
+		char metric[64];
+		snprintf(metric, sizeof(metric), "Scratch arenas, %s, all workers", modeNames[i]);
+		Benchmarking::Report(metric, static_cast<double>(capacity), "bytes");
+		snprintf(metric, sizeof(metric), "Scratch arenas, %s, per worker", modeNames[i]);
+		Benchmarking::Report(metric, static_cast<double>(capacity) / jobSystem.GetNumWorkers(), "bytes");
+		snprintf(metric, sizeof(metric), "Scratch arenas, %s, reduction", modeNames[i]);
+		Benchmarking::Report(metric, static_cast<double>(LEGACY_STAGING_BYTES) / capacity, "x");
+	}
+	Benchmarking::Report("Legacy staging buffers", static_cast<double>(LEGACY_STAGING_BYTES), "bytes");
+}
+
+// Chunks of the density terrain generated per sampling, the surface runs through the middle layer
+constexpr XMINT3 DENSITY_BLOCK { 4, 3, 4 };
+constexpr uint32_t DENSITY_BLOCK_CHUNKS = DENSITY_BLOCK.x * DENSITY_BLOCK.y * DENSITY_BLOCK.z;
+
+static eastl::vector<XMINT3> GetDensityBlockPositions()
+{
+	const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+	eastl::vector<XMINT3> positions;
+	for (int z = 0; z < DENSITY_BLOCK.z; ++z)
+	{
+		for (int y = 0; y < DENSITY_BLOCK.y; ++y)
+		{
+			for (int x = 0; x < DENSITY_BLOCK.x; ++x)
+			{
+				positions.push_back({ x * width, (y - 1) * width, z * width });
+			}
+		}
+	}
+	return positions;
+}
+
+static void GenerateDensityBlock(ChunkManager& chunkManager, JobSystem& jobSystem, uint32_t sampleScale, int octaves)
+{
+	chunkManager.SetDensitySampling(sampleScale, octaves);
+	for (const XMINT3& position : GetDensityBlockPositions())
+	{
+		chunkManager.AddChunk(position);
+	}
+	jobSystem.WaitForAll();
+	chunkManager.UploadGeneratedChunks();
+}
+
+UNTITLED_BENCHMARK(DensitySampling)
+{
+	// Every octave adds a full noise evaluation per sample, strided sampling only evaluates every 2^scale voxels
+	// along each axis and interpolates the rest, which drifts further from full resolution the larger the stride
+	JobSystem jobSystem;
+	const eastl::vector<XMINT3> positions = GetDensityBlockPositions();
+	eastl::vector<uint64_t> fullOccupancy;
+	const int octaveCounts[3] = { 1, 2, 4 };
+	for (int octaves : octaveCounts)
+	{
+		double fullTime = 0.0;
+		for (uint32_t sampleScale = 0; sampleScale <= 3; ++sampleScale)
+		{
+			const double time = Benchmarking::Measure([&]()
+			{
+				ChunkManager chunkManager(nullptr, &jobSystem, TerrainMode::Density);
+				GenerateDensityBlock(chunkManager, jobSystem, sampleScale, octaves);
+				Benchmarking::KeepAlive(chunkManager.GetStats().numTriangles);
+			}, 3, 0.5);
+
+			// The workers mesh every chunk they generate, the terrain and with it the meshing time changes with the sampling
+			ChunkManager chunkManager(nullptr, &jobSystem, TerrainMode::Density);
+			GenerateDensityBlock(chunkManager, jobSystem, sampleScale, octaves);
+			const double meshingTime = Benchmarking::Measure([&]()
+			{
+				for (const XMINT3& position : positions)
+				{
+					Chunk& chunk = *chunkManager.GetChunkAt(position);
+					ChunkMesher::GenerateMesh(chunk, MeshingMode::Greedy, 0);
+					Benchmarking::KeepAlive(chunk.mesh.vertices.size());
+				}
+			}, 3, 0.5);
+			const double samplingTime = time - meshingTime;
+
+			eastl::vector<uint64_t> occupancy;
+			for (const XMINT3& position : positions)
+			{
+				const Chunk& chunk = *chunkManager.GetChunkAt(position);
+				occupancy.insert(occupancy.end(), chunk.occupiedColumns.begin(), chunk.occupiedColumns.end());
+			}
+
+			char metric[64];
+			snprintf(metric, sizeof(metric), "%i octaves, stride %u", octaves, 1u << sampleScale);
+			Benchmarking::Report(metric, samplingTime / 1000.0 / DENSITY_BLOCK_CHUNKS, "us/chunk");
+			if (sampleScale == 0)
+			{
+				fullTime = samplingTime;
+				fullOccupancy = eastl::move(occupancy);
+				continue;
+			}
+
+			size_t numDiffering = 0;
+			for (size_t i = 0; i < occupancy.size(); ++i)
+			{
+				numDiffering += std::popcount(occupancy[i] ^ fullOccupancy[i]);
+			}
+			snprintf(metric, sizeof(metric), "%i octaves, stride %u speedup", octaves, 1u << sampleScale);
+			Benchmarking::Report(metric, fullTime / samplingTime, "x");
+			snprintf(metric, sizeof(metric), "%i octaves, stride %u differing voxels", octaves, 1u << sampleScale);
+			Benchmarking::Report(metric, 100.0 * numDiffering / (occupancy.size() * VOXEL_CHUNK_WIDTH), "%");
+		}
+	}
+}
+
+// SIMD levels of FastNoiseSIMD compiled for x64, AVX-512 isn't compiled in
+constexpr int NUM_NOISE_SIMD_LEVELS = FN_AVX2 + 1;
+constexpr const char* NOISE_SIMD_LEVEL_NAMES[NUM_NOISE_SIMD_LEVELS] = { "No SIMD", "SSE2", "SSE4.1", "AVX2" };
+
+// Chunks of heightmap noise filled per run, as single chunks or in batches of up to 8x8 chunks
+constexpr int NOISE_CHUNKS = 32;
+constexpr int NOISE_MAX_BATCH = 8;
+
+// Configured like the noise of the chunk manager
+static FastNoiseSIMD* NewChunkNoise()
+{
+	FastNoiseSIMD* noise = FastNoiseSIMD::NewFastNoiseSIMD(42);
+	noise->SetNoiseType(FastNoiseSIMD::SimplexFractal);
+	noise->SetFrequency(0.025f);
+	noise->SetFractalType(FastNoiseSIMD::FractalType::FBM);
+	noise->SetFractalOctaves(2);
+	noise->SetFractalLacunarity(2.33f);
+	noise->SetFractalGain(0.366f);
+	return noise;
+}
+
+// Levels above the one the CPU supports would crash, the level only applies to noise created afterwards
+static int GetNumSupportedSIMDLevels()
+{
+	FastNoiseSIMD::SetSIMDLevel(-1);
+	return eastl::min(FastNoiseSIMD::GetSIMDLevel() + 1, NUM_NOISE_SIMD_LEVELS);
+}
+
+UNTITLED_BENCHMARK(NoiseBatching)
+{
+	const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+	const double numChunks = NOISE_CHUNKS * NOISE_CHUNKS;
+	const int numLevels = GetNumSupportedSIMDLevels();
+	for (int level = 0; level < numLevels; ++level)
+	{
+		FastNoiseSIMD::SetSIMDLevel(level);
+		eastl::unique_ptr<FastNoiseSIMD> noise(NewChunkNoise());
+
+		// Every chunk allocates and frees its own set, like the chunk manager did before the sets went into scratch arenas
+		const double allocatedTime = Benchmarking::Measure([&]()
+		{
+			float sum = 0.0f;
+			for (int z = 0; z < NOISE_CHUNKS; ++z)
+			{
+				for (int x = 0; x < NOISE_CHUNKS; ++x)
+				{
+					float* noiseSet = noise->GetNoiseSet(x * width, 0, z * width, width, 1, width, 0.25f);
+					sum += noiseSet[0];
+					FastNoiseSIMD::FreeNoiseSet(noiseSet);
+				}
+			}
+			Benchmarking::KeepAlive(static_cast<uint64_t>(sum * 1000.0f));
+		});
+
+		// A batch of size x size chunks per call into a reused set, a batch of 1 is what the chunk manager does
+		float* noiseSet = FastNoiseSIMD::GetEmptySet(NOISE_MAX_BATCH * width, 1, NOISE_MAX_BATCH * width);
+		double singleTime = 0.0;
+		char metric[64];
+		for (int size = 1; size <= NOISE_MAX_BATCH; size *= 2)
+		{
+			const double time = Benchmarking::Measure([&]()
+			{
+				float sum = 0.0f;
+				for (int z = 0; z < NOISE_CHUNKS; z += size)
+				{
+					for (int x = 0; x < NOISE_CHUNKS; x += size)
+					{
+						noise->FillNoiseSet(noiseSet, x * width, 0, z * width, size * width, 1, size * width, 0.25f);
+						sum += noiseSet[0];
+					}
+				}
+				Benchmarking::KeepAlive(static_cast<uint64_t>(sum * 1000.0f));
+			});
+
+			if (size == 1)
+			{
+				singleTime = time;
+				snprintf(metric, sizeof(metric), "%s, allocated sets", NOISE_SIMD_LEVEL_NAMES[level]);
+				Benchmarking::Report(metric, numChunks / allocatedTime * 1e9, "chunks/s");
+				snprintf(metric, sizeof(metric), "%s, single chunks", NOISE_SIMD_LEVEL_NAMES[level]);
+				Benchmarking::Report(metric, numChunks / time * 1e9, "chunks/s");
+				continue;
+			}
+			snprintf(metric, sizeof(metric), "%s, %ix%i batches", NOISE_SIMD_LEVEL_NAMES[level], size, size);
+			Benchmarking::Report(metric, numChunks / time * 1e9, "chunks/s");
+			snprintf(metric, sizeof(metric), "%s, %ix%i batches speedup", NOISE_SIMD_LEVEL_NAMES[level], size, size);
+			Benchmarking::Report(metric, singleTime / time, "x");
+		}
+		FastNoiseSIMD::FreeNoiseSet(noiseSet);
+	}
+	FastNoiseSIMD::SetSIMDLevel(-1);
+}
+
+UNTITLED_BENCHMARK(GenerationSIMDLevels)
+{
+	// The chunk manager creates its noise when it's constructed, every run of MeasureGeneration picks up the level
+	JobSystem jobSystem;
+	const int numLevels = GetNumSupportedSIMDLevels();
+	for (int level = 0; level < numLevels; ++level)
+	{
+		FastNoiseSIMD::SetSIMDLevel(level);
+		const TerrainMode terrainModes[2] = { TerrainMode::Heightmap, TerrainMode::Density };
+		const char* const terrainNames[2] = { "Heightmap", "Density" };
+		for (int i = 0; i < 2; ++i)
+		{
+			const double time = MeasureGeneration(jobSystem, terrainModes[i]);
+
+			char metric[64];
+			snprintf(metric, sizeof(metric), "%s, %s", terrainNames[i], NOISE_SIMD_LEVEL_NAMES[level]);
+			Benchmarking::Report(metric, GENERATION_BLOCK_CHUNKS / time * 1e9, "chunks/s");
+		}
+	}
+	FastNoiseSIMD::SetSIMDLevel(-1);
+}
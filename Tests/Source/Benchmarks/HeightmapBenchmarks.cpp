@@ -0,0 +1,82 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/ChunkFixtures.h"
+#include "Game/Heightmap.h"
+
+using namespace DirectX;
+
+// Ceilings of the world space hills over a chunk at the origin, the surface runs through the chunk
+static void FillWorldHillsHeights(eastl::array<int32_t, VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH>& heights)
+{
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+		{
+			heights[z * VOXEL_CHUNK_WIDTH + x] = ChunkFixtures::GetWorldHillsHeight(x, z);
+		}
+	}
+}
+
+// Fills the rows of every z slice of the chunk with the given fill, the column heights are already clamped to the chunk
+template<typename FillRows>
+static double MeasureRowFill(const int8_t* columnHeights, Chunk& chunk, FillRows&& fillRows)
+{
+	return Benchmarking::Measure([&]()
+	{
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			fillRows(&columnHeights[z * VOXEL_CHUNK_WIDTH], &chunk.occupiedColumns[GetColumnIndex(0, z)]);
+		}
+		Benchmarking::KeepAlive(chunk.occupiedColumns[GetColumnIndex(VOXEL_CHUNK_WIDTH / 2, VOXEL_CHUNK_WIDTH / 2)]);
+	}, 100);
+}
+
+UNTITLED_BENCHMARK(HeightmapFill)
+{
+	eastl::array<int32_t, VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH> heights;
+	FillWorldHillsHeights(heights);
+	alignas(32) eastl::array<int8_t, VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH> columnHeights;
+	for (size_t i = 0; i < columnHeights.size(); ++i)
+	{
+		columnHeights[i] = static_cast<int8_t>(eastl::clamp(heights[i], 0, static_cast<int>(VOXEL_CHUNK_WIDTH)));
+	}
+
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	const double simdTime = MeasureRowFill(columnHeights.data(), *chunk, FillHeightmapRows);
+	const double scalarTime = MeasureRowFill(columnHeights.data(), *chunk, FillHeightmapRowsScalar);
+
+	// Every voxel compared against the height of its column, like the generation did before the fill was vectorized
+	const double voxelTime = MeasureRowFill(columnHeights.data(), *chunk, [](const int8_t* sliceHeights, uint64_t* rows)
+	{
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			uint64_t row = 0;
+			for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+			{
+				row |= static_cast<uint64_t>(y < sliceHeights[x]) << x;
+			}
+			rows[y] = row;
+		}
+	});
+
+	// What generating a heightmap chunk costs from the ceilings on, including the palettes of its sections
+	const double columnsTime = Benchmarking::Measure([&]()
+	{
+		FillHeightmapColumns(*chunk, heights.data());
+		Benchmarking::KeepAlive(chunk->solidColumns[GetColumnIndex(VOXEL_CHUNK_WIDTH / 2, VOXEL_CHUNK_WIDTH / 2)]);
+	}, 100);
+	const double sectionsTime = Benchmarking::Measure([&]()
+	{
+		FillHeightmapColumns(*chunk, heights.data());
+		chunk->FillSections();
+		Benchmarking::KeepAlive(chunk->GetMemoryUsage());
+	}, 100);
+
+	Benchmarking::Report("SIMD rows, chunk", simdTime / 1000.0, "us");
+	Benchmarking::Report("Scalar rows, chunk", scalarTime / 1000.0, "us");
+	Benchmarking::Report("Per voxel, chunk", voxelTime / 1000.0, "us");
+	Benchmarking::Report("SIMD rows speedup over per voxel", voxelTime / simdTime, "x");
+	Benchmarking::Report("Scalar rows speedup over per voxel", voxelTime / scalarTime, "x");
+	Benchmarking::Report("Heightmap columns, chunk", columnsTime / 1000.0, "us");
+	Benchmarking::Report("Heightmap columns and sections, chunk", sectionsTime / 1000.0, "us");
+}
@@ -0,0 +1,98 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/ChunkFixtures.h"
+
+using namespace DirectX;
+
+// Chunks of the surface layer within this many chunks of the origin, like the streamer keeps them around the camera
+constexpr int PYRAMID_WORLD_RADIUS = 32;
+constexpr uint32_t PYRAMID_QUERIES = 1 << 20;
+
+// Column words of a chunk of the world space hills, the pyramids only need the occupancy
+static void FillWorldHillsColumns(XMINT3 position, eastl::vector<uint64_t>& columns)
+{
+	eastl::fill(columns.begin(), columns.end(), 0ull);
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+		{
+			// Pools fill the valleys up to a height of 16
+			const int height = eastl::max(ChunkFixtures::GetWorldHillsHeight(position.x + x, position.z + z), 16) - position.y;
+			for (int y = 0; y < eastl::min(height, static_cast<int>(VOXEL_CHUNK_WIDTH)); ++y)
+			{
+				columns[GetColumnIndex(y, z)] |= 1ull << x;
+			}
+		}
+	}
+}
+
+UNTITLED_BENCHMARK(OccupancyPyramids)
+{
+	eastl::vector<XMINT3> positions;
+	for (int z = -PYRAMID_WORLD_RADIUS; z <= PYRAMID_WORLD_RADIUS; ++z)
+	{
+		for (int x = -PYRAMID_WORLD_RADIUS; x <= PYRAMID_WORLD_RADIUS; ++x)
+		{
+			if (x * x + z * z > PYRAMID_WORLD_RADIUS * PYRAMID_WORLD_RADIUS) continue;
+
+			const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+			positions.push_back({ x * width, 0, z * width });
+		}
+	}
+
+	eastl::vector<eastl::vector<uint64_t>> columns(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		columns[i].resize(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+		FillWorldHillsColumns(positions[i], columns[i]);
+	}
+
+	eastl::vector<OccupancyPyramid> pyramids(positions.size());
+	const double buildTime = Benchmarking::Measure([&]()
+	{
+		for (size_t i = 0; i < pyramids.size(); ++i)
+		{
+			pyramids[i].Build(columns[i].data());
+		}
+		Benchmarking::KeepAlive(pyramids.back().GetRow(1, 0, 0));
+	});
+
+	size_t pyramidMemory = 0;
+	for (const OccupancyPyramid& pyramid : pyramids)
+	{
+		pyramidMemory += pyramid.GetMemoryUsage();
+	}
+
+	// The voxels of a chunk of the same terrain, every chunk of the world would keep about as much without its pyramid
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillWorldHills(*chunk);
+	const double voxelMemory = static_cast<double>(chunk->GetMemoryUsage()) * positions.size();
+
+	// Random cells of random chunks at every level, like the LOD meshers and neighbor culling read them
+	Random random(5);
+	eastl::vector<uint32_t> queries(PYRAMID_QUERIES);
+	for (uint32_t& query : queries)
+	{
+		query = static_cast<uint32_t>(random.Next() >> 32);
+	}
+	const double queryTime = Benchmarking::Measure([&]()
+	{
+		uint64_t occupied = 0;
+		for (uint32_t query : queries)
+		{
+			const uint32_t level = 1 + query % OccupancyPyramid::NUM_LEVELS;
+			const int mask = static_cast<int>(OccupancyPyramid::GetWidth(level)) - 1;
+			const OccupancyPyramid& pyramid = pyramids[(query >> 2) % pyramids.size()];
+			occupied += pyramid.IsOccupied(level, (query >> 8) & mask, (query >> 14) & mask, (query >> 20) & mask);
+		}
+		Benchmarking::KeepAlive(occupied);
+	});
+
+	Benchmarking::Report("Chunks", static_cast<double>(positions.size()), "chunks");
+	Benchmarking::Report("Build, all chunks", buildTime / 1e6, "ms");
+	Benchmarking::Report("Build, per chunk", buildTime / 1000.0 / positions.size(), "us");
+	Benchmarking::Report("Query", queryTime / PYRAMID_QUERIES, "ns");
+	Benchmarking::Report("Pyramid memory", static_cast<double>(pyramidMemory), "bytes");
+	Benchmarking::Report("Voxel memory", voxelMemory, "bytes");
+	Benchmarking::Report("Memory reduction", voxelMemory / pyramidMemory, "x");
+}
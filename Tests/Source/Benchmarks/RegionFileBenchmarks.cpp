@@ -0,0 +1,88 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/ChunkFixtures.h"
+#include "Game/RegionFile.h"
+
+using namespace DirectX;
+
+// Surface chunks of the world space hills, spread over the region files of a 3x2 block of regions
+constexpr int REGION_WORLD_WIDTH = 40;
+constexpr int REGION_WORLD_DEPTH = 25;
+constexpr int REGION_WORLD_REGIONS_X = (REGION_WORLD_WIDTH + REGION_WIDTH - 1) / REGION_WIDTH;
+constexpr int REGION_WORLD_REGIONS_Z = (REGION_WORLD_DEPTH + REGION_WIDTH - 1) / REGION_WIDTH;
+constexpr int REGION_WORLD_REGIONS = REGION_WORLD_REGIONS_X * REGION_WORLD_REGIONS_Z;
+
+static int GetBenchmarkRegion(const Chunk& chunk)
+{
+	const XMINT3 region = GetRegionCoordinate(GetChunkCoordinate(chunk.position));
+	return region.x + REGION_WORLD_REGIONS_X * region.z;
+}
+
+static eastl::string GetBenchmarkRegionPath(int region)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "RegionFileBenchmarks.%i.region", region);
+	return path;
+}
+
+UNTITLED_BENCHMARK(RegionFiles)
+{
+	eastl::vector<eastl::unique_ptr<Chunk>> chunks;
+	eastl::array<eastl::vector<Chunk*>, REGION_WORLD_REGIONS> regionChunks;
+	for (int z = 0; z < REGION_WORLD_DEPTH; ++z)
+	{
+		for (int x = 0; x < REGION_WORLD_WIDTH; ++x)
+		{
+			const int width = static_cast<int>(VOXEL_CHUNK_WIDTH);
+			auto& chunk = chunks.emplace_back(eastl::make_unique<Chunk>(XMINT3 { x * width, 0, z * width }, chunks.size()));
+			ChunkFixtures::FillWorldHills(*chunk);
+			regionChunks[GetBenchmarkRegion(*chunk)].push_back(chunk.get());
+		}
+	}
+
+	// The first save appends every payload to the empty files
+	eastl::array<RegionFile, REGION_WORLD_REGIONS> regionFiles;
+	uint64_t payloadSize = 0;
+	for (int region = 0; region < REGION_WORLD_REGIONS; ++region)
+	{
+		remove(GetBenchmarkRegionPath(region).c_str());
+		const bool opened = regionFiles[region].Open(GetBenchmarkRegionPath(region), true);
+		const uint64_t tableSize = regionFiles[region].GetSize();
+		const bool saved = opened && regionFiles[region].SaveChunks({ regionChunks[region].data(), regionChunks[region].size() });
+		UNTITLED_ASSERT(saved && "Benchmark region file couldn't be written!");
+		payloadSize += regionFiles[region].GetSize() - tableSize;
+	}
+
+	// Saving again writes every payload to free space next to the previous one, which is reused by the save after it
+	const double saveTime = Benchmarking::Measure([&]()
+	{
+		for (int region = 0; region < REGION_WORLD_REGIONS; ++region)
+		{
+			regionFiles[region].SaveChunks({ regionChunks[region].data(), regionChunks[region].size() });
+		}
+		Benchmarking::KeepAlive(regionFiles[0].GetSize());
+	});
+
+	// Every chunk is decoded into the same chunk, loads only touch the voxel sections
+	auto loaded = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	const double loadTime = Benchmarking::Measure([&]()
+	{
+		uint32_t numLoaded = 0;
+		for (const auto& chunk : chunks)
+		{
+			const uint32_t index = GetRegionChunkIndex(GetChunkCoordinate(chunk->position));
+			numLoaded += regionFiles[GetBenchmarkRegion(*chunk)].LoadChunk(index, *loaded) ? 1 : 0;
+		}
+		UNTITLED_ASSERT(numLoaded == chunks.size());
+		Benchmarking::KeepAlive(numLoaded);
+	});
+
+	const double numChunks = static_cast<double>(chunks.size());
+	Benchmarking::Report("Chunks", numChunks, "chunks");
+	Benchmarking::Report("Payloads", static_cast<double>(payloadSize), "bytes");
+	Benchmarking::Report("Payload per chunk", payloadSize / numChunks, "bytes");
+	Benchmarking::Report("Save", numChunks / saveTime * 1e9, "chunks/s");
+	Benchmarking::Report("Save", payloadSize / saveTime * 1000.0, "MB/s");
+	Benchmarking::Report("Load", numChunks / loadTime * 1e9, "chunks/s");
+	Benchmarking::Report("Load", payloadSize / loadTime * 1000.0, "MB/s");
+}
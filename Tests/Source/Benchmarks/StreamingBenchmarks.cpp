@@ -0,0 +1,110 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Core/JobSystem.h"
+#include "Game/ChunkStreamer.h"
+
+using namespace DirectX;
+
+// The camera flies out along the waypoints and back to where it started, so the end of the path
+// requests chunks that have just been unloaded again. Frames are paced like the game at 60 Hz.
+constexpr eastl::array<XMFLOAT3A, 4> STREAMING_PATH { {
+	{ 0.0f, 80.0f, 0.0f },
+	{ 512.0f, 80.0f, 0.0f },
+	{ 512.0f, 80.0f, 512.0f },
+	{ 0.0f, 80.0f, 0.0f }
+} };
+constexpr float STREAMING_CAMERA_SPEED = 96.0f;
+constexpr float STREAMING_FRAME_SECONDS = 1.0f / 60.0f;
+constexpr float STREAMING_MAX_CATCH_UP_SECONDS = 10.0f;
+
+static void PlaceCamera(RaytracingCamera& camera, XMFLOAT3A position, XMFLOAT3A direction)
+{
+	const XMVECTOR forward = XMVector3Normalize(XMLoadFloat3A(&direction));
+	camera.position = position;
+	XMStoreFloat3A(&camera.forward, forward);
+	camera.view = XMMatrixLookAtLH(XMLoadFloat3A(&camera.position), XMVectorAdd(XMLoadFloat3A(&camera.position), forward),
+		XMLoadFloat3A(&camera.up));
+}
+
+UNTITLED_BENCHMARK(Streaming)
+{
+	using clock = eastl::chrono::steady_clock;
+
+	JobSystem jobSystem;
+	ChunkManager chunkManager(nullptr, &jobSystem);
+	ChunkStreamer streamer(&chunkManager);
+	RaytracingCamera camera(STREAMING_PATH[0], 16.0f / 9.0f, 1000.0f, 0.0f, 0.0f);
+
+	uint32_t numFrames = 0;
+	uint64_t totalQueueDepth = 0;
+	uint32_t maxQueueDepth = 0;
+	uint32_t maxGeneratingChunks = 0;
+	double totalUpdateMs = 0.0;
+	double maxUpdateMs = 0.0;
+
+	// Runs the per-frame work of the game and sleeps for the rest of the frame
+	auto RunFrame = [&]()
+	{
+		const auto frameStart = clock::now();
+		streamer.Update(camera);
+		chunkManager.ApplyEdits();
+		chunkManager.RemeshDirtyChunks();
+		chunkManager.RebuildUpdatedChunks();
+		const double updateMs = eastl::chrono::duration<double, eastl::milli>(clock::now() - frameStart).count();
+
+		numFrames++;
+		totalQueueDepth += streamer.GetLoadQueueDepth();
+		maxQueueDepth = eastl::max(maxQueueDepth, streamer.GetLoadQueueDepth());
+		maxGeneratingChunks = eastl::max(maxGeneratingChunks, chunkManager.GetNumGeneratingChunks());
+		totalUpdateMs += updateMs;
+		maxUpdateMs = eastl::max(maxUpdateMs, updateMs);
+
+		const auto frameEnd = frameStart + eastl::chrono::duration_cast<clock::duration>(eastl::chrono::duration<float>(STREAMING_FRAME_SECONDS));
+		std::this_thread::sleep_for(std::chrono::nanoseconds((frameEnd - clock::now()).count()));
+	};
+
+	for (size_t i = 1; i < STREAMING_PATH.size(); ++i)
+	{
+		const XMFLOAT3A from = STREAMING_PATH[i - 1];
+		const XMFLOAT3A to = STREAMING_PATH[i];
+		const XMFLOAT3A direction { to.x - from.x, to.y - from.y, to.z - from.z };
+		const float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		const uint32_t numSteps = static_cast<uint32_t>(ceilf(length / (STREAMING_CAMERA_SPEED * STREAMING_FRAME_SECONDS)));
+
+		for (uint32_t step = 1; step <= numSteps; ++step)
+		{
+			const float t = static_cast<float>(step) / numSteps;
+			PlaceCamera(camera, { from.x + direction.x * t, from.y + direction.y * t, from.z + direction.z * t }, direction);
+			RunFrame();
+		}
+	}
+	const uint32_t numPathFrames = numFrames;
+
+	// The camera stays at the end of the path until everything around it is resident
+	const auto catchUpStart = clock::now();
+	while ((streamer.GetLoadQueueDepth() > 0 || chunkManager.GetNumGeneratingChunks() > 0) &&
+		eastl::chrono::duration<float>(clock::now() - catchUpStart).count() < STREAMING_MAX_CATCH_UP_SECONDS)
+	{
+		RunFrame();
+	}
+	jobSystem.WaitForAll();
+
+	const ChunkStats stats = chunkManager.GetStats();
+	Benchmarking::Report("Frames on the path", numPathFrames, "frames");
+	Benchmarking::Report("Frames to catch up afterwards", numFrames - numPathFrames, "frames");
+	Benchmarking::Report("Load latency, average", stats.averageLoadLatencyMs, "ms");
+	Benchmarking::Report("Load latency, max", stats.maxLoadLatencyMs, "ms");
+	Benchmarking::Report("Generation time, average", stats.averageGenerationMs, "ms");
+	Benchmarking::Report("Generation time, max", stats.maxGenerationMs, "ms");
+	Benchmarking::Report("Load queue depth, average", static_cast<double>(totalQueueDepth) / numFrames, "chunks");
+	Benchmarking::Report("Load queue depth, max", maxQueueDepth, "chunks");
+	Benchmarking::Report("Chunks generating, max", maxGeneratingChunks, "chunks");
+	Benchmarking::Report("Main thread update, average", totalUpdateMs / numFrames, "ms");
+	Benchmarking::Report("Main thread update, max", maxUpdateMs, "ms");
+	Benchmarking::Report("Resident chunks", stats.numChunks, "chunks");
+	Benchmarking::Report("Coarse chunks", stats.numCoarseChunks, "chunks");
+	Benchmarking::Report("Voxel memory", static_cast<double>(stats.voxelMemoryUsage), "bytes");
+	Benchmarking::Report("Mesh memory", static_cast<double>(stats.meshMemoryUsage), "bytes");
+	Benchmarking::Report("Cold cache memory", static_cast<double>(stats.coldMemoryUsage), "bytes");
+	Benchmarking::Report("Cold cache hit rate", stats.coldHitRate * 100.0f, "%");
+}
@@ -0,0 +1,88 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/Random.h"
+#include "Graphics/Memory/TLSFAllocator.h"
+#include "Graphics/Raytracing/AccelerationStructurePool.h"
+
+// Sizes of chunk BLASes, most meshes are small and a few reach a few megabytes
+static uint64_t GetStructureSize(Random& random)
+{
+	const uint32_t log = 13 + random.Below(random.Below(8) == 0 ? 9 : 5);
+	return (1ull << log) + random.Below(1u << log);
+}
+
+// One pool block filled up to a target use, then structures are freed and allocated in random order like chunks
+// streaming in and out. Reports the cost of an allocation and a free, and the shape of the free memory it leaves.
+UNTITLED_BENCHMARK(TLSFAllocatorChurn)
+{
+	struct Structure
+	{
+		TLSFAllocator::Allocation allocation;
+		uint64_t size;
+	};
+
+	const auto measure = [](const char* name, float targetUse)
+	{
+		TLSFAllocator allocator(AS_POOL_BLOCK_SIZE, ACCELERATION_STRUCTURE_ALIGNMENT);
+		eastl::vector<Structure> structures;
+		Random random(25);
+		const uint64_t targetSize = static_cast<uint64_t>(targetUse * AS_POOL_BLOCK_SIZE);
+
+		const auto allocate = [&]()
+		{
+			Structure structure { {}, GetStructureSize(random) };
+			if (allocator.Allocate(structure.size, structure.allocation))
+			{
+				structures.push_back(structure);
+			}
+		};
+		const auto release = [&]()
+		{
+			const size_t index = random.Below(static_cast<uint32_t>(structures.size()));
+			allocator.Free(structures[index].allocation);
+			structures[index] = structures.back();
+			structures.pop_back();
+		};
+
+		while (allocator.GetUsedSize() < targetSize)
+		{
+			allocate();
+		}
+
+		// Each run frees and allocates the same number of structures, the use stays around the target
+		constexpr uint32_t numSteps = 4096;
+		uint32_t numFailed = 0;
+		const double nanoseconds = Benchmarking::Measure([&]()
+		{
+			numFailed = 0;
+			for (uint32_t step = 0; step < numSteps; ++step)
+			{
+				if (allocator.GetUsedSize() >= targetSize)
+				{
+					release();
+				}
+				else
+				{
+					const size_t numStructures = structures.size();
+					allocate();
+					numFailed += structures.size() == numStructures ? 1 : 0;
+				}
+			}
+		});
+
+		char metric[64];
+		snprintf(metric, sizeof(metric), "%s allocate or free", name);
+		Benchmarking::Report(metric, nanoseconds / numSteps, "ns");
+		snprintf(metric, sizeof(metric), "%s fragmentation", name);
+		Benchmarking::Report(metric, allocator.GetFragmentation() * 100.0, "%");
+		snprintf(metric, sizeof(metric), "%s largest free range", name);
+		Benchmarking::Report(metric, static_cast<double>(allocator.GetLargestFreeRange()) / 1024.0, "KB");
+		snprintf(metric, sizeof(metric), "%s free ranges", name);
+		Benchmarking::Report(metric, allocator.GetNumFreeRanges(), "ranges");
+		snprintf(metric, sizeof(metric), "%s failed allocations", name);
+		Benchmarking::Report(metric, numFailed, "allocations");
+	};
+
+	measure("Half used", 0.5f);
+	measure("90% used", 0.9f);
+}
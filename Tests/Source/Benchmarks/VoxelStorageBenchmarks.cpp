@@ -0,0 +1,180 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/LegacyChunk.h"
+#include "Game/ChunkMesher.h"
+
+using namespace DirectX;
+
+static void ReportChunkMemory(const char* name, const Chunk& chunk)
+{
+	char metric[64];
+	const double legacyBytes = static_cast<double>(sizeof(LegacyVoxel)) * VOXELS_PER_CHUNK;
+	snprintf(metric, sizeof(metric), "%s chunk", name);
+	Benchmarking::Report(metric, static_cast<double>(chunk.GetMemoryUsage()), "bytes");
+	snprintf(metric, sizeof(metric), "%s chunk reduction", name);
+	Benchmarking::Report(metric, legacyBytes / chunk.GetMemoryUsage(), "x");
+}
+
+UNTITLED_BENCHMARK(ChunkMemory)
+{
+	Benchmarking::Report("Legacy chunk", static_cast<double>(sizeof(LegacyVoxel)) * VOXELS_PER_CHUNK, "bytes");
+
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	ReportChunkMemory("Hills", *chunk);
+	ChunkFixtures::FillRandom(*chunk, 1, 0.5f);
+	ReportChunkMemory("Random two type", *chunk);
+	ChunkFixtures::FillRandom(*chunk, 2, 0.4f, 0.2f);
+	ReportChunkMemory("Random three type", *chunk);
+}
+
+UNTITLED_BENCHMARK(VoxelGetSet)
+{
+	eastl::vector<LegacyVoxel> legacy(VOXELS_PER_CHUNK);
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillRandom(*chunk, 3, 0.4f, 0.2f);
+
+	// The same random types are written to both layouts, in the x-fastest order the generator uses
+	eastl::vector<FillType> types(VOXELS_PER_CHUNK);
+	Random random(4);
+	for (FillType& type : types)
+	{
+		type = static_cast<FillType>(random.Below(3));
+	}
+
+	const double legacySet = Benchmarking::Measure([&]()
+	{
+		for (uint32_t i = 0; i < VOXELS_PER_CHUNK; ++i)
+		{
+			legacy[i].fillType = types[i];
+		}
+		Benchmarking::KeepAlive(static_cast<uint64_t>(legacy[VOXELS_PER_CHUNK / 2].fillType));
+	});
+
+	const double paletteSet = Benchmarking::Measure([&]()
+	{
+		uint32_t i = 0;
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					chunk->voxelSections[GetSectionIndex(x, y, z)].Set(GetSectionVoxelIndex(x, y, z), types[i++]);
+				}
+			}
+		}
+		Benchmarking::KeepAlive(static_cast<uint64_t>(chunk->GetVoxel(32, 32, 32)));
+	});
+
+	const double legacyGet = Benchmarking::Measure([&]()
+	{
+		uint64_t solid = 0;
+		for (uint32_t i = 0; i < VOXELS_PER_CHUNK; ++i)
+		{
+			solid += legacy[i].fillType == FillType::Solid ? 1 : 0;
+		}
+		Benchmarking::KeepAlive(solid);
+	});
+
+	const double paletteGet = Benchmarking::Measure([&]()
+	{
+		uint64_t solid = 0;
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					solid += chunk->GetVoxel(x, y, z) == FillType::Solid ? 1 : 0;
+				}
+			}
+		}
+		Benchmarking::KeepAlive(solid);
+	});
+
+	// Rows of a section at once, like the culling reads them
+	const double paletteMatch = Benchmarking::Measure([&]()
+	{
+		uint64_t solid = 0;
+		for (const VoxelStorage& section : chunk->voxelSections)
+		{
+			for (uint32_t first = 0; first < VOXELS_PER_SECTION; first += SECTION_WIDTH)
+			{
+				solid += std::popcount(section.Match(first, SECTION_WIDTH, FillType::Solid));
+			}
+		}
+		Benchmarking::KeepAlive(solid);
+	});
+
+	const auto report = [](const char* metric, double nanoseconds)
+	{
+		Benchmarking::Report(metric, VOXELS_PER_CHUNK / nanoseconds * 1000.0, "Mvoxels/s");
+	};
+	report("Legacy set", legacySet);
+	report("Palette set", paletteSet);
+	report("Legacy get", legacyGet);
+	report("Palette get", paletteGet);
+	report("Palette match", paletteMatch);
+}
+
+// Stores indices for every uniform section of the chunk, like all sections were stored before they could be uniform.
+// The voxels stay the same, so the faces and occupancy don't change.
+static uint32_t ExpandUniformSections(Chunk& chunk)
+{
+	uint32_t numExpanded = 0;
+	for (VoxelStorage& section : chunk.voxelSections)
+	{
+		if (!section.IsUniform()) continue;
+
+		const FillType type = section.Get(0);
+		section.Set(0, type == FillType::Solid ? FillType::Empty : FillType::Solid);
+		section.Set(0, type);
+		numExpanded++;
+	}
+	return numExpanded;
+}
+
+static void BenchmarkUniformSections(const char* name, Chunk& chunk)
+{
+	const size_t uniformMemory = chunk.GetMemoryUsage();
+	const double uniformMeshing = Benchmarking::Measure([&]()
+	{
+		ChunkMesher::GenerateMesh(chunk, MeshingMode::Greedy, 0);
+		Benchmarking::KeepAlive(chunk.mesh.vertices.size());
+	});
+
+	const uint32_t numUniform = ExpandUniformSections(chunk);
+	const size_t expandedMemory = chunk.GetMemoryUsage();
+	const double expandedMeshing = Benchmarking::Measure([&]()
+	{
+		ChunkMesher::GenerateMesh(chunk, MeshingMode::Greedy, 0);
+		Benchmarking::KeepAlive(chunk.mesh.vertices.size());
+	});
+
+	char metric[64];
+	snprintf(metric, sizeof(metric), "%s, uniform sections", name);
+	Benchmarking::Report(metric, numUniform, "sections");
+	snprintf(metric, sizeof(metric), "%s, memory with uniform sections", name);
+	Benchmarking::Report(metric, static_cast<double>(uniformMemory), "bytes");
+	snprintf(metric, sizeof(metric), "%s, memory with indices everywhere", name);
+	Benchmarking::Report(metric, static_cast<double>(expandedMemory), "bytes");
+	snprintf(metric, sizeof(metric), "%s, greedy meshing with uniform sections", name);
+	Benchmarking::Report(metric, uniformMeshing / 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, greedy meshing with indices everywhere", name);
+	Benchmarking::Report(metric, expandedMeshing / 1000.0, "us");
+	snprintf(metric, sizeof(metric), "%s, meshing speedup", name);
+	Benchmarking::Report(metric, expandedMeshing / uniformMeshing, "x");
+}
+
+UNTITLED_BENCHMARK(UniformSections)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	BenchmarkUniformSections("Hills", *chunk);
+	ChunkFixtures::Fill(*chunk, [](int, int y, int) { return y < 32 ? FillType::Solid : FillType::Empty; });
+	BenchmarkUniformSections("Flat", *chunk);
+	ChunkFixtures::Fill(*chunk, [](int, int, int) { return FillType::Solid; });
+	BenchmarkUniformSections("Solid", *chunk);
+}
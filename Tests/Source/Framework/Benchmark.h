@@ -0,0 +1,39 @@
+#pragma once
+
+// Benchmarks register themselves like tests and are run by BenchmarkMain, they report their own figures.
+// They are meant to be run from an optimized build, the figures of a debug build say little.
+namespace Benchmarking
+{
+	using BenchmarkFunction = void(*)();
+
+	bool Register(const char* name, BenchmarkFunction function);
+
+	// Prints a figure of the running benchmark
+	void Report(const char* metric, double value, const char* unit);
+
+	// Folds a result into a sink the compiler can't see through, so the work producing it isn't optimized away
+	void KeepAlive(uint64_t value);
+
+	// Runs the function until it has run minRuns times and for at least minSeconds, returns the fastest run in
+	// nanoseconds. The fastest run is the one least disturbed by the rest of the system.
+	template<typename Function>
+	double Measure(Function&& function, uint32_t minRuns = 5, double minSeconds = 0.2)
+	{
+		using clock = eastl::chrono::steady_clock;
+
+		double fastest = eastl::numeric_limits<double>::max();
+		const auto start = clock::now();
+		for (uint32_t run = 0; run < minRuns || eastl::chrono::duration<double>(clock::now() - start).count() < minSeconds; ++run)
+		{
+			const auto runStart = clock::now();
+			function();
+			fastest = eastl::min(fastest, eastl::chrono::duration<double, eastl::nano>(clock::now() - runStart).count());
+		}
+		return fastest;
+	}
+}
+
+#define UNTITLED_BENCHMARK(name) \
+	static void name(); \
+	static const bool name##Registered = Benchmarking::Register(#name, name); \
+	static void name()
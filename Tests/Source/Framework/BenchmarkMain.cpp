@@ -0,0 +1,47 @@
+#include "PCH.h"
+#include "Framework/Benchmark.h"
+
+struct BenchmarkCase
+{
+	const char* name;
+	Benchmarking::BenchmarkFunction function;
+};
+
+static eastl::vector<BenchmarkCase>& GetBenchmarks()
+{
+	static eastl::vector<BenchmarkCase> benchmarks;
+	return benchmarks;
+}
+
+static volatile uint64_t sink = 0;
+
+bool Benchmarking::Register(const char* name, BenchmarkFunction function)
+{
+	GetBenchmarks().push_back(BenchmarkCase { name, function });
+	return true;
+}
+
+void Benchmarking::Report(const char* metric, double value, const char* unit)
+{
+	printf("    %-48s %14.3f %s\n", metric, value, unit);
+}
+
+void Benchmarking::KeepAlive(uint64_t value)
+{
+	sink = sink + value;
+}
+
+// Runs every benchmark, or the ones whose name contains the first argument
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+
+	for (const BenchmarkCase& benchmark : GetBenchmarks())
+	{
+		if (filter && !strstr(benchmark.name, filter)) continue;
+
+		printf("%s\n", benchmark.name);
+		benchmark.function();
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Framework/Random.h"
+#include "Game/Chunk.h"
+
+// Chunks with known contents for the tests and benchmarks, filled without any noise or ChunkManager
+namespace ChunkFixtures
+{
+	// Sets the block type of every voxel and derives the columns, faces and occupancy like a loaded chunk
+	template<typename Function>
+	void Fill(Chunk& chunk, Function&& typeAt)
+	{
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					chunk.voxelSections[GetSectionIndex(x, y, z)].Set(GetSectionVoxelIndex(x, y, z), typeAt(x, y, z));
+				}
+			}
+		}
+		chunk.CompactSections(~0ull);
+		chunk.RebuildColumns();
+		chunk.CullFaces();
+		chunk.occupancy.Build(chunk.occupiedColumns.data());
+	}
+
+	// Rolling hills with transparent pools in the valleys, the surface crosses a few sections of every column
+	inline void FillHills(Chunk& chunk)
+	{
+		Fill(chunk, [](int x, int y, int z)
+		{
+			const int height = 24 + static_cast<int>(10.0f * sinf(x * 0.2f) * cosf(z * 0.15f));
+			if (y < height) return FillType::Solid;
+			return y < 20 ? FillType::Transparent : FillType::Empty;
+		});
+	}
+
+	// Surface height of hills in world space, unlike FillHills they continue across the chunk borders
+	inline int GetWorldHillsHeight(int x, int z)
+	{
+		return 24 + static_cast<int>(12.0f * sinf(x * 0.05f) * cosf(z * 0.04f) + 6.0f * sinf(z * 0.13f));
+	}
+
+	// Fills the chunk with the world space hills at its position, with transparent pools below a height of 16
+	inline void FillWorldHills(Chunk& chunk)
+	{
+		const DirectX::XMINT3 position = chunk.position;
+		Fill(chunk, [&](int x, int y, int z)
+		{
+			if (position.y + y < GetWorldHillsHeight(position.x + x, position.z + z)) return FillType::Solid;
+			return position.y + y < 16 ? FillType::Transparent : FillType::Empty;
+		});
+	}
+
+	// Independent voxels, the worst case for culling and meshing since hardly any faces are hidden or merged
+	inline void FillRandom(Chunk& chunk, uint64_t seed, float solidProbability, float transparentProbability = 0.0f)
+	{
+		Random random(seed);
+		Fill(chunk, [&](int, int, int)
+		{
+			const float value = random.Float();
+			if (value < solidProbability) return FillType::Solid;
+			return value < solidProbability + transparentProbability ? FillType::Transparent : FillType::Empty;
+		});
+	}
+}
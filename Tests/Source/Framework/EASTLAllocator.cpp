@@ -0,0 +1,26 @@
+#include "PCH.h"
+
+// OPERATOR OVERLOADS FOR EASTL, the game defines them next to its entry point
+void* __cdecl operator new[](size_t size, const char* name, int flags, unsigned debugFlags, const char* file, int line)
+{
+	UNREFERENCED_PARAMETER(name);
+	UNREFERENCED_PARAMETER(flags);
+	UNREFERENCED_PARAMETER(debugFlags);
+	UNREFERENCED_PARAMETER(file);
+	UNREFERENCED_PARAMETER(line);
+
+	return new uint8_t[size];
+}
+
+void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, const char* pName, int flags, unsigned debugFlags, const char* file, int line)
+{
+	UNREFERENCED_PARAMETER(alignment);
+	UNREFERENCED_PARAMETER(alignmentOffset);
+	UNREFERENCED_PARAMETER(pName);
+	UNREFERENCED_PARAMETER(flags);
+	UNREFERENCED_PARAMETER(debugFlags);
+	UNREFERENCED_PARAMETER(file);
+	UNREFERENCED_PARAMETER(line);
+
+	return new uint8_t[size];
+}
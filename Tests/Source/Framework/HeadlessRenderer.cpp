@@ -0,0 +1,56 @@
+#include "PCH.h"
+#include "Graphics/Renderer.h"
+
+// The benchmarks run ChunkManager without a renderer, which never calls into it then. These definitions
+// stand in for Renderer.cpp and AccelerationStructureManager.cpp, so the benchmarks don't have to link
+// the device, the pipelines and the shader compiler.
+
+DXDeviceLocalBuffer Renderer::CreateVertexBuffer(const Vertex*, size_t)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+	return {};
+}
+
+DXDeviceLocalBuffer Renderer::CreateIndexBuffer(const uint32_t*, size_t)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+	return {};
+}
+
+void Renderer::UpdateBuffer(DXDeviceLocalBuffer&, const void*, uint64_t, eastl::span<const DXBufferRegion>)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+}
+
+BLASHandle AccelerationStructureManager::AddBLAS(eastl::vector<AccelerationStructureGeometry>&&)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+	return {};
+}
+
+void AccelerationStructureManager::RebuildBLAS(BLASHandle, eastl::vector<AccelerationStructureGeometry>&&, float)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+}
+
+BLASInstanceHandle AccelerationStructureManager::AddBLASInstance(BLASHandle, DirectX::XMMATRIX, uint32_t)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+	return {};
+}
+
+void AccelerationStructureManager::RemoveBLASInstance(BLASInstanceHandle&)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+}
+
+void AccelerationStructureManager::RemoveBLAS(BLASHandle&)
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+}
+
+AccelerationStructureStats AccelerationStructureManager::GetStats() const
+{
+	UNTITLED_ASSERT(false && "Benchmarks run without a renderer!");
+	return {};
+}
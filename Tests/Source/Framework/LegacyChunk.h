@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Game/Chunk.h"
+
+// Layout the chunks used before the palette storage and the column bitmasks, one of these per voxel
+struct LegacyVoxel
+{
+	FillType fillType;
+	uint32_t visibleFaces;
+	DirectX::XMVECTOR color;
+};
+
+// Mesh vertex before it was packed into 8 bytes
+struct LegacyVertex
+{
+	DirectX::XMVECTOR position;
+	DirectX::XMVECTOR normal;
+};
+
+// Normals of the face indices of packed vertices, in the order of VisibleFaces
+inline const DirectX::XMVECTORF32 LEGACY_FACE_NORMALS[NUM_FACE_DIRECTIONS] = {
+	{ { { 0.0f, 0.0f, 1.0f, 0.0f } } },
+	{ { { 0.0f, 0.0f, -1.0f, 0.0f } } },
+	{ { { 1.0f, 0.0f, 0.0f, 0.0f } } },
+	{ { { -1.0f, 0.0f, 0.0f, 0.0f } } },
+	{ { { 0.0f, 1.0f, 0.0f, 0.0f } } },
+	{ { { 0.0f, -1.0f, 0.0f, 0.0f } } }
+};
+
+// Voxels of a chunk in the old layout, culled voxel by voxel like the chunks were before the column bitmasks
+struct LegacyChunk
+{
+	eastl::vector<LegacyVoxel> voxels;
+
+	LegacyChunk() : voxels(VOXELS_PER_CHUNK, LegacyVoxel { FillType::Empty, 0, {} })
+	{
+	}
+
+	static inline int GetIndex(int x, int y, int z)
+	{
+		return x + VOXEL_CHUNK_WIDTH * (y + VOXEL_CHUNK_WIDTH * z);
+	}
+
+	void CopyFrom(const Chunk& chunk)
+	{
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					voxels[GetIndex(x, y, z)].fillType = chunk.GetVoxel(x, y, z);
+				}
+			}
+		}
+	}
+
+	inline void SetFacesForVoxel(int x, int y, int z)
+	{
+		auto& voxel = voxels[GetIndex(x, y, z)];
+
+		voxel.visibleFaces = VisibleFaces::AllFaces;
+		if (x + 1 < VOXEL_CHUNK_WIDTH	&& voxels[GetIndex(x + 1, y, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::East;
+		if (x - 1 >= 0					&& voxels[GetIndex(x - 1, y, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::West;
+		if (y + 1 < VOXEL_CHUNK_WIDTH	&& voxels[GetIndex(x, y + 1, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::Top;
+		if (y - 1 >= 0					&& voxels[GetIndex(x, y - 1, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::Bottom;
+		if (z + 1 < VOXEL_CHUNK_WIDTH	&& voxels[GetIndex(x, y, z + 1)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::North;
+		if (z - 1 >= 0					&& voxels[GetIndex(x, y, z - 1)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::South;
+	}
+
+	// Culls every occupied voxel, returns the number of visible faces
+	uint32_t CullFaces()
+	{
+		uint32_t visibleFaces = 0;
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					LegacyVoxel& voxel = voxels[GetIndex(x, y, z)];
+					if (voxel.fillType == FillType::Empty) continue;
+
+					SetFacesForVoxel(x, y, z);
+					visibleFaces += std::popcount(voxel.visibleFaces);
+				}
+			}
+		}
+		return visibleFaces;
+	}
+};
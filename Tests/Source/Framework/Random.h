@@ -0,0 +1,33 @@
+#pragma once
+
+// Small deterministic generator (xorshift64*), so every run of a test or benchmark sees the same data
+class Random
+{
+public:
+	explicit Random(uint64_t seed) : state(seed != 0 ? seed : 0x9E3779B97F4A7C15ull)
+	{
+	}
+
+	inline uint64_t Next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	}
+
+	// Uniform in [0, range)
+	inline uint32_t Below(uint32_t range)
+	{
+		return static_cast<uint32_t>((Next() >> 32) * range >> 32);
+	}
+
+	// Uniform in [0, 1)
+	inline float Float()
+	{
+		return static_cast<float>(Next() >> 40) / static_cast<float>(1 << 24);
+	}
+
+private:
+	uint64_t state;
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+// Tests register themselves from static initializers and are run by TestMain in the order they were registered.
+// Checks are compiled into every configuration, unlike UNTITLED_ASSERT, and a failed check doesn't stop its test.
+namespace Testing
+{
+	using TestFunction = void(*)();
+
+	bool Register(const char* name, TestFunction function);
+	void ReportFailure(const char* file, int line, const char* expression);
+}
+
+#define UNTITLED_TEST(name) \
+	static void name(); \
+	static const bool name##Registered = Testing::Register(#name, name); \
+	static void name()
+
+#define UNTITLED_CHECK(x) do { if (!(x)) Testing::ReportFailure(__FILE__, __LINE__, #x); } while (0)
@@ -0,0 +1,53 @@
+#include "PCH.h"
+#include "Framework/Test.h"
+
+struct TestCase
+{
+	const char* name;
+	Testing::TestFunction function;
+};
+
+// Function local, so tests of other files can register before main regardless of the initialization order
+static eastl::vector<TestCase>& GetTests()
+{
+	static eastl::vector<TestCase> tests;
+	return tests;
+}
+
+static uint32_t numFailedChecks = 0;
+
+bool Testing::Register(const char* name, TestFunction function)
+{
+	GetTests().push_back(TestCase { name, function });
+	return true;
+}
+
+void Testing::ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("    %s(%i): check failed: %s\n", file, line, expression);
+	numFailedChecks++;
+}
+
+// Runs every test, or the ones whose name contains the first argument
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+
+	uint32_t numTests = 0;
+	uint32_t numFailedTests = 0;
+	for (const TestCase& test : GetTests())
+	{
+		if (filter && !strstr(test.name, filter)) continue;
+
+		const uint32_t failedChecksBefore = numFailedChecks;
+		test.function();
+		const bool passed = numFailedChecks == failedChecksBefore;
+		printf("[%s] %s\n", passed ? "PASS" : "FAIL", test.name);
+
+		numTests++;
+		numFailedTests += passed ? 0 : 1;
+	}
+
+	printf("%u of %u tests passed\n", numTests - numFailedTests, numTests);
+	return numFailedTests == 0 ? 0 : 1;
+}
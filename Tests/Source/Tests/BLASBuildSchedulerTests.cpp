@@ -0,0 +1,165 @@
+#include "PCH.h"
+#include "Framework/Test.h"
+#include "Graphics/Raytracing/AccelerationStructureManager.h"
+#include "Graphics/Raytracing/BLASBuildScheduler.h"
+
+// Handles only come out of a sparse array, the scheduler never looks at the structures behind them
+static eastl::vector<BLASHandle> CreateHandles(SparseArray<BottomLevelAccelerationStructure, 16>& structures, uint32_t count)
+{
+	eastl::vector<BLASHandle> handles;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		handles.push_back(structures.Insert(BottomLevelAccelerationStructure {}));
+	}
+	return handles;
+}
+
+UNTITLED_TEST(BLASBuildSchedulerSpillsOverBudget)
+{
+	SparseArray<BottomLevelAccelerationStructure, 16> structures;
+	const auto handles = CreateHandles(structures, 4);
+
+	BLASBuildScheduler scheduler;
+	for (BLASHandle handle : handles)
+	{
+		scheduler.Queue(handle, false, SCRATCH_ALIGNMENT, 100);
+	}
+
+	// The triangle budget fits two builds, the rest keep their order for the next frames
+	eastl::vector<BLASBuildScheduler::PlannedBuild> builds;
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 250, builds);
+	UNTITLED_CHECK(builds.size() == 2 && builds[0].handle == handles[0] && builds[1].handle == handles[1]);
+	UNTITLED_CHECK(scheduler.GetPlannedTriangles() == 200 && scheduler.GetNumQueued() == 2);
+
+	// The scratch buffer fits one build
+	scheduler.Plan(SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 1 && builds[0].handle == handles[2] && scheduler.GetNumQueued() == 1);
+
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 1 && builds[0].handle == handles[3] && scheduler.GetNumQueued() == 0);
+
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.empty() && scheduler.GetPlannedScratchSize() == 0 && scheduler.GetPlannedTriangles() == 0);
+}
+
+UNTITLED_TEST(BLASBuildSchedulerExemptsFirstBuild)
+{
+	SparseArray<BottomLevelAccelerationStructure, 16> structures;
+	const auto handles = CreateHandles(structures, 2);
+
+	BLASBuildScheduler scheduler;
+	scheduler.Queue(handles[0], false, SCRATCH_ALIGNMENT, 5000);
+	scheduler.Queue(handles[1], false, SCRATCH_ALIGNMENT, 5000);
+
+	// Meshes larger than the budget are still built, one per frame
+	eastl::vector<BLASBuildScheduler::PlannedBuild> builds;
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 1 && builds[0].handle == handles[0] && scheduler.GetPlannedTriangles() == 5000);
+
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 1 && builds[0].handle == handles[1] && scheduler.GetNumQueued() == 0);
+}
+
+UNTITLED_TEST(BLASBuildSchedulerSeparatesScratchRegions)
+{
+	SparseArray<BottomLevelAccelerationStructure, 16> structures;
+	const auto handles = CreateHandles(structures, 5);
+	const eastl::array<uint64_t, 5> scratchSizes { 1, 300, SCRATCH_ALIGNMENT, 4000, 513 };
+
+	BLASBuildScheduler scheduler;
+	for (size_t i = 0; i < handles.size(); ++i)
+	{
+		scheduler.Queue(handles[i], i % 2 == 1, scratchSizes[i], 10);
+	}
+
+	const uint64_t scratchSize = 64 * SCRATCH_ALIGNMENT;
+	eastl::vector<BLASBuildScheduler::PlannedBuild> builds;
+	scheduler.Plan(scratchSize, 1000, builds);
+	UNTITLED_CHECK(builds.size() == handles.size());
+
+	// Regions are aligned, in the order of the builds and don't overlap
+	uint64_t end = 0;
+	for (size_t i = 0; i < builds.size(); ++i)
+	{
+		UNTITLED_CHECK(builds[i].handle == handles[i] && builds[i].update == (i % 2 == 1));
+		UNTITLED_CHECK(builds[i].scratchOffset % SCRATCH_ALIGNMENT == 0 && builds[i].scratchOffset >= end);
+		end = builds[i].scratchOffset + scratchSizes[i];
+	}
+	UNTITLED_CHECK(end <= scheduler.GetPlannedScratchSize() && scheduler.GetPlannedScratchSize() <= scratchSize);
+	UNTITLED_CHECK(scheduler.GetPlannedScratchSize() == (1 + 2 + 1 + 16 + 3) * SCRATCH_ALIGNMENT);
+}
+
+UNTITLED_TEST(BLASBuildSchedulerMergesRequests)
+{
+	SparseArray<BottomLevelAccelerationStructure, 16> structures;
+	const auto handles = CreateHandles(structures, 3);
+	eastl::vector<BLASBuildScheduler::PlannedBuild> builds;
+
+	// Refits of a queued refit keep the largest scratch size
+	BLASBuildScheduler scheduler;
+	scheduler.Queue(handles[0], true, 3 * SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[0], true, SCRATCH_ALIGNMENT, 20);
+	UNTITLED_CHECK(scheduler.GetNumQueued() == 1);
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 1 && builds[0].update);
+	UNTITLED_CHECK(scheduler.GetPlannedScratchSize() == 3 * SCRATCH_ALIGNMENT && scheduler.GetPlannedTriangles() == 20);
+
+	// A build replaces a queued refit and a refit of a queued build is dropped, the build keeps its place
+	scheduler.Queue(handles[1], true, SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[2], false, SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[1], false, 2 * SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[2], true, SCRATCH_ALIGNMENT, 10);
+	UNTITLED_CHECK(scheduler.GetNumQueued() == 2);
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 2 && builds[0].handle == handles[1] && builds[1].handle == handles[2]);
+	UNTITLED_CHECK(!builds[0].update && !builds[1].update);
+	UNTITLED_CHECK(builds[1].scratchOffset == 2 * SCRATCH_ALIGNMENT);
+}
+
+UNTITLED_TEST(BLASBuildSchedulerBuildReplacesBuild)
+{
+	SparseArray<BottomLevelAccelerationStructure, 16> structures;
+	const auto handles = CreateHandles(structures, 2);
+
+	// The geometry grew before the first build was recorded, its region has to hold the new size
+	BLASBuildScheduler scheduler;
+	scheduler.Queue(handles[0], false, SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[1], false, SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[0], false, 4 * SCRATCH_ALIGNMENT, 40);
+	UNTITLED_CHECK(scheduler.GetNumQueued() == 2);
+
+	eastl::vector<BLASBuildScheduler::PlannedBuild> builds;
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 2 && builds[0].handle == handles[0] && !builds[0].update);
+	UNTITLED_CHECK(builds[1].scratchOffset == 4 * SCRATCH_ALIGNMENT);
+	UNTITLED_CHECK(scheduler.GetPlannedScratchSize() == 5 * SCRATCH_ALIGNMENT && scheduler.GetPlannedTriangles() == 50);
+
+	// A scratch buffer too small for the new size holds the first build back, instead of overlapping the second
+	scheduler.Queue(handles[0], false, SCRATCH_ALIGNMENT, 10);
+	scheduler.Queue(handles[0], false, 4 * SCRATCH_ALIGNMENT, 40);
+	scheduler.Queue(handles[1], false, SCRATCH_ALIGNMENT, 10);
+	scheduler.Plan(4 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 1 && builds[0].handle == handles[0] && scheduler.GetNumQueued() == 1);
+}
+
+UNTITLED_TEST(BLASBuildSchedulerRemovesBuilds)
+{
+	SparseArray<BottomLevelAccelerationStructure, 16> structures;
+	const auto handles = CreateHandles(structures, 3);
+
+	BLASBuildScheduler scheduler;
+	for (BLASHandle handle : handles)
+	{
+		scheduler.Queue(handle, false, SCRATCH_ALIGNMENT, 10);
+	}
+	scheduler.Remove(handles[1]);
+	scheduler.Remove(handles[1]);
+	UNTITLED_CHECK(!scheduler.IsQueued(handles[1]) && scheduler.IsQueued(handles[0]) && scheduler.IsQueued(handles[2]));
+	UNTITLED_CHECK(scheduler.GetNumQueued() == 2);
+
+	eastl::vector<BLASBuildScheduler::PlannedBuild> builds;
+	scheduler.Plan(16 * SCRATCH_ALIGNMENT, 1000, builds);
+	UNTITLED_CHECK(builds.size() == 2 && builds[0].handle == handles[0] && builds[1].handle == handles[2]);
+	UNTITLED_CHECK(builds[1].scratchOffset == SCRATCH_ALIGNMENT);
+	UNTITLED_CHECK(!scheduler.IsQueued(handles[0]) && !scheduler.IsQueued(handles[2]));
+}
@@ -0,0 +1,107 @@
+#include "PCH.h"
+#include "Framework/Test.h"
+#include "Graphics/Raytracing/BLASUpdatePolicy.h"
+
+// State of a structure that has just been built for tracing with the given geometry
+static BLASUpdateState CreateBuiltState(const BLASUpdatePolicy& policy, uint32_t vertexCount, uint32_t indexCount)
+{
+	BLASUpdateState state;
+	policy.OnBuilt(state, vertexCount, indexCount);
+	return state;
+}
+
+UNTITLED_TEST(BLASUpdatePolicyBuildsTopologyChanges)
+{
+	BLASUpdatePolicy policy;
+	BLASUpdateState state = CreateBuiltState(policy, 400, 600);
+
+	// Refits can only move vertices, a different vertex or index count needs a build
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 404, 600, 0.01f, true) == BLASUpdate::FastBuild);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 606, 0.01f, true) == BLASUpdate::FastBuild);
+	UNTITLED_CHECK(state.preferFastBuild && state.numRefits == 0);
+	UNTITLED_CHECK(policy.GetStats().numTopologyBuilds == 2 && policy.GetStats().numFastBuilds == 2);
+
+	// The same geometry can be refit, unless the structure doesn't allow it
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.01f, true) == BLASUpdate::Refit);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.01f, false) == BLASUpdate::FastBuild);
+	UNTITLED_CHECK(policy.GetStats().numRefits == 1 && policy.GetStats().numTopologyBuilds == 2 && policy.GetStats().numFastBuilds == 3);
+}
+
+UNTITLED_TEST(BLASUpdatePolicyLimitsRefitCount)
+{
+	BLASUpdatePolicy policy;
+	BLASUpdateState state = CreateBuiltState(policy, 400, 600);
+
+	// Small changes stay below the delta limit, the count limit ends the refits
+	for (uint32_t i = 0; i < MAX_BLAS_REFITS; ++i)
+	{
+		UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.001f, true) == BLASUpdate::Refit);
+	}
+	UNTITLED_CHECK(state.numRefits == MAX_BLAS_REFITS && !state.preferFastBuild);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.001f, true) == BLASUpdate::FastBuild);
+	UNTITLED_CHECK(state.preferFastBuild && state.numRefits == MAX_BLAS_REFITS);
+	UNTITLED_CHECK(policy.GetStats().numRefits == MAX_BLAS_REFITS && policy.GetStats().numFastBuilds == 1);
+	UNTITLED_CHECK(policy.GetStats().numTopologyBuilds == 0);
+}
+
+UNTITLED_TEST(BLASUpdatePolicyLimitsRefitDelta)
+{
+	BLASUpdatePolicy policy;
+	BLASUpdateState state = CreateBuiltState(policy, 400, 600);
+
+	// The delta adds up over the refits, reaching the limit exactly is still allowed
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, MAX_BLAS_REFIT_DELTA / 2, true) == BLASUpdate::Refit);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, MAX_BLAS_REFIT_DELTA / 2, true) == BLASUpdate::Refit);
+	UNTITLED_CHECK(state.geometryDelta == MAX_BLAS_REFIT_DELTA);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.01f, true) == BLASUpdate::FastBuild);
+
+	// A single change larger than the limit is built right away
+	BLASUpdateState other = CreateBuiltState(policy, 400, 600);
+	UNTITLED_CHECK(policy.OnGeometryChanged(other, 400, 600, MAX_BLAS_REFIT_DELTA + 0.01f, true) == BLASUpdate::FastBuild);
+	UNTITLED_CHECK(other.numRefits == 0 && other.geometryDelta == 0.0f);
+}
+
+UNTITLED_TEST(BLASUpdatePolicyRebuildsIdleStructures)
+{
+	BLASUpdatePolicy policy;
+
+	// Structures built for tracing and never refit stay as they are
+	BLASUpdateState state = CreateBuiltState(policy, 400, 600);
+	UNTITLED_CHECK(!policy.OnIdle(state));
+	UNTITLED_CHECK(policy.GetStats().numFastTraceBuilds == 0);
+
+	// Refit structures are built for tracing again
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.01f, true) == BLASUpdate::Refit);
+	UNTITLED_CHECK(policy.OnIdle(state));
+	UNTITLED_CHECK(!state.preferFastBuild && policy.GetStats().numFastTraceBuilds == 1);
+
+	// So are structures that were built for speed
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 404, 606, 1.0f, true) == BLASUpdate::FastBuild);
+	policy.OnBuilt(state, 404, 606);
+	UNTITLED_CHECK(state.fastBuilt);
+	UNTITLED_CHECK(policy.OnIdle(state));
+	UNTITLED_CHECK(!state.preferFastBuild && policy.GetStats().numFastTraceBuilds == 2);
+
+	// Once that build has been recorded, the structure is idle for good
+	policy.OnBuilt(state, 404, 606);
+	UNTITLED_CHECK(!state.fastBuilt && !policy.OnIdle(state));
+	UNTITLED_CHECK(policy.GetStats().numFastTraceBuilds == 2);
+}
+
+UNTITLED_TEST(BLASUpdatePolicyResetsOnBuild)
+{
+	BLASUpdatePolicy policy;
+	BLASUpdateState state = CreateBuiltState(policy, 400, 600);
+	for (uint32_t i = 0; i < MAX_BLAS_REFITS; ++i)
+	{
+		policy.OnGeometryChanged(state, 400, 600, 0.01f, true);
+	}
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.01f, true) == BLASUpdate::FastBuild);
+
+	// A build takes the new geometry, forgets the refits and keeps the flags it was built with
+	policy.OnBuilt(state, 404, 606);
+	UNTITLED_CHECK(state.vertexCount == 404 && state.indexCount == 606);
+	UNTITLED_CHECK(state.numRefits == 0 && state.geometryDelta == 0.0f && state.fastBuilt);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 404, 606, 0.01f, true) == BLASUpdate::Refit);
+	UNTITLED_CHECK(policy.OnGeometryChanged(state, 400, 600, 0.01f, true) == BLASUpdate::FastBuild);
+}
@@ -0,0 +1,302 @@
+#include "PCH.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/Test.h"
+#include "Game/ChunkMesher.h"
+
+using namespace DirectX;
+
+// Cell faces covered by the quads of a mesh, counted per face direction and cell of the LOD the mesh was made at
+struct CoveredFaces
+{
+	int width;
+	eastl::vector<uint8_t> counts;
+	uint32_t numQuads = 0;
+	// Quads that aren't axis aligned rectangles on the cell grid, or whose block type differs from the voxels below
+	uint32_t numInvalidQuads = 0;
+
+	explicit CoveredFaces(uint32_t lod) :
+		width(static_cast<int>(VOXEL_CHUNK_WIDTH >> lod)),
+		counts(NUM_FACE_DIRECTIONS * width * width * width, 0)
+	{
+	}
+
+	inline uint8_t& At(uint32_t face, int x, int y, int z)
+	{
+		return counts[((face * width + z) * width + y) * width + x];
+	}
+};
+
+static void CoverQuads(const Chunk& chunk, eastl::span<const Vertex> vertices, uint32_t lod, CoveredFaces& covered)
+{
+	const int cellWidth = 1 << lod;
+	for (size_t quad = 0; quad + 4 <= vertices.size(); quad += 4)
+	{
+		int min[3] = { INT_MAX, INT_MAX, INT_MAX };
+		int max[3] = { INT_MIN, INT_MIN, INT_MIN };
+		for (size_t i = quad; i < quad + 4; ++i)
+		{
+			const XMINT3 position = GetVertexPosition(vertices[i]);
+			const int coordinates[3] = { position.x, position.y, position.z };
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				min[axis] = eastl::min(min[axis], coordinates[axis]);
+				max[axis] = eastl::max(max[axis], coordinates[axis]);
+			}
+		}
+
+		// Unused quads of a section are collapsed into a point
+		if (min[0] == max[0] && min[1] == max[1] && min[2] == max[2]) continue;
+		covered.numQuads++;
+
+		// Faces pointing along the positive direction of their axis lie on the far side of their cells
+		const uint32_t face = GetVertexFaceIndex(vertices[quad]);
+		const FillType type = GetVertexBlockType(vertices[quad]);
+		const int d = (face < 2) ? 2 : (face < 4) ? 0 : 1;
+		const bool positive = (face & 1) == 0;
+		bool valid = min[d] == max[d];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			valid &= (min[axis] % cellWidth) == 0 && (max[axis] % cellWidth) == 0;
+		}
+		if (!valid)
+		{
+			covered.numInvalidQuads++;
+			continue;
+		}
+
+		max[d] = min[d] + (positive ? 0 : cellWidth);
+		min[d] = max[d] - cellWidth;
+		for (int z = min[2]; z < max[2]; z += cellWidth)
+		{
+			for (int y = min[1]; y < max[1]; y += cellWidth)
+			{
+				for (int x = min[0]; x < max[0]; x += cellWidth)
+				{
+					covered.At(face, x >> lod, y >> lod, z >> lod)++;
+					if (lod == 0 && chunk.GetVoxel(x, y, z) != type) covered.numInvalidQuads++;
+					if (lod > 0 && type != FillType::Solid) covered.numInvalidQuads++;
+				}
+			}
+		}
+	}
+}
+
+// Whether the face of a cell is visible, without neighboring chunks. At LOD 0 the faces of the chunk decide,
+// coarser cells are hidden by any occupied cell next to them.
+static bool IsCellFaceVisible(const Chunk& chunk, uint32_t lod, uint32_t face, int x, int y, int z)
+{
+	if (lod == 0) return chunk.HasVisibleFace(static_cast<VisibleFaces>(1 << face), x, y, z);
+	if (!chunk.occupancy.IsOccupied(lod, x, y, z)) return false;
+
+	const int offsets[NUM_FACE_DIRECTIONS][3] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 } };
+	const int width = static_cast<int>(OccupancyPyramid::GetWidth(lod));
+	const int nx = x + offsets[face][0], ny = y + offsets[face][1], nz = z + offsets[face][2];
+	if (nx < 0 || ny < 0 || nz < 0 || nx >= width || ny >= width || nz >= width) return true;
+	return !chunk.occupancy.IsOccupied(lod, nx, ny, nz);
+}
+
+// Number of cell faces that are visible but not covered exactly once, or covered although they are hidden
+static uint32_t CountCoverageMismatches(const Chunk& chunk, uint32_t lod, CoveredFaces& covered)
+{
+	uint32_t mismatches = 0;
+	for (uint32_t face = 0; face < NUM_FACE_DIRECTIONS; ++face)
+	{
+		for (int z = 0; z < covered.width; ++z)
+		{
+			for (int y = 0; y < covered.width; ++y)
+			{
+				for (int x = 0; x < covered.width; ++x)
+				{
+					const uint8_t expected = IsCellFaceVisible(chunk, lod, face, x, y, z) ? 1 : 0;
+					mismatches += covered.At(face, x, y, z) != expected ? 1 : 0;
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+static uint32_t CountMeshMismatches(const Chunk& chunk)
+{
+	CoveredFaces covered(chunk.mesh.lod);
+	CoverQuads(chunk, { chunk.mesh.vertices.data(), chunk.mesh.vertices.size() }, chunk.mesh.lod, covered);
+	return covered.numInvalidQuads + CountCoverageMismatches(chunk, chunk.mesh.lod, covered);
+}
+
+static uint32_t CountMeshQuads(const Chunk& chunk)
+{
+	uint32_t quads = 0;
+	for (const MeshSection& section : chunk.mesh.sections)
+	{
+		quads += section.quadCount;
+	}
+	return quads;
+}
+
+UNTITLED_TEST(MeshesCoverEveryVisibleFaceOnce)
+{
+	auto hills = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	auto noise = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 1);
+	ChunkFixtures::FillHills(*hills);
+	ChunkFixtures::FillRandom(*noise, 5, 0.3f, 0.2f);
+
+	for (Chunk* chunk : { hills.get(), noise.get() })
+	{
+		for (MeshingMode mode : { MeshingMode::Naive, MeshingMode::Greedy })
+		{
+			ChunkMesher::GenerateMesh(*chunk, mode, 0);
+			UNTITLED_CHECK(chunk->mesh.mode == mode && chunk->mesh.lod == 0);
+			UNTITLED_CHECK(CountMeshMismatches(*chunk) == 0);
+
+			// The naive mesher emits a quad per face, the greedy one merges them
+			const uint32_t quads = CountMeshQuads(*chunk);
+			UNTITLED_CHECK(mode == MeshingMode::Naive ? quads == chunk->CountVisibleFaces() : quads < chunk->CountVisibleFaces());
+		}
+	}
+}
+
+UNTITLED_TEST(GreedyMeshMergesSolidSections)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::Fill(*chunk, [](int, int, int) { return FillType::Solid; });
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		UNTITLED_CHECK(chunk->IsSectionUniform(section, FillType::Solid));
+	}
+
+	// Every section face on the outside of the chunk becomes a single quad
+	constexpr uint32_t sectionsPerSide = SECTIONS_PER_AXIS * SECTIONS_PER_AXIS;
+	ChunkMesher::GenerateMesh(*chunk, MeshingMode::Greedy, 0);
+	UNTITLED_CHECK(CountMeshQuads(*chunk) == NUM_FACE_DIRECTIONS * sectionsPerSide);
+	UNTITLED_CHECK(CountMeshMismatches(*chunk) == 0);
+
+	ChunkMesher::GenerateMesh(*chunk, MeshingMode::Naive, 0);
+	UNTITLED_CHECK(CountMeshQuads(*chunk) == NUM_FACE_DIRECTIONS * VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+}
+
+UNTITLED_TEST(LODMeshesCoverEveryVisibleCellFaceOnce)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+
+	uint32_t previousQuads = eastl::numeric_limits<uint32_t>::max();
+	for (uint32_t lod = 1; lod <= OccupancyPyramid::NUM_LEVELS; ++lod)
+	{
+		for (MeshingMode mode : { MeshingMode::Naive, MeshingMode::Greedy })
+		{
+			ChunkMesher::GenerateMesh(*chunk, mode, lod);
+			UNTITLED_CHECK(chunk->mesh.lod == lod);
+			UNTITLED_CHECK(CountMeshMismatches(*chunk) == 0);
+
+			uint32_t bound = 0;
+			for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+			{
+				bound += ChunkMesher::CountSectionQuads(*chunk, section, lod);
+			}
+			UNTITLED_CHECK(mode == MeshingMode::Naive ? CountMeshQuads(*chunk) == bound : CountMeshQuads(*chunk) <= bound);
+		}
+
+		// Coarser levels never need more quads
+		UNTITLED_CHECK(CountMeshQuads(*chunk) <= previousQuads);
+		previousQuads = CountMeshQuads(*chunk);
+	}
+}
+
+UNTITLED_TEST(SectionsReserveSpareQuads)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+
+	for (uint32_t lod : { 0u, 2u })
+	{
+		ChunkMesher::GenerateMesh(*chunk, MeshingMode::Greedy, lod);
+
+		// Ranges follow each other in section order, the unused quads of each collapse into its origin
+		uint32_t firstQuad = 0;
+		for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+		{
+			const MeshSection& range = chunk->mesh.sections[section];
+			UNTITLED_CHECK(range.firstQuad == firstQuad);
+			UNTITLED_CHECK(range.quadCapacity == range.quadCount + range.quadCount / 4 + (lod == 0 ? MESH_SECTION_SPARE_QUADS : 0));
+			firstQuad += range.quadCapacity;
+
+			const XMINT3 origin = GetSectionOrigin(section);
+			for (uint32_t quad = range.firstQuad + range.quadCount; quad < range.firstQuad + range.quadCapacity; ++quad)
+			{
+				const XMINT3 position = GetVertexPosition(chunk->mesh.vertices[quad * 4]);
+				UNTITLED_CHECK(position.x == origin.x && position.y == origin.y && position.z == origin.z);
+			}
+		}
+		UNTITLED_CHECK(chunk->mesh.vertices.size() == firstQuad * 4);
+		UNTITLED_CHECK(chunk->mesh.indices.size() == firstQuad * 6);
+		UNTITLED_CHECK(chunk->dirtySections == 0);
+	}
+}
+
+UNTITLED_TEST(RemeshedSectionsPatchTheMesh)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	ChunkMesher::GenerateMesh(*chunk, MeshingMode::Greedy, 0);
+
+	// Raises a small pillar on the surface, which touches a few neighboring sections
+	const XMINT3 min { 15, 30, 15 };
+	const XMINT3 max { 16, 33, 16 };
+	eastl::vector<uint64_t> rows(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH, 0);
+	for (int z = min.z; z <= max.z; ++z)
+	{
+		for (int y = min.y; y <= max.y; ++y)
+		{
+			rows[GetColumnIndex(y, z)] = 3ull << min.x;
+		}
+	}
+	UNTITLED_CHECK(chunk->SetVoxels(rows.data(), FillType::Solid, min, max));
+	chunk->CompactSections(chunk->dirtySections);
+	const uint64_t dirtySections = chunk->dirtySections;
+
+	eastl::span<const Vertex> patch;
+	eastl::fixed_vector<DXBufferRegion, NUM_SECTIONS, false> regions;
+	UNTITLED_CHECK(ChunkMesher::RemeshDirtySections(*chunk, patch, regions));
+	UNTITLED_CHECK(!regions.empty() && regions.size() <= static_cast<size_t>(std::popcount(dirtySections)));
+
+	// The regions are copied into the vertex buffer like the renderer does
+	uint64_t patchBytes = 0;
+	for (const DXBufferRegion& region : regions)
+	{
+		UNTITLED_CHECK(region.sourceOffset == patchBytes);
+		UNTITLED_CHECK(region.destinationOffset + region.size <= chunk->mesh.vertices.size() * sizeof(Vertex));
+		memcpy(reinterpret_cast<uint8_t*>(chunk->mesh.vertices.data()) + region.destinationOffset,
+			reinterpret_cast<const uint8_t*>(patch.data()) + region.sourceOffset, region.size);
+		patchBytes += region.size;
+	}
+	UNTITLED_CHECK(patchBytes == patch.size() * sizeof(Vertex));
+	UNTITLED_CHECK(CountMeshMismatches(*chunk) == 0);
+}
+
+UNTITLED_TEST(RemeshFailsWhenASectionOutgrowsItsRange)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	ChunkMesher::GenerateMesh(*chunk, MeshingMode::Greedy, 0);
+	const auto sections = chunk->mesh.sections;
+
+	// A checkerboard in the air has six faces per voxel, far more than the spare room of its section
+	const XMINT3 min { 48, 48, 48 };
+	const XMINT3 max { 63, 63, 63 };
+	eastl::vector<uint64_t> rows(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH, 0);
+	for (int z = min.z; z <= max.z; ++z)
+	{
+		for (int y = min.y; y <= max.y; ++y)
+		{
+			rows[GetColumnIndex(y, z)] = (((y + z) & 1) ? 0x5555ull : 0xAAAAull) << min.x;
+		}
+	}
+	UNTITLED_CHECK(chunk->SetVoxels(rows.data(), FillType::Solid, min, max));
+
+	eastl::span<const Vertex> patch;
+	eastl::fixed_vector<DXBufferRegion, NUM_SECTIONS, false> regions;
+	UNTITLED_CHECK(!ChunkMesher::RemeshDirtySections(*chunk, patch, regions));
+	UNTITLED_CHECK(regions.empty());
+	UNTITLED_CHECK(chunk->dirtySections != 0);
+	UNTITLED_CHECK(memcmp(sections.data(), chunk->mesh.sections.data(), sizeof(sections)) == 0);
+}
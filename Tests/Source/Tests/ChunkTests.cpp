@@ -0,0 +1,227 @@
+#include "PCH.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/Test.h"
+
+using namespace DirectX;
+
+// Per-voxel culling the column bitmasks replaced: a face of an occupied voxel is visible unless the voxel next to
+// it is solid. Past the border the neighbor slabs decide, like in the chunk.
+static bool IsFaceVisible(const Chunk& chunk, VisibleFaces face, int x, int y, int z)
+{
+	if (chunk.GetVoxel(x, y, z) == FillType::Empty) return false;
+
+	constexpr int last = VOXEL_CHUNK_WIDTH - 1;
+	const auto& slab = chunk.neighborSlabs[GetFaceIndex(face)];
+	switch (face)
+	{
+	case VisibleFaces::North:	return z < last	? chunk.GetVoxel(x, y, z + 1) != FillType::Solid : !((slab[y] >> x) & 1);
+	case VisibleFaces::South:	return z > 0	? chunk.GetVoxel(x, y, z - 1) != FillType::Solid : !((slab[y] >> x) & 1);
+	case VisibleFaces::East:	return x < last	? chunk.GetVoxel(x + 1, y, z) != FillType::Solid : !((slab[z] >> y) & 1);
+	case VisibleFaces::West:	return x > 0	? chunk.GetVoxel(x - 1, y, z) != FillType::Solid : !((slab[z] >> y) & 1);
+	case VisibleFaces::Top:		return y < last	? chunk.GetVoxel(x, y + 1, z) != FillType::Solid : !((slab[z] >> x) & 1);
+	case VisibleFaces::Bottom:	return y > 0	? chunk.GetVoxel(x, y - 1, z) != FillType::Solid : !((slab[z] >> x) & 1);
+	default:					return false;
+	}
+}
+
+// Number of voxel faces whose culled bit differs from the reference
+static uint32_t CountCullingMismatches(const Chunk& chunk)
+{
+	uint32_t mismatches = 0;
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					const VisibleFaces direction = static_cast<VisibleFaces>(face);
+					mismatches += chunk.HasVisibleFace(direction, x, y, z) != IsFaceVisible(chunk, direction, x, y, z) ? 1 : 0;
+				}
+			}
+		}
+	}
+	return mismatches;
+}
+
+static bool ColumnsMatchVoxels(const Chunk& chunk)
+{
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+			{
+				const FillType type = chunk.GetVoxel(x, y, z);
+				const bool occupied = (chunk.occupiedColumns[GetColumnIndex(y, z)] >> x) & 1;
+				if (occupied != (type != FillType::Empty) || chunk.IsSolid(x, y, z) != (type == FillType::Solid)) return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool PyramidsMatch(const OccupancyPyramid& a, const OccupancyPyramid& b)
+{
+	for (uint32_t level = 1; level <= OccupancyPyramid::NUM_LEVELS; ++level)
+	{
+		const int width = static_cast<int>(OccupancyPyramid::GetWidth(level));
+		for (int z = 0; z < width; ++z)
+		{
+			for (int y = 0; y < width; ++y)
+			{
+				if (a.GetRow(level, y, z) != b.GetRow(level, y, z)) return false;
+			}
+		}
+	}
+	return true;
+}
+
+UNTITLED_TEST(CullFacesMatchesPerVoxelCulling)
+{
+	auto hills = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*hills);
+	UNTITLED_CHECK(ColumnsMatchVoxels(*hills));
+	UNTITLED_CHECK(CountCullingMismatches(*hills) == 0);
+
+	// Transparent voxels are occupied but don't hide the faces next to them
+	auto noise = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillRandom(*noise, 1, 0.4f, 0.2f);
+	UNTITLED_CHECK(ColumnsMatchVoxels(*noise));
+	UNTITLED_CHECK(CountCullingMismatches(*noise) == 0);
+}
+
+UNTITLED_TEST(NeighborSlabsHideBorderFaces)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	auto neighbor = eastl::make_unique<Chunk>(XMINT3 { static_cast<int>(VOXEL_CHUNK_WIDTH), 0, 0 }, 1);
+	ChunkFixtures::FillRandom(*chunk, 2, 0.5f, 0.1f);
+	ChunkFixtures::FillRandom(*neighbor, 3, 0.5f, 0.1f);
+
+	// Without neighbors every border face of an occupied voxel is visible
+	UNTITLED_CHECK(chunk->HasVisibleFace(VisibleFaces::East, VOXEL_CHUNK_WIDTH - 1, 0, 0) == (chunk->GetVoxel(VOXEL_CHUNK_WIDTH - 1, 0, 0) != FillType::Empty));
+
+	// The west layer of the neighbor covers the east layer of the chunk
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> slab;
+	neighbor->GetBorderSlab(VisibleFaces::West, slab);
+	chunk->dirtySections = 0;
+	UNTITLED_CHECK(chunk->SetNeighborSlab(VisibleFaces::East, slab));
+	UNTITLED_CHECK(!chunk->SetNeighborSlab(VisibleFaces::East, slab));
+	UNTITLED_CHECK(CountCullingMismatches(*chunk) == 0);
+
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			const bool covered = neighbor->GetVoxel(0, y, z) == FillType::Solid;
+			const bool occupied = chunk->GetVoxel(VOXEL_CHUNK_WIDTH - 1, y, z) != FillType::Empty;
+			UNTITLED_CHECK(chunk->HasVisibleFace(VisibleFaces::East, VOXEL_CHUNK_WIDTH - 1, y, z) == (occupied && !covered));
+		}
+	}
+
+	// Only the sections on the east side have to be remeshed
+	uint64_t eastSections = 0;
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		eastSections |= (GetSectionOrigin(section).x + SECTION_WIDTH == VOXEL_CHUNK_WIDTH) ? 1ull << section : 0;
+	}
+	UNTITLED_CHECK(chunk->dirtySections == eastSections);
+
+	// An empty slab tells the chunk the neighbor is gone
+	slab.fill(0);
+	UNTITLED_CHECK(chunk->SetNeighborSlab(VisibleFaces::East, slab));
+	UNTITLED_CHECK(CountCullingMismatches(*chunk) == 0);
+}
+
+UNTITLED_TEST(BorderSlabsMatchTheirLayer)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillRandom(*chunk, 4, 0.5f);
+
+	constexpr int last = VOXEL_CHUNK_WIDTH - 1;
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> slab;
+		chunk->GetBorderSlab(static_cast<VisibleFaces>(face), slab);
+		for (int i = 0; i < VOXEL_CHUNK_WIDTH; ++i)
+		{
+			for (int j = 0; j < VOXEL_CHUNK_WIDTH; ++j)
+			{
+				// Laid out as the neighbor on that side stores them, see Chunk::neighborSlabs
+				bool solid = false;
+				switch (face)
+				{
+				case VisibleFaces::North:	solid = chunk->IsSolid(j, i, last); break;
+				case VisibleFaces::South:	solid = chunk->IsSolid(j, i, 0); break;
+				case VisibleFaces::East:	solid = chunk->IsSolid(last, j, i); break;
+				case VisibleFaces::West:	solid = chunk->IsSolid(0, j, i); break;
+				case VisibleFaces::Top:		solid = chunk->IsSolid(j, last, i); break;
+				case VisibleFaces::Bottom:	solid = chunk->IsSolid(j, 0, i); break;
+				}
+				UNTITLED_CHECK(((slab[i] >> j) & 1) == (solid ? 1u : 0u));
+			}
+		}
+	}
+}
+
+UNTITLED_TEST(SetVoxelsUpdatesFacesAndOccupancy)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	chunk->dirtySections = 0;
+
+	// Digs a box through the surface, one of its sections is covered completely and becomes uniform
+	const XMINT3 min { 10, 8, 30 };
+	const XMINT3 max { 40, 35, 50 };
+	eastl::vector<uint64_t> rows(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH, 0);
+	for (int z = min.z; z <= max.z; ++z)
+	{
+		for (int y = min.y; y <= max.y; ++y)
+		{
+			rows[GetColumnIndex(y, z)] = ((1ull << (max.x - min.x + 1)) - 1) << min.x;
+		}
+	}
+
+	// Only the voxels that don't have the type yet change, the box holds all three types
+	for (FillType type : { FillType::Empty, FillType::Solid, FillType::Transparent })
+	{
+		uint32_t numOtherTypes = 0;
+		for (int z = min.z; z <= max.z; ++z)
+		{
+			for (int y = min.y; y <= max.y; ++y)
+			{
+				for (int x = min.x; x <= max.x; ++x)
+				{
+					numOtherTypes += chunk->GetVoxel(x, y, z) != type ? 1 : 0;
+				}
+			}
+		}
+		UNTITLED_CHECK(chunk->CountChangedVoxels(rows.data(), type, min, max) == numOtherTypes);
+	}
+	UNTITLED_CHECK(chunk->SetVoxels(rows.data(), FillType::Empty, min, max));
+	UNTITLED_CHECK(chunk->CountChangedVoxels(rows.data(), FillType::Empty, min, max) == 0);
+	UNTITLED_CHECK(chunk->edited && chunk->unsaved);
+	UNTITLED_CHECK(chunk->GetVoxel(20, 20, 40) == FillType::Empty);
+	UNTITLED_CHECK(chunk->IsSectionUniform(GetSectionIndex(16, 16, 32), FillType::Empty));
+	UNTITLED_CHECK(ColumnsMatchVoxels(*chunk));
+	UNTITLED_CHECK(CountCullingMismatches(*chunk) == 0);
+
+	OccupancyPyramid rebuilt;
+	rebuilt.Build(chunk->occupiedColumns.data());
+	UNTITLED_CHECK(PyramidsMatch(chunk->occupancy, rebuilt));
+
+	// The box and the voxels next to it are dirty, nothing else
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		const XMINT3 origin = GetSectionOrigin(section);
+		const bool touched = origin.x <= max.x + 1 && origin.x + static_cast<int>(SECTION_WIDTH) > min.x - 1 &&
+			origin.y <= max.y + 1 && origin.y + static_cast<int>(SECTION_WIDTH) > min.y - 1 &&
+			origin.z <= max.z + 1 && origin.z + static_cast<int>(SECTION_WIDTH) > min.z - 1;
+		UNTITLED_CHECK(((chunk->dirtySections >> section) & 1) == (touched ? 1u : 0u));
+	}
+
+	// A brush without any voxels doesn't touch the chunk
+	eastl::fill(rows.begin(), rows.end(), 0);
+	UNTITLED_CHECK(!chunk->SetVoxels(rows.data(), FillType::Solid, min, max));
+}
@@ -0,0 +1,111 @@
+#include "PCH.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/Test.h"
+#include "Game/ColdChunkCache.h"
+
+using namespace DirectX;
+
+static bool VoxelsMatch(const Chunk& a, const Chunk& b)
+{
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+			{
+				if (a.GetVoxel(x, y, z) != b.GetVoxel(x, y, z)) return false;
+			}
+		}
+	}
+	return true;
+}
+
+UNTITLED_TEST(ColdChunkCacheRoundTrips)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 64, 0, -128 }, 0);
+	ChunkFixtures::FillRandom(*chunk, 5, 0.4f, 0.2f);
+	chunk->edited = true;
+
+	ColdChunkCache cache(eastl::numeric_limits<size_t>::max());
+	cache.Insert(*chunk);
+	UNTITLED_CHECK(cache.GetNumEntries() == 1);
+
+	eastl::vector<uint8_t> data;
+	UNTITLED_CHECK(!cache.Take(XMINT3 { 0, 0, 0 }, data));
+	UNTITLED_CHECK(cache.Take(chunk->position, data));
+	UNTITLED_CHECK(cache.GetNumEntries() == 0 && cache.GetSize() == 0);
+
+	auto restored = eastl::make_unique<Chunk>(chunk->position, 0);
+	cache.Decompress(data, *restored);
+	UNTITLED_CHECK(VoxelsMatch(*chunk, *restored));
+	UNTITLED_CHECK(restored->edited && !restored->unsaved);
+}
+
+UNTITLED_TEST(ColdChunkCacheKeepsUnsavedEntries)
+{
+	// The budget holds two entries, the unsaved one has to outlive the saved ones inserted after it
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillRandom(*chunk, 6, 0.5f);
+	ColdChunkCache sizing(eastl::numeric_limits<size_t>::max());
+	sizing.Insert(*chunk);
+	const size_t budget = sizing.GetSize() * 5 / 2;
+	ColdChunkCache cache(budget);
+
+	chunk->edited = true;
+	chunk->unsaved = true;
+	cache.Insert(*chunk);
+	UNTITLED_CHECK(cache.GetNumUnsaved() == 1 && !cache.NeedsWriteBack());
+
+	chunk->unsaved = false;
+	for (int i = 1; i <= 3; ++i)
+	{
+		chunk->position = XMINT3 { i * VOXEL_CHUNK_WIDTH, 0, 0 };
+		cache.Insert(*chunk);
+	}
+	eastl::vector<uint8_t> data;
+	UNTITLED_CHECK(cache.GetNumEntries() == 2 && cache.GetSize() <= budget);
+	UNTITLED_CHECK(cache.GetNumUnsaved() == 1 && cache.NeedsWriteBack());
+	UNTITLED_CHECK(!cache.Take(XMINT3 { 2 * VOXEL_CHUNK_WIDTH, 0, 0 }, data));
+
+	// A failed write back keeps the entry, a successful one lets it be evicted like any other
+	auto scratch = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	uint32_t numSaves = 0;
+	cache.WriteBack(*scratch, [&](Chunk& cachedChunk)
+	{
+		numSaves += cachedChunk.unsaved ? 1 : 0;
+		return false;
+	});
+	UNTITLED_CHECK(numSaves == 1 && cache.GetNumUnsaved() == 1 && cache.NeedsWriteBack());
+
+	XMINT3 savedPosition { -1, -1, -1 };
+	bool voxelsMatch = false;
+	cache.WriteBack(*scratch, [&](Chunk& cachedChunk)
+	{
+		savedPosition = cachedChunk.position;
+		voxelsMatch = VoxelsMatch(*chunk, cachedChunk);
+		return true;
+	});
+	UNTITLED_CHECK(savedPosition.x == 0 && savedPosition.y == 0 && savedPosition.z == 0 && voxelsMatch);
+	UNTITLED_CHECK(cache.GetNumUnsaved() == 0 && !cache.NeedsWriteBack() && cache.GetNumEntries() == 2);
+
+	chunk->position = XMINT3 { 4 * VOXEL_CHUNK_WIDTH, 0, 0 };
+	cache.Insert(*chunk);
+	UNTITLED_CHECK(cache.GetNumEntries() == 2 && !cache.NeedsWriteBack());
+	UNTITLED_CHECK(!cache.Take(XMINT3 { 0, 0, 0 }, data));
+}
+
+UNTITLED_TEST(ColdChunkCacheCountsTakenUnsavedEntries)
+{
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	chunk->unsaved = true;
+
+	ColdChunkCache cache(eastl::numeric_limits<size_t>::max());
+	cache.Insert(*chunk);
+	cache.Insert(*chunk);
+	UNTITLED_CHECK(cache.GetNumEntries() == 1 && cache.GetNumUnsaved() == 1);
+
+	eastl::vector<uint8_t> data;
+	UNTITLED_CHECK(cache.Take(chunk->position, data));
+	UNTITLED_CHECK(cache.GetNumUnsaved() == 0);
+}
@@ -0,0 +1,124 @@
+#include "PCH.h"
+#include "Core/DirtyRanges.h"
+#include "Framework/Random.h"
+#include "Framework/Test.h"
+
+struct Run
+{
+	uint32_t first;
+	uint32_t count;
+
+	inline bool operator ==(const Run& other) const { return first == other.first && count == other.count; }
+};
+
+template<size_t Size, size_t NumCopies, uint32_t MaxGap>
+static eastl::vector<Run> Consume(DirtyRanges<Size, NumCopies, MaxGap>& ranges, uint32_t copyIndex)
+{
+	eastl::vector<Run> runs;
+	ranges.Consume(copyIndex, [&](uint32_t first, uint32_t count) { runs.push_back({ first, count }); });
+	return runs;
+}
+
+// Runs of marked elements found one element at a time, joined across gaps of at most maxGap elements
+static eastl::vector<Run> GetReferenceRuns(const eastl::vector<bool>& marked, uint32_t maxGap)
+{
+	eastl::vector<Run> runs;
+	for (uint32_t i = 0; i < marked.size(); ++i)
+	{
+		if (!marked[i]) continue;
+		if (!runs.empty() && runs.back().first + runs.back().count + maxGap >= i)
+		{
+			runs.back().count = i + 1 - runs.back().first;
+		}
+		else
+		{
+			runs.push_back({ i, 1 });
+		}
+	}
+	return runs;
+}
+
+UNTITLED_TEST(DirtyRangesJoinsRunsAcrossWords)
+{
+	DirtyRanges<256, 1> ranges;
+	for (uint32_t i = 60; i < 70; ++i)
+	{
+		ranges.Mark(i);
+	}
+
+	// Full words in the middle of a run, and a run ending on the last element
+	for (uint32_t i = 120; i < 256; ++i)
+	{
+		ranges.Mark(i);
+	}
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 60, 10 }, { 120, 136 } }));
+	UNTITLED_CHECK(ranges.IsEmpty(0) && Consume(ranges, 0).empty());
+
+	// Single elements on both sides of a word boundary
+	ranges.Mark(63);
+	ranges.Mark(64);
+	ranges.Mark(191);
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 63, 2 }, { 191, 1 } }));
+
+	ranges.MarkAll();
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 0, 256 } }));
+}
+
+UNTITLED_TEST(DirtyRangesJoinsRunsWithinMaxGap)
+{
+	DirtyRanges<256, 1, 4> ranges;
+
+	// Gaps of four elements are joined, gaps of five aren't, also across word boundaries
+	ranges.Mark(10);
+	ranges.Mark(15);
+	ranges.Mark(21);
+	ranges.Mark(61);
+	ranges.Mark(66);
+	ranges.Mark(127);
+	ranges.Mark(133);
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 10, 6 }, { 21, 1 }, { 61, 6 }, { 127, 1 }, { 133, 1 } }));
+
+	// A run that is joined keeps growing over the following gaps
+	for (uint32_t i = 130; i < 200; i += 5)
+	{
+		ranges.Mark(i);
+	}
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 130, 66 } }));
+}
+
+UNTITLED_TEST(DirtyRangesMatchesReference)
+{
+	Random random(23);
+	DirtyRanges<1024, 1, 4> gapRanges;
+	DirtyRanges<1024, 1> ranges;
+	for (int round = 0; round < 200; ++round)
+	{
+		// Sparse marks and clusters of marks, both leave short and long gaps
+		eastl::vector<bool> marked(1024, false);
+		const uint32_t numMarks = 1 + random.Below(round % 2 == 0 ? 16 : 512);
+		for (uint32_t i = 0; i < numMarks; ++i)
+		{
+			const uint32_t index = random.Below(1024);
+			marked[index] = true;
+			gapRanges.Mark(index);
+			ranges.Mark(index);
+		}
+		UNTITLED_CHECK(Consume(gapRanges, 0) == GetReferenceRuns(marked, 4));
+		UNTITLED_CHECK(Consume(ranges, 0) == GetReferenceRuns(marked, 0));
+	}
+}
+
+UNTITLED_TEST(DirtyRangesTracksCopies)
+{
+	// Every copy sees every mark once, no matter when it is consumed
+	DirtyRanges<128, 3> ranges;
+	ranges.Mark(5);
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 5, 1 } }));
+	UNTITLED_CHECK(ranges.IsEmpty(0) && !ranges.IsEmpty(1) && !ranges.IsEmpty(2));
+
+	ranges.Mark(100);
+	UNTITLED_CHECK((Consume(ranges, 1) == eastl::vector<Run> { { 5, 1 }, { 100, 1 } }));
+	UNTITLED_CHECK((Consume(ranges, 0) == eastl::vector<Run> { { 100, 1 } }));
+	UNTITLED_CHECK((Consume(ranges, 2) == eastl::vector<Run> { { 5, 1 }, { 100, 1 } }));
+	UNTITLED_CHECK(ranges.IsEmpty(0) && ranges.IsEmpty(1) && ranges.IsEmpty(2));
+}
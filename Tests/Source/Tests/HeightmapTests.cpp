@@ -0,0 +1,123 @@
+#include "PCH.h"
+#include "Framework/Random.h"
+#include "Framework/Test.h"
+#include "Game/Heightmap.h"
+
+using namespace DirectX;
+
+// Heights of a column slice covering every height a chunk can see, including the empty and the full column
+static void FillSliceHeights(int8_t* heights, Random& random)
+{
+	for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+	{
+		heights[x] = static_cast<int8_t>(x < 2 ? x * VOXEL_CHUNK_WIDTH : random.Below(VOXEL_CHUNK_WIDTH + 1));
+	}
+}
+
+// Number of voxels whose bit differs from the per-voxel y < height check
+static uint32_t CountRowMismatches(const int8_t* heights, const uint64_t* rows)
+{
+	uint32_t mismatches = 0;
+	for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+	{
+		for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+		{
+			mismatches += ((rows[y] >> x) & 1) != (y < heights[x] ? 1u : 0u) ? 1 : 0;
+		}
+	}
+	return mismatches;
+}
+
+UNTITLED_TEST(HeightmapRowsMatchVoxels)
+{
+	Random random(18);
+	alignas(32) eastl::array<int8_t, VOXEL_CHUNK_WIDTH> heights;
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> rows;
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> scalarRows;
+	for (int slice = 0; slice < 256; ++slice)
+	{
+		FillSliceHeights(heights.data(), random);
+		FillHeightmapRows(heights.data(), rows.data());
+		FillHeightmapRowsScalar(heights.data(), scalarRows.data());
+		UNTITLED_CHECK(CountRowMismatches(heights.data(), rows.data()) == 0);
+		UNTITLED_CHECK(rows == scalarRows);
+	}
+
+	// Every column at the same height, which lands all of them in the same bucket of the scalar fill
+	for (int height = 0; height <= VOXEL_CHUNK_WIDTH; ++height)
+	{
+		heights.fill(static_cast<int8_t>(height));
+		FillHeightmapRows(heights.data(), rows.data());
+		FillHeightmapRowsScalar(heights.data(), scalarRows.data());
+		UNTITLED_CHECK(CountRowMismatches(heights.data(), rows.data()) == 0);
+		UNTITLED_CHECK(rows == scalarRows);
+	}
+}
+
+UNTITLED_TEST(HeightmapChunkMatchesVoxels)
+{
+	// Surfaces in world space that pass through, stay below and stay above the chunks stacked at these heights
+	Random random(19);
+	eastl::array<int32_t, VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH> heights;
+	for (int32_t& height : heights)
+	{
+		height = static_cast<int32_t>(random.Below(4 * VOXEL_CHUNK_WIDTH)) - 2 * VOXEL_CHUNK_WIDTH;
+	}
+
+	for (int chunkY = -3; chunkY <= 2; ++chunkY)
+	{
+		auto chunk = eastl::make_unique<Chunk>(XMINT3 { 128, chunkY * VOXEL_CHUNK_WIDTH, -64 }, 0);
+		FillHeightmapColumns(*chunk, heights.data());
+		chunk->FillSections();
+
+		uint32_t mismatches = 0;
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+				{
+					const bool below = y + chunk->position.y < heights[z * VOXEL_CHUNK_WIDTH + x];
+					const FillType expected = below ? FillType::Solid : FillType::Empty;
+					mismatches += chunk->GetVoxel(x, y, z) != expected ? 1 : 0;
+					mismatches += chunk->IsSolid(x, y, z) != below ? 1 : 0;
+					mismatches += ((chunk->occupiedColumns[GetColumnIndex(y, z)] >> x) & 1) != (below ? 1u : 0u) ? 1 : 0;
+				}
+			}
+		}
+		UNTITLED_CHECK(mismatches == 0);
+
+		// Sections entirely below the surface store a single type
+		for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+		{
+			const XMINT3 origin = GetSectionOrigin(section);
+			bool allSolid = true;
+			for (int z = origin.z; z < origin.z + static_cast<int>(SECTION_WIDTH); ++z)
+			{
+				for (int x = origin.x; x < origin.x + static_cast<int>(SECTION_WIDTH); ++x)
+				{
+					allSolid &= origin.y + static_cast<int>(SECTION_WIDTH) + chunk->position.y <= heights[z * VOXEL_CHUNK_WIDTH + x];
+				}
+			}
+			UNTITLED_CHECK(!allSolid || chunk->IsSectionUniform(section, FillType::Solid));
+		}
+	}
+}
+
+UNTITLED_TEST(HeightmapSurfaceCeiling)
+{
+	UNTITLED_CHECK(GetSurfaceCeiling(0.0f) == 0);
+	UNTITLED_CHECK(GetSurfaceCeiling(3.0f) == 3);
+	UNTITLED_CHECK(GetSurfaceCeiling(-3.0f) == -3);
+
+	Random random(20);
+	for (int i = 0; i < 100000; ++i)
+	{
+		const float surface = (random.Float() - 0.5f) * 4.0f * VOXEL_CHUNK_WIDTH;
+		UNTITLED_CHECK(GetSurfaceCeiling(surface) == static_cast<int32_t>(ceilf(surface)));
+
+		// Every voxel below the ceiling is below the surface and the one at the ceiling isn't
+		const int32_t ceiling = GetSurfaceCeiling(surface);
+		UNTITLED_CHECK(static_cast<float>(ceiling - 1) < surface && !(static_cast<float>(ceiling) < surface));
+	}
+}
@@ -0,0 +1,139 @@
+#include "PCH.h"
+#include "Framework/ChunkFixtures.h"
+#include "Framework/Test.h"
+#include "Game/RegionFile.h"
+
+using namespace DirectX;
+
+static const char* const TEST_REGION_PATH = "RegionFileTests.region";
+
+static bool VoxelsMatch(const Chunk& a, const Chunk& b)
+{
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+			{
+				if (a.GetVoxel(x, y, z) != b.GetVoxel(x, y, z)) return false;
+			}
+		}
+	}
+	return true;
+}
+
+static uint32_t GetIndex(const Chunk& chunk)
+{
+	return GetRegionChunkIndex(GetChunkCoordinate(chunk.position));
+}
+
+static bool LoadMatches(const RegionFile& regionFile, const Chunk& chunk)
+{
+	auto loaded = eastl::make_unique<Chunk>(chunk.position, 0);
+	return regionFile.LoadChunk(GetIndex(chunk), *loaded) && VoxelsMatch(chunk, *loaded) && loaded->edited == chunk.edited;
+}
+
+UNTITLED_TEST(RegionFileRoundTrips)
+{
+	remove(TEST_REGION_PATH);
+
+	// Mixed, random and uniform sections
+	eastl::array<eastl::unique_ptr<Chunk>, 3> chunks;
+	chunks[0] = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	chunks[1] = eastl::make_unique<Chunk>(XMINT3 { VOXEL_CHUNK_WIDTH, 0, 0 }, 0);
+	chunks[2] = eastl::make_unique<Chunk>(XMINT3 { 0, 2 * VOXEL_CHUNK_WIDTH, 3 * VOXEL_CHUNK_WIDTH }, 0);
+	ChunkFixtures::FillHills(*chunks[0]);
+	ChunkFixtures::FillRandom(*chunks[1], 15, 0.4f, 0.2f);
+	ChunkFixtures::Fill(*chunks[2], [](int, int y, int) { return y < 32 ? FillType::Solid : FillType::Empty; });
+	eastl::array<Chunk*, 3> chunksToSave;
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		chunks[i]->edited = i != 1;
+		chunks[i]->unsaved = true;
+		chunksToSave[i] = chunks[i].get();
+	}
+
+	{
+		RegionFile regionFile;
+		UNTITLED_CHECK(!regionFile.Open(TEST_REGION_PATH, false));
+		UNTITLED_CHECK(regionFile.Open(TEST_REGION_PATH, true));
+		UNTITLED_CHECK(regionFile.SaveChunks({ chunksToSave.data(), chunksToSave.size() }));
+		UNTITLED_CHECK(!chunks[0]->unsaved && !chunks[1]->unsaved && !chunks[2]->unsaved);
+	}
+
+	// Everything is read back from the file
+	RegionFile regionFile;
+	UNTITLED_CHECK(regionFile.Open(TEST_REGION_PATH, false));
+	for (const auto& chunk : chunks)
+	{
+		UNTITLED_CHECK(regionFile.HasChunk(GetIndex(*chunk)) && LoadMatches(regionFile, *chunk));
+	}
+	UNTITLED_CHECK(!regionFile.HasChunk(GetRegionChunkIndex(XMINT3 { 5, 5, 5 })));
+	auto missing = eastl::make_unique<Chunk>(XMINT3 { 5 * VOXEL_CHUNK_WIDTH, 0, 0 }, 0);
+	UNTITLED_CHECK(!regionFile.LoadChunk(GetIndex(*missing), *missing));
+}
+
+UNTITLED_TEST(RegionFileReusesReplacedPayloads)
+{
+	remove(TEST_REGION_PATH);
+
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillRandom(*chunk, 16, 0.5f);
+	Chunk* chunkToSave = chunk.get();
+
+	uint64_t size = 0;
+	{
+		RegionFile regionFile;
+		UNTITLED_CHECK(regionFile.Open(TEST_REGION_PATH, true));
+		const uint64_t emptySize = regionFile.GetSize();
+		UNTITLED_CHECK(regionFile.SaveChunks({ &chunkToSave, 1 }));
+		const uint64_t payloadSize = regionFile.GetSize() - emptySize;
+
+		// The payload of the same size isn't written over the one the table points at, the one after it goes
+		// to the space of the first
+		UNTITLED_CHECK(regionFile.SaveChunks({ &chunkToSave, 1 }) && regionFile.GetSize() == emptySize + 2 * payloadSize);
+		UNTITLED_CHECK(LoadMatches(regionFile, *chunk));
+		UNTITLED_CHECK(regionFile.SaveChunks({ &chunkToSave, 1 }) && regionFile.GetSize() == emptySize + 2 * payloadSize);
+		UNTITLED_CHECK(LoadMatches(regionFile, *chunk));
+
+		// Smaller payloads fit into the free space too
+		ChunkFixtures::FillHills(*chunk);
+		UNTITLED_CHECK(regionFile.SaveChunks({ &chunkToSave, 1 }) && regionFile.GetSize() == emptySize + 2 * payloadSize);
+		UNTITLED_CHECK(LoadMatches(regionFile, *chunk));
+		size = regionFile.GetSize();
+	}
+
+	// The free space is found again from the table
+	RegionFile regionFile;
+	UNTITLED_CHECK(regionFile.Open(TEST_REGION_PATH, false) && LoadMatches(regionFile, *chunk));
+	ChunkFixtures::FillRandom(*chunk, 17, 0.5f);
+	UNTITLED_CHECK(regionFile.SaveChunks({ &chunkToSave, 1 }) && regionFile.GetSize() == size);
+	UNTITLED_CHECK(LoadMatches(regionFile, *chunk));
+}
+
+UNTITLED_TEST(RegionFileRejectsCorruptedPayloads)
+{
+	remove(TEST_REGION_PATH);
+
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	ChunkFixtures::FillHills(*chunk);
+	Chunk* chunkToSave = chunk.get();
+	uint64_t size = 0;
+	{
+		RegionFile regionFile;
+		UNTITLED_CHECK(regionFile.Open(TEST_REGION_PATH, true) && regionFile.SaveChunks({ &chunkToSave, 1 }));
+		size = regionFile.GetSize();
+	}
+
+	// The last byte of the file belongs to the payload
+	{
+		MappedFile file;
+		UNTITLED_CHECK(file.Open(TEST_REGION_PATH, false) && file.GetSize() == size);
+		const uint8_t corrupted = file.GetData()[size - 1] ^ 0xFF;
+		UNTITLED_CHECK(file.Write(size - 1, &corrupted, 1));
+	}
+	RegionFile regionFile;
+	auto loaded = eastl::make_unique<Chunk>(chunk->position, 0);
+	UNTITLED_CHECK(regionFile.Open(TEST_REGION_PATH, false) && regionFile.HasChunk(GetIndex(*chunk)));
+	UNTITLED_CHECK(!regionFile.LoadChunk(GetIndex(*chunk), *loaded));
+}
@@ -0,0 +1,171 @@
+#include "PCH.h"
+#include "Framework/Random.h"
+#include "Framework/Test.h"
+#include "Graphics/Memory/TLSFAllocator.h"
+
+UNTITLED_TEST(TLSFAllocatorSplitsAndMerges)
+{
+	TLSFAllocator allocator(1024 * 256, 256);
+	UNTITLED_CHECK(allocator.IsEmpty() && allocator.GetNumFreeRanges() == 1);
+
+	// Allocations are taken from the front of the block, the rest stays free behind them
+	TLSFAllocator::Allocation a, b, c;
+	UNTITLED_CHECK(allocator.Allocate(100 * 256, a) && allocator.Allocate(200 * 256, b) && allocator.Allocate(300 * 256, c));
+	UNTITLED_CHECK(a.offset == 0 && b.offset == 100 * 256 && c.offset == 300 * 256);
+	UNTITLED_CHECK(allocator.GetNumAllocations() == 3 && allocator.GetNumFreeRanges() == 1);
+	UNTITLED_CHECK(allocator.GetUsedSize() == 600 * 256 && allocator.GetLargestFreeRange() == 424 * 256);
+
+	// A range between two allocations stays on its own, freeing a neighbor merges them
+	allocator.Free(b);
+	UNTITLED_CHECK(b.node == TLSFAllocator::INVALID_NODE);
+	UNTITLED_CHECK(allocator.GetNumFreeRanges() == 2 && allocator.GetFreeSize() == 624 * 256);
+	allocator.Free(a);
+	UNTITLED_CHECK(allocator.GetNumFreeRanges() == 2 && allocator.GetLargestFreeRange() == 424 * 256);
+
+	// The merged range is reused for a request whose size class it fits, and merges with the rest once c is gone
+	TLSFAllocator::Allocation d;
+	UNTITLED_CHECK(allocator.Allocate(288 * 256, d) && d.offset == 0);
+	allocator.Free(d);
+	allocator.Free(c);
+	UNTITLED_CHECK(allocator.IsEmpty() && allocator.GetNumFreeRanges() == 1);
+	UNTITLED_CHECK(allocator.GetUsedSize() == 0 && allocator.GetLargestFreeRange() == allocator.GetSize());
+
+	TLSFAllocator::Allocation whole;
+	UNTITLED_CHECK(allocator.Allocate(allocator.GetSize(), whole) && whole.offset == 0 && allocator.GetNumFreeRanges() == 0);
+	UNTITLED_CHECK(!allocator.Allocate(256, d));
+	allocator.Free(whole);
+	UNTITLED_CHECK(allocator.IsEmpty() && allocator.GetNumFreeRanges() == 1);
+}
+
+UNTITLED_TEST(TLSFAllocatorAlignsRanges)
+{
+	TLSFAllocator allocator(64 * 1024, 256);
+
+	// Sizes are rounded up to the alignment, so every offset is aligned and no two ranges overlap
+	const eastl::array<uint64_t, 6> sizes { 1, 255, 256, 257, 1000, 4097 };
+	eastl::array<TLSFAllocator::Allocation, 6> allocations;
+	uint64_t usedSize = 0;
+	uint64_t end = 0;
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		UNTITLED_CHECK(allocator.Allocate(sizes[i], allocations[i]));
+		UNTITLED_CHECK(allocations[i].offset % 256 == 0 && allocations[i].offset >= end);
+		end = allocations[i].offset + sizes[i];
+		usedSize += (sizes[i] + 255) / 256 * 256;
+	}
+	UNTITLED_CHECK(allocator.GetUsedSize() == usedSize);
+	UNTITLED_CHECK(allocations[1].offset == 256 && allocations[4].offset == 5 * 256 && allocations[5].offset == 9 * 256);
+
+	for (TLSFAllocator::Allocation& allocation : allocations)
+	{
+		allocator.Free(allocation);
+	}
+	UNTITLED_CHECK(allocator.IsEmpty() && allocator.GetLargestFreeRange() == allocator.GetSize());
+}
+
+UNTITLED_TEST(TLSFAllocatorSearchesSizeClassOfRequest)
+{
+	// A block of 41 units lies in the size class of 40 and 41 units. Requests are rounded up to the next class
+	// to find a range that is large enough right away, only the list of their own class can still hold the block.
+	TLSFAllocator allocator(41 * 256, 256);
+	TLSFAllocator::Allocation whole;
+	UNTITLED_CHECK(allocator.Allocate(41 * 256, whole) && whole.offset == 0);
+	allocator.Free(whole);
+
+	// Ranges of the same class that are too small aren't taken
+	TLSFAllocator split(81 * 256, 256);
+	TLSFAllocator::Allocation a, b, c, d;
+	UNTITLED_CHECK(split.Allocate(40 * 256, a) && split.Allocate(256, b) && split.Allocate(40 * 256, c));
+	split.Free(a);
+	split.Free(c);
+	UNTITLED_CHECK(split.GetNumFreeRanges() == 2 && split.GetFreeSize() == 80 * 256);
+	UNTITLED_CHECK(!split.Allocate(41 * 256, d));
+	UNTITLED_CHECK(split.Allocate(40 * 256, d) && (d.offset == 0 || d.offset == 41 * 256));
+
+	// Small sizes each have a class of their own
+	TLSFAllocator small(15 * 256, 256);
+	UNTITLED_CHECK(small.Allocate(15 * 256, whole) && !small.Allocate(256, a));
+}
+
+UNTITLED_TEST(TLSFAllocatorReportsFragmentation)
+{
+	TLSFAllocator allocator(100 * 256, 256);
+	UNTITLED_CHECK(allocator.GetFragmentation() == 0.0f);
+
+	// Four equal free ranges, the largest one holds a quarter of the free memory
+	eastl::array<TLSFAllocator::Allocation, 8> allocations;
+	for (TLSFAllocator::Allocation& allocation : allocations)
+	{
+		UNTITLED_CHECK(allocator.Allocate(10 * 256, allocation));
+	}
+	TLSFAllocator::Allocation rest;
+	UNTITLED_CHECK(allocator.Allocate(20 * 256, rest));
+	UNTITLED_CHECK(allocator.GetFreeSize() == 0 && allocator.GetFragmentation() == 0.0f);
+	for (size_t i = 0; i < allocations.size(); i += 2)
+	{
+		allocator.Free(allocations[i]);
+	}
+	UNTITLED_CHECK(allocator.GetLargestFreeRange() == 10 * 256 && allocator.GetFragmentation() == 0.75f);
+
+	// Freeing the ranges in between merges everything into one piece again
+	for (size_t i = 1; i < allocations.size(); i += 2)
+	{
+		allocator.Free(allocations[i]);
+	}
+	UNTITLED_CHECK(allocator.GetLargestFreeRange() == 80 * 256 && allocator.GetFragmentation() == 0.0f);
+	allocator.Free(rest);
+	UNTITLED_CHECK(allocator.GetNumFreeRanges() == 1 && allocator.GetLargestFreeRange() == allocator.GetSize());
+}
+
+UNTITLED_TEST(TLSFAllocatorSurvivesChurn)
+{
+	// Random allocations and frees, checked against the ranges that are handed out
+	constexpr uint64_t size = 4096 * 256;
+	TLSFAllocator allocator(size, 256);
+	Random random(25);
+
+	struct Range
+	{
+		TLSFAllocator::Allocation allocation;
+		uint64_t size;
+	};
+	eastl::vector<Range> ranges;
+	uint64_t usedSize = 0;
+	bool valid = true;
+	for (int step = 0; step < 20000; ++step)
+	{
+		if (!ranges.empty() && (random.Below(2) == 0 || usedSize > size * 3 / 4))
+		{
+			const size_t index = random.Below(static_cast<uint32_t>(ranges.size()));
+			usedSize -= ranges[index].size;
+			allocator.Free(ranges[index].allocation);
+			ranges[index] = ranges.back();
+			ranges.pop_back();
+		}
+		else
+		{
+			const uint64_t rangeSize = (1 + random.Below(random.Below(4) == 0 ? 512 : 16)) * 256;
+			Range range { {}, rangeSize };
+			if (!allocator.Allocate(rangeSize, range.allocation)) continue;
+			valid &= range.allocation.offset + rangeSize <= size;
+			usedSize += rangeSize;
+			ranges.push_back(range);
+		}
+		valid &= allocator.GetUsedSize() == usedSize && allocator.GetNumAllocations() == ranges.size();
+	}
+	UNTITLED_CHECK(valid);
+
+	// None of the ranges overlap
+	eastl::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.allocation.offset < b.allocation.offset; });
+	for (size_t i = 1; i < ranges.size(); ++i)
+	{
+		valid &= ranges[i - 1].allocation.offset + ranges[i - 1].size <= ranges[i].allocation.offset;
+	}
+	UNTITLED_CHECK(valid);
+
+	for (Range& range : ranges)
+	{
+		allocator.Free(range.allocation);
+	}
+	UNTITLED_CHECK(allocator.IsEmpty() && allocator.GetNumFreeRanges() == 1 && allocator.GetLargestFreeRange() == size);
+}
@@ -0,0 +1,58 @@
+#include "PCH.h"
+#include "Framework/Test.h"
+#include "Game/Chunk.h"
+
+using namespace DirectX;
+
+static bool RoundTrips(XMINT3 position, VisibleFaces face, FillType type)
+{
+	const Vertex vertex = PackVertex(position, face, type);
+	const XMINT3 unpacked = GetVertexPosition(vertex);
+	return unpacked.x == position.x && unpacked.y == position.y && unpacked.z == position.z &&
+		GetVertexFaceIndex(vertex) == GetFaceIndex(face) && GetVertexBlockType(vertex) == type;
+}
+
+UNTITLED_TEST(PackedVerticesAreEightBytes)
+{
+	UNTITLED_CHECK(sizeof(Vertex) == 8);
+}
+
+UNTITLED_TEST(PackedVertexPositionsRoundTrip)
+{
+	// Quads span up to the far side of the chunk, so corners reach one past the last voxel
+	uint32_t mismatches = 0;
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		for (int z = 0; z <= VOXEL_CHUNK_WIDTH; ++z)
+		{
+			for (int y = 0; y <= VOXEL_CHUNK_WIDTH; ++y)
+			{
+				for (int x = 0; x <= VOXEL_CHUNK_WIDTH; ++x)
+				{
+					mismatches += RoundTrips({ x, y, z }, static_cast<VisibleFaces>(face), FillType::Solid) ? 0 : 1;
+				}
+			}
+		}
+	}
+	UNTITLED_CHECK(mismatches == 0);
+}
+
+UNTITLED_TEST(PackedVertexBlockTypesRoundTrip)
+{
+	// Every type the 13 bits next to the face index can hold, at the corners of the chunk
+	uint32_t mismatches = 0;
+	for (uint32_t type = 0; type < (1 << 13); ++type)
+	{
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			const XMINT3 position {
+				(corner & 1) ? static_cast<int>(VOXEL_CHUNK_WIDTH) : 0,
+				(corner & 2) ? static_cast<int>(VOXEL_CHUNK_WIDTH) : 0,
+				(corner & 4) ? static_cast<int>(VOXEL_CHUNK_WIDTH) : 0
+			};
+			mismatches += RoundTrips(position, VisibleFaces::Bottom, static_cast<FillType>(type)) ? 0 : 1;
+			mismatches += RoundTrips(position, VisibleFaces::North, static_cast<FillType>(type)) ? 0 : 1;
+		}
+	}
+	UNTITLED_CHECK(mismatches == 0);
+}
@@ -0,0 +1,195 @@
+#include "PCH.h"
+#include "Framework/Random.h"
+#include "Framework/Test.h"
+#include "Game/VoxelStorage.h"
+
+// Block types beyond the named ones, the storage only cares about distinct values
+static FillType GetType(uint32_t i)
+{
+	return static_cast<FillType>(i);
+}
+
+// Fills the storage and a plain copy with random types out of the first numTypes
+static void FillRandom(VoxelStorage& storage, eastl::vector<FillType>& expected, uint32_t numTypes, uint64_t seed)
+{
+	Random random(seed);
+	for (uint32_t i = 0; i < expected.size(); ++i)
+	{
+		expected[i] = GetType(random.Below(numTypes));
+		storage.Set(i, expected[i]);
+	}
+}
+
+static bool Matches(const VoxelStorage& storage, const eastl::vector<FillType>& expected)
+{
+	for (uint32_t i = 0; i < expected.size(); ++i)
+	{
+		if (storage.Get(i) != expected[i]) return false;
+	}
+	return true;
+}
+
+UNTITLED_TEST(VoxelStorageStartsUniform)
+{
+	VoxelStorage storage(4096, FillType::Solid);
+	UNTITLED_CHECK(storage.IsUniform());
+	UNTITLED_CHECK(storage.Get(0) == FillType::Solid && storage.Get(4095) == FillType::Solid);
+
+	// Setting the type it already has doesn't allocate indices
+	storage.Set(17, FillType::Solid);
+	UNTITLED_CHECK(storage.IsUniform());
+	UNTITLED_CHECK(storage.GetWords().empty());
+
+	storage.Set(17, FillType::Empty);
+	UNTITLED_CHECK(!storage.IsUniform());
+	UNTITLED_CHECK(storage.GetBitsPerIndex() == 1);
+	UNTITLED_CHECK(storage.GetWords().size() == 4096 / 64);
+	UNTITLED_CHECK(storage.Get(17) == FillType::Empty && storage.Get(16) == FillType::Solid && storage.Get(18) == FillType::Solid);
+}
+
+UNTITLED_TEST(VoxelStorageWidensIndicesWithThePalette)
+{
+	// Every width holds up to 2^bits types, one more doubles it
+	const eastl::array<eastl::pair<uint32_t, uint32_t>, 5> widths { {
+		{ 2, 1 }, { 3, 2 }, { 5, 4 }, { 17, 8 }, { 257, 16 }
+	} };
+
+	for (const auto& [numTypes, bits] : widths)
+	{
+		VoxelStorage storage(4096);
+		eastl::vector<FillType> expected(4096, FillType::Empty);
+
+		// Every type is set once before the random fill, so the palette reaches its full size
+		for (uint32_t type = 0; type < numTypes; ++type)
+		{
+			storage.Set(type, GetType(type));
+			expected[type] = GetType(type);
+		}
+		UNTITLED_CHECK(storage.GetPaletteSize() == numTypes);
+		UNTITLED_CHECK(storage.GetBitsPerIndex() == bits);
+		UNTITLED_CHECK(Matches(storage, expected));
+
+		FillRandom(storage, expected, numTypes, numTypes);
+		UNTITLED_CHECK(storage.GetBitsPerIndex() == bits);
+		UNTITLED_CHECK(Matches(storage, expected));
+	}
+}
+
+UNTITLED_TEST(VoxelStorageMatchAgreesWithGet)
+{
+	for (uint32_t numTypes : { 2u, 3u, 5u, 17u })
+	{
+		VoxelStorage storage(4096);
+		eastl::vector<FillType> expected(4096, FillType::Empty);
+		FillRandom(storage, expected, numTypes, 7 * numTypes);
+
+		// Rows of a section are 16 voxels, which never straddle a word at any width
+		for (uint32_t first = 0; first < 4096; first += 16)
+		{
+			for (uint32_t type = 0; type < numTypes + 1; ++type)
+			{
+				uint64_t reference = 0;
+				for (uint32_t i = 0; i < 16; ++i)
+				{
+					reference |= static_cast<uint64_t>(expected[first + i] == GetType(type)) << i;
+				}
+				UNTITLED_CHECK(storage.Match(first, 16, GetType(type)) == reference);
+			}
+		}
+	}
+
+	// Whole words of 1 bit indices
+	VoxelStorage storage(4096);
+	eastl::vector<FillType> expected(4096, FillType::Empty);
+	FillRandom(storage, expected, 2, 3);
+	for (uint32_t first = 0; first < 4096; first += 64)
+	{
+		uint64_t reference = 0;
+		for (uint32_t i = 0; i < 64; ++i)
+		{
+			reference |= static_cast<uint64_t>(expected[first + i] == FillType::Solid) << i;
+		}
+		UNTITLED_CHECK(storage.Match(first, 64, FillType::Solid) == reference);
+		UNTITLED_CHECK(storage.Match(first, 64, FillType::Empty) == ~reference);
+	}
+}
+
+UNTITLED_TEST(VoxelStorageCompactShrinksThePalette)
+{
+	VoxelStorage storage(4096);
+	eastl::vector<FillType> expected(4096, FillType::Empty);
+	FillRandom(storage, expected, 5, 11);
+	UNTITLED_CHECK(storage.GetBitsPerIndex() == 4);
+
+	// Two types are left, which fit into 1 bit indices again
+	for (uint32_t i = 0; i < expected.size(); ++i)
+	{
+		expected[i] = (expected[i] == GetType(3)) ? FillType::Solid : FillType::Transparent;
+		storage.Set(i, expected[i]);
+	}
+	storage.Compact();
+	UNTITLED_CHECK(storage.GetPaletteSize() == 2);
+	UNTITLED_CHECK(storage.GetBitsPerIndex() == 1);
+	UNTITLED_CHECK(Matches(storage, expected));
+
+	// A single type left makes the storage uniform
+	for (uint32_t i = 0; i < expected.size(); ++i)
+	{
+		storage.Set(i, FillType::Solid);
+	}
+	storage.Compact();
+	UNTITLED_CHECK(storage.IsUniform());
+	UNTITLED_CHECK(storage.Get(1234) == FillType::Solid);
+}
+
+UNTITLED_TEST(VoxelStorageFillReleasesIndices)
+{
+	VoxelStorage storage(4096);
+	eastl::vector<FillType> expected(4096, FillType::Empty);
+	FillRandom(storage, expected, 3, 5);
+	const size_t usedMemory = storage.GetMemoryUsage();
+
+	storage.Fill(FillType::Transparent);
+	UNTITLED_CHECK(storage.IsUniform());
+	UNTITLED_CHECK(storage.GetMemoryUsage() < usedMemory);
+	UNTITLED_CHECK(storage.Get(0) == FillType::Transparent && storage.Get(4095) == FillType::Transparent);
+	UNTITLED_CHECK(storage.Match(64, 64, FillType::Transparent) == ~0ull);
+}
+
+UNTITLED_TEST(VoxelStorageAssignRoundTrips)
+{
+	for (uint32_t numTypes : { 1u, 2u, 3u, 17u })
+	{
+		VoxelStorage storage(4096);
+		eastl::vector<FillType> expected(4096, FillType::Empty);
+		FillRandom(storage, expected, numTypes, 13 * numTypes);
+
+		// The words are read from an unaligned copy, like a payload of a region file
+		const auto words = storage.GetWords();
+		eastl::vector<uint8_t> bytes(words.size() * sizeof(uint64_t) + 1);
+		memcpy(bytes.data() + 1, words.data(), words.size() * sizeof(uint64_t));
+
+		VoxelStorage restored(4096, FillType::Solid);
+		restored.Assign(storage.GetPalette(), std::countr_zero(storage.GetBitsPerIndex()), storage.IsUniform() ? nullptr : bytes.data() + 1);
+		UNTITLED_CHECK(restored.IsUniform() == storage.IsUniform());
+		UNTITLED_CHECK(restored.GetBitsPerIndex() == storage.GetBitsPerIndex());
+		UNTITLED_CHECK(Matches(restored, expected));
+	}
+}
+
+UNTITLED_TEST(VoxelStorageAssignUniformResetsIndices)
+{
+	// Storage with wide indices becomes uniform, the next writes widen it again from single bits
+	VoxelStorage storage(4096);
+	eastl::vector<FillType> expected(4096, FillType::Empty);
+	FillRandom(storage, expected, 17, 21);
+	UNTITLED_CHECK(storage.GetBitsPerIndex() > 1);
+
+	const FillType uniformType = FillType::Solid;
+	storage.Assign({ &uniformType, 1 }, 0, nullptr);
+	UNTITLED_CHECK(storage.IsUniform() && storage.GetBitsPerIndex() == 1 && storage.Get(4095) == FillType::Solid);
+
+	expected.assign(4096, FillType::Solid);
+	FillRandom(storage, expected, 17, 22);
+	UNTITLED_CHECK(Matches(storage, expected));
+}
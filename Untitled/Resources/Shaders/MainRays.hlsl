@@ -135,7 +135,7 @@ void MainGen()
 void MainAnyHit(inout MainHitInfo payload, Attributes attrib)
 {
 	//Vertex vertex = GetCurrentVertex();
-	//if ((uint)vertex.position.w == 1)
+	//if (GetVertexBlockType(vertex) == 2)
 	//{
 	//	IgnoreHit();
 	//}
@@ -150,7 +150,7 @@ void MainHit(inout MainHitInfo payload, Attributes attrib)
 {
 	Vertex vertex = GetCurrentVertex();
 
-	float3 N = vertex.normal.xyz;
+	float3 N = GetVertexNormal(vertex);
 	float3 sun_dir = normalize(-g_Constants.sunDirection.xyz);
 	
 	// Compute the Lambertian term N.L
@@ -164,7 +164,7 @@ void MainHit(inout MainHitInfo payload, Attributes attrib)
 	float3 shade_color = visibility * NdotL * float4(0.995, 0.6, 0.385, 1.0);
 	payload.color = float4(shade_color, 1.0);
 
-	if (asuint(vertex.position.w) == l_PickBuffer[0])
+	if (InstanceID() == l_PickBuffer[0] && GetHitVoxelIndex(vertex) == (l_PickBuffer[1] & 0xFFFFFF))
 	{
 		payload.color += (float4(0.995, 0.6, 0.385, 1.0) * 0.5);
 	}
@@ -134,7 +134,7 @@ void MainGen()
 void MainAnyHit(inout MainHitInfo payload, Attributes attrib)
 {
 	//Vertex vertex = GetCurrentVertex();
-	//if ((uint)vertex.position.w == 1)
+	//if (GetVertexBlockType(vertex) == 2)
 	//{
 	//	IgnoreHit();
 	//}
@@ -157,7 +157,7 @@ void MainHit(inout MainHitInfo payload, Attributes attrib)
 	uint2 launchDim = DispatchRaysDimensions().xy;
 
 	Vertex vertex = GetCurrentVertex();
-	float3 N = vertex.normal.xyz;
+	float3 N = GetVertexNormal(vertex);
 	float3 NT, NB;
 	GetCubeTangents(N, NT, NB);
 	
@@ -181,7 +181,7 @@ void MainHit(inout MainHitInfo payload, Attributes attrib)
 	ao /= 8.0;
 	payload.color = ao;
 
-	//if (asuint(vertex.position.w) == l_PickBuffer[0])
+	//if (InstanceID() == l_PickBuffer[0] && GetHitVoxelIndex(vertex) == (l_PickBuffer[1] & 0xFFFFFF))
 	//{
 	//	payload.color += (float4(0.995, 0.6, 0.385, 1.0) * 0.5);
 	//}
@@ -97,8 +97,10 @@ void PickGen()
 void PickHit(inout PickHitInfo payload, Attributes attrib)
 {
 	Vertex v = GetCurrentVertex();
-	l_PickBuffer[0] = asuint(v.position.w);
-	l_PickBuffer[1] = asuint(v.normal.w);
+
+	// Matches the layout of BlockIdentifier
+	l_PickBuffer[0] = InstanceID();
+	l_PickBuffer[1] = GetHitVoxelIndex(v) | ((1u << GetVertexFaceIndex(v)) << 24);
 }
 
 [shader("miss")]
@@ -1,5 +1,46 @@
 #define PI 3.14159265359
 
+// Decoding of the packed Vertex, see RaytracingSharedHlsl.h
+float3 GetVertexPosition(Vertex v)
+{
+	return float3(f16tof32(v.positionXY), f16tof32(v.positionXY >> 16), f16tof32(v.positionZData));
+}
+
+uint GetVertexFaceIndex(Vertex v)
+{
+	return (v.positionZData >> 16) & 0x7;
+}
+
+uint GetVertexBlockType(Vertex v)
+{
+	return v.positionZData >> 19;
+}
+
+// Face indices follow VisibleFaces: North, South, East, West, Top, Bottom
+float3 GetVertexNormal(Vertex v)
+{
+	static const float3 normals[6] =
+	{
+		float3(0.0f, 0.0f, 1.0f),
+		float3(0.0f, 0.0f, -1.0f),
+		float3(1.0f, 0.0f, 0.0f),
+		float3(-1.0f, 0.0f, 0.0f),
+		float3(0.0f, 1.0f, 0.0f),
+		float3(0.0f, -1.0f, 0.0f)
+	};
+	return normals[GetVertexFaceIndex(v)];
+}
+
+// Index of the voxel hit by the current ray within its chunk, the chunk index is the instance ID.
+// Quads can span several voxels when meshed greedily, so the voxel is found by stepping 
+// half a voxel from the hit position into the surface. 64 has to match VOXEL_CHUNK_WIDTH.
+uint GetHitVoxelIndex(Vertex v)
+{
+	float3 hitPosition = ObjectRayOrigin() + ObjectRayDirection() * RayTCurrent();
+	uint3 voxel = (uint3)clamp(floor(hitPosition - GetVertexNormal(v) * 0.5f), 0.0f, 63.0f);
+	return voxel.x + 64 * (voxel.y + 64 * voxel.z);
+}
+
 // Retrieve hit world position.
 float3 HitWorldPosition()
 {
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Core/Logging.h"
+#include "EABase/eabase.h"
+
+// Tracks the elements of an array that changed since each of its copies was last written, so only those are
+// written again. Every copy has a bit per element and the span of words that have bits set, collecting the
+// ranges of a copy only scans that span. Marks go to a pending set first, which is merged into the copies
+// when one of them is consumed.
+template<size_t Size, size_t NumCopies, uint32_t MaxGap = 0>
+class DirtyRanges
+{
+public:
+	DirtyRanges()
+	{
+		static_assert(Size % 64 == 0 && "Size has to be a multiple of the word size!");
+		pending.words.fill(0);
+		for (Bits& copy : copies)
+		{
+			copy.words.fill(0);
+		}
+	}
+
+	inline void Mark(uint32_t index)
+	{
+		UNTITLED_ASSERT(index < Size && "Index out of range!");
+
+		const uint32_t word = index / 64;
+		pending.words[word] |= 1ull << (index % 64);
+		pending.firstWord = eastl::min(pending.firstWord, word);
+		pending.endWord = eastl::max(pending.endWord, word + 1);
+	}
+
+	inline void MarkAll()
+	{
+		pending.words.fill(~0ull);
+		pending.firstWord = 0;
+		pending.endWord = NUM_WORDS;
+	}
+
+	inline bool IsEmpty(uint32_t copyIndex) const
+	{
+		return pending.IsEmpty() && copies[copyIndex].IsEmpty();
+	}
+
+	// Calls function(first, count) for every run of changed elements of a copy in ascending order. Runs continue across
+	// words, and runs separated by at most MaxGap unchanged elements are joined, since rewriting those is cheaper.
+	template<typename Function>
+	inline void Consume(uint32_t copyIndex, Function function)
+	{
+		MergePending();
+
+		Bits& copy = copies[copyIndex];
+		uint32_t runStart = 0;
+		uint32_t runLength = 0;
+		for (uint32_t word = copy.firstWord; word < copy.endWord; ++word)
+		{
+			uint64_t bits = copy.words[word];
+			copy.words[word] = 0;
+			while (bits != 0)
+			{
+				const uint32_t offset = std::countr_zero(bits);
+				const uint32_t length = std::countr_one(bits >> offset);
+				bits = offset + length == 64 ? 0 : bits & ~(((1ull << length) - 1) << offset);
+
+				const uint32_t first = word * 64 + offset;
+				if (runLength > 0 && runStart + runLength + MaxGap >= first)
+				{
+					runLength = first + length - runStart;
+					continue;
+				}
+				if (runLength > 0)
+				{
+					function(runStart, runLength);
+				}
+				runStart = first;
+				runLength = length;
+			}
+		}
+		if (runLength > 0)
+		{
+			function(runStart, runLength);
+		}
+
+		copy.firstWord = NUM_WORDS;
+		copy.endWord = 0;
+	}
+
+private:
+	static constexpr uint32_t NUM_WORDS = static_cast<uint32_t>(Size / 64);
+
+	struct Bits
+	{
+		eastl::array<uint64_t, NUM_WORDS> words;
+		uint32_t firstWord = NUM_WORDS;
+		uint32_t endWord = 0;
+
+		inline bool IsEmpty() const { return firstWord >= endWord; }
+	};
+	Bits pending;
+	eastl::array<Bits, NumCopies> copies;
+
+	inline void MergePending()
+	{
+		if (pending.IsEmpty()) return;
+
+		for (Bits& copy : copies)
+		{
+			for (uint32_t word = pending.firstWord; word < pending.endWord; ++word)
+			{
+				copy.words[word] |= pending.words[word];
+			}
+			copy.firstWord = eastl::min(copy.firstWord, pending.firstWord);
+			copy.endWord = eastl::max(copy.endWord, pending.endWord);
+		}
+		eastl::fill(pending.words.begin() + pending.firstWord, pending.words.begin() + pending.endWord, 0ull);
+		pending.firstWord = NUM_WORDS;
+		pending.endWord = 0;
+	}
+};
@@ -0,0 +1,105 @@
+#include "PCH.h"
+#include "FileSystem.h"
+
+bool CreateDirectoryIfMissing(const eastl::string& path)
+{
+	return CreateDirectoryA(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+MappedFile::MappedFile() :
+	file(INVALID_HANDLE_VALUE),
+	mapping(nullptr),
+	data(nullptr),
+	size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const eastl::string& path, bool create)
+{
+	Close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		create ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	if (!Map())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+	Unmap();
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool MappedFile::Write(uint64_t offset, const void* source, size_t sourceSize)
+{
+	UNTITLED_ASSERT(IsOpen() && "File hasn't been opened!");
+
+	// The handle is synchronous, so the offset in the overlapped structure is only used to position the write
+	const uint8_t* bytes = static_cast<const uint8_t*>(source);
+	while (sourceSize > 0)
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+		DWORD written = 0;
+		const DWORD chunkSize = static_cast<DWORD>(eastl::min<size_t>(sourceSize, 1u << 30));
+		if (!WriteFile(file, bytes, chunkSize, &written, &overlapped) || written == 0) return false;
+
+		bytes += written;
+		offset += written;
+		sourceSize -= written;
+	}
+	return true;
+}
+
+bool MappedFile::Map()
+{
+	Unmap();
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) return false;
+
+	size = static_cast<uint64_t>(fileSize.QuadPart);
+	if (size == 0) return true;
+
+	// A failed mapping leaves no data and no size behind, instead of a size without data
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	data = mapping ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+	if (!data)
+	{
+		Unmap();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Unmap()
+{
+	if (data)
+	{
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+	if (mapping)
+	{
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	size = 0;
+}
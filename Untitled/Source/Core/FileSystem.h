@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Core/Logging.h"
+
+// Creates a directory, succeeds if it already exists
+bool CreateDirectoryIfMissing(const eastl::string& path);
+
+// File that is mapped read-only into memory. Writes go through the file handle and
+// only show up in the mapping once it has been mapped again, which also covers the
+// parts the file has grown by.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Opens the file for reading and writing and maps it, a missing file is only created if create is set
+	bool Open(const eastl::string& path, bool create);
+	void Close();
+
+	inline bool IsOpen() const { return file != INVALID_HANDLE_VALUE; }
+
+	bool Write(uint64_t offset, const void* source, size_t sourceSize);
+
+	// Maps the whole file, pointers into the previous mapping become invalid
+	bool Map();
+
+	// Empty files can't be mapped and have no data
+	inline const uint8_t* GetData() const { return data; }
+	inline uint64_t GetSize() const { return size; }
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const uint8_t* data;
+	uint64_t size;
+
+	void Unmap();
+};
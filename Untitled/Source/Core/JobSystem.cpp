@@ -0,0 +1,132 @@
+#include "PCH.h"
+#include "JobSystem.h"
+
+#include "Core/Logging.h"
+
+// Index of the queue owned by the current thread, threads outside the pool don't own one
+static thread_local uint32_t currentWorkerIndex = eastl::numeric_limits<uint32_t>::max();
+
+JobSystem::JobSystem(uint32_t numWorkers /*= 0*/) :
+	pendingJobs(0),
+	queuedJobs(0),
+	nextQueue(0),
+	running(true)
+{
+	if (numWorkers == 0)
+	{
+		numWorkers = eastl::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		queues.push_back(eastl::make_unique<WorkerQueue>());
+	}
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		workers.emplace_back([this, i]() { WorkerLoop(i); });
+	}
+
+	UNTITLED_LOG_INFO("Job system started with %u workers\n", numWorkers);
+}
+
+JobSystem::~JobSystem()
+{
+	WaitForAll();
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wakeCondition.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::Submit(Job&& job)
+{
+	// Jobs spawned by a worker stay local to it, everything else is distributed
+	uint32_t queueIndex = currentWorkerIndex;
+	if (queueIndex == eastl::numeric_limits<uint32_t>::max())
+	{
+		queueIndex = nextQueue.fetch_add(1) % static_cast<uint32_t>(queues.size());
+	}
+
+	pendingJobs++;
+	{
+		std::lock_guard<std::mutex> lock(queues[queueIndex]->mutex);
+		queues[queueIndex]->jobs.push_back(eastl::move(job));
+		queuedJobs++;
+	}
+
+	// Taking the sleep mutex ensures a worker can't miss the wake up between checking for work and sleeping
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeCondition.notify_one();
+}
+
+void JobSystem::WaitForAll()
+{
+	while (pendingJobs > 0)
+	{
+		if (!TryRunJob(0))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool JobSystem::TryRunJob(uint32_t queueIndex)
+{
+	Job job;
+	bool found = false;
+
+	// Own queue first, newest job first as it's most likely still in cache
+	{
+		auto& queue = *queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = eastl::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			queuedJobs--;
+			found = true;
+		}
+	}
+
+	// Otherwise steal the oldest job from one of the other queues
+	for (uint32_t i = 1; i < queues.size() && !found; ++i)
+	{
+		auto& queue = *queues[(queueIndex + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = eastl::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			queuedJobs--;
+			found = true;
+		}
+	}
+
+	if (!found) return false;
+
+	job();
+	pendingJobs--;
+	return true;
+}
+
+void JobSystem::WorkerLoop(uint32_t workerIndex)
+{
+	currentWorkerIndex = workerIndex;
+
+	while (running)
+	{
+		if (TryRunJob(workerIndex)) continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeCondition.wait(lock, [this]() { return !running || queuedJobs > 0; });
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+using Job = eastl::function<void()>;
+
+// Fixed pool of worker threads with one job deque per worker. Workers pop their
+// own deque from the back and steal from the front of the other deques when
+// they run dry, jobs submitted from outside the pool are spread round-robin.
+class JobSystem
+{
+public:
+	// A worker count of 0 uses one worker per hardware thread, minus the main thread
+	JobSystem(uint32_t numWorkers = 0);
+	~JobSystem();
+
+	void Submit(Job&& job);
+
+	// Helps executing jobs on the calling thread until all submitted jobs have finished
+	void WaitForAll();
+
+	inline uint32_t GetNumWorkers() const { return static_cast<uint32_t>(workers.size()); }
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		eastl::deque<Job> jobs;
+	};
+
+	eastl::vector<eastl::unique_ptr<WorkerQueue>> queues;
+	eastl::vector<std::thread> workers;
+
+	// Jobs that haven't finished yet and jobs that haven't been picked up by any thread yet
+	std::atomic<uint32_t> pendingJobs;
+	std::atomic<uint32_t> queuedJobs;
+	std::atomic<uint32_t> nextQueue;
+	std::atomic<bool> running;
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+
+	bool TryRunJob(uint32_t queueIndex);
+	void WorkerLoop(uint32_t workerIndex);
+};
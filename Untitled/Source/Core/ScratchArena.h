@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Core/Logging.h"
+
+// Growable bump allocator for short lived scratch memory. Allocations are only
+// released all at once by Reset, which is also the only point where the arena grows,
+// so spans handed out between two resets are never invalidated.
+// Intended to be used thread-local, the arena itself is not thread-safe.
+class ScratchArena
+{
+public:
+	static constexpr size_t ALIGNMENT = 64;
+
+	ScratchArena() : memory(nullptr), capacity(0), offset(0)
+	{
+	}
+
+	~ScratchArena()
+	{
+		Release();
+	}
+
+	ScratchArena(const ScratchArena&) = delete;
+	ScratchArena& operator=(const ScratchArena&) = delete;
+
+	// Discards all allocations and makes sure at least requiredBytes can be allocated.
+	// Each allocation can waste up to ALIGNMENT - 1 bytes, which the caller has to account for
+	inline void Reset(size_t requiredBytes)
+	{
+		offset = 0;
+		if (requiredBytes <= capacity) return;
+
+		// Grow geometrically so a slowly increasing demand doesn't reallocate every time
+		const size_t newCapacity = eastl::max(requiredBytes, capacity * 2);
+		Release();
+		memory = static_cast<uint8_t*>(::operator new[](newCapacity, std::align_val_t(ALIGNMENT)));
+		capacity = newCapacity;
+		totalCapacity += newCapacity;
+	}
+
+	template<typename T>
+	[[nodiscard]] inline eastl::span<T> Allocate(size_t count)
+	{
+		static_assert(alignof(T) <= ALIGNMENT);
+
+		const size_t start = (offset + alignof(T) - 1) & ~(alignof(T) - 1);
+		UNTITLED_ASSERT(start + count * sizeof(T) <= capacity && "Scratch arena is too small, reset it with a larger size!");
+
+		offset = start + count * sizeof(T);
+		return eastl::span<T>(reinterpret_cast<T*>(memory + start), count);
+	}
+
+	inline size_t GetCapacity() const { return capacity; }
+
+	// Capacity of the arenas of all threads together, arenas of threads that have exited are no longer included
+	static inline size_t GetTotalCapacity() { return totalCapacity; }
+
+private:
+	uint8_t* memory;
+	size_t capacity;
+	size_t offset;
+
+	static inline std::atomic<size_t> totalCapacity = 0;
+
+	inline void Release()
+	{
+		if (memory)
+		{
+			::operator delete[](memory, std::align_val_t(ALIGNMENT));
+			totalCapacity -= capacity;
+			memory = nullptr;
+			capacity = 0;
+		}
+	}
+};
@@ -11,6 +11,8 @@ public:
 	{
 	}
 
+	inline bool operator ==(const SparseHandle& other) const { return value == other.value; }
+
 private:
 	template<typename T, size_t Size>
 	friend class SparseArray;
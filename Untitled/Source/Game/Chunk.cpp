@@ -0,0 +1,374 @@
+#include "PCH.h"
+#include "Chunk.h"
+
+using namespace DirectX;
+
+Chunk::Chunk(DirectX::XMINT3 position_, size_t index_) :
+	position(position_),
+	index(index_),
+	needsRebuild(false),
+	patchedVertexBytes(0),
+	state(ChunkState::Generating),
+	removed(false),
+	coarse(false),
+	edited(false),
+	unsaved(false),
+	requestTime(eastl::chrono::steady_clock::now()),
+	dirtySections(0),
+	remeshQueued(false)
+{
+	// The mesh is only generated by the worker, until then it has no quads at all
+	mesh.mode = MeshingMode::Greedy;
+	mesh.lod = 0;
+	mesh.sections.fill(MeshSection { 0, 0, 0 });
+
+	AllocateVoxels();
+	for (auto& slab : neighborSlabs)
+	{
+		slab.fill(0);
+	}
+}
+
+void Chunk::AllocateVoxels()
+{
+	voxelSections.assign(NUM_SECTIONS, VoxelStorage(VOXELS_PER_SECTION));
+	occupiedColumns.assign(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH, 0);
+	solidColumns.assign(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH, 0);
+	for (auto& columns : faceColumns)
+	{
+		columns.assign(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH, 0);
+	}
+	borderSlabs.set_capacity(0);
+}
+
+void Chunk::ReleaseVoxels()
+{
+	UNTITLED_ASSERT(!coarse && dirtySections == 0 && "Chunk can't be made coarse!");
+
+	// The slabs are taken before the columns they are gathered from are gone
+	borderSlabs.resize(NUM_FACE_DIRECTIONS * VOXEL_CHUNK_WIDTH);
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> slab;
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		GetBorderSlab(static_cast<VisibleFaces>(face), slab);
+		eastl::copy(slab.begin(), slab.end(), borderSlabs.begin() + GetFaceIndex(static_cast<VisibleFaces>(face)) * VOXEL_CHUNK_WIDTH);
+	}
+
+	voxelSections.clear();
+	voxelSections.shrink_to_fit();
+	occupiedColumns.set_capacity(0);
+	solidColumns.set_capacity(0);
+	for (auto& columns : faceColumns)
+	{
+		columns.set_capacity(0);
+	}
+	coarse = true;
+}
+
+bool Chunk::SetVoxels(const uint64_t* rows, FillType type, XMINT3 min, XMINT3 max)
+{
+	constexpr int last = VOXEL_CHUNK_WIDTH - 1;
+
+	// Sections covered completely are filled and become uniform, the others are set voxel by voxel
+	for (int sz = min.z >> SECTION_WIDTH_LOG2; sz <= (max.z >> SECTION_WIDTH_LOG2); ++sz)
+	{
+		for (int sy = min.y >> SECTION_WIDTH_LOG2; sy <= (max.y >> SECTION_WIDTH_LOG2); ++sy)
+		{
+			for (int sx = min.x >> SECTION_WIDTH_LOG2; sx <= (max.x >> SECTION_WIDTH_LOG2); ++sx)
+			{
+				const uint32_t section = GetSectionIndex(sx << SECTION_WIDTH_LOG2, sy << SECTION_WIDTH_LOG2, sz << SECTION_WIDTH_LOG2);
+				const XMINT3 origin = GetSectionOrigin(section);
+				const uint64_t sectionMask = ((1ull << SECTION_WIDTH) - 1) << origin.x;
+				const int sectionLast = static_cast<int>(SECTION_WIDTH) - 1;
+				const int beginY = eastl::max(origin.y, min.y), endY = eastl::min(origin.y + sectionLast, max.y);
+				const int beginZ = eastl::max(origin.z, min.z), endZ = eastl::min(origin.z + sectionLast, max.z);
+
+				bool covered = beginY == origin.y && beginZ == origin.z && endY == origin.y + sectionLast && endZ == origin.z + sectionLast;
+				for (int z = beginZ; z <= endZ && covered; ++z)
+				{
+					for (int y = beginY; y <= endY && covered; ++y)
+					{
+						covered = (rows[GetColumnIndex(y, z)] & sectionMask) == sectionMask;
+					}
+				}
+
+				VoxelStorage& storage = voxelSections[section];
+				if (covered)
+				{
+					storage.Fill(type);
+					continue;
+				}
+
+				for (int z = beginZ; z <= endZ; ++z)
+				{
+					for (int y = beginY; y <= endY; ++y)
+					{
+						for (uint64_t bits = rows[GetColumnIndex(y, z)] & sectionMask; bits != 0; bits &= bits - 1)
+						{
+							storage.Set(GetSectionVoxelIndex(std::countr_zero(bits), y, z), type);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Occupancy is updated a whole row at a time
+	bool changed = false;
+	for (int z = min.z; z <= max.z; ++z)
+	{
+		for (int y = min.y; y <= max.y; ++y)
+		{
+			const int column = GetColumnIndex(y, z);
+			const uint64_t mask = rows[column];
+			if (mask == 0) continue;
+
+			occupiedColumns[column] = (type != FillType::Empty) ? (occupiedColumns[column] | mask) : (occupiedColumns[column] & ~mask);
+			solidColumns[column] = (type == FillType::Solid) ? (solidColumns[column] | mask) : (solidColumns[column] & ~mask);
+			occupancy.Update(occupiedColumns.data(), y, z);
+			changed = true;
+		}
+	}
+	if (!changed) return false;
+	edited = true;
+	unsaved = true;
+
+	// Rows cover their x neighbors, the rows around the box cover y and z
+	for (int z = eastl::max(min.z - 1, 0); z <= eastl::min(max.z + 1, last); ++z)
+	{
+		for (int y = eastl::max(min.y - 1, 0); y <= eastl::min(max.y + 1, last); ++y)
+		{
+			CullFacesForRow(y, z);
+		}
+	}
+
+	// The faces of the neighboring voxels changed too, which can lie in the adjacent sections. 
+	// At a coarser LOD the voxels are merged into bigger cells, whose neighbors can lie even further away.
+	const int cellWidth = 1 << mesh.lod;
+	MarkSectionsDirty(
+		XMINT3 { eastl::max((min.x & -cellWidth) - 1, 0), eastl::max((min.y & -cellWidth) - 1, 0), eastl::max((min.z & -cellWidth) - 1, 0) },
+		XMINT3 { eastl::min((max.x | (cellWidth - 1)) + 1, last), eastl::min((max.y | (cellWidth - 1)) + 1, last), eastl::min((max.z | (cellWidth - 1)) + 1, last) });
+	return true;
+}
+
+void Chunk::RebuildColumns()
+{
+	eastl::fill(occupiedColumns.begin(), occupiedColumns.end(), 0);
+	eastl::fill(solidColumns.begin(), solidColumns.end(), 0);
+
+	const uint64_t rowMask = (1ull << SECTION_WIDTH) - 1;
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		const XMINT3 origin = GetSectionOrigin(section);
+		const VoxelStorage& storage = voxelSections[section];
+		for (int z = origin.z; z < origin.z + static_cast<int>(SECTION_WIDTH); ++z)
+		{
+			for (int y = origin.y; y < origin.y + static_cast<int>(SECTION_WIDTH); ++y)
+			{
+				// The voxels of a row within a section are stored next to each other
+				const uint32_t first = GetSectionVoxelIndex(0, y, z);
+				const uint64_t occupied = ~storage.Match(first, SECTION_WIDTH, FillType::Empty) & rowMask;
+				const uint64_t solid = storage.Match(first, SECTION_WIDTH, FillType::Solid);
+
+				occupiedColumns[GetColumnIndex(y, z)] |= occupied << origin.x;
+				solidColumns[GetColumnIndex(y, z)] |= solid << origin.x;
+			}
+		}
+	}
+}
+
+void Chunk::FillSections()
+{
+	const uint64_t rowMask = (1ull << SECTION_WIDTH) - 1;
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		const XMINT3 origin = GetSectionOrigin(section);
+
+		uint64_t anySolid = 0;
+		uint64_t allSolid = rowMask;
+		for (int z = origin.z; z < origin.z + static_cast<int>(SECTION_WIDTH); ++z)
+		{
+			for (int y = origin.y; y < origin.y + static_cast<int>(SECTION_WIDTH); ++y)
+			{
+				const uint64_t row = (solidColumns[GetColumnIndex(y, z)] >> origin.x) & rowMask;
+				anySolid |= row;
+				allSolid &= row;
+			}
+		}
+
+		VoxelStorage& storage = voxelSections[section];
+		if (allSolid == rowMask)
+		{
+			storage.Fill(FillType::Solid);
+		}
+		else if (anySolid != 0)
+		{
+			for (int z = origin.z; z < origin.z + static_cast<int>(SECTION_WIDTH); ++z)
+			{
+				for (int y = origin.y; y < origin.y + static_cast<int>(SECTION_WIDTH); ++y)
+				{
+					for (uint64_t row = solidColumns[GetColumnIndex(y, z)] & (rowMask << origin.x); row != 0; row &= row - 1)
+					{
+						const int x = std::countr_zero(row);
+						storage.Set(GetSectionVoxelIndex(x, y, z), FillType::Solid);
+					}
+				}
+			}
+		}
+	}
+}
+
+void Chunk::CompactSections(uint64_t sections)
+{
+	for (; sections != 0; sections &= sections - 1)
+	{
+		VoxelStorage& storage = voxelSections[std::countr_zero(sections)];
+		if (!storage.IsUniform()) storage.Compact();
+	}
+}
+
+void Chunk::MarkSectionsDirty(XMINT3 min, XMINT3 max)
+{
+	for (int z = min.z >> SECTION_WIDTH_LOG2; z <= (max.z >> SECTION_WIDTH_LOG2); ++z)
+	{
+		for (int y = min.y >> SECTION_WIDTH_LOG2; y <= (max.y >> SECTION_WIDTH_LOG2); ++y)
+		{
+			for (int x = min.x >> SECTION_WIDTH_LOG2; x <= (max.x >> SECTION_WIDTH_LOG2); ++x)
+			{
+				dirtySections |= 1ull << GetSectionIndex(x << SECTION_WIDTH_LOG2, y << SECTION_WIDTH_LOG2, z << SECTION_WIDTH_LOG2);
+			}
+		}
+	}
+}
+
+void Chunk::CullFaces()
+{
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			CullFacesForRow(y, z);
+		}
+	}
+}
+
+void Chunk::GetBorderSlab(VisibleFaces face, eastl::array<uint64_t, VOXEL_CHUNK_WIDTH>& slab) const
+{
+	if (coarse)
+	{
+		const auto first = borderSlabs.begin() + GetFaceIndex(face) * VOXEL_CHUNK_WIDTH;
+		eastl::copy(first, first + VOXEL_CHUNK_WIDTH, slab.begin());
+		return;
+	}
+
+	constexpr int last = VOXEL_CHUNK_WIDTH - 1;
+	for (int i = 0; i < VOXEL_CHUNK_WIDTH; ++i)
+	{
+		switch (face)
+		{
+		case VisibleFaces::North:	slab[i] = solidColumns[GetColumnIndex(i, last)]; break;
+		case VisibleFaces::South:	slab[i] = solidColumns[GetColumnIndex(i, 0)]; break;
+		case VisibleFaces::Top:		slab[i] = solidColumns[GetColumnIndex(last, i)]; break;
+		case VisibleFaces::Bottom:	slab[i] = solidColumns[GetColumnIndex(0, i)]; break;
+		case VisibleFaces::East:
+		case VisibleFaces::West:
+		{
+			// Gathers a single bit out of every row of the z slice i
+			const int x = (face == VisibleFaces::East) ? last : 0;
+			uint64_t word = 0;
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				word |= ((solidColumns[GetColumnIndex(y, i)] >> x) & 1) << y;
+			}
+			slab[i] = word;
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+bool Chunk::SetNeighborSlab(VisibleFaces face, const eastl::array<uint64_t, VOXEL_CHUNK_WIDTH>& slab)
+{
+	auto& neighborSlab = neighborSlabs[GetFaceIndex(face)];
+	if (neighborSlab == slab) return false;
+	neighborSlab = slab;
+
+	// Only the rows touching that side depend on the slab, east and west touch every row.
+	// Coarse chunks don't have any rows, their mesh is culled against the slabs directly
+	constexpr int last = VOXEL_CHUNK_WIDTH - 1;
+	for (int i = 0; i < VOXEL_CHUNK_WIDTH && !coarse; ++i)
+	{
+		switch (face)
+		{
+		case VisibleFaces::North:	CullFacesForRow(i, last); break;
+		case VisibleFaces::South:	CullFacesForRow(i, 0); break;
+		case VisibleFaces::Top:		CullFacesForRow(last, i); break;
+		case VisibleFaces::Bottom:	CullFacesForRow(0, i); break;
+		case VisibleFaces::East:
+		case VisibleFaces::West:
+			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+			{
+				CullFacesForRow(y, i);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	// A section touches the side if its first or last voxel does
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		const XMINT3 first = GetSectionOrigin(section);
+		const XMINT3 last { first.x + static_cast<int>(SECTION_WIDTH) - 1, 
+			first.y + static_cast<int>(SECTION_WIDTH) - 1, first.z + static_cast<int>(SECTION_WIDTH) - 1 };
+		if (IsOnBorder(face, first.x, first.y, first.z) || IsOnBorder(face, last.x, last.y, last.z))
+		{
+			dirtySections |= 1ull << section;
+		}
+	}
+	return true;
+}
+
+void Chunk::CullFacesForRow(int y, int z)
+{
+	const int column = GetColumnIndex(y, z);
+	const uint64_t occupied = occupiedColumns[column];
+	const uint64_t solid = solidColumns[column];
+
+	// Rows of empty sections, the most common case above the surface
+	if (occupied == 0)
+	{
+		for (auto& columns : faceColumns)
+		{
+			columns[column] = 0;
+		}
+		return;
+	}
+
+	// A face is visible unless a solid voxel is next to it. Neighbors along x are the adjacent bits
+	// of the same word, the other axes are neighboring words. Past the chunk boundary the border
+	// slabs of the neighboring chunks are used, which are empty if no neighbor is loaded.
+	const uint64_t solidTop		= (y + 1 < VOXEL_CHUNK_WIDTH)	? solidColumns[GetColumnIndex(y + 1, z)] : neighborSlabs[GetFaceIndex(VisibleFaces::Top)][z];
+	const uint64_t solidBottom	= (y - 1 >= 0)					? solidColumns[GetColumnIndex(y - 1, z)] : neighborSlabs[GetFaceIndex(VisibleFaces::Bottom)][z];
+	const uint64_t solidNorth	= (z + 1 < VOXEL_CHUNK_WIDTH)	? solidColumns[GetColumnIndex(y, z + 1)] : neighborSlabs[GetFaceIndex(VisibleFaces::North)][y];
+	const uint64_t solidSouth	= (z - 1 >= 0)					? solidColumns[GetColumnIndex(y, z - 1)] : neighborSlabs[GetFaceIndex(VisibleFaces::South)][y];
+	const uint64_t solidEast	= (solid >> 1) | (((neighborSlabs[GetFaceIndex(VisibleFaces::East)][z] >> y) & 1) << (VOXEL_CHUNK_WIDTH - 1));
+	const uint64_t solidWest	= (solid << 1) | ((neighborSlabs[GetFaceIndex(VisibleFaces::West)][z] >> y) & 1);
+
+	const uint64_t east		= occupied & ~solidEast;
+	const uint64_t west		= occupied & ~solidWest;
+	const uint64_t top		= occupied & ~solidTop;
+	const uint64_t bottom	= occupied & ~solidBottom;
+	const uint64_t north	= occupied & ~solidNorth;
+	const uint64_t south	= occupied & ~solidSouth;
+
+	faceColumns[GetFaceIndex(VisibleFaces::North)][column] = north;
+	faceColumns[GetFaceIndex(VisibleFaces::South)][column] = south;
+	faceColumns[GetFaceIndex(VisibleFaces::East)][column] = east;
+	faceColumns[GetFaceIndex(VisibleFaces::West)][column] = west;
+	faceColumns[GetFaceIndex(VisibleFaces::Top)][column] = top;
+	faceColumns[GetFaceIndex(VisibleFaces::Bottom)][column] = bottom;
+}
@@ -3,6 +3,8 @@
 #include "Graphics/DX/DXBuffer.h"
 #include "Graphics/Raytracing/RaytracingSharedHlsl.h"
 #include "Graphics/Raytracing/AccelerationStructureManager.h"
+#include "Game/OccupancyPyramid.h"
+#include "Game/VoxelStorage.h"
 
 enum VisibleFaces
 {
@@ -11,21 +13,62 @@ enum VisibleFaces
 	East = 1 << 2,		// 000100
 	West = 1 << 3,		// 001000
 	Top = 1 << 4,		// 010000
-	Bottom = 1 << 5		// 100000
+	Bottom = 1 << 5,	// 100000
+	AllFaces = 0x3F		// 111111
 };
 
-enum class FillType
+enum class ChunkState
 {
-	Empty,
-	Solid,
-	Transparent
+	// Voxels and mesh are being generated on a worker thread
+	Generating,
+	// Mesh has been uploaded and the chunk is part of the acceleration structure
+	Ready
 };
 
-struct Voxel
+enum class MeshingMode
 {
-	FillType fillType;
-	uint32_t visibleFaces;
-	DirectX::XMVECTOR color;
+	// One quad per visible voxel face
+	Naive,
+	// Coplanar faces of identical block types are merged into maximal rectangles
+	Greedy
+};
+
+constexpr uint32_t VOXEL_CHUNK_WIDTH = 64;
+constexpr uint32_t VOXEL_CHUNK_WIDTH_LOG2 = 6;
+static_assert((1 << VOXEL_CHUNK_WIDTH_LOG2) == VOXEL_CHUNK_WIDTH);
+constexpr uint32_t VOXELS_PER_CHUNK = VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH;
+static_assert(OccupancyPyramid::BASE_WIDTH == VOXEL_CHUNK_WIDTH);
+
+// Chunks are stored and meshed in sections of 16^3 voxels. Uniform sections don't store 
+// any voxels and are skipped by the mesher, and an edit only remeshes the sections around it.
+// The dirty sections of a chunk are tracked in a single word, so there can't be more than 64.
+constexpr uint32_t SECTION_WIDTH_LOG2 = 4;
+constexpr uint32_t SECTION_WIDTH = 1 << SECTION_WIDTH_LOG2;
+constexpr uint32_t SECTIONS_PER_AXIS = VOXEL_CHUNK_WIDTH / SECTION_WIDTH;
+constexpr uint32_t NUM_SECTIONS = SECTIONS_PER_AXIS * SECTIONS_PER_AXIS * SECTIONS_PER_AXIS;
+constexpr uint32_t VOXELS_PER_SECTION = SECTION_WIDTH * SECTION_WIDTH * SECTION_WIDTH;
+static_assert(NUM_SECTIONS <= 64 && SECTION_WIDTH < VOXEL_CHUNK_WIDTH);
+
+// Range of quads in the buffers of a chunk owned by one section. Sections reserve some 
+// spare quads, so edits can be patched into the range as long as the section still fits.
+struct MeshSection
+{
+	uint32_t firstQuad;
+	uint32_t quadCapacity;
+	uint32_t quadCount;
+};
+
+// Mesh data generated on the CPU, the vertices and indices are kept until they have been uploaded to the GPU.
+// Unused quads of a section are collapsed into a single point and never hit. Every quad always uses the same
+// indices, so patching a section only touches vertices and the BLAS can be updated instead of rebuilt.
+struct ChunkMesh
+{
+	MeshingMode mode;
+	// Level of the occupancy pyramid the mesh was generated from, 0 meshes the voxels themselves
+	uint32_t lod;
+	eastl::array<MeshSection, NUM_SECTIONS> sections;
+	eastl::vector<Vertex> vertices;
+	eastl::vector<uint32_t> indices;
 };
 
 struct ChunkGPUResources
@@ -37,37 +80,278 @@ struct ChunkGPUResources
 	BLASInstanceHandle BLASInstance;
 };
 
-constexpr uint32_t VOXEL_CHUNK_WIDTH = 64;
-
-
 inline int GetIndex(int x, int y, int z)
 {
 	return x + VOXEL_CHUNK_WIDTH * (y + VOXEL_CHUNK_WIDTH * z);
 }
 
+// Coordinate of the chunk containing a voxel given in world space, the 
+// arithmetic shift rounds towards negative infinity for negative coordinates
+inline DirectX::XMINT3 GetChunkCoordinate(DirectX::XMINT3 voxel)
+{
+	return DirectX::XMINT3 { voxel.x >> VOXEL_CHUNK_WIDTH_LOG2, voxel.y >> VOXEL_CHUNK_WIDTH_LOG2, voxel.z >> VOXEL_CHUNK_WIDTH_LOG2 };
+}
+
+constexpr uint32_t NUM_FACE_DIRECTIONS = 6;
+
+// Index of a face direction into per-direction arrays, North = 0 ... Bottom = 5
+inline uint32_t GetFaceIndex(VisibleFaces face)
+{
+	return std::countr_zero(static_cast<uint32_t>(face));
+}
+
+// Face direction pointing the other way, the directions are ordered in opposing pairs
+inline VisibleFaces GetOppositeFace(VisibleFaces face)
+{
+	return static_cast<VisibleFaces>(1 << (GetFaceIndex(face) ^ 1));
+}
+
+// Index of the section containing a voxel of a chunk
+inline uint32_t GetSectionIndex(int x, int y, int z)
+{
+	return (x >> SECTION_WIDTH_LOG2) + SECTIONS_PER_AXIS * 
+		((y >> SECTION_WIDTH_LOG2) + SECTIONS_PER_AXIS * (z >> SECTION_WIDTH_LOG2));
+}
+
+// Index of a voxel of a chunk within the storage of its section
+inline uint32_t GetSectionVoxelIndex(int x, int y, int z)
+{
+	constexpr int mask = SECTION_WIDTH - 1;
+	return (x & mask) + SECTION_WIDTH * ((y & mask) + SECTION_WIDTH * (z & mask));
+}
+
+// First voxel of a section
+inline DirectX::XMINT3 GetSectionOrigin(uint32_t section)
+{
+	return DirectX::XMINT3 {
+		static_cast<int>((section % SECTIONS_PER_AXIS) * SECTION_WIDTH),
+		static_cast<int>(((section / SECTIONS_PER_AXIS) % SECTIONS_PER_AXIS) * SECTION_WIDTH),
+		static_cast<int>((section / (SECTIONS_PER_AXIS * SECTIONS_PER_AXIS)) * SECTION_WIDTH)
+	};
+}
+
+// Index of the 64-bit column word holding row (y, z) of a chunk, bit x of that word is voxel (x, y, z)
+inline int GetColumnIndex(int y, int z)
+{
+	return y + VOXEL_CHUNK_WIDTH * z;
+}
+
+// Packs a lattice point of a chunk with the face and block type it belongs to, see Vertex
+inline Vertex PackVertex(DirectX::XMINT3 position, VisibleFaces face, FillType type)
+{
+	using namespace DirectX::PackedVector;
+	UNTITLED_ASSERT(static_cast<uint32_t>(type) < (1 << 13) && "Block type doesn't fit into a packed vertex!");
+
+	const uint32_t data = GetFaceIndex(face) | (static_cast<uint32_t>(type) << 3);
+	return Vertex {
+		.positionXY = static_cast<uint32_t>(XMConvertFloatToHalf(static_cast<float>(position.x))) | 
+			(static_cast<uint32_t>(XMConvertFloatToHalf(static_cast<float>(position.y))) << 16),
+		.positionZData = static_cast<uint32_t>(XMConvertFloatToHalf(static_cast<float>(position.z))) | (data << 16)
+	};
+}
+
+inline DirectX::XMINT3 GetVertexPosition(const Vertex& vertex)
+{
+	using namespace DirectX::PackedVector;
+	return DirectX::XMINT3 {
+		static_cast<int32_t>(XMConvertHalfToFloat(static_cast<HALF>(vertex.positionXY & 0xFFFF))),
+		static_cast<int32_t>(XMConvertHalfToFloat(static_cast<HALF>(vertex.positionXY >> 16))),
+		static_cast<int32_t>(XMConvertHalfToFloat(static_cast<HALF>(vertex.positionZData & 0xFFFF)))
+	};
+}
+
+inline uint32_t GetVertexFaceIndex(const Vertex& vertex)
+{
+	return (vertex.positionZData >> 16) & 0x7;
+}
+
+inline FillType GetVertexBlockType(const Vertex& vertex)
+{
+	return static_cast<FillType>(vertex.positionZData >> 19);
+}
+
 struct Chunk
 {
 	DirectX::XMINT3 position;
 	size_t index;
 	bool needsRebuild;
+	// Vertex data rewritten since the BLAS was last updated
+	uint64_t patchedVertexBytes;
+	ChunkState state;
+
+	// Set when the chunk is removed while it's still being generated
+	bool removed;
+
+	// Coarse chunks have released their voxels and only keep the occupancy pyramid and their border slabs, 
+	// they can only be meshed from the pyramid. Edited chunks can't be regenerated and are loaded from their
+	// region file instead, they are saved to it when they are coarsened or removed and have unsaved edits.
+	bool coarse;
+	bool edited;
+	bool unsaved;
+	eastl::chrono::steady_clock::time_point requestTime;
+
+	// Block types are palette compressed per section. Occupancy and visible faces are derived from them 
+	// and kept as column bitmasks, one 64-bit word per (y, z) row with bit x per voxel.
+	eastl::vector<VoxelStorage> voxelSections;
+	eastl::vector<uint64_t> occupiedColumns;
+	eastl::vector<uint64_t> solidColumns;
+	eastl::array<eastl::vector<uint64_t>, NUM_FACE_DIRECTIONS> faceColumns;
+
+	// Solid voxels of the layer of each neighboring chunk that touches this chunk, zero where no
+	// neighbor is loaded. Top and bottom slabs hold one row word per z, north and south slabs
+	// one row word per y, east and west slabs hold one word per z with bit y per voxel.
+	eastl::array<eastl::array<uint64_t, VOXEL_CHUNK_WIDTH>, NUM_FACE_DIRECTIONS> neighborSlabs;
 
-	eastl::vector<Voxel> voxels;
+	// Bit per mesh section whose faces changed since it was meshed, by an edit or by a neighbor
+	uint64_t dirtySections;
+	// Set while the chunk has an entry in the remesh queue of the chunk manager
+	bool remeshQueued;
+
+	// Downsampled occupancy, kept up to date with every edit
+	OccupancyPyramid occupancy;
+	// Border slabs of a coarse chunk ordered like VisibleFaces, neighbors still need them for culling
+	eastl::vector<uint64_t> borderSlabs;
+
+	ChunkMesh mesh;
 	ChunkGPUResources GPUResources;
 
-	Chunk(DirectX::XMINT3 position_, size_t index_) : position(position_), index(index_), needsRebuild(false) {}
+	Chunk(DirectX::XMINT3 position_, size_t index_);
+
+	// Allocates empty voxel data, the chunk has to be generated again afterwards
+	void AllocateVoxels();
 
-	inline void SetFacesForVoxel(int x, int y, int z)
+	// Releases the voxel data and makes the chunk coarse
+	void ReleaseVoxels();
+
+	inline FillType GetVoxel(int x, int y, int z) const
 	{
-		auto& voxel = voxels[GetIndex(x, y, z)];
-
-		voxel.visibleFaces = (VisibleFaces::East | VisibleFaces::West | VisibleFaces::Top | VisibleFaces::Bottom | VisibleFaces::North | VisibleFaces::South);
-		if (x + 1 < VOXEL_CHUNK_WIDTH	&& voxels[GetIndex(x + 1, y, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::East;
-		if (x - 1 >= 0					&& voxels[GetIndex(x - 1, y, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::West;
-		if (y + 1 < VOXEL_CHUNK_WIDTH	&& voxels[GetIndex(x, y + 1, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::Top;
-		if (y - 1 >= 0					&& voxels[GetIndex(x, y - 1, z)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::Bottom;
-		if (z + 1 < VOXEL_CHUNK_WIDTH	&& voxels[GetIndex(x, y, z + 1)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::North;
-		if (z - 1 >= 0					&& voxels[GetIndex(x, y, z - 1)].fillType == FillType::Solid) voxel.visibleFaces &= ~VisibleFaces::South;
+		return voxelSections[GetSectionIndex(x, y, z)].Get(GetSectionVoxelIndex(x, y, z));
 	}
+
+	inline bool IsSectionUniform(uint32_t section, FillType type) const
+	{
+		return voxelSections[section].IsUniform() && voxelSections[section].Get(0) == type;
+	}
+
+	inline bool IsSolid(int x, int y, int z) const
+	{
+		return (solidColumns[GetColumnIndex(y, z)] >> x) & 1;
+	}
+
+	inline bool HasVisibleFace(VisibleFaces face, int x, int y, int z) const
+	{
+		return (faceColumns[GetFaceIndex(face)][GetColumnIndex(y, z)] >> x) & 1;
+	}
+
+	// Number of visible voxel faces, which is also an upper bound for the number of quads in any mesh of the chunk
+	inline uint32_t CountVisibleFaces() const
+	{
+		uint32_t count = 0;
+		for (const auto& columns : faceColumns)
+		{
+			for (uint64_t column : columns)
+			{
+				count += std::popcount(column);
+			}
+		}
+		return count;
+	}
+
+	// Number of visible voxel faces within a single mesh section
+	inline uint32_t CountVisibleFaces(uint32_t section) const
+	{
+		const DirectX::XMINT3 origin = GetSectionOrigin(section);
+		const uint64_t rowMask = ((1ull << SECTION_WIDTH) - 1) << origin.x;
+
+		uint32_t count = 0;
+		for (const auto& columns : faceColumns)
+		{
+			for (int z = origin.z; z < origin.z + static_cast<int>(SECTION_WIDTH); ++z)
+			{
+				for (int y = origin.y; y < origin.y + static_cast<int>(SECTION_WIDTH); ++y)
+				{
+					count += std::popcount(columns[GetColumnIndex(y, z)] & rowMask);
+				}
+			}
+		}
+		return count;
+	}
+
+	// Number of voxels SetVoxels would change, the ones set in rows that don't have the given type yet.
+	// The columns tell every block type apart, so the sections don't have to be read.
+	inline uint32_t CountChangedVoxels(const uint64_t* rows, FillType type, DirectX::XMINT3 min, DirectX::XMINT3 max) const
+	{
+		uint32_t count = 0;
+		for (int z = min.z; z <= max.z; ++z)
+		{
+			for (int y = min.y; y <= max.y; ++y)
+			{
+				const int column = GetColumnIndex(y, z);
+				const uint64_t matching = (type == FillType::Empty) ? ~occupiedColumns[column] :
+					(type == FillType::Solid) ? solidColumns[column] : occupiedColumns[column] & ~solidColumns[column];
+				count += std::popcount(rows[column] & ~matching);
+			}
+		}
+		return count;
+	}
+
+	// Sets the voxels of the box between min and max whose bits are set in rows, which holds a word per 
+	// row like the columns, to the given type. Updates the faces of the box and its surroundings and 
+	// marks the sections whose mesh changed, returns whether any voxel was set.
+	bool SetVoxels(const uint64_t* rows, FillType type, DirectX::XMINT3 min, DirectX::XMINT3 max);
+
+	// Derives the occupied and solid columns from the block types, after the sections have been replaced
+	void RebuildColumns();
+
+	// Sets the solid voxels of the empty sections from the solid columns after they have been generated. Only the 
+	// sections the surface passes through store individual voxels, the ones entirely below it a single type.
+	void FillSections();
+
+	// Compacts the storage of the given sections, edits can leave sections with a single 
+	// type behind, which the mesher only skips once their storage is uniform again
+	void CompactSections(uint64_t sections);
+
+	// Marks the sections overlapping the box between the two voxels as dirty
+	void MarkSectionsDirty(DirectX::XMINT3 min, DirectX::XMINT3 max);
+
+	// Recomputes the visible faces of every voxel in the chunk
+	void CullFaces();
+
+	// Solid voxels of the layer on the given side, laid out as the neighbor on that side stores them
+	void GetBorderSlab(VisibleFaces face, eastl::array<uint64_t, VOXEL_CHUNK_WIDTH>& slab) const;
+
+	// Replaces the slab of the neighbor on the given side and updates the border faces on that side,
+	// returns whether the faces of the chunk changed
+	bool SetNeighborSlab(VisibleFaces face, const eastl::array<uint64_t, VOXEL_CHUNK_WIDTH>& slab);
+
+	inline bool IsOnBorder(VisibleFaces face, int x, int y, int z) const
+	{
+		switch (face)
+		{
+		case VisibleFaces::North:	return z == VOXEL_CHUNK_WIDTH - 1;
+		case VisibleFaces::South:	return z == 0;
+		case VisibleFaces::East:	return x == VOXEL_CHUNK_WIDTH - 1;
+		case VisibleFaces::West:	return x == 0;
+		case VisibleFaces::Top:		return y == VOXEL_CHUNK_WIDTH - 1;
+		case VisibleFaces::Bottom:	return y == 0;
+		default:					return false;
+		}
+	}
+
+	inline size_t GetMemoryUsage() const
+	{
+		size_t voxelMemoryUsage = 0;
+		for (const VoxelStorage& section : voxelSections)
+		{
+			voxelMemoryUsage += section.GetMemoryUsage();
+		}
+
+		return sizeof(Chunk) + voxelMemoryUsage + occupancy.GetMemoryUsage() +
+			(occupiedColumns.capacity() + solidColumns.capacity() + NUM_FACE_DIRECTIONS * faceColumns[0].capacity() + borderSlabs.capacity()) * sizeof(uint64_t);
+	}
+
+private:
+	void CullFacesForRow(int y, int z);
 };
 
 constexpr eastl::array<uint32_t, 36> CUBE_INDICES =
@@ -1,12 +1,69 @@
 #include "PCH.h"
 #include "ChunkManager.h"
 
+#include "Core/ScratchArena.h"
+#include "Game/Heightmap.h"
 #include "Graphics/Raytracing/RaytracingPipeline.h"
 
 using namespace DirectX;
 
-ChunkManager::ChunkManager(Renderer* const renderer_) :
-	renderer(renderer_)
+// Noise sets are filled into memory of the worker instead of being allocated for every chunk. They are the
+// first allocation after a reset, which starts at the alignment FastNoiseSIMD needs for its widest vectors.
+static thread_local ScratchArena noiseArena;
+
+static eastl::span<float> AllocateNoiseSet(size_t size)
+{
+	noiseArena.Reset(size * sizeof(float));
+	return noiseArena.Allocate<float>(size);
+}
+
+// Bits of a row of voxels along x whose density is above the threshold of their height, each compare sets four bits
+static uint64_t GetDensityRow(const float* densities, int height)
+{
+	const __m128 threshold = _mm_set1_ps((height - DENSITY_SURFACE_HEIGHT) / DENSITY_FALLOFF);
+
+	uint64_t row = 0;
+	for (int x = 0; x < VOXEL_CHUNK_WIDTH; x += 16)
+	{
+		const uint64_t mask0 = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(densities + x), threshold));
+		const uint64_t mask1 = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(densities + x + 4), threshold));
+		const uint64_t mask2 = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(densities + x + 8), threshold));
+		const uint64_t mask3 = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(densities + x + 12), threshold));
+		row |= (mask0 | (mask1 << 4) | (mask2 << 8) | (mask3 << 12)) << x;
+	}
+	return row;
+}
+
+eastl::string GetRegionPath(XMINT3 region)
+{
+	char path[MAX_PATH];
+	snprintf(path, sizeof(path), "%s/%i.%i.%i.region", REGION_DIRECTORY, region.x, region.y, region.z);
+	return path;
+}
+
+ChunkManager::ChunkManager(Renderer* const renderer_, JobSystem* const jobSystem_, TerrainMode terrainMode_ /*= TerrainMode::Heightmap*/) :
+	renderer(renderer_),
+	jobSystem(jobSystem_),
+	terrainMode(terrainMode_),
+	meshingMode(MeshingMode::Greedy),
+	densitySampleScale(DENSITY_SAMPLE_SCALE),
+	numBorderRemeshes(0),
+	coldChunks(COLD_CHUNK_CACHE_BUDGET),
+	numGeneratingChunks(0),
+	numGeneratedChunks(0),
+	totalGenerationMs(0.0f),
+	maxGenerationMs(0.0f),
+	numLoadedChunks(0),
+	totalLoadLatencyMs(0.0f),
+	maxLoadLatencyMs(0.0f),
+	numEdits(0),
+	numEditedVoxels(0),
+	totalEditLatencyMs(0.0f),
+	maxEditLatencyMs(0.0f),
+	totalEditUploadBytes(0),
+	uploadedBytes(0),
+	numSectionRemeshes(0),
+	numFullRemeshes(0)
 {
 	// Initialize the noise generator 
 	noise = FastNoiseSIMD::NewFastNoiseSIMD(42);
@@ -17,272 +74,850 @@ ChunkManager::ChunkManager(Renderer* const renderer_) :
 	noise->SetFractalLacunarity(2.33f);
 	noise->SetFractalGain(0.366f);
 
-	vertices.resize(4'100'000);
-	indices.resize(16'400'000);
+	if (!CreateDirectoryIfMissing(REGION_DIRECTORY))
+	{
+		UNTITLED_LOG_WARN("Region directory %s couldn't be created, edits won't be saved\n", REGION_DIRECTORY);
+	}
 }
 
 ChunkManager::~ChunkManager()
 {
+	// Workers may still reference the chunks and the noise generator
+	jobSystem->WaitForAll();
+
+	eastl::vector<Chunk*> unsavedChunks;
 	for (auto& chunk : chunks)
 	{
-		FreeChunk(chunk);
+		if (chunk && chunk->state == ChunkState::Ready && chunk->unsaved)
+		{
+			unsavedChunks.push_back(chunk.get());
+		}
+	}
+	SaveChunks({ unsavedChunks.data(), unsavedChunks.size() });
+	SaveColdChunks();
+
+	for (auto& chunk : chunks)
+	{
+		// Coarse chunks that are being regenerated still own their previous mesh
+		if (chunk && (chunk->state == ChunkState::Ready || chunk->coarse))
+		{
+			FreeChunk(*chunk);
+		}
 	}
 
 	delete noise;
 }
 
-void ChunkManager::AddChunk(XMINT3 position)
+void ChunkManager::AddChunk(XMINT3 position, uint32_t lod /*= 0*/)
 {
-	auto& chunk = chunks.emplace_back(Chunk(position, chunks.size()));
-	GenerateVoxels(chunk);
-	GenerateMesh(chunk);
+	UNTITLED_ASSERT(!HasChunk(position) && "Chunk has already been added!");
+
+	size_t index;
+	if (freeChunkIndices.empty())
+	{
+		index = chunks.size();
+		chunks.emplace_back();
+	}
+	else
+	{
+		index = freeChunkIndices.back();
+		freeChunkIndices.pop_back();
+	}
+	UNTITLED_ASSERT(index < MAX_NUM_CHUNKS && "Exceeded the maximum number of chunks!");
+
+	chunks[index] = eastl::make_unique<Chunk>(position, index);
+	chunkMap.Insert(GetChunkCoordinate(position), static_cast<uint32_t>(index));
+	if (terrainMode == TerrainMode::Heightmap)
+	{
+		AcquireColumn(position);
+	}
+	SubmitGeneration(*chunks[index], lod);
 }
 
-void ChunkManager::CreateVoxel(DirectX::XMUINT2 pickBuffer)
+bool ChunkManager::CoarsenChunk(XMINT3 position)
 {
-	BlockIdentifier identifier;
-	identifier.value = pickBuffer.x;
+	Chunk* chunk = GetChunkAt(position);
+	if (!chunk || chunk->state != ChunkState::Ready || chunk->coarse || chunk->dirtySections != 0 || chunk->mesh.lod == 0) return false;
 
-	int x = identifier.bits.voxelIndex % VOXEL_CHUNK_WIDTH;
-	int y = (identifier.bits.voxelIndex / VOXEL_CHUNK_WIDTH) % VOXEL_CHUNK_WIDTH;
-	int z = identifier.bits.voxelIndex / (VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+	// Refining the chunk loads the edits back from its region file
+	if (chunk->unsaved)
+	{
+		SaveChunks({ &chunk, 1 });
+		if (chunk->unsaved) return false;
+	}
+
+	coldChunks.Insert(*chunk);
+	chunk->ReleaseVoxels();
+	return true;
+}
 
-	if (pickBuffer.y == VisibleFaces::Bottom)
+bool ChunkManager::RefineChunk(XMINT3 position)
+{
+	Chunk* chunk = GetChunkAt(position);
+	if (!chunk || chunk->state != ChunkState::Ready || !chunk->coarse) return false;
+
+	// The chunk keeps its mesh and stays coarse until the regenerated one is uploaded
+	chunk->state = ChunkState::Generating;
+	chunk->requestTime = eastl::chrono::steady_clock::now();
+	SubmitGeneration(*chunk, chunk->mesh.lod);
+	return true;
+}
+
+bool ChunkManager::SetChunkLOD(XMINT3 position, uint32_t lod)
+{
+	UNTITLED_ASSERT(lod <= OccupancyPyramid::NUM_LEVELS && "Invalid LOD!");
+
+	Chunk* chunk = GetChunkAt(position);
+	if (!chunk || chunk->state != ChunkState::Ready || chunk->mesh.lod == lod || (lod == 0 && chunk->coarse)) return false;
+
+	chunk->mesh.lod = lod;
+	RegenerateMesh(*chunk);
+	return true;
+}
+
+void ChunkManager::SubmitGeneration(Chunk& chunk, uint32_t lod)
+{
+	numGeneratingChunks++;
+	const MeshingMode mode = meshingMode;
+	const bool allocate = chunk.coarse;
+
+	// Neighbors are only touched on this thread, so the worker culls against a copy of their borders
+	PullNeighborBorders(chunk);
+
+	// Saved chunks are loaded instead of being generated, which falls back to generating them if their payload is corrupted
+	const RegionFile* regionFile = &GetRegionFile(chunk.position);
+	const uint32_t regionIndex = GetRegionChunkIndex(GetChunkCoordinate(chunk.position));
+	const bool saved = regionFile->HasChunk(regionIndex);
+	ColumnHeightmap* column = GetColumn(chunk.position);
+
+	// Chunks that left the range recently are still cached, which is faster than both
+	eastl::vector<uint8_t> coldData;
+	const bool cold = coldChunks.Take(chunk.position, coldData);
+
+	jobSystem->Submit([this, chunk = &chunk, mode, lod, allocate, regionFile, regionIndex, saved, column, cold, coldData = eastl::move(coldData)]()
 	{
-		chunks[0].voxels[GetIndex(x, y - 1, z)].fillType = FillType::Solid;
-		chunks[0].SetFacesForVoxel(x, y - 1, z);
+		using clock = eastl::chrono::steady_clock;
+		auto start = clock::now();
+
+		if (allocate)
+		{
+			chunk->AllocateVoxels();
+		}
+		if (cold)
+		{
+			RestoreVoxels(*chunk, coldData);
+		}
+		else if (!saved || !LoadVoxels(*chunk, *regionFile, regionIndex))
+		{
+			GenerateVoxels(*chunk, column);
+		}
+		ChunkMesher::GenerateMesh(*chunk, mode, lod);
+
+		const float generationMs = eastl::chrono::duration_cast<eastl::chrono::microseconds>(clock::now() - start).count() / 1000.0f;
+
+		std::lock_guard<std::mutex> lock(generatedChunksMutex);
+		generatedChunks.push_back(GeneratedChunk { chunk->index, generationMs });
+	});
+}
+
+void ChunkManager::RemoveChunk(XMINT3 position)
+{
+	const uint32_t index = chunkMap.Find(GetChunkCoordinate(position));
+	if (index == ChunkMap::INVALID_INDEX) return;
+
+	chunkMap.Remove(GetChunkCoordinate(position));
+
+	// A worker still owns the chunk, it's released once the job has finished
+	Chunk& chunk = *chunks[index];
+	if (chunk.state != ChunkState::Ready)
+	{
+		// Coarse chunks being refined are still drawn, so the neighbors hid their faces behind them
+		if (chunk.coarse)
+		{
+			PushBorders(chunk, VisibleFaces::AllFaces, true);
+		}
+		chunk.removed = true;
+		return;
 	}
-	else if (pickBuffer.y == VisibleFaces::Top)
+
+	if (chunk.unsaved)
+	{
+		Chunk* chunkToSave = &chunk;
+		SaveChunks({ &chunkToSave, 1 });
+	}
+
+	// Coarse chunks were cached when they released their voxels
+	if (!chunk.coarse)
 	{
-		chunks[0].voxels[GetIndex(x, y + 1, z)].fillType = FillType::Solid;
-		chunks[0].SetFacesForVoxel(x, y + 1, z);
+		coldChunks.Insert(chunk);
+		if (coldChunks.NeedsWriteBack())
+		{
+			SaveColdChunks();
+		}
 	}
-	else if (pickBuffer.y == VisibleFaces::East)
+
+	PushBorders(chunk, VisibleFaces::AllFaces, true);
+	FreeChunk(chunk);
+	ReleaseChunk(index);
+}
+
+bool ChunkManager::HasChunk(XMINT3 position) const
+{
+	return chunkMap.Find(GetChunkCoordinate(position)) != ChunkMap::INVALID_INDEX;
+}
+
+Chunk* ChunkManager::GetChunkAt(XMINT3 voxel) const
+{
+	const uint32_t index = chunkMap.Find(GetChunkCoordinate(voxel));
+	return index != ChunkMap::INVALID_INDEX ? chunks[index].get() : nullptr;
+}
+
+eastl::array<Chunk*, NUM_FACE_DIRECTIONS> ChunkManager::GetNeighbors(const Chunk& chunk) const
+{
+	eastl::array<uint32_t, NUM_FACE_DIRECTIONS> indices;
+	chunkMap.FindNeighbors(GetChunkCoordinate(chunk.position), indices);
+
+	eastl::array<Chunk*, NUM_FACE_DIRECTIONS> neighbors;
+	for (uint32_t i = 0; i < NUM_FACE_DIRECTIONS; ++i)
 	{
-		chunks[0].voxels[GetIndex(x + 1, y, z)].fillType = FillType::Solid;
-		chunks[0].SetFacesForVoxel(x + 1, y, z);
+		neighbors[i] = indices[i] != ChunkMap::INVALID_INDEX ? chunks[indices[i]].get() : nullptr;
 	}
-	else if (pickBuffer.y == VisibleFaces::West)
+	return neighbors;
+}
+
+void ChunkManager::UploadGeneratedChunks(uint32_t maxUploads /*= eastl::numeric_limits<uint32_t>::max()*/)
+{
+	uint32_t numUploads = 0;
+	while (numUploads < maxUploads)
 	{
-		chunks[0].voxels[GetIndex(x - 1, y, z)].fillType = FillType::Solid;
-		chunks[0].SetFacesForVoxel(x - 1, y, z);
+		GeneratedChunk generated;
+		{
+			std::lock_guard<std::mutex> lock(generatedChunksMutex);
+			if (generatedChunks.empty()) break;
+
+			generated = generatedChunks.front();
+			generatedChunks.pop_front();
+		}
+		numGeneratingChunks--;
+		numGeneratedChunks++;
+		totalGenerationMs += generated.generationMs;
+		maxGenerationMs = eastl::max(maxGenerationMs, generated.generationMs);
+		const size_t index = generated.index;
+
+		// Coarse chunks that have been regenerated still own the mesh they were made coarse with
+		Chunk& chunk = *chunks[index];
+		if (chunk.coarse)
+		{
+			FreeChunk(chunk);
+			chunk.coarse = false;
+		}
+
+		// Chunks removed during generation never reach the GPU and don't count towards the budget
+		if (chunk.removed)
+		{
+			ReleaseChunk(index);
+			continue;
+		}
+
+		// Neighbors may have been loaded or edited while the chunk was being generated, 
+		// and the meshing mode may have been switched
+		const bool bordersChanged = PullNeighborBorders(chunk);
+		if (bordersChanged || chunk.mesh.mode != meshingMode)
+		{
+			ChunkMesher::GenerateMesh(chunk, meshingMode, chunk.mesh.lod);
+		}
+
+		UploadMesh(chunk);
+		chunk.state = ChunkState::Ready;
+		numUploads++;
+
+		// Hide the faces of the neighbors that are now covered by this chunk
+		PushBorders(chunk, VisibleFaces::AllFaces);
+
+		const float latencyMs = eastl::chrono::duration_cast<eastl::chrono::microseconds>(
+			eastl::chrono::steady_clock::now() - chunk.requestTime).count() / 1000.0f;
+		numLoadedChunks++;
+		totalLoadLatencyMs += latencyMs;
+		maxLoadLatencyMs = eastl::max(maxLoadLatencyMs, latencyMs);
 	}
-	else if (pickBuffer.y == VisibleFaces::North)
+}
+
+ChunkStats ChunkManager::GetStats() const
+{
+	ChunkStats stats {
+		.numChunks = chunkMap.GetSize(),
+		.numGeneratingChunks = numGeneratingChunks,
+		.numColumns = columnMap.GetSize(),
+		.numCoarseChunks = 0,
+		.voxelMemoryUsage = 0,
+		.meshMemoryUsage = 0,
+		.numTriangles = 0,
+		.numChunksPerLOD = {},
+		.numTrianglesPerLOD = {},
+		.numBorderRemeshes = numBorderRemeshes,
+		.averageLoadLatencyMs = numLoadedChunks > 0 ? totalLoadLatencyMs / numLoadedChunks : 0.0f,
+		.maxLoadLatencyMs = maxLoadLatencyMs,
+		.averageGenerationMs = numGeneratedChunks > 0 ? totalGenerationMs / numGeneratedChunks : 0.0f,
+		.maxGenerationMs = maxGenerationMs,
+		.numEdits = numEdits,
+		.numEditedVoxels = numEditedVoxels,
+		.averageEditLatencyMs = numEdits > 0 ? totalEditLatencyMs / numEdits : 0.0f,
+		.maxEditLatencyMs = maxEditLatencyMs,
+		.averageEditUploadBytes = numEdits > 0 ? totalEditUploadBytes / numEdits : 0,
+		.numSectionRemeshes = numSectionRemeshes,
+		.numFullRemeshes = numFullRemeshes,
+		.numColdChunks = coldChunks.GetNumEntries(),
+		.coldMemoryUsage = coldChunks.GetSize(),
+		.coldHitRate = coldChunks.GetHitRate(),
+		.coldCompressionRatio = coldChunks.GetCompressionRatio(),
+		.averageDecompressUs = coldChunks.GetAverageDecompressUs()
+	};
+
+	if (renderer)
 	{
-		chunks[0].voxels[GetIndex(x, y, z + 1)].fillType = FillType::Solid;
-		chunks[0].SetFacesForVoxel(x, y, z + 1);
+		const AccelerationStructureStats ASStats = renderer->RTPipeline->GetAccelerationStructureStats();
+		stats.numCompactedBLAS = ASStats.numCompactedBLAS;
+		stats.BLASMemoryUsage = ASStats.memoryUsage;
+		stats.uncompactedBLASMemoryUsage = ASStats.uncompactedMemoryUsage;
+		stats.numBLASRefits = ASStats.updates.numRefits;
+		stats.numBLASFastBuilds = ASStats.updates.numFastBuilds;
+		stats.numBLASTopologyBuilds = ASStats.updates.numTopologyBuilds;
+		stats.numBLASFastTraceBuilds = ASStats.updates.numFastTraceBuilds;
+		stats.numASPoolBlocks = ASStats.pool.numBlocks;
+		stats.ASPoolMemory = ASStats.pool.reservedMemory;
+		stats.ASPoolFragmentation = ASStats.pool.fragmentation;
+		stats.TLASMemoryUsage = ASStats.TLASMemoryUsage;
 	}
-	else if (pickBuffer.y == VisibleFaces::South)
+
+	for (const auto& chunk : chunks)
 	{
-		chunks[0].voxels[GetIndex(x, y, z - 1)].fillType = FillType::Solid;
-		chunks[0].SetFacesForVoxel(x, y, z - 1);
+		if (chunk && chunk->state == ChunkState::Ready)
+		{
+			stats.numCoarseChunks += chunk->coarse ? 1 : 0;
+			stats.voxelMemoryUsage += chunk->GetMemoryUsage();
+			stats.meshMemoryUsage += chunk->GPUResources.vBuffer.sizeInBytes + chunk->GPUResources.iBuffer.sizeInBytes;
+			stats.numChunksPerLOD[chunk->mesh.lod]++;
+			for (const MeshSection& section : chunk->mesh.sections)
+			{
+				stats.numTriangles += section.quadCount * 2;
+				stats.numTrianglesPerLOD[chunk->mesh.lod] += section.quadCount * 2;
+			}
+		}
 	}
-	
-	RegenerateMesh(chunks[0]);
+	return stats;
 }
 
-void ChunkManager::DestroyVoxel(DirectX::XMUINT2 pickBuffer)
+void ChunkManager::CreateVoxel(DirectX::XMUINT2 pickBuffer)
 {
+	XMINT3 voxel;
+	if (!GetPickedVoxel(pickBuffer, voxel)) return;
+
 	BlockIdentifier identifier;
-	identifier.value = pickBuffer.x;
+	identifier.value = pickBuffer.y;
+
+	// The new voxel is placed next to the picked face, which can be in a neighboring chunk
+	if (identifier.bits.face == VisibleFaces::Bottom)		voxel.y--;
+	else if (identifier.bits.face == VisibleFaces::Top)		voxel.y++;
+	else if (identifier.bits.face == VisibleFaces::East)	voxel.x++;
+	else if (identifier.bits.face == VisibleFaces::West)	voxel.x--;
+	else if (identifier.bits.face == VisibleFaces::North)	voxel.z++;
+	else if (identifier.bits.face == VisibleFaces::South)	voxel.z--;
+
+	Chunk* chunk = GetChunkAt(voxel);
+	if (!chunk || chunk->state != ChunkState::Ready || chunk->coarse) return;
 
-	int x = identifier.bits.voxelIndex % VOXEL_CHUNK_WIDTH;
-	int y = (identifier.bits.voxelIndex / VOXEL_CHUNK_WIDTH) % VOXEL_CHUNK_WIDTH;
-	int z = identifier.bits.voxelIndex / (VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+	QueueEdit(VoxelBrush { .shape = BrushShape::Box, .start = voxel, .end = voxel, .radius = 0, .type = FillType::Solid });
+}
 
-	chunks[0].voxels[identifier.bits.voxelIndex].fillType = FillType::Empty;
+void ChunkManager::DestroyVoxel(DirectX::XMUINT2 pickBuffer)
+{
+	XMINT3 voxel;
+	if (!GetPickedVoxel(pickBuffer, voxel)) return;
 
-	auto idx = GetIndex(x, y, z);
-	UNTITLED_ASSERT(idx == identifier.bits.voxelIndex);
+	QueueEdit(VoxelBrush { .shape = BrushShape::Box, .start = voxel, .end = voxel, .radius = 0, .type = FillType::Empty });
+}
 
-	// Since the voxel is now visible, flags need to be updated for surrounding voxels
-	if (x + 1 < VOXEL_CHUNK_WIDTH && chunks[0].voxels[GetIndex(x + 1, y, z)].fillType == FillType::Solid) chunks[0].voxels[GetIndex(x + 1, y, z)].visibleFaces |= VisibleFaces::West;
-	if (x - 1 >= 0				  && chunks[0].voxels[GetIndex(x - 1, y, z)].fillType == FillType::Solid) chunks[0].voxels[GetIndex(x - 1, y, z)].visibleFaces |= VisibleFaces::East;
-	if (y + 1 < VOXEL_CHUNK_WIDTH && chunks[0].voxels[GetIndex(x, y + 1, z)].fillType == FillType::Solid) chunks[0].voxels[GetIndex(x, y + 1, z)].visibleFaces |= VisibleFaces::Bottom;
-	if (y - 1 >= 0				  && chunks[0].voxels[GetIndex(x, y - 1, z)].fillType == FillType::Solid) chunks[0].voxels[GetIndex(x, y - 1, z)].visibleFaces |= VisibleFaces::Top;
-	if (z + 1 < VOXEL_CHUNK_WIDTH && chunks[0].voxels[GetIndex(x, y, z + 1)].fillType == FillType::Solid) chunks[0].voxels[GetIndex(x, y, z + 1)].visibleFaces |= VisibleFaces::South;
-	if (z - 1 >= 0				  && chunks[0].voxels[GetIndex(x, y, z - 1)].fillType == FillType::Solid) chunks[0].voxels[GetIndex(x, y, z - 1)].visibleFaces |= VisibleFaces::North;
+void ChunkManager::QueueEdit(const VoxelBrush& brush)
+{
+	queuedEdits.push_back(QueuedEdit { brush, eastl::chrono::steady_clock::now() });
+}
 
-	RegenerateMesh(chunks[0]);
+void ChunkManager::ApplyEdits()
+{
+	if (queuedEdits.empty()) return;
+
+	const size_t uploadedBytesBefore = uploadedBytes;
+	brushRows.resize(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+	for (const QueuedEdit& edit : queuedEdits)
+	{
+		ApplyBrush(edit.brush);
+		pendingEditTimes.push_back(edit.queueTime);
+	}
+	numEdits += static_cast<uint32_t>(queuedEdits.size());
+	queuedEdits.clear();
+
+	// Borders are passed on first, so edited neighbors pick them up before they are remeshed below. 
+	// Their sections are dirty already, which keeps PushBorders from queueing them a second time.
+	for (const auto& [index, borderFaces] : editedChunks)
+	{
+		PushBorders(*chunks[index], borderFaces);
+	}
+	for (const auto& [index, borderFaces] : editedChunks)
+	{
+		chunks[index]->CompactSections(chunks[index]->dirtySections);
+		if (!RemeshDirtySections(*chunks[index]))
+		{
+			RegenerateMesh(*chunks[index]);
+		}
+	}
+	editedChunks.clear();
+	totalEditUploadBytes += uploadedBytes - uploadedBytesBefore;
+}
+
+void ChunkManager::RemeshDirtyChunks(uint32_t maxRemeshes /*= MAX_BORDER_REMESHES_PER_FRAME*/)
+{
+	for (uint32_t numRemeshes = 0; numRemeshes < maxRemeshes && !dirtyChunks.empty();)
+	{
+		const size_t index = dirtyChunks.front();
+		dirtyChunks.pop_front();
+
+		// The chunk may have been unloaded, already remeshed by an edit or handed to a worker to be refined
+		Chunk* chunk = chunks[index].get();
+		if (!chunk || !chunk->remeshQueued) continue;
+
+		chunk->remeshQueued = false;
+		if (chunk->state != ChunkState::Ready || chunk->dirtySections == 0) continue;
+
+		if (!RemeshDirtySections(*chunk))
+		{
+			RegenerateMesh(*chunk);
+		}
+		numBorderRemeshes++;
+		numRemeshes++;
+	}
 }
 
 void ChunkManager::RebuildUpdatedChunks()
 {
 	for (auto& chunk : chunks)
 	{
-		if (chunk.needsRebuild)
+		if (chunk && chunk->needsRebuild)
 		{
-			renderer->RTPipeline->RebuildBLAS(chunk.GPUResources.BLAS, {
-				AccelerationStructureGeometry {
-					.vertices = chunk.GPUResources.vBuffer,
-					.indices = chunk.GPUResources.iBuffer
-				} 
-			});
-			chunk.needsRebuild = false;
+			if (renderer)
+			{
+				const float changedFraction = static_cast<float>(chunk->patchedVertexBytes) / chunk->GPUResources.vBuffer.sizeInBytes;
+				renderer->RTPipeline->RebuildBLAS(chunk->GPUResources.BLAS, {
+					AccelerationStructureGeometry {
+						.vertices = chunk->GPUResources.vBuffer,
+						.indices = chunk->GPUResources.iBuffer
+					} 
+				}, changedFraction);
+			}
+			chunk->needsRebuild = false;
+			chunk->patchedVertexBytes = 0;
 		}
 	}
+
+	const auto now = eastl::chrono::steady_clock::now();
+	for (const auto& editTime : pendingEditTimes)
+	{
+		const float latencyMs = eastl::chrono::duration_cast<eastl::chrono::microseconds>(now - editTime).count() / 1000.0f;
+		totalEditLatencyMs += latencyMs;
+		maxEditLatencyMs = eastl::max(maxEditLatencyMs, latencyMs);
+	}
+	pendingEditTimes.clear();
+}
+
+void ChunkManager::SetMeshingMode(MeshingMode mode)
+{
+	if (mode == meshingMode) return;
+
+	// Chunks that are still being generated are remeshed when they are uploaded
+	meshingMode = mode;
+	for (auto& chunk : chunks)
+	{
+		if (chunk && chunk->state == ChunkState::Ready)
+		{
+			RegenerateMesh(*chunk);
+		}
+	}
+}
+
+void ChunkManager::SetDensitySampling(uint32_t sampleScale, int octaves)
+{
+	UNTITLED_ASSERT(numGeneratingChunks == 0 && "The noise is changed while workers are sampling it!");
+	UNTITLED_ASSERT((VOXEL_CHUNK_WIDTH >> sampleScale) > 0 && "Density samples are further apart than a chunk!");
+
+	densitySampleScale = sampleScale;
+	noise->SetFractalOctaves(octaves);
 }
 
 void ChunkManager::FreeChunk(Chunk& chunk)
 {
+	if (!renderer) return;
+
 	renderer->RTPipeline->RemoveBLAS(chunk.GPUResources.BLAS);
 	renderer->RTPipeline->RemoveBLASInstance(chunk.GPUResources.BLASInstance);
 	chunk.GPUResources.iBuffer.Release();
 	chunk.GPUResources.vBuffer.Release();
 }
 
-void ChunkManager::GenerateVoxels(Chunk& chunk)
+bool ChunkManager::GetPickedVoxel(XMUINT2 pickBuffer, XMINT3& voxel) const
 {
-	chunk.voxels.resize(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+	// The pick result can refer to a chunk that has been unloaded since,
+	// chunks still owned by a worker or without voxels can't be edited either
+	if (pickBuffer.x >= chunks.size()) return false;
+	const Chunk* chunk = chunks[pickBuffer.x].get();
+	if (!chunk || chunk->removed || chunk->state != ChunkState::Ready || chunk->coarse) return false;
 
-	XMVECTOR positionVec = XMLoadSInt3(&chunk.position);
+	BlockIdentifier identifier;
+	identifier.value = pickBuffer.y;
 
-	float* noiseSet = noise->GetNoiseSet(chunk.position.x, chunk.position.y, chunk.position.z, VOXEL_CHUNK_WIDTH, 1, VOXEL_CHUNK_WIDTH, 0.25f);
-	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	const uint32_t voxelIndex = identifier.bits.voxelIndex;
+	voxel = XMINT3 {
+		chunk->position.x + static_cast<int>(voxelIndex % VOXEL_CHUNK_WIDTH),
+		chunk->position.y + static_cast<int>((voxelIndex / VOXEL_CHUNK_WIDTH) % VOXEL_CHUNK_WIDTH),
+		chunk->position.z + static_cast<int>(voxelIndex / (VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH))
+	};
+	return true;
+}
+
+void ChunkManager::QueueRemesh(Chunk& chunk)
+{
+	if (chunk.remeshQueued) return;
+
+	chunk.remeshQueued = true;
+	dirtyChunks.push_back(chunk.index);
+}
+
+bool ChunkManager::PullNeighborBorders(Chunk& chunk)
+{
+	const auto neighbors = GetNeighbors(chunk);
+
+	bool changed = false;
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> slab;
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
 	{
-		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		const Chunk* neighbor = neighbors[GetFaceIndex(static_cast<VisibleFaces>(face))];
+		if (neighbor && neighbor->state == ChunkState::Ready)
 		{
-			for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
-			{
-				auto& voxel = chunk.voxels[GetIndex(x, y, z)];
+			neighbor->GetBorderSlab(GetOppositeFace(static_cast<VisibleFaces>(face)), slab);
+		}
+		else
+		{
+			slab.fill(0);
+		}
+		changed |= chunk.SetNeighborSlab(static_cast<VisibleFaces>(face), slab);
+	}
+	return changed;
+}
 
-				const bool belowCutoff = (y + chunk.position.y) < (VOXEL_CHUNK_WIDTH * ((noiseSet[(z * VOXEL_CHUNK_WIDTH) + x] + 0.8f) / 1.6f));
-				belowCutoff ? voxel.fillType = FillType::Solid : voxel.fillType = FillType::Empty;
-			}
+void ChunkManager::PushBorders(Chunk& chunk, uint32_t faces, bool removed /*= false*/)
+{
+	const auto neighbors = GetNeighbors(chunk);
+
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH> slab;
+	for (; faces != 0; faces &= faces - 1)
+	{
+		// Neighbors that are still generating pull the borders themselves once they are uploaded
+		const VisibleFaces face = static_cast<VisibleFaces>(faces & (~faces + 1));
+		Chunk* neighbor = neighbors[GetFaceIndex(face)];
+		if (!neighbor || neighbor->state != ChunkState::Ready) continue;
+
+		if (removed)
+		{
+			slab.fill(0);
+		}
+		else
+		{
+			chunk.GetBorderSlab(face, slab);
+		}
+
+		if (neighbor->SetNeighborSlab(GetOppositeFace(face), slab))
+		{
+			QueueRemesh(*neighbor);
 		}
 	}
-	noise->FreeNoiseSet(noiseSet);
+}
+
+RegionFile& ChunkManager::GetRegionFile(XMINT3 position)
+{
+	const XMINT3 region = GetRegionCoordinate(GetChunkCoordinate(position));
+	uint32_t index = regionMap.Find(region);
+	if (index == ChunkMap::INVALID_INDEX)
+	{
+		index = static_cast<uint32_t>(regionFiles.size());
+		regionFiles.push_back(eastl::make_unique<RegionFile>());
+		regionMap.Insert(region, index);
+		regionFiles.back()->Open(GetRegionPath(region), false);
+	}
+	return *regionFiles[index];
+}
+
+void ChunkManager::SaveChunks(eastl::span<Chunk* const> chunksToSave)
+{
+	using clock = eastl::chrono::steady_clock;
+	const auto start = clock::now();
+
+	// Chunks of the same region are written together, the order of the regions doesn't matter
+	auto GetRegionKey = [](const Chunk* chunk)
+	{
+		const XMINT3 region = GetRegionCoordinate(GetChunkCoordinate(chunk->position));
+		return (static_cast<uint64_t>(region.x) & 0x1FFFFF) | ((static_cast<uint64_t>(region.y) & 0x1FFFFF) << 21) | 
+			((static_cast<uint64_t>(region.z) & 0x1FFFFF) << 42);
+	};
+	eastl::vector<Chunk*> sortedChunks(chunksToSave.begin(), chunksToSave.end());
+	eastl::sort(sortedChunks.begin(), sortedChunks.end(), [&](const Chunk* a, const Chunk* b) { return GetRegionKey(a) < GetRegionKey(b); });
 
-	for (auto z = 0; z < VOXEL_CHUNK_WIDTH; z++)
+	for (size_t first = 0; first < sortedChunks.size();)
 	{
-		for (auto y = 0; y < VOXEL_CHUNK_WIDTH; y++)
+		size_t last = first + 1;
+		while (last < sortedChunks.size() && GetRegionKey(sortedChunks[last]) == GetRegionKey(sortedChunks[first])) last++;
+
+		const XMINT3 region = GetRegionCoordinate(GetChunkCoordinate(sortedChunks[first]->position));
+		RegionFile& regionFile = GetRegionFile(sortedChunks[first]->position);
+		if ((!regionFile.IsOpen() && !regionFile.Open(GetRegionPath(region), true)) || 
+			!regionFile.SaveChunks({ sortedChunks.data() + first, last - first }))
 		{
-			for (auto x = 0; x < VOXEL_CHUNK_WIDTH; x++)
-			{
-				auto& voxel = chunk.voxels[GetIndex(x, y, z)];
+			UNTITLED_LOG_WARN("Region (%i, %i, %i) couldn't be saved\n", region.x, region.y, region.z);
+		}
+		first = last;
+	}
 
-				// Skip empty voxels
-				if (voxel.fillType == FillType::Empty) continue;
+	if (!sortedChunks.empty())
+	{
+		const auto saveTime = eastl::chrono::duration_cast<eastl::chrono::microseconds>(clock::now() - start).count();
+		UNTITLED_LOG_INFO("Saved %zu chunks in %lli us\n", sortedChunks.size(), static_cast<long long>(saveTime));
+	}
+}
 
+void ChunkManager::SaveColdChunks()
+{
+	if (coldChunks.GetNumUnsaved() == 0) return;
 
-				// Set visible faces for the current voxel, unsets the faces that have a solid block next to them
-				chunk.SetFacesForVoxel(x, y, z);
+	auto chunk = eastl::make_unique<Chunk>(XMINT3 { 0, 0, 0 }, 0);
+	coldChunks.WriteBack(*chunk, [this](Chunk& cachedChunk)
+	{
+		Chunk* chunkToSave = &cachedChunk;
+		SaveChunks({ &chunkToSave, 1 });
+		return !cachedChunk.unsaved;
+	});
+}
 
-				// Faces that aren't part of the top are not visible
-				// However if the top face is visible on this voxel, the sides are too to avoid gaps!
-				if (voxel.visibleFaces & VisibleFaces::Top)
-				{
-					if (x == VOXEL_CHUNK_WIDTH - 1) voxel.visibleFaces |= VisibleFaces::East;
-					if (x == 0)						voxel.visibleFaces |= VisibleFaces::West;
-					if (y == VOXEL_CHUNK_WIDTH - 1) voxel.visibleFaces |= VisibleFaces::Bottom;
-					if (y == 0)						voxel.visibleFaces |= VisibleFaces::North;
-					if (z == VOXEL_CHUNK_WIDTH - 1) voxel.visibleFaces |= VisibleFaces::South;
-				}
-			}
+void ChunkManager::ReleaseChunk(size_t index)
+{
+	if (terrainMode == TerrainMode::Heightmap)
+	{
+		ReleaseColumn(chunks[index]->position);
+	}
+	chunks[index].reset();
+	freeChunkIndices.push_back(index);
+}
+
+void ChunkManager::AcquireColumn(XMINT3 position)
+{
+	const XMINT3 coordinate = GetChunkCoordinate(position);
+	const XMINT3 columnCoordinate { coordinate.x, 0, coordinate.z };
+
+	uint32_t index = columnMap.Find(columnCoordinate);
+	if (index == ChunkMap::INVALID_INDEX)
+	{
+		if (freeColumnIndices.empty())
+		{
+			index = static_cast<uint32_t>(columns.size());
+			columns.emplace_back();
 		}
+		else
+		{
+			index = freeColumnIndices.back();
+			freeColumnIndices.pop_back();
+		}
+
+		// Once flags can't be reset, so every column gets a new heightmap
+		columns[index] = eastl::make_unique<ColumnHeightmap>();
+		columnMap.Insert(columnCoordinate, index);
 	}
+	columns[index]->numChunks++;
 }
 
-void ChunkManager::GenerateMesh(Chunk& chunk)
+void ChunkManager::ReleaseColumn(XMINT3 position)
 {
-	const auto& GetPointsFromFace = [](VisibleFaces face)
+	const XMINT3 coordinate = GetChunkCoordinate(position);
+	const XMINT3 columnCoordinate { coordinate.x, 0, coordinate.z };
+
+	const uint32_t index = columnMap.Find(columnCoordinate);
+	UNTITLED_ASSERT(index != ChunkMap::INVALID_INDEX && "Column hasn't been acquired!");
+	if (--columns[index]->numChunks > 0) return;
+
+	columnMap.Remove(columnCoordinate);
+	columns[index].reset();
+	freeColumnIndices.push_back(index);
+}
+
+ColumnHeightmap* ChunkManager::GetColumn(XMINT3 position) const
+{
+	const XMINT3 coordinate = GetChunkCoordinate(position);
+	const uint32_t index = columnMap.Find(XMINT3 { coordinate.x, 0, coordinate.z });
+	return index != ChunkMap::INVALID_INDEX ? columns[index].get() : nullptr;
+}
+
+void ChunkManager::GenerateVoxels(Chunk& chunk, ColumnHeightmap* column)
+{
+	if (terrainMode == TerrainMode::Density)
+	{
+		GenerateDensity(chunk, densitySampleScale);
+		chunk.FillSections();
+	}
+	else if (GenerateHeightmap(chunk, *column))
 	{
-		static const eastl::array<XMINT3, 8> cubePoints { {
-			{0, 0, 0},
-			{0, 1, 0},
-			{0, 0, 1},
-			{0, 1, 1},
-			{1, 0, 0},
-			{1, 1, 0},
-			{1, 0, 1},
-			{1, 1, 1}
-		} };
+		chunk.FillSections();
+	}
 
-		switch (face)
+	// Set visible faces for all voxels, unsets the faces that have a solid block next to them
+	chunk.CullFaces();
+	chunk.occupancy.Build(chunk.occupiedColumns.data());
+}
+
+void ChunkManager::GenerateColumn(ColumnHeightmap& column, XMINT3 position)
+{
+	// Noise sets are laid out with x as the outermost and z as the innermost dimension.
+	// The heightmap is sampled at y = 0, so the surface continues across the chunks of the column.
+	const eastl::span<float> noiseSet = AllocateNoiseSet(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+	noise->FillNoiseSet(noiseSet.data(), position.x, 0, position.z, VOXEL_CHUNK_WIDTH, 1, VOXEL_CHUNK_WIDTH, 0.25f);
+
+	column.minHeight = eastl::numeric_limits<int32_t>::max();
+	column.maxHeight = eastl::numeric_limits<int32_t>::min();
+	for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+	{
+		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
 		{
-		case VisibleFaces::North:
-			return eastl::array<XMINT3, 4> { cubePoints[6], cubePoints[7], cubePoints[3], cubePoints[2] };
-		case VisibleFaces::South:
-			return eastl::array<XMINT3, 4> { cubePoints[4], cubePoints[0], cubePoints[1], cubePoints[5] };
-		case VisibleFaces::East:
-			return eastl::array<XMINT3, 4> { cubePoints[4], cubePoints[5], cubePoints[7], cubePoints[6] };
-		case VisibleFaces::West:
-			return eastl::array<XMINT3, 4> { cubePoints[0], cubePoints[2], cubePoints[3], cubePoints[1] };
-		case VisibleFaces::Top:
-			return eastl::array<XMINT3, 4> { cubePoints[5], cubePoints[1], cubePoints[3], cubePoints[7] };
-		case VisibleFaces::Bottom:
-			return eastl::array<XMINT3, 4> { cubePoints[4], cubePoints[6], cubePoints[2], cubePoints[0] };
-		default:
-			return eastl::array<XMINT3, 4> { cubePoints[0], cubePoints[0], cubePoints[0], cubePoints[0] };
+			const float surface = VOXEL_CHUNK_WIDTH * ((noiseSet[(x * VOXEL_CHUNK_WIDTH) + z] + 0.8f) / 1.6f);
+			const int32_t ceiling = GetSurfaceCeiling(surface);
+
+			column.heights[(z * VOXEL_CHUNK_WIDTH) + x] = ceiling;
+			column.minHeight = eastl::min(column.minHeight, ceiling);
+			column.maxHeight = eastl::max(column.maxHeight, ceiling);
 		}
-	};
+	}
+}
+
+bool ChunkManager::GenerateHeightmap(Chunk& chunk, ColumnHeightmap& column)
+{
+	std::call_once(column.generated, [&]() { GenerateColumn(column, chunk.position); });
 
-	const auto& GetNormalFromFace = [](VisibleFaces face)
+	// A voxel is below the surface if y + position.y < surface, which for integers is y < ceil(surface) - position.y
+	const bool aboveSurface = chunk.position.y >= column.maxHeight;
+	if (aboveSurface || chunk.position.y + static_cast<int>(VOXEL_CHUNK_WIDTH) <= column.minHeight)
 	{
-		switch (face)
+		const FillType type = aboveSurface ? FillType::Empty : FillType::Solid;
+		const uint64_t row = aboveSurface ? 0 : ~0ull;
+		eastl::fill(chunk.occupiedColumns.begin(), chunk.occupiedColumns.end(), row);
+		eastl::fill(chunk.solidColumns.begin(), chunk.solidColumns.end(), row);
+		for (VoxelStorage& section : chunk.voxelSections)
 		{
-		case VisibleFaces::North:
-			return XMVECTOR { 0, 0, 1 };
-		case VisibleFaces::South:
-			return XMVECTOR { 0, 0, -1 };
-		case VisibleFaces::East:
-			return XMVECTOR { 1, 0, 0 };
-		case VisibleFaces::West:
-			return XMVECTOR { -1, 0, 0 };
-		case VisibleFaces::Top:
-			return XMVECTOR { 0, 1, 0 };
-		case VisibleFaces::Bottom:
-			return XMVECTOR { 0, -1, 0 };
-		default:
-			return XMVECTOR { 0, 0, 0 };
+			section.Fill(type);
 		}
-	};
+		return false;
+	}
 
-	uint32_t vertexCount = 0;
-	uint32_t indexCount = 0;
-	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	FillHeightmapColumns(chunk, column.heights.data());
+	return true;
+}
+
+void ChunkManager::GenerateDensity(Chunk& chunk, uint32_t sampleScale)
+{
+	UNTITLED_ASSERT((VOXEL_CHUNK_WIDTH >> sampleScale) > 0 && "Density samples are further apart than a chunk!");
+
+	// The noise is sampled with x and z swapped, so the innermost dimension of the set runs along
+	// the rows of the chunk and every row is compared against the threshold of its height at once
+	if (sampleScale == 0)
 	{
+		const eastl::span<float> noiseSet = AllocateNoiseSet(VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH);
+		noise->FillNoiseSet(noiseSet.data(), chunk.position.z, chunk.position.y, chunk.position.x, 
+			VOXEL_CHUNK_WIDTH, VOXEL_CHUNK_WIDTH, VOXEL_CHUNK_WIDTH);
 		for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
 		{
 			for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
 			{
-				for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
-				{
-					const auto index = x + VOXEL_CHUNK_WIDTH * (y + VOXEL_CHUNK_WIDTH * z);
-					const auto& voxel = chunk.voxels[index];
-
-					if (!(voxel.visibleFaces & face)) continue;
-					if (voxel.fillType == FillType::Empty) continue;
-
-					auto points = GetPointsFromFace(static_cast<VisibleFaces>(face));
-					for (int i = 0; i < 4; i++)
-					{
-						XMVECTOR finalPos = XMVECTOR { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z), 0 } + XMLoadSInt3(&points[i]);
-						XMVECTOR normal = GetNormalFromFace(static_cast<VisibleFaces>(face));
+				const uint64_t row = GetDensityRow(&noiseSet[GetColumnIndex(y, z) * VOXEL_CHUNK_WIDTH], y + chunk.position.y);
+				chunk.occupiedColumns[GetColumnIndex(y, z)] = row;
+				chunk.solidColumns[GetColumnIndex(y, z)] = row;
+			}
+		}
+		return;
+	}
 
-						BlockIdentifier identifier;
-						identifier.bits.chunkIndex = chunk.index;
-						identifier.bits.voxelIndex = index;
+	// Only the samples are filled, chunks start at multiples of their width so the samples line up with the chunk.
+	// Unlike FillSampledNoiseSet, this doesn't allocate a set of samples next to the full set of the chunk.
+	const int sampleSize = 1 << sampleScale;
+	const int sampleMask = sampleSize - 1;
+	const int numSamples = (VOXEL_CHUNK_WIDTH >> sampleScale) + 1;
+	const eastl::span<float> samples = AllocateNoiseSet(numSamples * numSamples * numSamples);
+	noise->FillNoiseSet(samples.data(), chunk.position.z >> sampleScale, chunk.position.y >> sampleScale, chunk.position.x >> sampleScale,
+		numSamples, numSamples, numSamples, static_cast<float>(sampleSize));
 
-						finalPos = DirectX::XMVectorSetIntW(finalPos, identifier.value);
-						normal = DirectX::XMVectorSetIntW(normal, face);
-						vertices[vertexCount++] = (Vertex { finalPos, normal });
-					}
+	// Voxels are interpolated like FillSampledNoiseSet does, at the centers of the voxels within a cell of samples
+	const float cellScale = 1.0f / sampleSize;
+	const float cellOffset = cellScale * 0.5f;
+	auto Lerp = [](float a, float b, float t) { return a + (b - a) * t; };
 
-					indices[indexCount++] = (vertexCount - 4 + 0);
-					indices[indexCount++] = (vertexCount - 4 + 1);
-					indices[indexCount++] = (vertexCount - 4 + 2);
+	eastl::array<float, VOXEL_CHUNK_WIDTH + 1> rowSamples;
+	alignas(16) eastl::array<float, VOXEL_CHUNK_WIDTH> densities;
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		const int sampleZ = z >> sampleScale;
+		const float zf = (z & sampleMask) * cellScale + cellOffset;
+		for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+		{
+			const int sampleY = y >> sampleScale;
+			const float yf = (y & sampleMask) * cellScale + cellOffset;
+			const float* samples00 = &samples[(sampleZ * numSamples + sampleY) * numSamples];
+			const float* samples10 = samples00 + numSamples * numSamples;
+			const float* samples01 = samples00 + numSamples;
+			const float* samples11 = samples10 + numSamples;
 
-					indices[indexCount++] = (vertexCount - 4 + 0);
-					indices[indexCount++] = (vertexCount - 4 + 2);
-					indices[indexCount++] = (vertexCount - 4 + 3);
-				}
+			// The samples along the row are interpolated across z and y first, then the row is interpolated between them
+			for (int x = 0; x < numSamples; ++x)
+			{
+				rowSamples[x] = Lerp(Lerp(samples00[x], samples10[x], zf), Lerp(samples01[x], samples11[x], zf), yf);
+			}
+			for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+			{
+				const int sampleX = x >> sampleScale;
+				densities[x] = Lerp(rowSamples[sampleX], rowSamples[sampleX + 1], (x & sampleMask) * cellScale + cellOffset);
 			}
+
+			const uint64_t row = GetDensityRow(densities.data(), y + chunk.position.y);
+			chunk.occupiedColumns[GetColumnIndex(y, z)] = row;
+			chunk.solidColumns[GetColumnIndex(y, z)] = row;
 		}
 	}
+}
 
-	chunk.GPUResources.vBuffer = renderer->CreateVertexBuffer(vertices.data(), vertexCount);
-	chunk.GPUResources.iBuffer = renderer->CreateIndexBuffer(indices.data(), indexCount);
+bool ChunkManager::LoadVoxels(Chunk& chunk, const RegionFile& regionFile, uint32_t regionIndex)
+{
+	if (!regionFile.LoadChunk(regionIndex, chunk)) return false;
+
+	// Everything else is derived from the block types, like for generated chunks
+	chunk.RebuildColumns();
+	chunk.CullFaces();
+	chunk.occupancy.Build(chunk.occupiedColumns.data());
+	return true;
+}
+
+void ChunkManager::RestoreVoxels(Chunk& chunk, const eastl::vector<uint8_t>& coldData)
+{
+	coldChunks.Decompress(coldData, chunk);
+
+	chunk.RebuildColumns();
+	chunk.CullFaces();
+	chunk.occupancy.Build(chunk.occupiedColumns.data());
+}
+
+void ChunkManager::UploadMesh(Chunk& chunk)
+{
+	UploadMeshBuffers(chunk);
+	if (!renderer) return;
 
 	chunk.GPUResources.BLAS = renderer->RTPipeline->AddBLAS({
 		AccelerationStructureGeometry {
@@ -291,12 +926,200 @@ void ChunkManager::GenerateMesh(Chunk& chunk)
 		}
 		});
 
-	chunk.GPUResources.BLASInstance = renderer->RTPipeline->AddBLASInstance(chunk.GPUResources.BLAS);
+	// Meshes are in chunk space, the instance places them in the world. 
+	// The chunk index is passed as instance ID, the shaders use it to identify picked voxels
+	const XMMATRIX transform = XMMatrixTranslation(static_cast<float>(chunk.position.x), 
+		static_cast<float>(chunk.position.y), static_cast<float>(chunk.position.z));
+	chunk.GPUResources.BLASInstance = renderer->RTPipeline->AddBLASInstance(chunk.GPUResources.BLAS, transform, static_cast<uint32_t>(chunk.index));
 }
 
-void ChunkManager::RegenerateMesh(Chunk& chunk)
+void ChunkManager::UploadMeshBuffers(Chunk& chunk)
 {
-	FreeChunk(chunk);
-	GenerateMesh(chunk);
+	if (renderer)
+	{
+		chunk.GPUResources.vBuffer = renderer->CreateVertexBuffer(chunk.mesh.vertices.data(), chunk.mesh.vertices.size());
+		chunk.GPUResources.iBuffer = renderer->CreateIndexBuffer(chunk.mesh.indices.data(), chunk.mesh.indices.size());
+	}
+	else
+	{
+		// Headless chunks only keep the sizes the buffers would have, for the stats
+		chunk.GPUResources.vBuffer.sizeInBytes = chunk.mesh.vertices.size() * sizeof(Vertex);
+		chunk.GPUResources.iBuffer.sizeInBytes = chunk.mesh.indices.size() * sizeof(uint32_t);
+	}
+	uploadedBytes += chunk.GPUResources.vBuffer.sizeInBytes + chunk.GPUResources.iBuffer.sizeInBytes;
+
+	// The CPU copy isn't needed anymore once the staging buffers have been filled
+	chunk.mesh.vertices.set_capacity(0);
+	chunk.mesh.indices.set_capacity(0);
+}
+
+bool ChunkManager::RemeshDirtySections(Chunk& chunk)
+{
+	if (chunk.dirtySections == 0) return true;
+
+	eastl::span<const Vertex> patch;
+	eastl::fixed_vector<DXBufferRegion, NUM_SECTIONS, false> regions;
+	if (!ChunkMesher::RemeshDirtySections(chunk, patch, regions)) return false;
+
+	const uint64_t patchBytes = patch.size() * sizeof(Vertex);
+	if (renderer)
+	{
+		renderer->UpdateBuffer(chunk.GPUResources.vBuffer, patch.data(), patchBytes, { regions.data(), regions.size() });
+	}
+	uploadedBytes += patchBytes;
+	numSectionRemeshes += std::popcount(chunk.dirtySections);
+
+	// The indices and the number of vertices stay the same, so the BLAS can be refit as long as not too much of it moved
+	chunk.dirtySections = 0;
 	chunk.needsRebuild = true;
+	chunk.patchedVertexBytes += patchBytes;
+	return true;
+}
+
+void ChunkManager::RegenerateMesh(Chunk& chunk)
+{
+	// The BLAS and its instance are kept, the new mesh changes its topology so it's built again instead of refit
+	if (renderer)
+	{
+		chunk.GPUResources.iBuffer.Release();
+		chunk.GPUResources.vBuffer.Release();
+	}
+	ChunkMesher::GenerateMesh(chunk, meshingMode, chunk.mesh.lod);
+	UploadMeshBuffers(chunk);
+	if (renderer)
+	{
+		renderer->RTPipeline->RebuildBLAS(chunk.GPUResources.BLAS, {
+			AccelerationStructureGeometry {
+				.vertices = chunk.GPUResources.vBuffer,
+				.indices = chunk.GPUResources.iBuffer
+			}
+			});
+	}
+	chunk.needsRebuild = false;
+	chunk.patchedVertexBytes = 0;
+	numFullRemeshes++;
+}
+
+void ChunkManager::ApplyBrush(const VoxelBrush& brush)
+{
+	constexpr int last = VOXEL_CHUNK_WIDTH - 1;
+
+	eastl::vector<XMINT3> filledVoxels;
+	if (brush.shape == BrushShape::FloodFill)
+	{
+		FloodFill(brush, filledVoxels);
+		if (filledVoxels.empty()) return;
+	}
+
+	XMINT3 min, max;
+	GetBrushBounds(brush, min, max);
+	const XMINT3 minChunk = GetChunkCoordinate(min);
+	const XMINT3 maxChunk = GetChunkCoordinate(max);
+	for (int cz = minChunk.z; cz <= maxChunk.z; ++cz)
+	{
+		for (int cy = minChunk.y; cy <= maxChunk.y; ++cy)
+		{
+			for (int cx = minChunk.x; cx <= maxChunk.x; ++cx)
+			{
+				Chunk* chunk = GetChunkAt(XMINT3 { cx << VOXEL_CHUNK_WIDTH_LOG2, cy << VOXEL_CHUNK_WIDTH_LOG2, cz << VOXEL_CHUNK_WIDTH_LOG2 });
+				if (!chunk || chunk->state != ChunkState::Ready || chunk->coarse) continue;
+
+				// Only the rows within the bounds are written, the others keep the masks of previous chunks
+				const XMINT3& position = chunk->position;
+				const XMINT3 localMin { eastl::max(min.x - position.x, 0), eastl::max(min.y - position.y, 0), eastl::max(min.z - position.z, 0) };
+				const XMINT3 localMax { eastl::min(max.x - position.x, last), eastl::min(max.y - position.y, last), eastl::min(max.z - position.z, last) };
+				for (int z = localMin.z; z <= localMax.z; ++z)
+				{
+					for (int y = localMin.y; y <= localMax.y; ++y)
+					{
+						brushRows[GetColumnIndex(y, z)] = (brush.shape == BrushShape::FloodFill) ? 0 :
+							GetBrushRow(brush, position.x, position.y + y, position.z + z);
+					}
+				}
+
+				for (const XMINT3& voxel : filledVoxels)
+				{
+					const XMINT3 local { voxel.x - position.x, voxel.y - position.y, voxel.z - position.z };
+					if (local.x < 0 || local.x > last || local.y < 0 || local.y > last || local.z < 0 || local.z > last) continue;
+					brushRows[GetColumnIndex(local.y, local.z)] |= 1ull << local.x;
+				}
+
+				const uint32_t numChangedVoxels = chunk->CountChangedVoxels(brushRows.data(), brush.type, localMin, localMax);
+				if (!chunk->SetVoxels(brushRows.data(), brush.type, localMin, localMax)) continue;
+				numEditedVoxels += numChangedVoxels;
+
+				// Voxels on the border also change the faces of the neighbor behind it
+				uint32_t borderFaces = 0;
+				if (localMax.z == last)	borderFaces |= VisibleFaces::North;
+				if (localMin.z == 0)	borderFaces |= VisibleFaces::South;
+				if (localMax.x == last)	borderFaces |= VisibleFaces::East;
+				if (localMin.x == 0)	borderFaces |= VisibleFaces::West;
+				if (localMax.y == last)	borderFaces |= VisibleFaces::Top;
+				if (localMin.y == 0)	borderFaces |= VisibleFaces::Bottom;
+
+				auto edited = eastl::find_if(editedChunks.begin(), editedChunks.end(), 
+					[chunk](const auto& editedChunk) { return editedChunk.first == chunk->index; });
+				if (edited != editedChunks.end())
+				{
+					edited->second |= borderFaces;
+				}
+				else
+				{
+					editedChunks.push_back(eastl::make_pair(chunk->index, borderFaces));
+				}
+			}
+		}
+	}
+}
+
+void ChunkManager::FloodFill(const VoxelBrush& brush, eastl::vector<XMINT3>& voxels) const
+{
+	const Chunk* chunk = GetChunkAt(brush.start);
+	if (!chunk || chunk->state != ChunkState::Ready || chunk->coarse) return;
+
+	const FillType target = chunk->GetVoxel(brush.start.x - chunk->position.x, brush.start.y - chunk->position.y, brush.start.z - chunk->position.z);
+	if (target == brush.type) return;
+
+	// Every voxel within the bounds is visited at most once, which is tracked with a bit per voxel
+	XMINT3 min, max;
+	GetBrushBounds(brush, min, max);
+	const int width = max.x - min.x + 1;
+	eastl::vector<uint64_t> visited((width * width * width + 63) / 64, 0);
+	auto Visit = [&](XMINT3 voxel)
+	{
+		if (voxel.x < min.x || voxel.x > max.x || voxel.y < min.y || voxel.y > max.y || voxel.z < min.z || voxel.z > max.z) return false;
+
+		const int bit = (voxel.x - min.x) + width * ((voxel.y - min.y) + width * (voxel.z - min.z));
+		if ((visited[bit >> 6] >> (bit & 63)) & 1) return false;
+		visited[bit >> 6] |= 1ull << (bit & 63);
+		return true;
+	};
+
+	static const eastl::array<XMINT3, NUM_FACE_DIRECTIONS> offsets { {
+		{ 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }
+	} };
+
+	Visit(brush.start);
+	voxels.push_back(brush.start);
+	for (size_t i = 0; i < voxels.size(); ++i)
+	{
+		const XMINT3 voxel = voxels[i];
+		for (const XMINT3& offset : offsets)
+		{
+			const XMINT3 neighbor { voxel.x + offset.x, voxel.y + offset.y, voxel.z + offset.z };
+			if (!Visit(neighbor)) continue;
+
+			// Most neighbors lie in the same chunk as the voxel before them, only crossing a border needs a lookup
+			const XMINT3 local { neighbor.x - chunk->position.x, neighbor.y - chunk->position.y, neighbor.z - chunk->position.z };
+			const bool inChunk = local.x >= 0 && local.x < VOXEL_CHUNK_WIDTH && local.y >= 0 && local.y < VOXEL_CHUNK_WIDTH && local.z >= 0 && local.z < VOXEL_CHUNK_WIDTH;
+			const Chunk* neighborChunk = inChunk ? chunk : GetChunkAt(neighbor);
+			if (!neighborChunk || neighborChunk->state != ChunkState::Ready || neighborChunk->coarse) continue;
+			chunk = neighborChunk;
+
+			if (chunk->GetVoxel(neighbor.x - chunk->position.x, neighbor.y - chunk->position.y, neighbor.z - chunk->position.z) == target)
+			{
+				voxels.push_back(neighbor);
+			}
+		}
+	}
 }
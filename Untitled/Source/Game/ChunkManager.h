@@ -1,43 +1,312 @@
 #pragma once
 
+#include "Core/JobSystem.h"
 #include "Game/Chunk.h"
+#include "Game/ChunkMesher.h"
+#include "Game/ChunkMap.h"
+#include "Game/ColdChunkCache.h"
+#include "Game/RegionFile.h"
+#include "Game/VoxelBrush.h"
 #include "Graphics/Renderer.h"
 
+// Chunk indices are passed to the shaders as instance IDs, which are limited to 24 bits
+constexpr uint32_t MAX_NUM_CHUNKS = 1 << 24;
+
+// Chunks whose border faces were changed by a neighbor are remeshed over several frames
+constexpr uint32_t MAX_BORDER_REMESHES_PER_FRAME = 4;
+
+// Edited chunks are saved to region files in this directory, relative to the working directory
+constexpr const char* REGION_DIRECTORY = "Regions";
+
+// Path of the file of a region, see GetRegionCoordinate
+eastl::string GetRegionPath(DirectX::XMINT3 region);
+
+// Chunks leaving the streaming range are kept compressed in memory up to this many bytes
+constexpr size_t COLD_CHUNK_CACHE_BUDGET = 64 * 1024 * 1024;
+
+enum class TerrainMode
+{
+	// Surface height from 2D noise, the terrain has no caves or overhangs
+	Heightmap,
+	// Solid wherever 3D noise exceeds a threshold rising with the height, which also carves caves and overhangs
+	Density
+};
+
+// 3D noise is sampled every 2^DENSITY_SAMPLE_SCALE voxels and trilinearly interpolated in between, 0 samples every voxel
+constexpr uint32_t DENSITY_SAMPLE_SCALE = 2;
+
+// Height in world space where the density threshold is 0, and the height over which it rises by 1
+constexpr float DENSITY_SURFACE_HEIGHT = 32.0f;
+constexpr float DENSITY_FALLOFF = 48.0f;
+
+// Second component of the pick buffer, the first one holds the index of the picked chunk
 union BlockIdentifier
 {
 	struct
 	{
-		uint32_t chunkIndex : 8;
 		uint32_t voxelIndex : 24;
+		uint32_t face : 8;
 	} bits;
 	uint32_t value;
 };
 
+// Surface of a column of chunks, the heightmap noise doesn't depend on y so all chunks stacked in the column share it
+struct ColumnHeightmap
+{
+	// Ceiling of the surface height in world space for every column of voxels, indexed by z * VOXEL_CHUNK_WIDTH + x
+	eastl::array<int32_t, VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH> heights;
+	int32_t minHeight;
+	int32_t maxHeight;
+
+	// The first chunk of the column to be generated samples the heightmap, the others wait for it
+	std::once_flag generated;
+	// Resident chunks of the column, the heightmap is released together with the last of them
+	uint32_t numChunks = 0;
+};
+
+struct ChunkStats
+{
+	uint32_t numChunks;
+	uint32_t numGeneratingChunks;
+	// Column heightmaps shared by the chunks stacked in them, see ColumnHeightmap
+	uint32_t numColumns;
+	// Chunks that only keep their occupancy pyramid, see Chunk::coarse
+	uint32_t numCoarseChunks;
+	size_t voxelMemoryUsage;
+	size_t meshMemoryUsage;
+	size_t numTriangles;
+
+	// Chunks and their triangles per LOD the chunks are meshed at
+	eastl::array<uint32_t, OccupancyPyramid::NUM_LEVELS + 1> numChunksPerLOD;
+	eastl::array<size_t, OccupancyPyramid::NUM_LEVELS + 1> numTrianglesPerLOD;
+
+	// Remeshes caused by neighboring chunks loading, unloading or editing their border
+	uint32_t numBorderRemeshes;
+
+	// Time from requesting a chunk until it has been uploaded, over all chunks loaded so far
+	float averageLoadLatencyMs;
+	float maxLoadLatencyMs;
+
+	// Time a worker spent generating, loading or restoring and meshing a chunk, over all chunks generated so far
+	float averageGenerationMs;
+	float maxGenerationMs;
+
+	// Time from queueing an edit until the updated BLAS has been recorded, over all edits so far
+	uint32_t numEdits;
+	size_t numEditedVoxels;
+	float averageEditLatencyMs;
+	float maxEditLatencyMs;
+	size_t averageEditUploadBytes;
+
+	// Sections patched in place and chunks that had to be remeshed as a whole since a section outgrew its range
+	uint32_t numSectionRemeshes;
+	uint32_t numFullRemeshes;
+
+	// Chunks restored from the cold chunk cache instead of being loaded or generated, see ColdChunkCache
+	uint32_t numColdChunks;
+	size_t coldMemoryUsage;
+	float coldHitRate;
+	float coldCompressionRatio;
+	float averageDecompressUs;
+
+	// Memory of the chunk BLASes and what it was before the ones that stopped changing were compacted
+	uint32_t numCompactedBLAS;
+	size_t BLASMemoryUsage;
+	size_t uncompactedBLASMemoryUsage;
+
+	// How edited BLASes were updated, fast builds include the ones caused by topology changes, see BLASUpdatePolicy
+	uint32_t numBLASRefits;
+	uint32_t numBLASFastBuilds;
+	uint32_t numBLASTopologyBuilds;
+	uint32_t numBLASFastTraceBuilds;
+
+	// Pool the BLASes are placed in, see AccelerationStructurePool, and the TLAS sized for the instances
+	uint32_t numASPoolBlocks;
+	size_t ASPoolMemory;
+	float ASPoolFragmentation;
+	size_t TLASMemoryUsage;
+};
+
 class ChunkManager
 {
 public:
-	ChunkManager(Renderer* const renderer_);
+	// Without a renderer the chunk manager runs headless, meshes are generated and counted but never uploaded
+	// and there are no acceleration structures. The streaming benchmark uses it to run without a GPU.
+	ChunkManager(Renderer* const renderer_, JobSystem* const jobSystem_, TerrainMode terrainMode_ = TerrainMode::Heightmap);
 	~ChunkManager();
 
-	void AddChunk(DirectX::XMINT3 position);
+	// Queues the generation of a chunk on the job system, the chunk becomes 
+	// visible once UploadGeneratedChunks has picked up the finished mesh
+	void AddChunk(DirectX::XMINT3 position, uint32_t lod = 0);
+
+	// Frees the chunk at the given position, chunks that are still being 
+	// generated are freed once their job has finished
+	void RemoveChunk(DirectX::XMINT3 position);
+
+	// Releases the voxels of a ready chunk and only keeps its occupancy pyramid. Edited chunks
+	// are saved first so their voxels can be restored, fails if they can't be saved.
+	bool CoarsenChunk(DirectX::XMINT3 position);
+
+	// Generates or loads the voxels of a coarse chunk again, its mesh stays visible until the new one has been uploaded
+	bool RefineChunk(DirectX::XMINT3 position);
+
+	// Remeshes a ready chunk from the given level of its occupancy pyramid, 0 meshes the voxels themselves.
+	// Coarse chunks can't be meshed at LOD 0 until they have been refined.
+	bool SetChunkLOD(DirectX::XMINT3 position, uint32_t lod);
+	bool HasChunk(DirectX::XMINT3 position) const;
+
+	// Returns the chunk containing the voxel given in world space, or nullptr if it isn't loaded
+	Chunk* GetChunkAt(DirectX::XMINT3 voxel) const;
+
+	// Returns the six face neighbors of a chunk ordered like VisibleFaces, nullptr where no chunk is loaded
+	eastl::array<Chunk*, NUM_FACE_DIRECTIONS> GetNeighbors(const Chunk& chunk) const;
+
+	// Creates the GPU buffers and acceleration structures for at most maxUploads chunks 
+	// finished by the workers, this has to happen on the render thread
+	void UploadGeneratedChunks(uint32_t maxUploads = eastl::numeric_limits<uint32_t>::max());
+
+	inline uint32_t GetNumGeneratingChunks() const { return numGeneratingChunks; }
+	ChunkStats GetStats() const;
+
+	// Edits are only queued and applied together by ApplyEdits once per frame, 
+	// so every chunk they touch is remeshed at most once however many edits hit it
+	void QueueEdit(const VoxelBrush& brush);
+	void ApplyEdits();
 
 	void CreateVoxel(DirectX::XMUINT2 pickBuffer);
 	void DestroyVoxel(DirectX::XMUINT2 pickBuffer);
 
+	// Finds the picked voxel in world space, fails if the chunk isn't ready to be edited
+	bool GetPickedVoxel(DirectX::XMUINT2 pickBuffer, DirectX::XMINT3& voxel) const;
+
+	// Remeshes at most maxRemeshes chunks whose border faces changed since they were meshed
+	void RemeshDirtyChunks(uint32_t maxRemeshes = MAX_BORDER_REMESHES_PER_FRAME);
 	void RebuildUpdatedChunks();
 
+	// Switches the mesher and regenerates the meshes of all chunks
+	void SetMeshingMode(MeshingMode mode);
+	inline MeshingMode GetMeshingMode() const { return meshingMode; }
+
+	// Samples the density terrain every 2^sampleScale voxels, the octaves apply to the noise of both terrain modes.
+	// Only chunks generated afterwards change, so no chunks may be generating while it's called.
+	void SetDensitySampling(uint32_t sampleScale, int octaves);
+
 private:
 	FastNoiseSIMD* noise;
 	Renderer* const renderer;
+	JobSystem* const jobSystem;
+	const TerrainMode terrainMode;
+	MeshingMode meshingMode;
+	uint32_t densitySampleScale;
 
-	eastl::vector<uint32_t> indices;
-	eastl::vector<Vertex> vertices;
-
-	eastl::vector<Chunk> chunks;
+	// Chunks are heap allocated so the workers can hold on to them while new chunks are added.
+	// Removed chunks leave a hole whose index is reused by the next chunk
+	eastl::vector<eastl::unique_ptr<Chunk>> chunks;
+	eastl::vector<size_t> freeChunkIndices;
+	ChunkMap chunkMap;
 	void FreeChunk(Chunk& chunk);
+	void ReleaseChunk(size_t index);
+
+	// Heightmaps of the columns with resident chunks, only used by heightmap terrain
+	eastl::vector<eastl::unique_ptr<ColumnHeightmap>> columns;
+	eastl::vector<uint32_t> freeColumnIndices;
+	ChunkMap columnMap;
+	void AcquireColumn(DirectX::XMINT3 position);
+	void ReleaseColumn(DirectX::XMINT3 position);
+	ColumnHeightmap* GetColumn(DirectX::XMINT3 position) const;
+
+	// Chunks with dirty sections caused by a neighbor. A chunk is only queued once, see Chunk::remeshQueued, so entries
+	// whose chunk has been released or replaced by another one at the same index are skipped.
+	eastl::deque<size_t> dirtyChunks;
+	uint32_t numBorderRemeshes;
+	void QueueRemesh(Chunk& chunk);
+
+	// Copies the border slabs of all ready neighbors into the chunk, returns whether any of them changed
+	bool PullNeighborBorders(Chunk& chunk);
+
+	// Passes the border slabs on the given sides to the neighbors there, empty slabs tell them the chunk is gone
+	void PushBorders(Chunk& chunk, uint32_t faces, bool removed = false);
+
+	// Region files are opened the first time a chunk of their region is requested and stay open. 
+	// Regions without a file keep a closed one, which is only created once a chunk is saved to it.
+	eastl::vector<eastl::unique_ptr<RegionFile>> regionFiles;
+	ChunkMap regionMap;
+	RegionFile& GetRegionFile(DirectX::XMINT3 position);
 
-	void GenerateVoxels(Chunk& chunk);
-	void GenerateMesh(Chunk& chunk);
+	// Writes chunks to their region files, every region file touched is only mapped again once
+	void SaveChunks(eastl::span<Chunk* const> chunksToSave);
+
+	// Writes the cached chunks whose edits couldn't be saved when they were removed, so the cache can evict them
+	void SaveColdChunks();
+
+	// Voxels of removed and coarsened chunks, taken back out when they are requested again
+	ColdChunkCache coldChunks;
+
+	// Chunks whose generation jobs have finished and how long the jobs took
+	struct GeneratedChunk
+	{
+		size_t index;
+		float generationMs;
+	};
+	std::mutex generatedChunksMutex;
+	eastl::deque<GeneratedChunk> generatedChunks;
+	uint32_t numGeneratingChunks;
+	uint32_t numGeneratedChunks;
+	float totalGenerationMs;
+	float maxGenerationMs;
+
+	uint32_t numLoadedChunks;
+	float totalLoadLatencyMs;
+	float maxLoadLatencyMs;
+
+	struct QueuedEdit
+	{
+		VoxelBrush brush;
+		eastl::chrono::steady_clock::time_point queueTime;
+	};
+
+	// Edits are applied in the order they were queued, later brushes overwrite earlier ones
+	eastl::vector<QueuedEdit> queuedEdits;
+	// Row masks of the chunk a brush is currently applied to, ordered like the columns of a chunk
+	eastl::vector<uint64_t> brushRows;
+	// Chunks changed by the edits of this frame and the sides on which their border changed
+	eastl::vector<eastl::pair<size_t, uint32_t>> editedChunks;
+
+	// Edits become visible with the next BLAS update, the times are resolved in RebuildUpdatedChunks
+	eastl::vector<eastl::chrono::steady_clock::time_point> pendingEditTimes;
+	uint32_t numEdits;
+	size_t numEditedVoxels;
+	float totalEditLatencyMs;
+	float maxEditLatencyMs;
+	size_t totalEditUploadBytes;
+	size_t uploadedBytes;
+	uint32_t numSectionRemeshes;
+	uint32_t numFullRemeshes;
+
+	// Generates the voxels and mesh of a chunk on the job system
+	void SubmitGeneration(Chunk& chunk, uint32_t lod);
+	void GenerateVoxels(Chunk& chunk, ColumnHeightmap* column);
+	void GenerateColumn(ColumnHeightmap& column, DirectX::XMINT3 position);
+	// Fill the occupied and solid columns of a chunk, GenerateVoxels derives the block types from them. Chunks entirely
+	// above or below the surface of their column are filled with a single type, and GenerateHeightmap returns false.
+	bool GenerateHeightmap(Chunk& chunk, ColumnHeightmap& column);
+	void GenerateDensity(Chunk& chunk, uint32_t sampleScale);
+	bool LoadVoxels(Chunk& chunk, const RegionFile& regionFile, uint32_t regionIndex);
+	void RestoreVoxels(Chunk& chunk, const eastl::vector<uint8_t>& coldData);
+	void UploadMesh(Chunk& chunk);
+	void UploadMeshBuffers(Chunk& chunk);
+
+	// Remeshes the dirty sections and patches their ranges in the vertex buffer of the chunk.
+	// Fails without touching the chunk if a section doesn't fit into its range anymore.
+	bool RemeshDirtySections(Chunk& chunk);
+
+	// Remeshes the whole chunk into new buffers, also redistributing the spare room between the sections
 	void RegenerateMesh(Chunk& chunk);
+
+	// Sets the voxels of every loaded chunk the brush covers without remeshing them
+	void ApplyBrush(const VoxelBrush& brush);
+
+	// Voxels connected to the start of a flood fill that have the same type as it, within the bounds of the brush
+	void FloodFill(const VoxelBrush& brush, eastl::vector<DirectX::XMINT3>& voxels) const;
 };
 
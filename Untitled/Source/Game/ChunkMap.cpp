@@ -0,0 +1,101 @@
+#include "PCH.h"
+#include "ChunkMap.h"
+
+using namespace DirectX;
+
+ChunkMap::ChunkMap(uint32_t initialCapacity /*= 64*/) :
+	size(0)
+{
+	UNTITLED_ASSERT(std::has_single_bit(initialCapacity) && "Capacity must be a power of two!");
+
+	slots.resize(initialCapacity, Slot { EMPTY_KEY, INVALID_INDEX });
+	mask = initialCapacity - 1;
+}
+
+void ChunkMap::Insert(XMINT3 coordinate, uint32_t index)
+{
+	if ((size + 1) * 2 > slots.size())
+	{
+		Grow();
+	}
+
+	const uint64_t key = PackCoordinate(coordinate);
+	for (uint64_t slot = Hash(key) & mask;; slot = (slot + 1) & mask)
+	{
+		if (slots[slot].key == key)
+		{
+			slots[slot].index = index;
+			return;
+		}
+		if (slots[slot].key == EMPTY_KEY)
+		{
+			slots[slot] = Slot { key, index };
+			size++;
+			return;
+		}
+	}
+}
+
+bool ChunkMap::Remove(XMINT3 coordinate)
+{
+	const uint64_t key = PackCoordinate(coordinate);
+	uint64_t slot = Hash(key) & mask;
+	while (slots[slot].key != key)
+	{
+		if (slots[slot].key == EMPTY_KEY) return false;
+		slot = (slot + 1) & mask;
+	}
+
+	// Shift the following entries of the probe sequence back into the hole,
+	// unless the hole lies before their home slot
+	uint64_t hole = slot;
+	for (uint64_t next = (hole + 1) & mask; slots[next].key != EMPTY_KEY; next = (next + 1) & mask)
+	{
+		const uint64_t home = Hash(slots[next].key) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			slots[hole] = slots[next];
+			hole = next;
+		}
+	}
+
+	slots[hole] = Slot { EMPTY_KEY, INVALID_INDEX };
+	size--;
+	return true;
+}
+
+void ChunkMap::FindNeighbors(XMINT3 coordinate, eastl::array<uint32_t, NUM_FACE_DIRECTIONS>& indices) const
+{
+	static constexpr eastl::array<XMINT3, NUM_FACE_DIRECTIONS> offsets { {
+		{ 0, 0, 1 },	// North
+		{ 0, 0, -1 },	// South
+		{ 1, 0, 0 },	// East
+		{ -1, 0, 0 },	// West
+		{ 0, 1, 0 },	// Top
+		{ 0, -1, 0 }	// Bottom
+	} };
+
+	for (uint32_t i = 0; i < NUM_FACE_DIRECTIONS; ++i)
+	{
+		indices[i] = Find({ coordinate.x + offsets[i].x, coordinate.y + offsets[i].y, coordinate.z + offsets[i].z });
+	}
+}
+
+void ChunkMap::Grow()
+{
+	eastl::vector<Slot> oldSlots(slots.size() * 2, Slot { EMPTY_KEY, INVALID_INDEX });
+	oldSlots.swap(slots);
+	mask = slots.size() - 1;
+
+	for (const Slot& oldSlot : oldSlots)
+	{
+		if (oldSlot.key == EMPTY_KEY) continue;
+
+		uint64_t slot = Hash(oldSlot.key) & mask;
+		while (slots[slot].key != EMPTY_KEY)
+		{
+			slot = (slot + 1) & mask;
+		}
+		slots[slot] = oldSlot;
+	}
+}
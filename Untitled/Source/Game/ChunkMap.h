@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Game/Chunk.h"
+
+// Open addressing hash map from chunk coordinates to chunk indices. Uses linear probing
+// with backward shift deletion, so no tombstones pile up while chunks stream in and out.
+// The capacity is kept at a power of two with a load factor of at most 1/2.
+class ChunkMap
+{
+public:
+	static constexpr uint32_t INVALID_INDEX = eastl::numeric_limits<uint32_t>::max();
+
+	ChunkMap(uint32_t initialCapacity = 64);
+
+	void Insert(DirectX::XMINT3 coordinate, uint32_t index);
+	bool Remove(DirectX::XMINT3 coordinate);
+
+	// Returns INVALID_INDEX if there is no chunk at the coordinate
+	inline uint32_t Find(DirectX::XMINT3 coordinate) const
+	{
+		const uint64_t key = PackCoordinate(coordinate);
+		for (uint64_t slot = Hash(key) & mask;; slot = (slot + 1) & mask)
+		{
+			if (slots[slot].key == key) return slots[slot].index;
+			if (slots[slot].key == EMPTY_KEY) return INVALID_INDEX;
+		}
+	}
+
+	// Looks up the six face neighbors of a chunk, ordered like VisibleFaces
+	void FindNeighbors(DirectX::XMINT3 coordinate, eastl::array<uint32_t, NUM_FACE_DIRECTIONS>& indices) const;
+
+	inline uint32_t GetSize() const { return size; }
+
+private:
+	// Packed coordinates only use 63 bits, so all bits set never collides with a valid key
+	static constexpr uint64_t EMPTY_KEY = eastl::numeric_limits<uint64_t>::max();
+
+	struct Slot
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	eastl::vector<Slot> slots;
+	uint64_t mask;
+	uint32_t size;
+
+	// 21 bits per axis in two's complement, which covers over a million chunks in every direction
+	static inline uint64_t PackCoordinate(DirectX::XMINT3 coordinate)
+	{
+		return (static_cast<uint64_t>(coordinate.x) & 0x1FFFFF) |
+			((static_cast<uint64_t>(coordinate.y) & 0x1FFFFF) << 21) |
+			((static_cast<uint64_t>(coordinate.z) & 0x1FFFFF) << 42);
+	}
+
+	// Finalizer of MurmurHash3, neighboring coordinates differ in few bits and have to be spread over all slots
+	static inline uint64_t Hash(uint64_t key)
+	{
+		key ^= key >> 33;
+		key *= 0xFF51AFD7ED558CCDull;
+		key ^= key >> 33;
+		key *= 0xC4CEB9FE1A85EC53ull;
+		key ^= key >> 33;
+		return key;
+	}
+
+	void Grow();
+};
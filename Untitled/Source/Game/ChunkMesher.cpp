@@ -0,0 +1,489 @@
+#include "PCH.h"
+#include "ChunkMesher.h"
+
+#include "Core/Logging.h"
+#include "Core/ScratchArena.h"
+
+using namespace DirectX;
+
+// Every thread that meshes chunks gets its own scratch memory, so meshing doesn't need to be serialized
+static thread_local ScratchArena meshArena;
+
+static eastl::array<XMINT3, 4> GetPointsFromFace(VisibleFaces face)
+{
+	static const eastl::array<XMINT3, 8> cubePoints { {
+		{0, 0, 0},
+		{0, 1, 0},
+		{0, 0, 1},
+		{0, 1, 1},
+		{1, 0, 0},
+		{1, 1, 0},
+		{1, 0, 1},
+		{1, 1, 1}
+	} };
+
+	switch (face)
+	{
+	case VisibleFaces::North:
+		return eastl::array<XMINT3, 4> { cubePoints[6], cubePoints[7], cubePoints[3], cubePoints[2] };
+	case VisibleFaces::South:
+		return eastl::array<XMINT3, 4> { cubePoints[4], cubePoints[0], cubePoints[1], cubePoints[5] };
+	case VisibleFaces::East:
+		return eastl::array<XMINT3, 4> { cubePoints[4], cubePoints[5], cubePoints[7], cubePoints[6] };
+	case VisibleFaces::West:
+		return eastl::array<XMINT3, 4> { cubePoints[0], cubePoints[2], cubePoints[3], cubePoints[1] };
+	case VisibleFaces::Top:
+		return eastl::array<XMINT3, 4> { cubePoints[5], cubePoints[1], cubePoints[3], cubePoints[7] };
+	case VisibleFaces::Bottom:
+		return eastl::array<XMINT3, 4> { cubePoints[4], cubePoints[6], cubePoints[2], cubePoints[0] };
+	default:
+		return eastl::array<XMINT3, 4> { cubePoints[0], cubePoints[0], cubePoints[0], cubePoints[0] };
+	}
+}
+
+// Sections are widest in cells at LOD 1
+constexpr uint32_t MAX_LOD_SECTION_WIDTH = SECTION_WIDTH >> 1;
+
+// Visible faces of the cells of a section, one row per face direction and (z, y) cell of the section
+using LODSectionFaces = eastl::array<uint64_t, NUM_FACE_DIRECTIONS * MAX_LOD_SECTION_WIDTH * MAX_LOD_SECTION_WIDTH>;
+
+// Row of the border cells on the given side that are entirely covered by solid voxels of the neighbor there,
+// laid out like the neighbor slabs of the chunk
+static uint64_t GetCoveredBorderRow(const Chunk& chunk, VisibleFaces face, uint32_t lod, int row)
+{
+	const auto& slab = chunk.neighborSlabs[GetFaceIndex(face)];
+	const int cellWidth = 1 << lod;
+
+	uint64_t covered = ~0ull;
+	for (int i = row * cellWidth; i < (row + 1) * cellWidth; ++i)
+	{
+		covered &= slab[i];
+	}
+
+	// Halves the row once per level, keeping the pairs whose bits are both set
+	for (uint32_t level = 0; level < lod; ++level)
+	{
+		covered = CompactEvenBits(covered & (covered >> 1));
+	}
+	return covered;
+}
+
+// Culls the faces of the cells of a section against the neighboring cells of the same level. Past the chunk
+// boundary a face is only hidden where the neighbor is solid across the whole cell. Any LOD of the neighbor
+// covers at least its solid voxels, so there are no cracks between chunks meshed at different levels.
+static void CullLODSection(const Chunk& chunk, uint32_t section, uint32_t lod, LODSectionFaces& faces)
+{
+	const OccupancyPyramid& occupancy = chunk.occupancy;
+	const int last = static_cast<int>(OccupancyPyramid::GetWidth(lod)) - 1;
+	const int cells = static_cast<int>(SECTION_WIDTH >> lod);
+	const uint64_t rowMask = (1ull << cells) - 1;
+
+	const XMINT3 origin = GetSectionOrigin(section);
+	const XMINT3 cellOrigin { origin.x >> lod, origin.y >> lod, origin.z >> lod };
+
+	// Only the sections on the east and west border need the bits of the neighbors along x
+	const bool touchesEast = cellOrigin.x + cells - 1 == last;
+	const bool touchesWest = cellOrigin.x == 0;
+
+	auto Store = [&](VisibleFaces face, int y, int z, uint64_t row)
+	{
+		faces[(GetFaceIndex(face) * cells + (z - cellOrigin.z)) * cells + (y - cellOrigin.y)] = (row >> cellOrigin.x) & rowMask;
+	};
+
+	for (int z = cellOrigin.z; z < cellOrigin.z + cells; ++z)
+	{
+		for (int y = cellOrigin.y; y < cellOrigin.y + cells; ++y)
+		{
+			const uint64_t occupied = occupancy.GetRow(lod, y, z);
+
+			const uint64_t top		= (y < last)	? occupancy.GetRow(lod, y + 1, z) : GetCoveredBorderRow(chunk, VisibleFaces::Top, lod, z);
+			const uint64_t bottom	= (y > 0)		? occupancy.GetRow(lod, y - 1, z) : GetCoveredBorderRow(chunk, VisibleFaces::Bottom, lod, z);
+			const uint64_t north	= (z < last)	? occupancy.GetRow(lod, y, z + 1) : GetCoveredBorderRow(chunk, VisibleFaces::North, lod, y);
+			const uint64_t south	= (z > 0)		? occupancy.GetRow(lod, y, z - 1) : GetCoveredBorderRow(chunk, VisibleFaces::South, lod, y);
+			const uint64_t east		= (occupied >> 1) | (touchesEast ? ((GetCoveredBorderRow(chunk, VisibleFaces::East, lod, z) >> y) & 1) << last : 0);
+			const uint64_t west		= (occupied << 1) | (touchesWest ? (GetCoveredBorderRow(chunk, VisibleFaces::West, lod, z) >> y) & 1 : 0);
+
+			Store(VisibleFaces::North, y, z, occupied & ~north);
+			Store(VisibleFaces::South, y, z, occupied & ~south);
+			Store(VisibleFaces::East, y, z, occupied & ~east);
+			Store(VisibleFaces::West, y, z, occupied & ~west);
+			Store(VisibleFaces::Top, y, z, occupied & ~top);
+			Store(VisibleFaces::Bottom, y, z, occupied & ~bottom);
+		}
+	}
+}
+
+static void EmitQuad(VisibleFaces face, XMINT3 origin, XMINT3 size, FillType type, MeshOutput& output)
+{
+	// The picked voxel is resolved from the hit position and the chunk from the instance ID
+	auto points = GetPointsFromFace(face);
+	for (int i = 0; i < 4; i++)
+	{
+		const XMINT3 position {
+			origin.x + points[i].x * size.x,
+			origin.y + points[i].y * size.y,
+			origin.z + points[i].z * size.z
+		};
+		output.vertices[output.vertexCount++] = PackVertex(position, face, type);
+	}
+}
+
+static void GenerateNaiveMesh(const Chunk& chunk, XMINT3 sectionOrigin, MeshOutput& output)
+{
+	const uint64_t rowMask = ((1ull << SECTION_WIDTH) - 1) << sectionOrigin.x;
+
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		const auto& faceColumns = chunk.faceColumns[GetFaceIndex(static_cast<VisibleFaces>(face))];
+		for (int z = sectionOrigin.z; z < sectionOrigin.z + static_cast<int>(SECTION_WIDTH); ++z)
+		{
+			for (int y = sectionOrigin.y; y < sectionOrigin.y + static_cast<int>(SECTION_WIDTH); ++y)
+			{
+				// Only visit the voxels of the section that have a visible face in this direction
+				for (uint64_t column = faceColumns[GetColumnIndex(y, z)] & rowMask; column != 0; column &= column - 1)
+				{
+					const int x = std::countr_zero(column);
+					EmitQuad(static_cast<VisibleFaces>(face), { x, y, z }, { 1, 1, 1 }, chunk.GetVoxel(x, y, z), output);
+				}
+			}
+		}
+	}
+}
+
+static void GenerateGreedyMesh(const Chunk& chunk, XMINT3 sectionOrigin, bool outerSlicesOnly, MeshOutput& output)
+{
+	// Every face direction is meshed slice by slice along its normal axis. Each slice is a 2D
+	// mask of the block types with a visible face in that direction, which is then covered 
+	// with maximal rectangles of identical block types. Rectangles don't cross section boundaries.
+	constexpr int width = static_cast<int>(SECTION_WIDTH);
+	eastl::array<FillType, SECTION_WIDTH * SECTION_WIDTH> mask;
+	const int sectionStart[3] = { sectionOrigin.x, sectionOrigin.y, sectionOrigin.z };
+
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		// The normal axis (d) and the two axes spanning the slice (u, v)
+		int d, u, v;
+		if (face == VisibleFaces::North || face == VisibleFaces::South) { d = 2; u = 0; v = 1; }
+		else if (face == VisibleFaces::East || face == VisibleFaces::West) { d = 0; u = 1; v = 2; }
+		else { d = 1; u = 0; v = 2; }
+
+		// Faces pointing in the positive direction of their axis can only be visible on the last slice
+		int sliceBegin = sectionStart[d];
+		int sliceEnd = sectionStart[d] + width;
+		if (outerSlicesOnly)
+		{
+			const bool positive = face == VisibleFaces::North || face == VisibleFaces::East || face == VisibleFaces::Top;
+			sliceBegin = positive ? sliceEnd - 1 : sliceBegin;
+			sliceEnd = sliceBegin + 1;
+		}
+
+		for (int slice = sliceBegin; slice < sliceEnd; ++slice)
+		{
+			int position[3];
+			position[d] = slice;
+
+			for (int j = 0; j < width; ++j)
+			{
+				for (int i = 0; i < width; ++i)
+				{
+					position[u] = sectionStart[u] + i;
+					position[v] = sectionStart[v] + j;
+					mask[i + j * width] = chunk.HasVisibleFace(static_cast<VisibleFaces>(face), position[0], position[1], position[2]) ?
+						chunk.GetVoxel(position[0], position[1], position[2]) : FillType::Empty;
+				}
+			}
+
+			for (int j = 0; j < width; ++j)
+			{
+				for (int i = 0; i < width;)
+				{
+					const FillType type = mask[i + j * width];
+					if (type == FillType::Empty)
+					{
+						i++;
+						continue;
+					}
+
+					// Grow the rectangle along u first, then along v for as long as the whole row matches
+					int quadWidth = 1;
+					while (i + quadWidth < width && mask[i + quadWidth + j * width] == type) quadWidth++;
+
+					int quadHeight = 1;
+					for (; j + quadHeight < width; ++quadHeight)
+					{
+						bool rowMatches = true;
+						for (int k = 0; k < quadWidth; ++k)
+						{
+							if (mask[i + k + (j + quadHeight) * width] != type)
+							{
+								rowMatches = false;
+								break;
+							}
+						}
+						if (!rowMatches) break;
+					}
+
+					for (int h = 0; h < quadHeight; ++h)
+					{
+						for (int k = 0; k < quadWidth; ++k)
+						{
+							mask[i + k + (j + h) * width] = FillType::Empty;
+						}
+					}
+
+					int origin[3];
+					int size[3];
+					origin[d] = slice;					size[d] = 1;
+					origin[u] = sectionStart[u] + i;	size[u] = quadWidth;
+					origin[v] = sectionStart[v] + j;	size[v] = quadHeight;
+					EmitQuad(static_cast<VisibleFaces>(face), { origin[0], origin[1], origin[2] }, 
+						{ size[0], size[1], size[2] }, type, output);
+
+					i += quadWidth;
+				}
+			}
+		}
+	}
+}
+
+// Meshes the cells of a section at a level of the occupancy pyramid, all of them use the solid block type
+static void GenerateLODMesh(const Chunk& chunk, uint32_t section, MeshingMode mode, uint32_t lod, MeshOutput& output)
+{
+	LODSectionFaces faces;
+	CullLODSection(chunk, section, lod, faces);
+
+	// Same slicing as the greedy mesher, but the masks are bits since cells don't have a block type.
+	// The naive mode emits one quad per cell face.
+	const int cells = static_cast<int>(SECTION_WIDTH >> lod);
+	const int cellWidth = 1 << lod;
+	const XMINT3 sectionOrigin = GetSectionOrigin(section);
+	const int cellStart[3] = { sectionOrigin.x >> lod, sectionOrigin.y >> lod, sectionOrigin.z >> lod };
+	eastl::array<uint64_t, MAX_LOD_SECTION_WIDTH> mask;
+
+	for (uint32_t face = VisibleFaces::North; face <= VisibleFaces::Bottom; face *= 2)
+	{
+		const uint64_t* faceRows = &faces[GetFaceIndex(static_cast<VisibleFaces>(face)) * cells * cells];
+
+		int d, u, v;
+		if (face == VisibleFaces::North || face == VisibleFaces::South) { d = 2; u = 0; v = 1; }
+		else if (face == VisibleFaces::East || face == VisibleFaces::West) { d = 0; u = 1; v = 2; }
+		else { d = 1; u = 0; v = 2; }
+
+		for (int slice = 0; slice < cells; ++slice)
+		{
+			// Rows of the face rows run along x, slices across x gather a single bit of every row
+			for (int j = 0; j < cells; ++j)
+			{
+				if (d == 2) mask[j] = faceRows[slice * cells + j];
+				else if (d == 1) mask[j] = faceRows[j * cells + slice];
+				else
+				{
+					mask[j] = 0;
+					for (int i = 0; i < cells; ++i)
+					{
+						mask[j] |= ((faceRows[j * cells + i] >> slice) & 1) << i;
+					}
+				}
+			}
+
+			for (int j = 0; j < cells; ++j)
+			{
+				while (mask[j] != 0)
+				{
+					const int i = std::countr_zero(mask[j]);
+					const int quadWidth = (mode == MeshingMode::Greedy) ? std::countr_zero(~(mask[j] >> i)) : 1;
+					const uint64_t quadBits = ((1ull << quadWidth) - 1) << i;
+
+					int quadHeight = 1;
+					while (mode == MeshingMode::Greedy && j + quadHeight < cells && (mask[j + quadHeight] & quadBits) == quadBits)
+					{
+						mask[j + quadHeight] &= ~quadBits;
+						quadHeight++;
+					}
+					mask[j] &= ~quadBits;
+
+					int origin[3];
+					int size[3];
+					origin[d] = (cellStart[d] + slice) * cellWidth;	size[d] = cellWidth;
+					origin[u] = (cellStart[u] + i) * cellWidth;		size[u] = quadWidth * cellWidth;
+					origin[v] = (cellStart[v] + j) * cellWidth;		size[v] = quadHeight * cellWidth;
+					EmitQuad(static_cast<VisibleFaces>(face), { origin[0], origin[1], origin[2] }, 
+						{ size[0], size[1], size[2] }, FillType::Solid, output);
+				}
+			}
+		}
+	}
+}
+
+void ChunkMesher::GenerateMesh(Chunk& chunk, MeshingMode mode, uint32_t lod)
+{
+	// Every quad covers at least one visible voxel or cell face, so the face count bounds the mesh size
+	size_t maxQuads = 0;
+	if (lod == 0)
+	{
+		maxQuads = chunk.CountVisibleFaces();
+	}
+	else
+	{
+		for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+		{
+			maxQuads += CountSectionQuads(chunk, section, lod);
+		}
+	}
+	meshArena.Reset(maxQuads * 4 * sizeof(Vertex) + ScratchArena::ALIGNMENT);
+
+	MeshOutput output {
+		.vertices = meshArena.Allocate<Vertex>(maxQuads * 4)
+	};
+
+	// Sections are meshed back to back, then spread out with spare room in between
+	eastl::array<uint32_t, NUM_SECTIONS> firstVertices;
+	uint32_t quadCapacity = 0;
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		firstVertices[section] = output.vertexCount;
+		GenerateSectionMesh(chunk, section, mode, lod, output);
+
+		const uint32_t quadCount = (output.vertexCount - firstVertices[section]) / 4;
+		chunk.mesh.sections[section] = MeshSection {
+			.firstQuad = quadCapacity,
+			.quadCapacity = quadCount + quadCount / 4 + (lod == 0 ? MESH_SECTION_SPARE_QUADS : 0),
+			.quadCount = quadCount
+		};
+		quadCapacity += chunk.mesh.sections[section].quadCapacity;
+	}
+
+	chunk.mesh.mode = mode;
+	chunk.mesh.lod = lod;
+	chunk.mesh.vertices.resize(quadCapacity * 4);
+	chunk.mesh.indices.resize(quadCapacity * 6);
+	for (uint32_t section = 0; section < NUM_SECTIONS; ++section)
+	{
+		const MeshSection& range = chunk.mesh.sections[section];
+		WriteSection(section, output.vertices.data() + firstVertices[section], range.quadCount, 
+			eastl::span<Vertex>(chunk.mesh.vertices.data() + range.firstQuad * 4, range.quadCapacity * 4));
+	}
+
+	for (uint32_t quad = 0; quad < quadCapacity; ++quad)
+	{
+		const uint32_t base = quad * 4;
+		uint32_t* indices = &chunk.mesh.indices[quad * 6];
+		indices[0] = base + 0;
+		indices[1] = base + 1;
+		indices[2] = base + 2;
+
+		indices[3] = base + 0;
+		indices[4] = base + 2;
+		indices[5] = base + 3;
+	}
+	chunk.dirtySections = 0;
+}
+
+bool ChunkMesher::RemeshDirtySections(Chunk& chunk, eastl::span<const Vertex>& patch, eastl::fixed_vector<DXBufferRegion, NUM_SECTIONS, false>& regions)
+{
+	patch = {};
+	regions.clear();
+	if (chunk.dirtySections == 0) return true;
+
+	// Scratch space for the quads of all dirty sections followed by their patched ranges
+	size_t maxQuads = 0;
+	size_t patchQuads = 0;
+	for (uint64_t dirty = chunk.dirtySections; dirty != 0; dirty &= dirty - 1)
+	{
+		const uint32_t section = std::countr_zero(dirty);
+		maxQuads += CountSectionQuads(chunk, section, chunk.mesh.lod);
+		patchQuads += chunk.mesh.sections[section].quadCapacity;
+	}
+	meshArena.Reset((maxQuads + patchQuads) * 4 * sizeof(Vertex) + 2 * ScratchArena::ALIGNMENT);
+
+	MeshOutput output {
+		.vertices = meshArena.Allocate<Vertex>(maxQuads * 4)
+	};
+	const eastl::span<Vertex> patchVertices = meshArena.Allocate<Vertex>(patchQuads * 4);
+
+	eastl::array<uint32_t, NUM_SECTIONS> quadCounts;
+	eastl::array<uint32_t, NUM_SECTIONS> firstVertices;
+	for (uint64_t dirty = chunk.dirtySections; dirty != 0; dirty &= dirty - 1)
+	{
+		const uint32_t section = std::countr_zero(dirty);
+		firstVertices[section] = output.vertexCount;
+		GenerateSectionMesh(chunk, section, chunk.mesh.mode, chunk.mesh.lod, output);
+
+		quadCounts[section] = (output.vertexCount - firstVertices[section]) / 4;
+		if (quadCounts[section] > chunk.mesh.sections[section].quadCapacity) return false;
+	}
+
+	// Sections are laid out in order, so neighboring dirty sections are copied as a single region
+	uint64_t patchOffset = 0;
+	for (uint64_t dirty = chunk.dirtySections; dirty != 0; dirty &= dirty - 1)
+	{
+		const uint32_t section = std::countr_zero(dirty);
+		MeshSection& range = chunk.mesh.sections[section];
+		range.quadCount = quadCounts[section];
+
+		const uint64_t size = range.quadCapacity * 4 * sizeof(Vertex);
+		WriteSection(section, output.vertices.data() + firstVertices[section], range.quadCount,
+			eastl::span<Vertex>(patchVertices.data() + patchOffset / sizeof(Vertex), range.quadCapacity * 4));
+
+		const uint64_t destinationOffset = range.firstQuad * 4 * sizeof(Vertex);
+		if (!regions.empty() && regions.back().destinationOffset + regions.back().size == destinationOffset)
+		{
+			regions.back().size += size;
+		}
+		else
+		{
+			regions.push_back(DXBufferRegion { patchOffset, destinationOffset, size });
+		}
+		patchOffset += size;
+	}
+	patch = patchVertices;
+	return true;
+}
+
+void ChunkMesher::GenerateSectionMesh(const Chunk& chunk, uint32_t section, MeshingMode mode, uint32_t lod, MeshOutput& output)
+{
+	if (lod > 0)
+	{
+		GenerateLODMesh(chunk, section, mode, lod, output);
+		return;
+	}
+
+	// Voxels of an empty section don't have any faces
+	if (chunk.IsSectionUniform(section, FillType::Empty)) return;
+
+	if (mode == MeshingMode::Greedy)
+	{
+		// Within a solid section all faces are hidden, except for those on the outer layers
+		GenerateGreedyMesh(chunk, GetSectionOrigin(section), chunk.IsSectionUniform(section, FillType::Solid), output);
+	}
+	else
+	{
+		GenerateNaiveMesh(chunk, GetSectionOrigin(section), output);
+	}
+}
+
+uint32_t ChunkMesher::CountSectionQuads(const Chunk& chunk, uint32_t section, uint32_t lod)
+{
+	if (lod == 0) return chunk.CountVisibleFaces(section);
+
+	LODSectionFaces faces;
+	CullLODSection(chunk, section, lod, faces);
+
+	const uint32_t cells = SECTION_WIDTH >> lod;
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < NUM_FACE_DIRECTIONS * cells * cells; ++i)
+	{
+		count += std::popcount(faces[i]);
+	}
+	return count;
+}
+
+void ChunkMesher::WriteSection(uint32_t section, const Vertex* quadVertices, uint32_t quadCount, eastl::span<Vertex> destination)
+{
+	UNTITLED_ASSERT(quadCount * 4 <= destination.size() && "Section doesn't fit into its range!");
+
+	// Unused quads are collapsed into the origin of the section, which keeps the bounds of the range tight
+	const Vertex unused = PackVertex(GetSectionOrigin(section), VisibleFaces::North, FillType::Empty);
+	eastl::copy(quadVertices, quadVertices + quadCount * 4, destination.begin());
+	eastl::fill(destination.begin() + quadCount * 4, destination.end(), unused);
+}
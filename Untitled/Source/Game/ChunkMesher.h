@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Game/Chunk.h"
+
+// Every section reserves a quarter of its quads plus a few more as spare room for edits,
+// so most edits can be patched in place instead of reallocating the buffers of the chunk.
+// Distant chunks meshed at a coarser LOD are rarely edited and only reserve the quarter.
+constexpr uint32_t MESH_SECTION_SPARE_QUADS = 8;
+
+// Output of the meshers, the span is sized by the caller from an upper bound of the quad count.
+// Only vertices are emitted, the indices of every quad follow the same pattern.
+struct MeshOutput
+{
+	eastl::span<Vertex> vertices;
+	uint32_t vertexCount = 0;
+};
+
+// Meshers only read the voxels, faces and occupancy of a chunk and write its ChunkMesh. Every thread
+// meshes into scratch memory of its own, so chunks can be meshed on the workers and the render thread at once.
+namespace ChunkMesher
+{
+	// Meshes every section and lays them out with spare room for edits
+	void GenerateMesh(Chunk& chunk, MeshingMode mode, uint32_t lod);
+
+	// Remeshes the dirty sections and writes their ranges into a patch for the vertex buffer of the chunk, sections next
+	// to each other share a region. The patch lives in the scratch memory of the thread until it meshes the next chunk.
+	// Fails without touching the chunk if a section doesn't fit into its range anymore.
+	bool RemeshDirtySections(Chunk& chunk, eastl::span<const Vertex>& patch, eastl::fixed_vector<DXBufferRegion, NUM_SECTIONS, false>& regions);
+
+	void GenerateSectionMesh(const Chunk& chunk, uint32_t section, MeshingMode mode, uint32_t lod, MeshOutput& output);
+
+	// Upper bound for the number of quads of a section meshed at the given LOD
+	uint32_t CountSectionQuads(const Chunk& chunk, uint32_t section, uint32_t lod);
+
+	// Copies the quads of a section into its range and collapses the unused quads
+	void WriteSection(uint32_t section, const Vertex* quadVertices, uint32_t quadCount, eastl::span<Vertex> destination);
+}
@@ -0,0 +1,215 @@
+#include "PCH.h"
+#include "ChunkStreamer.h"
+
+using namespace DirectX;
+
+// Every resident chunk owns a BLAS, chunks removed while generating never get one
+static_assert((2 * STREAMING_UNLOAD_RADIUS + 1) * (2 * STREAMING_UNLOAD_RADIUS + 1) <= MAX_NUM_BLAS,
+	"Streaming radius exceeds the maximum number of BLAS!");
+
+static int GetHorizontalDistanceSquared(XMINT3 a, XMINT3 b)
+{
+	return (a.x - b.x) * (a.x - b.x) + (a.z - b.z) * (a.z - b.z);
+}
+
+static XMINT3 GetChunkPosition(XMINT3 coordinate)
+{
+	return XMINT3 {
+		coordinate.x * static_cast<int>(VOXEL_CHUNK_WIDTH),
+		coordinate.y * static_cast<int>(VOXEL_CHUNK_WIDTH),
+		coordinate.z * static_cast<int>(VOXEL_CHUNK_WIDTH)
+	};
+}
+
+ChunkStreamer::ChunkStreamer(ChunkManager* const chunkManager_) :
+	chunkManager(chunkManager_),
+	cameraChunk({ 0, 0, 0 }),
+	initialized(false),
+	streaming(false)
+{
+}
+
+void ChunkStreamer::Update(const RaytracingCamera& camera)
+{
+	// The terrain fits into a single layer of chunks, so only the horizontal position matters
+	const XMINT3 currentChunk {
+		static_cast<int>(floorf(camera.position.x / VOXEL_CHUNK_WIDTH)),
+		0,
+		static_cast<int>(floorf(camera.position.z / VOXEL_CHUNK_WIDTH))
+	};
+
+	if (!initialized || currentChunk.x != cameraChunk.x || currentChunk.z != cameraChunk.z)
+	{
+		cameraChunk = currentChunk;
+		initialized = true;
+		UpdateQueues();
+	}
+
+	// The camera may have turned since the last frame, so the order is refreshed every frame
+	PrioritizeLoadQueue(camera);
+
+	while (!loadQueue.empty() && chunkManager->GetNumGeneratingChunks() < STREAMING_MAX_GENERATING_CHUNKS)
+	{
+		const XMINT3 coordinate = loadQueue.back();
+		loadQueue.pop_back();
+
+		chunkManager->AddChunk(GetChunkPosition(coordinate), SelectLOD(camera, coordinate, 0));
+		residentChunks.push_back(coordinate);
+	}
+
+	chunkManager->UploadGeneratedChunks(STREAMING_MAX_UPLOADS_PER_FRAME);
+
+	// Chunks only become ready over time, so their detail is checked every frame
+	UpdateDetail(camera);
+
+	// Report the state of the world whenever streaming has caught up with the camera
+	const bool wasStreaming = streaming;
+	streaming = !loadQueue.empty() || chunkManager->GetNumGeneratingChunks() > 0;
+	if (wasStreaming && !streaming)
+	{
+		const ChunkStats stats = chunkManager->GetStats();
+		UNTITLED_LOG_INFO("Streaming caught up: %u chunks resident (%u coarse) in %u columns, load latency %.2f ms average / %.2f ms max, "
+			"generation %.2f ms average / %.2f ms max, %zu bytes of voxel data, %zu bytes of mesh data, %zu triangles, %u remeshes caused by neighbors\n", 
+			stats.numChunks, stats.numCoarseChunks, stats.numColumns, stats.averageLoadLatencyMs, stats.maxLoadLatencyMs, 
+			stats.averageGenerationMs, stats.maxGenerationMs, stats.voxelMemoryUsage, 
+			stats.meshMemoryUsage, stats.numTriangles, stats.numBorderRemeshes);
+		for (uint32_t lod = 0; lod <= OccupancyPyramid::NUM_LEVELS; ++lod)
+		{
+			UNTITLED_LOG_INFO("LOD %u: %u chunks, %zu triangles\n", lod, stats.numChunksPerLOD[lod], stats.numTrianglesPerLOD[lod]);
+		}
+		UNTITLED_LOG_INFO("Edits: %u changing %zu voxels, visible after %.2f ms average / %.2f ms max, %zu bytes uploaded on average, "
+			"%u sections patched, %u chunks remeshed\n", stats.numEdits, stats.numEditedVoxels, stats.averageEditLatencyMs, 
+			stats.maxEditLatencyMs, stats.averageEditUploadBytes, stats.numSectionRemeshes, stats.numFullRemeshes);
+		UNTITLED_LOG_INFO("Cold chunks: %u cached in %zu bytes, %.1f%% hit rate, %.1fx compression, %.1f us average decompression\n",
+			stats.numColdChunks, stats.coldMemoryUsage, stats.coldHitRate * 100.0f, stats.coldCompressionRatio, stats.averageDecompressUs);
+		UNTITLED_LOG_INFO("BLAS memory: %zu bytes, %zu bytes before compaction with %u of them compacted\n",
+			stats.BLASMemoryUsage, stats.uncompactedBLASMemoryUsage, stats.numCompactedBLAS);
+		UNTITLED_LOG_INFO("BLAS updates: %u refits, %u fast builds (%u for topology changes), %u fast trace builds\n",
+			stats.numBLASRefits, stats.numBLASFastBuilds, stats.numBLASTopologyBuilds, stats.numBLASFastTraceBuilds);
+		UNTITLED_LOG_INFO("AS pool: %zu bytes in %u blocks, %.1f%% of the free memory fragmented, %zu bytes of TLAS\n",
+			stats.ASPoolMemory, stats.numASPoolBlocks, stats.ASPoolFragmentation * 100.0f, stats.TLASMemoryUsage);
+	}
+}
+
+void ChunkStreamer::UpdateQueues()
+{
+	const int loadRadiusSquared = STREAMING_LOAD_RADIUS * STREAMING_LOAD_RADIUS;
+	const int unloadRadiusSquared = STREAMING_UNLOAD_RADIUS * STREAMING_UNLOAD_RADIUS;
+
+	// Unload the chunks that left the unload radius and drop requests that left the load radius
+	eastl::erase_if(residentChunks, [&](XMINT3 coordinate)
+	{
+		if (GetHorizontalDistanceSquared(coordinate, cameraChunk) <= unloadRadiusSquared) return false;
+
+		chunkManager->RemoveChunk(GetChunkPosition(coordinate));
+		return true;
+	});
+	eastl::erase_if(loadQueue, [&](XMINT3 coordinate)
+	{
+		return GetHorizontalDistanceSquared(coordinate, cameraChunk) > loadRadiusSquared;
+	});
+
+	// Request every chunk within the load radius that isn't resident or queued yet
+	for (int z = -STREAMING_LOAD_RADIUS; z <= STREAMING_LOAD_RADIUS; ++z)
+	{
+		for (int x = -STREAMING_LOAD_RADIUS; x <= STREAMING_LOAD_RADIUS; ++x)
+		{
+			if (x * x + z * z > loadRadiusSquared) continue;
+
+			const XMINT3 coordinate { cameraChunk.x + x, 0, cameraChunk.z + z };
+			if (chunkManager->HasChunk(GetChunkPosition(coordinate))) continue;
+
+			auto queued = eastl::find_if(loadQueue.begin(), loadQueue.end(), [&](XMINT3 other)
+			{
+				return other.x == coordinate.x && other.z == coordinate.z;
+			});
+			if (queued == loadQueue.end())
+			{
+				loadQueue.push_back(coordinate);
+			}
+		}
+	}
+
+	UNTITLED_LOG_INFO("Camera entered chunk (%i, %i), %u chunks queued for loading\n",
+		cameraChunk.x, cameraChunk.z, GetLoadQueueDepth());
+}
+
+void ChunkStreamer::UpdateDetail(const RaytracingCamera& camera)
+{
+	const int detailRadiusSquared = STREAMING_DETAIL_RADIUS * STREAMING_DETAIL_RADIUS;
+	const int coarseRadiusSquared = STREAMING_COARSE_RADIUS * STREAMING_COARSE_RADIUS;
+
+	uint32_t numLODSwitches = 0;
+	for (XMINT3 coordinate : residentChunks)
+	{
+		const Chunk* chunk = chunkManager->GetChunkAt(GetChunkPosition(coordinate));
+		if (!chunk || chunk->state != ChunkState::Ready) continue;
+
+		const uint32_t lod = SelectLOD(camera, coordinate, chunk->mesh.lod);
+		if (lod != chunk->mesh.lod && numLODSwitches < STREAMING_MAX_LOD_SWITCHES_PER_FRAME)
+		{
+			numLODSwitches += chunkManager->SetChunkLOD(GetChunkPosition(coordinate), lod) ? 1 : 0;
+		}
+
+		// Refining shares the generation budget with loading
+		const int distanceSquared = GetHorizontalDistanceSquared(coordinate, cameraChunk);
+		if (distanceSquared > coarseRadiusSquared)
+		{
+			chunkManager->CoarsenChunk(GetChunkPosition(coordinate));
+		}
+		else if (distanceSquared <= detailRadiusSquared && chunkManager->GetNumGeneratingChunks() < STREAMING_MAX_GENERATING_CHUNKS)
+		{
+			chunkManager->RefineChunk(GetChunkPosition(coordinate));
+		}
+	}
+}
+
+uint32_t ChunkStreamer::SelectLOD(const RaytracingCamera& camera, XMINT3 coordinate, uint32_t currentLOD) const
+{
+	// Distance to the closest point of the chunk
+	const XMINT3 position = GetChunkPosition(coordinate);
+	auto GetAxisDistance = [](float camera, int start)
+	{
+		return eastl::max(eastl::max(start - camera, camera - (start + static_cast<int>(VOXEL_CHUNK_WIDTH))), 0.0f);
+	};
+	const float dx = GetAxisDistance(camera.position.x, position.x);
+	const float dy = GetAxisDistance(camera.position.y, position.y);
+	const float dz = GetAxisDistance(camera.position.z, position.z);
+	const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+	uint32_t lod = 0;
+	for (uint32_t level = 0; level < OccupancyPyramid::NUM_LEVELS; ++level)
+	{
+		const float threshold = STREAMING_LOD_DISTANCES[level] - (level < currentLOD ? STREAMING_LOD_HYSTERESIS : 0.0f);
+		if (distance > threshold) lod = level + 1;
+	}
+	return lod;
+}
+
+void ChunkStreamer::PrioritizeLoadQueue(const RaytracingCamera& camera)
+{
+	if (loadQueue.empty()) return;
+
+	BoundingFrustum frustum(camera.projection);
+	frustum.Transform(frustum, XMMatrixInverse(nullptr, camera.view));
+
+	const XMVECTOR cameraPosition = XMLoadFloat3A(&camera.position);
+	const float halfWidth = VOXEL_CHUNK_WIDTH * 0.5f;
+
+	// Nearest chunks first, chunks outside of the view frustum are treated as if they were twice as far away
+	auto GetPriority = [&](XMINT3 coordinate)
+	{
+		const XMINT3 position = GetChunkPosition(coordinate);
+		const XMFLOAT3 center { position.x + halfWidth, position.y + halfWidth, position.z + halfWidth };
+		const float distanceSquared = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&center) - cameraPosition));
+
+		const BoundingBox bounds(center, XMFLOAT3 { halfWidth, halfWidth, halfWidth });
+		return frustum.Intersects(bounds) ? distanceSquared : 4.0f * distanceSquared;
+	};
+
+	// Sorted back to front since the queue is consumed from the back
+	eastl::sort(loadQueue.begin(), loadQueue.end(), [&](XMINT3 a, XMINT3 b)
+	{
+		return GetPriority(a) > GetPriority(b);
+	});
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Game/ChunkManager.h"
+#include "Graphics/Raytracing/RaytracingCamera.h"
+
+// Radii are in chunks and measured on the horizontal plane around the chunk containing the camera.
+// Chunks are loaded within LOAD_RADIUS but only unloaded beyond UNLOAD_RADIUS, so moving
+// back and forth across a chunk border doesn't repeatedly load and unload the same chunks.
+constexpr int STREAMING_LOAD_RADIUS = 5;
+constexpr int STREAMING_UNLOAD_RADIUS = 7;
+
+// Chunks beyond COARSE_RADIUS release their voxels and only keep the occupancy pyramid,
+// they are generated again once they come back within DETAIL_RADIUS
+constexpr int STREAMING_DETAIL_RADIUS = 3;
+constexpr int STREAMING_COARSE_RADIUS = 4;
+static_assert(STREAMING_DETAIL_RADIUS < STREAMING_COARSE_RADIUS);
+
+// Chunks further from the camera than the distance of a LOD are meshed at that level of their occupancy
+// pyramid, distances are in voxels. A chunk only switches back to a finer level once it is closer than 
+// the distance of that level minus the hysteresis, so a camera moving along a threshold doesn't remesh it every frame.
+// Chunks within LOD 0 have to be within the detail radius, coarse chunks can't be meshed from their voxels.
+constexpr eastl::array<float, OccupancyPyramid::NUM_LEVELS> STREAMING_LOD_DISTANCES = { 128.0f, 192.0f, 256.0f };
+constexpr float STREAMING_LOD_HYSTERESIS = 16.0f;
+constexpr uint32_t STREAMING_MAX_LOD_SWITCHES_PER_FRAME = 4;
+
+// Limits the work started per frame. Generation jobs are only submitted up to a fixed number in
+// flight, the remaining requests stay in the load queue so they can be reprioritized as the camera moves
+constexpr uint32_t STREAMING_MAX_GENERATING_CHUNKS = 8;
+constexpr uint32_t STREAMING_MAX_UPLOADS_PER_FRAME = 2;
+
+// Keeps the chunks around the camera resident
+class ChunkStreamer
+{
+public:
+	ChunkStreamer(ChunkManager* const chunkManager_);
+
+	void Update(const RaytracingCamera& camera);
+
+	inline uint32_t GetLoadQueueDepth() const { return static_cast<uint32_t>(loadQueue.size()); }
+
+private:
+	ChunkManager* const chunkManager;
+
+	DirectX::XMINT3 cameraChunk;
+	bool initialized;
+	bool streaming;
+
+	// Chunk coordinates that are requested but haven't been submitted yet, ordered by priority
+	eastl::vector<DirectX::XMINT3> loadQueue;
+	// Chunk coordinates of all chunks that have been submitted to the chunk manager
+	eastl::vector<DirectX::XMINT3> residentChunks;
+
+	void UpdateQueues();
+	void UpdateDetail(const RaytracingCamera& camera);
+	void PrioritizeLoadQueue(const RaytracingCamera& camera);
+
+	// Picks the LOD of a chunk based on its distance to the camera and the LOD it's currently meshed at
+	uint32_t SelectLOD(const RaytracingCamera& camera, DirectX::XMINT3 coordinate, uint32_t currentLOD) const;
+};
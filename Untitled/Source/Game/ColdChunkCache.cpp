@@ -0,0 +1,270 @@
+#include "PCH.h"
+#include "ColdChunkCache.h"
+
+using namespace DirectX;
+
+// Entries start with the flags of the chunk, followed by a header, the palette and the runs of every section
+static constexpr uint8_t CHUNK_EDITED = 1;
+static constexpr uint8_t CHUNK_UNSAVED = 2;
+
+struct SectionHeader
+{
+	uint8_t bitsLog2;
+	uint8_t uniform;
+	uint16_t paletteSize;
+};
+
+// A control byte with the high bit set repeats the following word, otherwise that many words follow literally
+static constexpr uint8_t REPEAT_RUN = 0x80;
+static constexpr uint32_t MAX_RUN_LENGTH = 0x7F;
+
+// Sections store at most 16 bits per index
+static constexpr uint32_t MAX_WORDS_PER_SECTION = VOXELS_PER_SECTION * 16 / 64;
+
+static void Append(eastl::vector<uint8_t>& data, const void* source, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(source);
+	data.insert(data.end(), bytes, bytes + size);
+}
+
+// Packed indices of terrain are mostly runs of all solid or all empty words, and stay as they are elsewhere
+static void CompressWords(eastl::span<const uint64_t> words, eastl::vector<uint8_t>& data)
+{
+	size_t i = 0;
+	while (i < words.size())
+	{
+		size_t length = 1;
+		while (i + length < words.size() && length < MAX_RUN_LENGTH && words[i + length] == words[i]) length++;
+		if (length > 1)
+		{
+			data.push_back(static_cast<uint8_t>(REPEAT_RUN | length));
+			Append(data, &words[i], sizeof(uint64_t));
+			i += length;
+			continue;
+		}
+
+		// Literal runs end where the next repeat starts
+		while (i + length < words.size() && length < MAX_RUN_LENGTH &&
+			!(i + length + 1 < words.size() && words[i + length] == words[i + length + 1])) length++;
+		data.push_back(static_cast<uint8_t>(length));
+		Append(data, &words[i], length * sizeof(uint64_t));
+		i += length;
+	}
+}
+
+static const uint8_t* DecompressWords(const uint8_t* data, uint64_t* words, size_t wordCount)
+{
+	for (size_t i = 0; i < wordCount;)
+	{
+		const uint8_t control = *data++;
+		const size_t length = control & MAX_RUN_LENGTH;
+		UNTITLED_ASSERT(i + length <= wordCount && "Run exceeds the section!");
+		if (control & REPEAT_RUN)
+		{
+			uint64_t word;
+			memcpy(&word, data, sizeof(word));
+			eastl::fill_n(words + i, length, word);
+			data += sizeof(word);
+		}
+		else
+		{
+			memcpy(words + i, data, length * sizeof(uint64_t));
+			data += length * sizeof(uint64_t);
+		}
+		i += length;
+	}
+	return data;
+}
+
+ColdChunkCache::ColdChunkCache(size_t budget_) :
+	oldest(INVALID_ENTRY),
+	newest(INVALID_ENTRY),
+	budget(budget_),
+	size(0),
+	numUnsaved(0),
+	writeBackNeeded(false),
+	numHits(0),
+	numMisses(0),
+	totalResidentBytes(0),
+	totalCompressedBytes(0),
+	totalDecompressNs(0),
+	numDecompressions(0)
+{
+}
+
+void ColdChunkCache::Insert(const Chunk& chunk)
+{
+	UNTITLED_ASSERT(!chunk.coarse && "Coarse chunks have no voxels to cache!");
+
+	const XMINT3 coordinate = GetChunkCoordinate(chunk.position);
+	const uint32_t existing = entryMap.Find(coordinate);
+	if (existing != ChunkMap::INVALID_INDEX)
+	{
+		Remove(existing);
+	}
+
+	uint32_t index;
+	if (freeEntries.empty())
+	{
+		index = static_cast<uint32_t>(entries.size());
+		entries.emplace_back();
+	}
+	else
+	{
+		index = freeEntries.back();
+		freeEntries.pop_back();
+	}
+
+	Entry& entry = entries[index];
+	entry.position = chunk.position;
+	entry.data.clear();
+	entry.data.push_back((chunk.edited ? CHUNK_EDITED : 0) | (chunk.unsaved ? CHUNK_UNSAVED : 0));
+	numUnsaved += chunk.unsaved ? 1 : 0;
+
+	size_t residentBytes = 0;
+	for (const VoxelStorage& section : chunk.voxelSections)
+	{
+		const eastl::span<const FillType> palette = section.GetPalette();
+		const SectionHeader header {
+			.bitsLog2 = static_cast<uint8_t>(std::countr_zero(section.GetBitsPerIndex())),
+			.uniform = section.IsUniform(),
+			.paletteSize = static_cast<uint16_t>(palette.size())
+		};
+		Append(entry.data, &header, sizeof(header));
+		Append(entry.data, palette.data(), palette.size() * sizeof(FillType));
+		CompressWords(section.GetWords(), entry.data);
+		residentBytes += section.GetMemoryUsage();
+	}
+
+	// Entries stay in the cache for a while, so they don't keep the slack of the buffer
+	entry.data.shrink_to_fit();
+	size += entry.data.size();
+	totalResidentBytes += residentBytes;
+	totalCompressedBytes += entry.data.size();
+
+	entry.previous = newest;
+	entry.next = INVALID_ENTRY;
+	if (newest != INVALID_ENTRY)
+	{
+		entries[newest].next = index;
+	}
+	else
+	{
+		oldest = index;
+	}
+	newest = index;
+	entryMap.Insert(coordinate, index);
+	Evict();
+}
+
+bool ColdChunkCache::Take(XMINT3 position, eastl::vector<uint8_t>& data)
+{
+	const uint32_t index = entryMap.Find(GetChunkCoordinate(position));
+	if (index == ChunkMap::INVALID_INDEX)
+	{
+		numMisses++;
+		return false;
+	}
+
+	numHits++;
+	data.clear();
+	data.swap(entries[index].data);
+	size -= data.size();
+	numUnsaved -= (data[0] & CHUNK_UNSAVED) ? 1 : 0;
+	Remove(index);
+	return true;
+}
+
+static void DecompressChunk(const eastl::vector<uint8_t>& data, Chunk& chunk)
+{
+	const uint8_t* source = data.data();
+	const uint8_t flags = *source++;
+
+	eastl::array<uint64_t, MAX_WORDS_PER_SECTION> words;
+	eastl::fixed_vector<FillType, 16> palette;
+	for (VoxelStorage& section : chunk.voxelSections)
+	{
+		SectionHeader header;
+		memcpy(&header, source, sizeof(header));
+		source += sizeof(header);
+		UNTITLED_ASSERT((!header.uniform || (header.bitsLog2 == 0 && header.paletteSize == 1)) && "Cached section is invalid!");
+
+		palette.resize(header.paletteSize);
+		memcpy(palette.data(), source, header.paletteSize * sizeof(FillType));
+		source += header.paletteSize * sizeof(FillType);
+
+		if (!header.uniform)
+		{
+			source = DecompressWords(source, words.data(), VOXELS_PER_SECTION >> (6 - header.bitsLog2));
+		}
+		section.Assign({ palette.data(), palette.size() }, header.bitsLog2, header.uniform ? nullptr : words.data());
+	}
+	UNTITLED_ASSERT(source == data.data() + data.size() && "Cached chunk has been decompressed partially!");
+
+	chunk.edited = (flags & CHUNK_EDITED) != 0;
+	chunk.unsaved = (flags & CHUNK_UNSAVED) != 0;
+}
+
+void ColdChunkCache::Decompress(const eastl::vector<uint8_t>& data, Chunk& chunk)
+{
+	using clock = eastl::chrono::steady_clock;
+	auto start = clock::now();
+
+	DecompressChunk(data, chunk);
+
+	totalDecompressNs += eastl::chrono::duration_cast<eastl::chrono::nanoseconds>(clock::now() - start).count();
+	numDecompressions++;
+}
+
+void ColdChunkCache::WriteBack(Chunk& chunk, const eastl::function<bool(Chunk&)>& save)
+{
+	for (uint32_t index = oldest; index != INVALID_ENTRY && numUnsaved > 0; index = entries[index].next)
+	{
+		Entry& entry = entries[index];
+		if (!(entry.data[0] & CHUNK_UNSAVED)) continue;
+
+		chunk.position = entry.position;
+		DecompressChunk(entry.data, chunk);
+		if (save(chunk))
+		{
+			entry.data[0] &= ~CHUNK_UNSAVED;
+			numUnsaved--;
+		}
+	}
+	writeBackNeeded = writeBackNeeded && numUnsaved > 0;
+	Evict();
+}
+
+void ColdChunkCache::Remove(uint32_t index)
+{
+	Entry& entry = entries[index];
+	if (entry.previous != INVALID_ENTRY) entries[entry.previous].next = entry.next;
+	else oldest = entry.next;
+	if (entry.next != INVALID_ENTRY) entries[entry.next].previous = entry.previous;
+	else newest = entry.previous;
+
+	// Taken entries have already moved their data out
+	size -= entry.data.size();
+	numUnsaved -= (!entry.data.empty() && (entry.data[0] & CHUNK_UNSAVED)) ? 1 : 0;
+	entry.data = {};
+	entryMap.Remove(GetChunkCoordinate(entry.position));
+	freeEntries.push_back(index);
+}
+
+void ColdChunkCache::Evict()
+{
+	uint32_t index = oldest;
+	while (size > budget && index != INVALID_ENTRY)
+	{
+		const uint32_t next = entries[index].next;
+		if (entries[index].data[0] & CHUNK_UNSAVED)
+		{
+			writeBackNeeded = true;
+		}
+		else
+		{
+			Remove(index);
+		}
+		index = next;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Game/ChunkMap.h"
+
+// Keeps the voxels of chunks that left the streaming range compressed in memory, so chunks coming back
+// are decompressed instead of being generated or loaded again. Chunks are in use until they leave the
+// range, so the entries are evicted in the order they were inserted once the cache exceeds its budget.
+// Entries with unsaved edits are never evicted, they stay over the budget until they have been written back.
+// Sections are stored like VoxelStorage holds them, with runs of identical index words collapsed.
+class ColdChunkCache
+{
+public:
+	ColdChunkCache(size_t budget_);
+
+	// Compresses the voxels of a chunk, evicting the oldest entries until the cache fits into its budget
+	void Insert(const Chunk& chunk);
+
+	// Moves the compressed voxels of the chunk at the given position out of the cache, fails if it isn't cached
+	bool Take(DirectX::XMINT3 position, eastl::vector<uint8_t>& data);
+
+	// Restores the voxel sections and flags of a chunk, can be called from any thread
+	void Decompress(const eastl::vector<uint8_t>& data, Chunk& chunk);
+
+	// Decompresses the entries with unsaved edits into the chunk one after the other and hands it to the 
+	// callback, entries are marked as saved when it returns true and evicted if the cache exceeds its budget
+	void WriteBack(Chunk& chunk, const eastl::function<bool(Chunk&)>& save);
+
+	inline size_t GetSize() const { return size; }
+	inline uint32_t GetNumEntries() const { return entryMap.GetSize(); }
+	inline uint32_t GetNumUnsaved() const { return numUnsaved; }
+
+	// Entries with unsaved edits were skipped while evicting, they need to be written back before they can go
+	inline bool NeedsWriteBack() const { return writeBackNeeded; }
+
+	inline float GetHitRate() const
+	{
+		return (numHits + numMisses) > 0 ? static_cast<float>(numHits) / (numHits + numMisses) : 0.0f;
+	}
+
+	// Memory the inserted chunks used while they were resident over the memory of their compressed voxels
+	inline float GetCompressionRatio() const
+	{
+		return totalCompressedBytes > 0 ? static_cast<float>(totalResidentBytes) / totalCompressedBytes : 0.0f;
+	}
+
+	inline float GetAverageDecompressUs() const
+	{
+		const uint32_t count = numDecompressions.load();
+		return count > 0 ? static_cast<float>(totalDecompressNs.load()) / count / 1000.0f : 0.0f;
+	}
+
+private:
+	static constexpr uint32_t INVALID_ENTRY = eastl::numeric_limits<uint32_t>::max();
+
+	// Entries form a list from the oldest to the newest one, removed entries are reused
+	struct Entry
+	{
+		DirectX::XMINT3 position;
+		eastl::vector<uint8_t> data;
+		uint32_t previous;
+		uint32_t next;
+	};
+
+	eastl::vector<Entry> entries;
+	eastl::vector<uint32_t> freeEntries;
+	ChunkMap entryMap;
+	uint32_t oldest;
+	uint32_t newest;
+
+	size_t budget;
+	size_t size;
+	uint32_t numUnsaved;
+	bool writeBackNeeded;
+
+	uint32_t numHits;
+	uint32_t numMisses;
+	size_t totalResidentBytes;
+	size_t totalCompressedBytes;
+
+	// Decompression happens on the workers
+	std::atomic<uint64_t> totalDecompressNs;
+	std::atomic<uint32_t> numDecompressions;
+
+	void Remove(uint32_t index);
+
+	// Removes the oldest saved entries until the cache fits into its budget, or no saved entries are left
+	void Evict();
+};
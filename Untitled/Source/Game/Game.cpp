@@ -3,18 +3,28 @@
 
 #include "Graphics/Raytracing/RaytracingPipeline.h"
 
+// Radius in voxels of the sphere carved with the brush key
+constexpr int CARVE_RADIUS = 8;
+
+// Density terrain has caves and overhangs, but takes longer to generate than the heightmap
+constexpr TerrainMode TERRAIN_MODE = TerrainMode::Heightmap;
+
 void Game::Init(HWND hwnd)
 {
 	input = eastl::make_unique<InputHandler>();
 	renderer = eastl::make_unique<Renderer>(hwnd, input.get());
 
-	chunkManager = eastl::make_unique<ChunkManager>(renderer.get());
+	jobSystem = eastl::make_unique<JobSystem>();
+	chunkManager = eastl::make_unique<ChunkManager>(renderer.get(), jobSystem.get(), TERRAIN_MODE);
+	chunkStreamer = eastl::make_unique<ChunkStreamer>(chunkManager.get());
 }
 
 void Game::Shutdown()
 {
 	// Explicit order of destruction is necessary
+	chunkStreamer.reset();
 	chunkManager.reset();
+	jobSystem.reset();
 
 	input.reset();
 	renderer.reset();
@@ -22,14 +32,7 @@ void Game::Shutdown()
 
 void Game::Simulate(float deltaTime)
 {
-	static int i = 0;
-
-	if (i == 0)
-	{
-		chunkManager->AddChunk({ 0, 0, 0 });
-	}
-	i++;
-
+	chunkStreamer->Update(renderer->RTPipeline->GetCamera());
 
 	if (input->mouseButtonPressed.left)
 	{
@@ -41,8 +44,23 @@ void Game::Simulate(float deltaTime)
 		chunkManager->DestroyVoxel(renderer->RTPipeline->pickBufferContent);
 	}
 
+	// 'C' carves a sphere around the picked voxel
+	DirectX::XMINT3 pickedVoxel;
+	if (input->IsKeyPressed(0x43) && chunkManager->GetPickedVoxel(renderer->RTPipeline->pickBufferContent, pickedVoxel))
+	{
+		chunkManager->QueueEdit(VoxelBrush { .shape = BrushShape::Sphere, .start = pickedVoxel, .end = pickedVoxel,
+			.radius = CARVE_RADIUS, .type = FillType::Empty });
+	}
 
+	// 'G' toggles between the greedy and the naive mesher
+	if (input->IsKeyPressed(0x47))
+	{
+		chunkManager->SetMeshingMode(chunkManager->GetMeshingMode() == MeshingMode::Greedy ? 
+			MeshingMode::Naive : MeshingMode::Greedy);
+	}
 
+	chunkManager->ApplyEdits();
+	chunkManager->RemeshDirtyChunks();
 	chunkManager->RebuildUpdatedChunks();
 }
 
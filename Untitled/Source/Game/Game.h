@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Core/InputHandler.h"
+#include "Core/JobSystem.h"
 #include "Game/ChunkManager.h"
+#include "Game/ChunkStreamer.h"
 #include "Graphics/Renderer.h"
 
 class Game
@@ -15,6 +17,8 @@ public:
 	void Simulate(float deltaTime);
 
 private:
+	eastl::unique_ptr<JobSystem> jobSystem;
 	eastl::unique_ptr<ChunkManager> chunkManager;
+	eastl::unique_ptr<ChunkStreamer> chunkStreamer;
 };
 
@@ -0,0 +1,66 @@
+#include "PCH.h"
+#include "Heightmap.h"
+
+void FillHeightmapRows(const int8_t* heights, uint64_t* rows)
+{
+#if defined(__AVX2__)
+	const __m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(heights));
+	const __m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(heights + 32));
+	for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+	{
+		const __m256i row = _mm256_set1_epi8(static_cast<char>(y));
+		const uint64_t lowMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(low, row)));
+		const uint64_t highMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(high, row)));
+		rows[y] = lowMask | (highMask << 32);
+	}
+#elif defined(_M_X64) || defined(__SSE2__)
+	const __m128i columns0 = _mm_load_si128(reinterpret_cast<const __m128i*>(heights));
+	const __m128i columns1 = _mm_load_si128(reinterpret_cast<const __m128i*>(heights + 16));
+	const __m128i columns2 = _mm_load_si128(reinterpret_cast<const __m128i*>(heights + 32));
+	const __m128i columns3 = _mm_load_si128(reinterpret_cast<const __m128i*>(heights + 48));
+	for (int y = 0; y < VOXEL_CHUNK_WIDTH; ++y)
+	{
+		const __m128i row = _mm_set1_epi8(static_cast<char>(y));
+		const uint64_t mask0 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(columns0, row)));
+		const uint64_t mask1 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(columns1, row)));
+		const uint64_t mask2 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(columns2, row)));
+		const uint64_t mask3 = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(columns3, row)));
+		rows[y] = mask0 | (mask1 << 16) | (mask2 << 32) | (mask3 << 48);
+	}
+#else
+	FillHeightmapRowsScalar(heights, rows);
+#endif
+}
+
+void FillHeightmapRowsScalar(const int8_t* heights, uint64_t* rows)
+{
+	// Columns are bucketed by their height, a row holds the columns of every bucket above it
+	eastl::array<uint64_t, VOXEL_CHUNK_WIDTH + 1> buckets {};
+	for (int x = 0; x < VOXEL_CHUNK_WIDTH; ++x)
+	{
+		buckets[heights[x]] |= 1ull << x;
+	}
+	uint64_t row = 0;
+	for (int y = VOXEL_CHUNK_WIDTH - 1; y >= 0; --y)
+	{
+		row |= buckets[y + 1];
+		rows[y] = row;
+	}
+}
+
+void FillHeightmapColumns(Chunk& chunk, const int32_t* heights)
+{
+	// Number of solid voxels at the bottom of every column of the chunk, ordered like the bits of the rows
+	alignas(32) eastl::array<int8_t, VOXEL_CHUNK_WIDTH * VOXEL_CHUNK_WIDTH> columnHeights;
+	for (size_t i = 0; i < columnHeights.size(); ++i)
+	{
+		columnHeights[i] = static_cast<int8_t>(eastl::clamp(heights[i] - chunk.position.y, 0, static_cast<int>(VOXEL_CHUNK_WIDTH)));
+	}
+
+	// The rows of a z slice are consecutive
+	for (int z = 0; z < VOXEL_CHUNK_WIDTH; ++z)
+	{
+		FillHeightmapRows(&columnHeights[z * VOXEL_CHUNK_WIDTH], &chunk.occupiedColumns[GetColumnIndex(0, z)]);
+	}
+	eastl::copy(chunk.occupiedColumns.begin(), chunk.occupiedColumns.end(), chunk.solidColumns.begin());
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Game/Chunk.h"
+
+// Height of the first voxel above a surface, a voxel at y is below the surface if y < surface,
+// which for integers is y < ceil(surface)
+inline int32_t GetSurfaceCeiling(float surface)
+{
+	// Truncation rounds towards zero, which is the ceiling unless the surface is above a positive integer
+	int32_t ceiling = static_cast<int32_t>(surface);
+	ceiling += static_cast<float>(ceiling) < surface ? 1 : 0;
+	return ceiling;
+}
+
+// Fills the rows of a z slice of a chunk from the heights of its columns, bit x of row y is set
+// wherever the column at x is higher than y. Heights are between 0 and VOXEL_CHUNK_WIDTH and
+// aligned to 32 bytes, each byte compare covers a column.
+void FillHeightmapRows(const int8_t* heights, uint64_t* rows);
+
+// Same as FillHeightmapRows without vector instructions, used where they aren't available
+void FillHeightmapRowsScalar(const int8_t* heights, uint64_t* rows);
+
+// Fills the occupied and solid columns of a chunk from the ceilings of the surface in world space,
+// indexed by z * VOXEL_CHUNK_WIDTH + x. Chunk::RebuildSections derives the block types from them.
+void FillHeightmapColumns(Chunk& chunk, const int32_t* heights);
@@ -0,0 +1,80 @@
+#include "PCH.h"
+#include "OccupancyPyramid.h"
+
+OccupancyPyramid::OccupancyPyramid()
+{
+	for (Level& level : levels)
+	{
+		level.uniformOccupied = false;
+	}
+}
+
+void OccupancyPyramid::Build(const uint64_t* columns)
+{
+	// Only the first level reads the chunk, every other level is built from the one below it
+	for (uint32_t level = 1; level <= NUM_LEVELS; ++level)
+	{
+		const int width = static_cast<int>(GetWidth(level));
+		Level& data = levels[level - 1];
+		data.words.assign(width * width * width / 64, 0);
+
+		for (int z = 0; z < width; ++z)
+		{
+			for (int y = 0; y < width; ++y)
+			{
+				SetRow(level, y, z, DownsampleRow(level, columns, y, z));
+			}
+		}
+		CompactLevel(level);
+	}
+}
+
+void OccupancyPyramid::Update(const uint64_t* columns, int y, int z)
+{
+	for (uint32_t level = 1; level <= NUM_LEVELS; ++level)
+	{
+		SetRow(level, y >> level, z >> level, DownsampleRow(level, columns, y >> level, z >> level));
+	}
+}
+
+uint64_t OccupancyPyramid::DownsampleRow(uint32_t level, const uint64_t* columns, int y, int z) const
+{
+	const uint64_t merged =
+		GetSourceRow(level, columns, 2 * y, 2 * z) | GetSourceRow(level, columns, 2 * y + 1, 2 * z) |
+		GetSourceRow(level, columns, 2 * y, 2 * z + 1) | GetSourceRow(level, columns, 2 * y + 1, 2 * z + 1);
+	return CompactEvenBits(merged | (merged >> 1));
+}
+
+void OccupancyPyramid::SetRow(uint32_t level, int y, int z, uint64_t row)
+{
+	Level& data = levels[level - 1];
+	const uint32_t width = GetWidth(level);
+	const uint64_t rowMask = (1ull << width) - 1;
+	if (data.words.empty())
+	{
+		if (row == (data.uniformOccupied ? rowMask : 0)) return;
+
+		// Every cell starts out with the uniform value
+		data.words.assign(width * width * width / 64, data.uniformOccupied ? ~0ull : 0);
+	}
+
+	const uint32_t bit = (y + width * z) * width;
+	uint64_t& word = data.words[bit >> 6];
+	word = (word & ~(rowMask << (bit & 63))) | (row << (bit & 63));
+}
+
+void OccupancyPyramid::CompactLevel(uint32_t level)
+{
+	Level& data = levels[level - 1];
+	if (data.words.empty()) return;
+
+	const uint64_t first = data.words[0];
+	if (first != 0 && first != ~0ull) return;
+	for (uint64_t word : data.words)
+	{
+		if (word != first) return;
+	}
+
+	data.uniformOccupied = first != 0;
+	data.words.set_capacity(0);
+}
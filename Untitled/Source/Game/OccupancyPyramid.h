@@ -0,0 +1,96 @@
+#pragma once
+
+#include "Core/Logging.h"
+
+// Gathers the even bits of a word into its lower half
+inline uint64_t CompactEvenBits(uint64_t bits)
+{
+	bits &= 0x5555555555555555ull;
+	bits = (bits | (bits >> 1)) & 0x3333333333333333ull;
+	bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+	bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FFull;
+	bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFFull;
+	bits = (bits | (bits >> 16)) & 0x00000000FFFFFFFFull;
+	return bits;
+}
+
+// Downsampled occupancy of a chunk at 1/2, 1/4 and 1/8 of its resolution. A cell is occupied if any
+// of the 2x2x2 cells below it is, so every level conservatively covers the voxels of the chunk.
+// Like the chunk, a level of width w is made of w-bit rows along x, which are packed back to back
+// into 64-bit words. Levels whose cells are all empty or all occupied don't store any words.
+class OccupancyPyramid
+{
+public:
+	// Level 0 are the column bitmasks of the chunk itself, the pyramid holds the levels above it
+	static constexpr uint32_t BASE_WIDTH = 64;
+	static constexpr uint32_t NUM_LEVELS = 3;
+
+	OccupancyPyramid();
+
+	// Builds all levels from the 64 * 64 column words of a chunk, indexed by y + 64 * z
+	void Build(const uint64_t* columns);
+
+	// Updates the cells covering row (y, z) of the chunk after the occupancy of the row changed
+	void Update(const uint64_t* columns, int y, int z);
+
+	static inline uint32_t GetWidth(uint32_t level)
+	{
+		return BASE_WIDTH >> level;
+	}
+
+	// Row (y, z) of a level, bit x of the result is cell (x, y, z)
+	inline uint64_t GetRow(uint32_t level, int y, int z) const
+	{
+		UNTITLED_ASSERT(level >= 1 && level <= NUM_LEVELS && "Invalid occupancy level!");
+		const Level& data = levels[level - 1];
+		const uint32_t width = GetWidth(level);
+		const uint64_t rowMask = (1ull << width) - 1;
+		if (data.words.empty()) return data.uniformOccupied ? rowMask : 0;
+
+		const uint32_t bit = (y + width * z) * width;
+		return (data.words[bit >> 6] >> (bit & 63)) & rowMask;
+	}
+
+	inline bool IsOccupied(uint32_t level, int x, int y, int z) const
+	{
+		return (GetRow(level, y, z) >> x) & 1;
+	}
+
+	// The coarsest level is empty only if the whole chunk is
+	inline bool IsEmpty() const
+	{
+		const Level& coarsest = levels[NUM_LEVELS - 1];
+		return coarsest.words.empty() && !coarsest.uniformOccupied;
+	}
+
+	inline size_t GetMemoryUsage() const
+	{
+		size_t memoryUsage = sizeof(OccupancyPyramid);
+		for (const Level& level : levels)
+		{
+			memoryUsage += level.words.capacity() * sizeof(uint64_t);
+		}
+		return memoryUsage;
+	}
+
+private:
+	struct Level
+	{
+		eastl::vector<uint64_t> words;
+		bool uniformOccupied;
+	};
+	eastl::array<Level, NUM_LEVELS> levels;
+
+	// Row (y, z) of the level below, level 1 is built from the columns of the chunk
+	inline uint64_t GetSourceRow(uint32_t level, const uint64_t* columns, int y, int z) const
+	{
+		return level == 1 ? columns[y + BASE_WIDTH * z] : GetRow(level - 1, y, z);
+	}
+
+	// Merges the four rows below row (y, z) of a level and halves them along x
+	uint64_t DownsampleRow(uint32_t level, const uint64_t* columns, int y, int z) const;
+	void SetRow(uint32_t level, int y, int z, uint64_t row);
+
+	// Releases the words of a level if all of its cells are equal
+	void CompactLevel(uint32_t level);
+};
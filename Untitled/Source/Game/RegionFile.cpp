@@ -0,0 +1,296 @@
+#include "PCH.h"
+#include "RegionFile.h"
+
+// CRC-32 with the reflected polynomial of zlib. Slicing by 8 processes a word at a time with a table
+// per byte of it, table i holds the CRC of a byte followed by i zero bytes.
+static constexpr eastl::array<eastl::array<uint32_t, 256>, 8> CRC_TABLES = []()
+{
+	eastl::array<eastl::array<uint32_t, 256>, 8> tables {};
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+		}
+		tables[0][i] = crc;
+	}
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		for (int slice = 1; slice < 8; ++slice)
+		{
+			tables[slice][i] = (tables[slice - 1][i] >> 8) ^ tables[0][tables[slice - 1][i] & 0xFF];
+		}
+	}
+	return tables;
+}();
+
+static uint32_t ComputeCRC(const uint8_t* data, size_t size)
+{
+	uint32_t crc = ~0u;
+	for (; size >= 8; data += 8, size -= 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		word ^= crc;
+		crc = CRC_TABLES[7][word & 0xFF] ^ CRC_TABLES[6][(word >> 8) & 0xFF] ^ CRC_TABLES[5][(word >> 16) & 0xFF] ^
+			CRC_TABLES[4][(word >> 24) & 0xFF] ^ CRC_TABLES[3][(word >> 32) & 0xFF] ^ CRC_TABLES[2][(word >> 40) & 0xFF] ^
+			CRC_TABLES[1][(word >> 48) & 0xFF] ^ CRC_TABLES[0][word >> 56];
+	}
+	for (; size > 0; ++data, --size)
+	{
+		crc = (crc >> 8) ^ CRC_TABLES[0][(crc ^ *data) & 0xFF];
+	}
+	return ~crc;
+}
+
+static void Append(eastl::vector<uint8_t>& payload, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	payload.insert(payload.end(), bytes, bytes + size);
+}
+
+bool RegionFile::Open(const eastl::string& path, bool create)
+{
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if (!file.Open(path, create)) return false;
+
+	entries.assign(CHUNKS_PER_REGION, Entry {});
+	freeExtents.clear();
+	const uint64_t tableEnd = sizeof(Header) + CHUNKS_PER_REGION * sizeof(Entry);
+	if (file.GetSize() == 0)
+	{
+		// New files start out with an empty table
+		const Header header { MAGIC, VERSION };
+		if (!file.Write(0, &header, sizeof(Header)) || !file.Write(sizeof(Header), entries.data(), entries.size() * sizeof(Entry)) || !file.Map())
+		{
+			file.Close();
+			return false;
+		}
+		return true;
+	}
+
+	Header header;
+	if (file.GetSize() >= tableEnd)
+	{
+		memcpy(&header, file.GetData(), sizeof(Header));
+	}
+	if (file.GetSize() < tableEnd || header.magic != MAGIC || header.version != VERSION)
+	{
+		UNTITLED_LOG_WARN("Region file %s is invalid\n", path.c_str());
+		file.Close();
+		return false;
+	}
+
+	// Entries pointing outside of the file can't be loaded, their chunks are generated again
+	memcpy(entries.data(), file.GetData() + sizeof(Header), entries.size() * sizeof(Entry));
+	for (Entry& entry : entries)
+	{
+		if (entry.size > 0 && (entry.offset < tableEnd || entry.size > entry.capacity ||
+			static_cast<uint64_t>(entry.offset) + entry.capacity > file.GetSize()))
+		{
+			UNTITLED_LOG_WARN("Region file %s has an invalid entry\n", path.c_str());
+			entry = Entry {};
+		}
+	}
+
+	// The gaps between the payloads are the space of payloads that have been replaced
+	eastl::vector<Entry> sortedEntries;
+	for (const Entry& entry : entries)
+	{
+		if (entry.size > 0) sortedEntries.push_back(entry);
+	}
+	eastl::sort(sortedEntries.begin(), sortedEntries.end(), [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+	uint64_t used = tableEnd;
+	for (const Entry& entry : sortedEntries)
+	{
+		if (entry.offset > used) AddFreeExtent({ static_cast<uint32_t>(used), static_cast<uint32_t>(entry.offset - used) });
+		used = eastl::max<uint64_t>(used, static_cast<uint64_t>(entry.offset) + entry.capacity);
+	}
+	if (file.GetSize() > used && file.GetSize() <= eastl::numeric_limits<uint32_t>::max())
+	{
+		AddFreeExtent({ static_cast<uint32_t>(used), static_cast<uint32_t>(file.GetSize() - used) });
+	}
+	return true;
+}
+
+bool RegionFile::HasChunk(uint32_t index) const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return IsOpen() && entries[index].size > 0;
+}
+
+bool RegionFile::LoadChunk(uint32_t index, Chunk& chunk) const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	if (!IsOpen() || entries[index].size == 0) return false;
+
+	const Entry& entry = entries[index];
+	const uint8_t* payload = file.GetData() + entry.offset;
+	if (ComputeCRC(payload, entry.size) != entry.crc)
+	{
+		UNTITLED_LOG_WARN("Chunk (%i, %i, %i) failed its CRC check\n", chunk.position.x, chunk.position.y, chunk.position.z);
+		return false;
+	}
+
+	if (!DecodeChunk(payload, entry.size, chunk))
+	{
+		UNTITLED_LOG_WARN("Chunk (%i, %i, %i) has an invalid payload\n", chunk.position.x, chunk.position.y, chunk.position.z);
+		for (VoxelStorage& section : chunk.voxelSections)
+		{
+			section.Fill(FillType::Empty);
+		}
+		return false;
+	}
+	return true;
+}
+
+bool RegionFile::SaveChunks(eastl::span<Chunk* const> chunks)
+{
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if (!IsOpen()) return false;
+
+	bool success = true;
+	uint64_t end = file.GetSize();
+	eastl::vector<uint8_t> payload;
+	for (Chunk* chunk : chunks)
+	{
+		payload.clear();
+		EncodeChunk(*chunk, payload);
+
+		// Payloads are placed in free space between the others or appended, offsets are limited to 32 bits
+		const uint32_t index = GetRegionChunkIndex(GetChunkCoordinate(chunk->position));
+		const uint32_t size = static_cast<uint32_t>(payload.size());
+		uint32_t offset = 0;
+		const bool reused = TakeFreeExtent(size, offset);
+		if (!reused && end + size > eastl::numeric_limits<uint32_t>::max())
+		{
+			UNTITLED_LOG_WARN("Region file is full, chunk (%i, %i, %i) can't be saved\n", chunk->position.x, chunk->position.y, chunk->position.z);
+			success = false;
+			continue;
+		}
+
+		const Entry entry {
+			.offset = reused ? offset : static_cast<uint32_t>(end),
+			.size = size,
+			.capacity = size,
+			.crc = ComputeCRC(payload.data(), payload.size())
+		};
+
+		// The payload never overwrites the one the table points at and is written before the table, so a crash
+		// in between leaves the previous payload of the chunk in place
+		if (!file.Write(entry.offset, payload.data(), payload.size()) ||
+			!file.Write(sizeof(Header) + index * sizeof(Entry), &entry, sizeof(Entry)))
+		{
+			UNTITLED_LOG_WARN("Chunk (%i, %i, %i) couldn't be written\n", chunk->position.x, chunk->position.y, chunk->position.z);
+			if (reused) AddFreeExtent({ entry.offset, entry.capacity });
+			success = false;
+			continue;
+		}
+
+		// Nothing points at the previous payload anymore, its space can be reused
+		if (entries[index].size > 0) AddFreeExtent({ entries[index].offset, entries[index].capacity });
+		entries[index] = entry;
+		end = eastl::max<uint64_t>(end, static_cast<uint64_t>(entry.offset) + entry.capacity);
+		chunk->unsaved = false;
+	}
+
+	// Loads read the payloads out of the mapping, a region that can't be mapped is closed until it's opened again
+	if (!file.Map())
+	{
+		UNTITLED_LOG_WARN("Region file couldn't be mapped again\n");
+		file.Close();
+		return false;
+	}
+	return success;
+}
+
+bool RegionFile::TakeFreeExtent(uint32_t size, uint32_t& offset)
+{
+	for (auto it = freeExtents.begin(); it != freeExtents.end(); ++it)
+	{
+		if (it->size < size) continue;
+
+		// First fit, the rest of the extent stays free
+		offset = it->offset;
+		it->offset += size;
+		it->size -= size;
+		if (it->size == 0) freeExtents.erase(it);
+		return true;
+	}
+	return false;
+}
+
+void RegionFile::AddFreeExtent(Extent extent)
+{
+	if (extent.size == 0) return;
+
+	// Extents touching the new one are merged with it
+	auto next = eastl::lower_bound(freeExtents.begin(), freeExtents.end(), extent.offset,
+		[](const Extent& free, uint32_t offset) { return free.offset < offset; });
+	if (next != freeExtents.end() && extent.offset + extent.size == next->offset)
+	{
+		extent.size += next->size;
+		next = freeExtents.erase(next);
+	}
+	if (next != freeExtents.begin() && (next - 1)->offset + (next - 1)->size == extent.offset)
+	{
+		(next - 1)->size += extent.size;
+		return;
+	}
+	freeExtents.insert(next, extent);
+}
+
+void RegionFile::EncodeChunk(const Chunk& chunk, eastl::vector<uint8_t>& payload)
+{
+	const uint32_t flags = chunk.edited ? CHUNK_EDITED : 0;
+	Append(payload, &flags, sizeof(flags));
+
+	for (const VoxelStorage& section : chunk.voxelSections)
+	{
+		const eastl::span<const FillType> palette = section.GetPalette();
+		const eastl::span<const uint64_t> words = section.GetWords();
+		const SectionHeader header {
+			.bitsLog2 = static_cast<uint8_t>(std::countr_zero(section.GetBitsPerIndex())),
+			.uniform = section.IsUniform(),
+			.paletteSize = static_cast<uint16_t>(palette.size())
+		};
+		Append(payload, &header, sizeof(header));
+		Append(payload, palette.data(), palette.size() * sizeof(FillType));
+		Append(payload, words.data(), words.size() * sizeof(uint64_t));
+	}
+}
+
+bool RegionFile::DecodeChunk(const uint8_t* payload, uint32_t size, Chunk& chunk)
+{
+	const uint8_t* const end = payload + size;
+	uint32_t flags;
+	if (size < sizeof(flags)) return false;
+	memcpy(&flags, payload, sizeof(flags));
+	payload += sizeof(flags);
+
+	for (VoxelStorage& section : chunk.voxelSections)
+	{
+		SectionHeader header;
+		if (end - payload < static_cast<ptrdiff_t>(sizeof(header))) return false;
+		memcpy(&header, payload, sizeof(header));
+		payload += sizeof(header);
+
+		// Every palette entry has to be addressable by the indices, uniform sections hold a single type
+		if (header.bitsLog2 > 4 || header.paletteSize == 0 || header.paletteSize > (1u << (1u << header.bitsLog2))) return false;
+		if (header.uniform && (header.bitsLog2 != 0 || header.paletteSize != 1)) return false;
+
+		const size_t paletteBytes = header.paletteSize * sizeof(FillType);
+		const size_t wordBytes = header.uniform ? 0 : (VOXELS_PER_SECTION >> (6 - header.bitsLog2)) * sizeof(uint64_t);
+		if (static_cast<size_t>(end - payload) < paletteBytes + wordBytes) return false;
+
+		// Palettes are small and copied into an aligned array, the indices are copied straight out of the payload
+		eastl::fixed_vector<FillType, 16> palette(header.paletteSize);
+		memcpy(palette.data(), payload, paletteBytes);
+		section.Assign({ palette.data(), palette.size() }, header.bitsLog2, header.uniform ? nullptr : payload + paletteBytes);
+		payload += paletteBytes + wordBytes;
+	}
+
+	chunk.edited = (flags & CHUNK_EDITED) != 0;
+	return payload == end;
+}
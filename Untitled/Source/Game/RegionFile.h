@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Core/FileSystem.h"
+#include "Game/Chunk.h"
+
+// Chunks are persisted in region files of 16^3 chunks each
+constexpr uint32_t REGION_WIDTH_LOG2 = 4;
+constexpr uint32_t REGION_WIDTH = 1 << REGION_WIDTH_LOG2;
+constexpr uint32_t CHUNKS_PER_REGION = REGION_WIDTH * REGION_WIDTH * REGION_WIDTH;
+
+// Coordinate of the region containing a chunk, the arithmetic shift rounds towards negative infinity
+inline DirectX::XMINT3 GetRegionCoordinate(DirectX::XMINT3 chunkCoordinate)
+{
+	return DirectX::XMINT3 { chunkCoordinate.x >> REGION_WIDTH_LOG2, chunkCoordinate.y >> REGION_WIDTH_LOG2, chunkCoordinate.z >> REGION_WIDTH_LOG2 };
+}
+
+// Index of a chunk into the table of its region
+inline uint32_t GetRegionChunkIndex(DirectX::XMINT3 chunkCoordinate)
+{
+	constexpr int mask = REGION_WIDTH - 1;
+	return (chunkCoordinate.x & mask) + REGION_WIDTH * ((chunkCoordinate.y & mask) + REGION_WIDTH * (chunkCoordinate.z & mask));
+}
+
+// A region file starts with a header and a table with an entry per chunk, followed by the payloads
+// of the chunks in no particular order. A payload holds the palette and packed indices of every
+// section of a chunk, and is checked against the CRC stored in its entry before it's decoded.
+// Loading decodes the sections straight out of the mapping of the file. Saving a chunk again
+// writes its payload to free space or the end of the file before its entry is changed, so a crash
+// never leaves a chunk without a complete payload. The space of the old payload is reused afterwards.
+class RegionFile
+{
+public:
+	// Maps the region file at the given path, a missing file is only created if create is set
+	bool Open(const eastl::string& path, bool create);
+	inline bool IsOpen() const { return file.IsOpen(); }
+
+	bool HasChunk(uint32_t index) const;
+
+	// Decodes the voxel sections of a chunk, fails if the chunk isn't stored or its payload is corrupted.
+	// The sections are left empty on failure. Can be called from any thread, saves wait for the loads.
+	bool LoadChunk(uint32_t index, Chunk& chunk) const;
+
+	// Encodes and writes the voxels of chunks of this region, the file is mapped again once after all of them
+	bool SaveChunks(eastl::span<Chunk* const> chunks);
+
+	inline uint64_t GetSize() const { return file.GetSize(); }
+
+private:
+	static constexpr uint32_t MAGIC = 0x47525655; // "UVRG"
+	static constexpr uint32_t VERSION = 1;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	// Unused entries have a size of 0
+	struct Entry
+	{
+		uint32_t offset;
+		uint32_t size;
+		uint32_t capacity;
+		uint32_t crc;
+	};
+
+	// Precedes the palette of a section, which is followed by the packed indices unless the section is uniform
+	struct SectionHeader
+	{
+		uint8_t bitsLog2;
+		uint8_t uniform;
+		uint16_t paletteSize;
+	};
+
+	// Range of the file that no entry points at
+	struct Extent
+	{
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	// Payloads start with the flags of the chunk
+	static constexpr uint32_t CHUNK_EDITED = 1;
+
+	MappedFile file;
+	// Copy of the table, so entries can be looked up without touching the mapping
+	eastl::vector<Entry> entries;
+	// Free space between the payloads, sorted by offset. Space past the end of the file isn't included.
+	eastl::vector<Extent> freeExtents;
+	// Workers load chunks while the main thread saves them, and saving maps the file again
+	mutable std::shared_mutex mutex;
+
+	// Takes space for a payload out of the free extents, fails if none of them is large enough
+	bool TakeFreeExtent(uint32_t size, uint32_t& offset);
+	void AddFreeExtent(Extent extent);
+
+	static void EncodeChunk(const Chunk& chunk, eastl::vector<uint8_t>& payload);
+	static bool DecodeChunk(const uint8_t* payload, uint32_t size, Chunk& chunk);
+};
@@ -0,0 +1,98 @@
+#include "PCH.h"
+#include "VoxelBrush.h"
+
+using namespace DirectX;
+
+// Bits begin to end of a row, both inclusive
+static inline uint64_t GetRunMask(int begin, int end)
+{
+	return (~0ull >> (63 - end)) & (~0ull << begin);
+}
+
+void GetBrushBounds(const VoxelBrush& brush, XMINT3& min, XMINT3& max)
+{
+	switch (brush.shape)
+	{
+	case BrushShape::Box:
+	case BrushShape::Line:
+	{
+		const int padding = brush.shape == BrushShape::Line ? brush.radius : 0;
+		min = XMINT3 { eastl::min(brush.start.x, brush.end.x) - padding, eastl::min(brush.start.y, brush.end.y) - padding,
+			eastl::min(brush.start.z, brush.end.z) - padding };
+		max = XMINT3 { eastl::max(brush.start.x, brush.end.x) + padding, eastl::max(brush.start.y, brush.end.y) + padding,
+			eastl::max(brush.start.z, brush.end.z) + padding };
+		break;
+	}
+	case BrushShape::Sphere:
+	case BrushShape::FloodFill:
+	{
+		const int radius = brush.shape == BrushShape::FloodFill ? eastl::min(brush.radius, MAX_FLOOD_FILL_RADIUS) : brush.radius;
+		min = XMINT3 { brush.start.x - radius, brush.start.y - radius, brush.start.z - radius };
+		max = XMINT3 { brush.start.x + radius, brush.start.y + radius, brush.start.z + radius };
+		break;
+	}
+	}
+}
+
+uint64_t GetBrushRow(const VoxelBrush& brush, int rowStart, int y, int z)
+{
+	XMINT3 min, max;
+	GetBrushBounds(brush, min, max);
+	if (y < min.y || y > max.y || z < min.z || z > max.z) return 0;
+
+	// Clips a run of voxels in world space to the row
+	auto GetClippedRun = [rowStart](int begin, int end)
+	{
+		begin = eastl::max(begin - rowStart, 0);
+		end = eastl::min(end - rowStart, 63);
+		return begin <= end ? GetRunMask(begin, end) : 0;
+	};
+
+	switch (brush.shape)
+	{
+	case BrushShape::Box:
+		return GetClippedRun(min.x, max.x);
+	case BrushShape::Sphere:
+	{
+		// The row crosses the sphere in a single run, its half length follows from the other two axes
+		const int dy = y - brush.start.y;
+		const int dz = z - brush.start.z;
+		const int remaining = brush.radius * brush.radius - dy * dy - dz * dz;
+		if (remaining < 0) return 0;
+
+		const int halfLength = static_cast<int>(sqrtf(static_cast<float>(remaining)));
+		return GetClippedRun(brush.start.x - halfLength, brush.start.x + halfLength);
+	}
+	case BrushShape::Line:
+	{
+		// Voxel centers within radius of the segment, the half voxel keeps lines of radius 0 connected
+		const float directionX = static_cast<float>(brush.end.x - brush.start.x);
+		const float directionY = static_cast<float>(brush.end.y - brush.start.y);
+		const float directionZ = static_cast<float>(brush.end.z - brush.start.z);
+		const float lengthSquared = directionX * directionX + directionY * directionY + directionZ * directionZ;
+		const float maxDistance = brush.radius + 0.5f;
+		const float offsetY = static_cast<float>(y - brush.start.y);
+		const float offsetZ = static_cast<float>(z - brush.start.z);
+
+		uint64_t row = 0;
+		const int begin = eastl::max(min.x, rowStart);
+		const int end = eastl::min(max.x, rowStart + 63);
+		for (int x = begin; x <= end; ++x)
+		{
+			const float offsetX = static_cast<float>(x - brush.start.x);
+			const float t = lengthSquared > 0.0f ?
+				eastl::clamp((offsetX * directionX + offsetY * directionY + offsetZ * directionZ) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+			const float distanceX = offsetX - directionX * t;
+			const float distanceY = offsetY - directionY * t;
+			const float distanceZ = offsetZ - directionZ * t;
+			if (distanceX * distanceX + distanceY * distanceY + distanceZ * distanceZ <= maxDistance * maxDistance)
+			{
+				row |= 1ull << (x - rowStart);
+			}
+		}
+		return row;
+	}
+	default:
+		return 0;
+	}
+}
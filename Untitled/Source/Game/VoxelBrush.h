@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Game/VoxelStorage.h"
+
+enum class BrushShape
+{
+	// Every voxel between start and end
+	Box,
+	// Voxels within radius of start
+	Sphere,
+	// Voxels within radius of the segment from start to end
+	Line,
+	// Voxels connected to start that have the same type as start, up to radius away from it along every axis
+	FloodFill
+};
+
+// Flood fills visit a box around their start, which has to stay small enough to track the visited voxels
+constexpr int MAX_FLOOD_FILL_RADIUS = 32;
+
+// Sets every voxel covered by a shape to the same type, coordinates are voxels in world space
+struct VoxelBrush
+{
+	BrushShape shape;
+	DirectX::XMINT3 start;
+	DirectX::XMINT3 end;
+	int radius;
+	FillType type;
+};
+
+// Smallest box containing every voxel a brush can cover, flood fills are bounded by their radius
+void GetBrushBounds(const VoxelBrush& brush, DirectX::XMINT3& min, DirectX::XMINT3& max);
+
+// Voxels of world row (y, z) covered by a brush, bit i of the result is voxel x = rowStart + i.
+// Flood fills depend on the voxels they spread through and are rasterized by the chunk manager.
+uint64_t GetBrushRow(const VoxelBrush& brush, int rowStart, int y, int z);
@@ -0,0 +1,115 @@
+#include "PCH.h"
+#include "VoxelStorage.h"
+
+VoxelStorage::VoxelStorage(uint32_t size_, FillType initialType /*= FillType::Empty*/) :
+	size(size_),
+	bitsLog2(0),
+	indexMask(1)
+{
+	UNTITLED_ASSERT(size % 64 == 0 && "Voxel storage size must be a multiple of 64!");
+
+	palette.push_back(initialType);
+}
+
+void VoxelStorage::Fill(FillType type)
+{
+	palette.clear();
+	palette.push_back(type);
+
+	bitsLog2 = 0;
+	indexMask = 1;
+	words.set_capacity(0);
+}
+
+void VoxelStorage::Assign(eastl::span<const FillType> newPalette, uint32_t newBitsLog2, const void* newWords)
+{
+	UNTITLED_ASSERT(!newPalette.empty() && newBitsLog2 <= 4 && "Invalid voxel storage!");
+	UNTITLED_ASSERT((newWords || (newBitsLog2 == 0 && newPalette.size() == 1)) && "Uniform voxel storage has a single type!");
+
+	palette.assign(newPalette.begin(), newPalette.end());
+	if (newWords)
+	{
+		bitsLog2 = newBitsLog2;
+		indexMask = (1ull << (1 << bitsLog2)) - 1;
+		words.resize(size >> (6 - bitsLog2));
+		memcpy(words.data(), newWords, words.size() * sizeof(uint64_t));
+	}
+	else
+	{
+		// Set widens uniform storage starting from single bit indices
+		bitsLog2 = 0;
+		indexMask = 1;
+		words.set_capacity(0);
+	}
+}
+
+void VoxelStorage::Compact()
+{
+	if (IsUniform()) return;
+
+	eastl::vector<uint32_t> remap(palette.size(), eastl::numeric_limits<uint32_t>::max());
+	eastl::vector<FillType> usedPalette;
+
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const uint64_t word = words[i >> (6 - bitsLog2)];
+		const uint32_t shift = (i & ((1 << (6 - bitsLog2)) - 1)) << bitsLog2;
+		const uint32_t paletteIndex = static_cast<uint32_t>((word >> shift) & indexMask);
+		if (remap[paletteIndex] == eastl::numeric_limits<uint32_t>::max())
+		{
+			remap[paletteIndex] = static_cast<uint32_t>(usedPalette.size());
+			usedPalette.push_back(palette[paletteIndex]);
+		}
+	}
+
+	if (usedPalette.size() == 1)
+	{
+		Fill(usedPalette[0]);
+		return;
+	}
+
+	// Find the smallest width that still holds every used palette entry
+	uint32_t newBitsLog2 = 0;
+	while ((1ull << (1 << newBitsLog2)) < usedPalette.size())
+	{
+		newBitsLog2++;
+	}
+
+	eastl::vector<uint64_t> newWords(size >> (6 - newBitsLog2), 0);
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const uint64_t word = words[i >> (6 - bitsLog2)];
+		const uint32_t shift = (i & ((1 << (6 - bitsLog2)) - 1)) << bitsLog2;
+		const uint64_t newIndex = remap[(word >> shift) & indexMask];
+
+		const uint32_t newShift = (i & ((1 << (6 - newBitsLog2)) - 1)) << newBitsLog2;
+		newWords[i >> (6 - newBitsLog2)] |= newIndex << newShift;
+	}
+
+	words = eastl::move(newWords);
+	palette = eastl::move(usedPalette);
+	bitsLog2 = newBitsLog2;
+	indexMask = (1ull << (1 << bitsLog2)) - 1;
+}
+
+void VoxelStorage::Repack(uint32_t newBitsLog2)
+{
+	// 16 bits per index is enough to address every possible block type
+	UNTITLED_ASSERT(newBitsLog2 <= 4 && "Palette exceeds the maximum index width!");
+
+	const uint64_t newIndexMask = (1ull << (1 << newBitsLog2)) - 1;
+	eastl::vector<uint64_t> newWords(size >> (6 - newBitsLog2), 0);
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		const uint64_t word = words[i >> (6 - bitsLog2)];
+		const uint32_t shift = (i & ((1 << (6 - bitsLog2)) - 1)) << bitsLog2;
+		const uint64_t index = (word >> shift) & indexMask;
+
+		const uint32_t newShift = (i & ((1 << (6 - newBitsLog2)) - 1)) << newBitsLog2;
+		newWords[i >> (6 - newBitsLog2)] |= index << newShift;
+	}
+
+	words = eastl::move(newWords);
+	bitsLog2 = newBitsLog2;
+	indexMask = newIndexMask;
+}
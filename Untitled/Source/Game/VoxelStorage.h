@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Core/Logging.h"
+
+enum class FillType : uint16_t
+{
+	Empty,
+	Solid,
+	Transparent
+};
+
+// Stores the block type of every voxel as an index into a small palette.
+// The indices are bit-packed into 64-bit words with 1, 2, 4, 8 or 16 bits per voxel,
+// the width is doubled whenever the palette no longer fits. Since every width
+// divides 64, an index never straddles two words. Uniform storage holds a single
+// palette entry and no indices at all, they are allocated on the first differing Set.
+class VoxelStorage
+{
+public:
+	VoxelStorage(uint32_t size_, FillType initialType = FillType::Empty);
+
+	inline FillType Get(uint32_t index) const
+	{
+		UNTITLED_ASSERT(index < size);
+		if (IsUniform()) return palette[0];
+
+		const uint64_t word = words[index >> (6 - bitsLog2)];
+		const uint32_t shift = (index & ((1 << (6 - bitsLog2)) - 1)) << bitsLog2;
+		return palette[(word >> shift) & indexMask];
+	}
+
+	// Bit i of the result is set if voxel first + i has the given type. The voxels can't straddle a word 
+	// when indices are 1 bit wide, which is the common case of two types and only takes a shift and mask.
+	inline uint64_t Match(uint32_t first, uint32_t count, FillType type) const
+	{
+		UNTITLED_ASSERT(count <= 64 && first + count <= size);
+		const uint64_t countMask = (count == 64) ? ~0ull : (1ull << count) - 1;
+		if (IsUniform()) return (palette[0] == type) ? countMask : 0;
+
+		const auto entry = eastl::find(palette.begin(), palette.end(), type);
+		if (entry == palette.end()) return 0;
+		const uint64_t paletteIndex = entry - palette.begin();
+
+		if (bitsLog2 == 0)
+		{
+			UNTITLED_ASSERT((first & 63) + count <= 64 && "Voxels straddle a word!");
+			const uint64_t bits = words[first >> 6] >> (first & 63);
+			return (paletteIndex == 1 ? bits : ~bits) & countMask;
+		}
+
+		uint64_t result = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint32_t index = first + i;
+			const uint64_t word = words[index >> (6 - bitsLog2)];
+			const uint32_t shift = (index & ((1 << (6 - bitsLog2)) - 1)) << bitsLog2;
+			result |= static_cast<uint64_t>(((word >> shift) & indexMask) == paletteIndex) << i;
+		}
+		return result;
+	}
+
+	inline void Set(uint32_t index, FillType type)
+	{
+		UNTITLED_ASSERT(index < size);
+		if (IsUniform())
+		{
+			if (type == palette[0]) return;
+
+			// Every index starts out pointing at the uniform type
+			words.resize(size / 64, 0);
+		}
+
+		// Looking up the palette index may widen the indices, so it has to happen first
+		const uint64_t paletteIndex = GetOrAddPaletteIndex(type);
+
+		uint64_t& word = words[index >> (6 - bitsLog2)];
+		const uint32_t shift = (index & ((1 << (6 - bitsLog2)) - 1)) << bitsLog2;
+		word = (word & ~(indexMask << shift)) | (paletteIndex << shift);
+	}
+
+	// Sets every voxel to the given type and releases the indices
+	void Fill(FillType type);
+
+	// Removes palette entries that are no longer referenced and shrinks the index
+	// width if the remaining palette allows it, storage using a single type becomes uniform
+	void Compact();
+
+	inline bool IsUniform() const { return words.empty(); }
+
+	// Raw palette and packed indices, uniform storage has no words
+	inline eastl::span<const FillType> GetPalette() const { return { palette.data(), palette.size() }; }
+	inline eastl::span<const uint64_t> GetWords() const { return { words.data(), words.size() }; }
+
+	// Replaces the contents with a palette and indices packed with 2^bitsLog2 bits each, as returned by
+	// GetPalette and GetWords. The words are copied bytewise and can be read from unaligned memory,
+	// storage becomes uniform if there are none.
+	void Assign(eastl::span<const FillType> newPalette, uint32_t newBitsLog2, const void* newWords);
+
+	inline uint32_t GetBitsPerIndex() const { return 1 << bitsLog2; }
+	inline uint32_t GetPaletteSize() const { return static_cast<uint32_t>(palette.size()); }
+	inline size_t GetMemoryUsage() const
+	{
+		return sizeof(VoxelStorage) + words.capacity() * sizeof(uint64_t) + palette.capacity() * sizeof(FillType);
+	}
+
+private:
+	uint32_t size;
+	uint32_t bitsLog2;
+	uint64_t indexMask;
+
+	eastl::vector<uint64_t> words;
+	eastl::vector<FillType> palette;
+
+	inline uint32_t GetOrAddPaletteIndex(FillType type)
+	{
+		// The palette rarely holds more than a handful of entries, a linear search is the fastest option
+		for (uint32_t i = 0; i < palette.size(); ++i)
+		{
+			if (palette[i] == type) return i;
+		}
+
+		palette.push_back(type);
+		if (palette.size() > (1ull << (1 << bitsLog2)))
+		{
+			Repack(bitsLog2 + 1);
+		}
+		return static_cast<uint32_t>(palette.size() - 1);
+	}
+
+	void Repack(uint32_t newBitsLog2);
+};
@@ -4,6 +4,14 @@
 #include "Graphics/DX/DXDescriptorHeap.h"
 #include "Graphics/DX/DXUtils.h"
 
+// Range of a staging buffer copied into a range of another buffer
+struct DXBufferRegion
+{
+	uint64_t sourceOffset;
+	uint64_t destinationOffset;
+	uint64_t size;
+};
+
 // Wrappers around a D3D12MA allocation for buffer types
 struct DXBuffer
 {
@@ -134,6 +134,29 @@ DXDeviceLocalBuffer ResourceAllocator::CreateDeviceLocalBufferWithData(const D3D
 	return buffer;
 }
 
+void ResourceAllocator::UpdateDeviceLocalBuffer(DXDeviceLocalBuffer& buffer, D3D12_RESOURCE_STATES resourceState, 
+	const void* data, uint64_t size, eastl::span<const DXBufferRegion> regions)
+{
+	// Prepare staging buffer
+	auto bufferDesc = DXUtils::ResourceDescBuffer(size);
+	stagingBuffers.push_back(CreateUploadBufferWithData(&bufferDesc, data));
+
+	// Record barriers and copy commands
+	auto barrier = DXUtils::ResourceBarrierTransition(buffer.GetResource(), resourceState, D3D12_RESOURCE_STATE_COPY_DEST);
+	context.graphicsCommands->ResourceBarrier(1, &barrier);
+
+	for (const DXBufferRegion& region : regions)
+	{
+		UNTITLED_ASSERT(region.sourceOffset + region.size <= size && region.destinationOffset + region.size <= buffer.sizeInBytes &&
+			"Buffer region out of bounds!");
+		context.graphicsCommands->CopyBufferRegion(buffer.GetResource(), region.destinationOffset,
+			stagingBuffers.back().GetResource(), region.sourceOffset, region.size);
+	}
+
+	barrier = DXUtils::ResourceBarrierTransition(buffer.GetResource(), D3D12_RESOURCE_STATE_COPY_DEST, resourceState);
+	context.graphicsCommands->ResourceBarrier(1, &barrier);
+}
+
 void ResourceAllocator::ReleaseStagingBuffers()
 {
 	for (auto& buf : stagingBuffers)
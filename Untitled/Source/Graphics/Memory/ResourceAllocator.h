@@ -27,6 +27,11 @@ public:
 	DXDeviceLocalBuffer CreateDeviceLocalBufferWithData(const D3D12_RESOURCE_DESC* resourceDesc,
 		D3D12_RESOURCE_STATES initResourceState, const void* data, uint32_t numInstances = 1);
 
+	// Stages size bytes of data and copies the given regions of it into an existing buffer,
+	// the copies are recorded on the graphics command list since the buffer may be in use
+	void UpdateDeviceLocalBuffer(DXDeviceLocalBuffer& buffer, D3D12_RESOURCE_STATES resourceState, const void* data, 
+		uint64_t size, eastl::span<const DXBufferRegion> regions);
+
 	void ReleaseStagingBuffers();
 
 private:
@@ -0,0 +1,238 @@
+#include "PCH.h"
+#include "TLSFAllocator.h"
+
+#include "Core/Logging.h"
+
+TLSFAllocator::TLSFAllocator(uint64_t size_, uint64_t alignment) :
+	size(size_),
+	alignmentShift(static_cast<uint32_t>(std::countr_zero(alignment)))
+{
+	UNTITLED_ASSERT(std::has_single_bit(alignment) && "Alignment has to be a power of two!");
+	UNTITLED_ASSERT(size > 0 && size % alignment == 0 && "Size has to be a multiple of the alignment!");
+
+	secondLevelBitmaps.fill(0);
+	for (auto& lists : freeLists)
+	{
+		lists.fill(INVALID_NODE);
+	}
+
+	// The whole block starts out as a single free range
+	InsertFreeNode(CreateNode(0, size));
+}
+
+bool TLSFAllocator::Allocate(uint64_t allocationSize, Allocation& allocation)
+{
+	UNTITLED_ASSERT(allocationSize > 0);
+	const uint64_t alignedSize = (((allocationSize - 1) >> alignmentShift) + 1) << alignmentShift;
+
+	const uint32_t node = FindFreeNode(alignedSize);
+	if (node == INVALID_NODE) return false;
+	RemoveFreeNode(node);
+
+	// The rest of the range stays free behind the allocation
+	if (nodes[node].size > alignedSize)
+	{
+		const uint32_t rest = CreateNode(nodes[node].offset + alignedSize, nodes[node].size - alignedSize);
+		nodes[rest].previousPhysical = node;
+		nodes[rest].nextPhysical = nodes[node].nextPhysical;
+		if (nodes[node].nextPhysical != INVALID_NODE)
+		{
+			nodes[nodes[node].nextPhysical].previousPhysical = rest;
+		}
+		nodes[node].nextPhysical = rest;
+		nodes[node].size = alignedSize;
+		InsertFreeNode(rest);
+	}
+
+	usedSize += alignedSize;
+	numAllocations++;
+	allocation = { nodes[node].offset, node };
+	return true;
+}
+
+void TLSFAllocator::Free(Allocation& allocation)
+{
+	uint32_t node = allocation.node;
+	UNTITLED_ASSERT(node < nodes.size() && !nodes[node].free && "Range has already been freed!");
+
+	usedSize -= nodes[node].size;
+	numAllocations--;
+
+	const uint32_t next = nodes[node].nextPhysical;
+	if (next != INVALID_NODE && nodes[next].free)
+	{
+		RemoveFreeNode(next);
+		MergeNodes(node, next);
+	}
+	const uint32_t previous = nodes[node].previousPhysical;
+	if (previous != INVALID_NODE && nodes[previous].free)
+	{
+		RemoveFreeNode(previous);
+		MergeNodes(previous, node);
+		node = previous;
+	}
+	InsertFreeNode(node);
+
+	allocation = {};
+}
+
+uint64_t TLSFAllocator::GetLargestFreeRange() const
+{
+	if (firstLevelBitmap == 0) return 0;
+
+	// The ranges of the highest non-empty list are larger than the ones of all other lists
+	const uint32_t firstLevel = 63 - std::countl_zero(firstLevelBitmap);
+	const uint32_t secondLevel = 31 - std::countl_zero(secondLevelBitmaps[firstLevel]);
+	uint64_t largest = 0;
+	for (uint32_t node = freeLists[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree)
+	{
+		largest = eastl::max(largest, nodes[node].size);
+	}
+	return largest;
+}
+
+float TLSFAllocator::GetFragmentation() const
+{
+	const uint64_t freeSize = GetFreeSize();
+	return freeSize > 0 ? 1.0f - static_cast<float>(GetLargestFreeRange()) / freeSize : 0.0f;
+}
+
+void TLSFAllocator::MapSize(uint64_t rangeSize, uint32_t& firstLevel, uint32_t& secondLevel) const
+{
+	// Sizes are counted in units of the alignment, the ones below the second level count share the first list
+	const uint64_t units = rangeSize >> alignmentShift;
+	if (units < SECOND_LEVEL_COUNT)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(units);
+		return;
+	}
+
+	const uint32_t log = 63 - std::countl_zero(units);
+	firstLevel = log - SECOND_LEVEL_BITS + 1;
+	secondLevel = static_cast<uint32_t>(units >> (log - SECOND_LEVEL_BITS)) - SECOND_LEVEL_COUNT;
+}
+
+uint32_t TLSFAllocator::FindFreeNode(uint64_t rangeSize) const
+{
+	// Rounding the size up to the next size class makes every range of the list found large enough
+	uint64_t searchSize = rangeSize;
+	const uint64_t units = rangeSize >> alignmentShift;
+	if (units >= SECOND_LEVEL_COUNT)
+	{
+		const uint32_t log = 63 - std::countl_zero(units);
+		searchSize += ((1ull << (log - SECOND_LEVEL_BITS)) - 1) << alignmentShift;
+	}
+
+	uint32_t firstLevel, secondLevel;
+	MapSize(searchSize, firstLevel, secondLevel);
+	uint32_t secondLevelMap = firstLevel < FIRST_LEVEL_COUNT ? secondLevelBitmaps[firstLevel] & (~0u << secondLevel) : 0;
+	if (secondLevelMap == 0)
+	{
+		const uint64_t firstLevelMap = firstLevel + 1 < FIRST_LEVEL_COUNT ? firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+		if (firstLevelMap != 0)
+		{
+			firstLevel = std::countr_zero(firstLevelMap);
+			secondLevelMap = secondLevelBitmaps[firstLevel];
+		}
+	}
+	if (secondLevelMap != 0)
+	{
+		return freeLists[firstLevel][std::countr_zero(secondLevelMap)];
+	}
+
+	// The list of the size itself can still hold a range that is large enough, like the whole block
+	MapSize(rangeSize, firstLevel, secondLevel);
+	for (uint32_t node = freeLists[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree)
+	{
+		if (nodes[node].size >= rangeSize) return node;
+	}
+	return INVALID_NODE;
+}
+
+uint32_t TLSFAllocator::CreateNode(uint64_t offset, uint64_t rangeSize)
+{
+	const Node node {
+		.offset = offset,
+		.size = rangeSize,
+		.previousPhysical = INVALID_NODE,
+		.nextPhysical = INVALID_NODE,
+		.previousFree = INVALID_NODE,
+		.nextFree = INVALID_NODE,
+		.free = false
+	};
+
+	if (unusedNodes.empty())
+	{
+		nodes.push_back(node);
+		return static_cast<uint32_t>(nodes.size() - 1);
+	}
+
+	const uint32_t index = unusedNodes.back();
+	unusedNodes.pop_back();
+	nodes[index] = node;
+	return index;
+}
+
+void TLSFAllocator::InsertFreeNode(uint32_t node)
+{
+	uint32_t firstLevel, secondLevel;
+	MapSize(nodes[node].size, firstLevel, secondLevel);
+
+	uint32_t& head = freeLists[firstLevel][secondLevel];
+	nodes[node].free = true;
+	nodes[node].previousFree = INVALID_NODE;
+	nodes[node].nextFree = head;
+	if (head != INVALID_NODE)
+	{
+		nodes[head].previousFree = node;
+	}
+	head = node;
+
+	firstLevelBitmap |= 1ull << firstLevel;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	numFreeRanges++;
+}
+
+void TLSFAllocator::RemoveFreeNode(uint32_t node)
+{
+	uint32_t firstLevel, secondLevel;
+	MapSize(nodes[node].size, firstLevel, secondLevel);
+
+	Node& removed = nodes[node];
+	if (removed.previousFree != INVALID_NODE)
+	{
+		nodes[removed.previousFree].nextFree = removed.nextFree;
+	}
+	else
+	{
+		freeLists[firstLevel][secondLevel] = removed.nextFree;
+	}
+	if (removed.nextFree != INVALID_NODE)
+	{
+		nodes[removed.nextFree].previousFree = removed.previousFree;
+	}
+	removed.free = false;
+
+	if (freeLists[firstLevel][secondLevel] == INVALID_NODE)
+	{
+		secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (secondLevelBitmaps[firstLevel] == 0)
+		{
+			firstLevelBitmap &= ~(1ull << firstLevel);
+		}
+	}
+	numFreeRanges--;
+}
+
+void TLSFAllocator::MergeNodes(uint32_t node, uint32_t next)
+{
+	// The next node is absorbed and its index can be reused
+	nodes[node].size += nodes[next].size;
+	nodes[node].nextPhysical = nodes[next].nextPhysical;
+	if (nodes[next].nextPhysical != INVALID_NODE)
+	{
+		nodes[nodes[next].nextPhysical].previousPhysical = node;
+	}
+	unusedNodes.push_back(next);
+}
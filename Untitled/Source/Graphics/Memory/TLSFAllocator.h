@@ -0,0 +1,72 @@
+#pragma once
+
+// Two level segregated fit allocator for the ranges of a memory block, it only hands out offsets and never touches
+// the memory itself. Free ranges are kept in lists by size class, the first level is the power of two of the size
+// and the second level splits that into linear steps. Allocating and freeing take constant time, freed ranges are
+// merged with their free neighbors right away. Sizes are rounded up to the alignment, so every offset is aligned.
+class TLSFAllocator
+{
+public:
+	static constexpr uint32_t INVALID_NODE = eastl::numeric_limits<uint32_t>::max();
+
+	struct Allocation
+	{
+		uint64_t offset = 0;
+		uint32_t node = INVALID_NODE;
+	};
+
+	// The alignment has to be a power of two and the size a multiple of it
+	TLSFAllocator(uint64_t size, uint64_t alignment);
+
+	// Returns false if there is no free range large enough
+	bool Allocate(uint64_t size, Allocation& allocation);
+	void Free(Allocation& allocation);
+
+	inline uint64_t GetSize() const { return size; }
+	inline uint64_t GetUsedSize() const { return usedSize; }
+	inline uint64_t GetFreeSize() const { return size - usedSize; }
+	inline uint32_t GetNumAllocations() const { return numAllocations; }
+	inline uint32_t GetNumFreeRanges() const { return numFreeRanges; }
+	inline bool IsEmpty() const { return numAllocations == 0; }
+
+	uint64_t GetLargestFreeRange() const;
+
+	// Part of the free memory that is not in the largest free range, 0 when all of it is in one piece
+	float GetFragmentation() const;
+
+private:
+	static constexpr uint32_t SECOND_LEVEL_BITS = 4;
+	static constexpr uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+	static constexpr uint32_t FIRST_LEVEL_COUNT = 64 - SECOND_LEVEL_BITS + 1;
+
+	struct Node
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t previousPhysical;
+		uint32_t nextPhysical;
+		uint32_t previousFree;
+		uint32_t nextFree;
+		bool free;
+	};
+
+	uint64_t size;
+	uint32_t alignmentShift;
+	uint64_t usedSize = 0;
+	uint32_t numAllocations = 0;
+	uint32_t numFreeRanges = 0;
+
+	eastl::vector<Node> nodes;
+	eastl::vector<uint32_t> unusedNodes;
+
+	uint64_t firstLevelBitmap = 0;
+	eastl::array<uint32_t, FIRST_LEVEL_COUNT> secondLevelBitmaps;
+	eastl::array<eastl::array<uint32_t, SECOND_LEVEL_COUNT>, FIRST_LEVEL_COUNT> freeLists;
+
+	void MapSize(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) const;
+	uint32_t FindFreeNode(uint64_t size) const;
+	uint32_t CreateNode(uint64_t offset, uint64_t size);
+	void InsertFreeNode(uint32_t node);
+	void RemoveFreeNode(uint32_t node);
+	void MergeNodes(uint32_t node, uint32_t next);
+};
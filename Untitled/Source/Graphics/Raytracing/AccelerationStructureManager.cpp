@@ -7,11 +7,38 @@
 #include "Graphics/Memory/ResourceAllocator.h"
 #include "Graphics/Raytracing/RaytracingSharedHlsl.h"
 
+// Every BLAS can be refit while it's edited and compacted once it isn't anymore
+static constexpr D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS BLAS_BUILD_FLAGS = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE |
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION;
+
+static D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS GetBLASBuildFlags(bool fastBuild)
+{
+	return BLAS_BUILD_FLAGS | (fastBuild ? D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_BUILD : 
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
+}
+
+static void CountBLASGeometry(const BottomLevelAccelerationStructure& BLAS, uint32_t& vertexCount, uint32_t& indexCount)
+{
+	vertexCount = 0;
+	indexCount = 0;
+	for (const auto& geometryDesc : BLAS.geometryDescriptions)
+	{
+		vertexCount += geometryDesc.Triangles.VertexCount;
+		indexCount += geometryDesc.Triangles.IndexCount;
+	}
+}
+
 AccelerationStructureManager::AccelerationStructureManager(GraphicsContext& context_) : 
-	context(context_)
+	context(context_),
+	ASPool(context_)
 {
-	auto bufferDesc =  DXUtils::ResourceDescBuffer(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * MAX_NUM_TOTAL_BLAS_INSTANCES);
+	auto bufferDesc =  DXUtils::ResourceDescBuffer(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * MAX_NUM_TOTAL_BLAS_INSTANCES * MAX_FRAMES_IN_FLIGHT);
 	BLInstanceDescriptorsGPU = context.allocator->CreateUploadBuffer(&bufferDesc);
+	D3D12_RANGE range {
+		.Begin = 0,
+		.End = 0
+	};
+	DXCHECK(BLInstanceDescriptorsGPU.GetResource()->Map(0, &range, reinterpret_cast<void**>(&mappedInstanceDescriptors)));
 
 	bufferDesc = DXUtils::ResourceDescBuffer(MAX_SCRATCHBUFFER_SIZE,
 		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
@@ -20,21 +47,28 @@ AccelerationStructureManager::AccelerationStructureManager(GraphicsContext& cont
 		D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 	DXUtils::SetName(scratchBuffer.GetResource(), L"ScratchBuffer");
 
-	// Allocate the TLAS buffer
-	TLAccelerationStructure.ASBuffer = context.allocator->CreateDeviceLocalBuffer(&bufferDesc,
-		D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
-	DXUtils::SetName(TLAccelerationStructure.ASBuffer.GetResource(), L"TLAS");
+	// The TLAS buffer is allocated by its first build, once the number of instances is known
+
+	// Compacted sizes of the structures queried in a frame
+	bufferDesc = DXUtils::ResourceDescBuffer(sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC) * 
+		MAX_BLAS_COMPACTIONS_PER_FRAME);
+	compactedSizes = context.allocator->CreateReadBackBuffer(&bufferDesc);
 }
 
 AccelerationStructureManager::~AccelerationStructureManager()
 {
+	BLInstanceDescriptorsGPU.GetResource()->Unmap(0, nullptr);
 	BLInstanceDescriptorsGPU.Release();
-	for (auto& BLAS : BLAccelerationStructures)
+	for (auto& buffer : retiredBuffers)
+	{
+		buffer.Release();
+	}
+	if (TLAccelerationStructure.ASBuffer.sizeInBytes > 0)
 	{
-		BLAS.ASBuffer.Release();
+		TLAccelerationStructure.ASBuffer.Release();
 	}
-	TLAccelerationStructure.ASBuffer.Release();
 	scratchBuffer.Release();
+	compactedSizes.Release();
 }
 
 BLASHandle AccelerationStructureManager::AddBLAS(eastl::vector<AccelerationStructureGeometry>&& geometries)
@@ -42,104 +76,302 @@ BLASHandle AccelerationStructureManager::AddBLAS(eastl::vector<AccelerationStruc
 	auto handle = BLAccelerationStructures.Insert({});
 	auto& BLAS = BLAccelerationStructures[handle];
 
-	// Add the geometry
-	for (auto& geometry : geometries)
+	SetBLASGeometry(BLAS, eastl::move(geometries));
+	ComputeBLASPrebuildInfo(BLAS);
+
+	// Edits before the first build is recorded are compared against it
+	uint32_t vertexCount, indexCount;
+	CountBLASGeometry(BLAS, vertexCount, indexCount);
+	updatePolicy.OnBuilt(BLAS.updateState, vertexCount, indexCount);
+
+	// Allocate the acceleration structure
+	BLAS.ASMemory = ASPool.Allocate(BLAS.resultSize);
+
+	BLAS.lastBuildFrame = 0;
+	BLAS.built = false;
+	BLAS.compacted = false;
+	buildScheduler.Queue(handle, false, BLAS.buildScratchSize, BLAS.numTriangles);
+	return handle;
+}
+
+void AccelerationStructureManager::RebuildBLAS(BLASHandle handle, eastl::vector<AccelerationStructureGeometry>&& geometries, float changedFraction)
+{
+	auto& BLAS = BLAccelerationStructures[handle];
+	UNTITLED_ASSERT((BLAS.built || buildScheduler.IsQueued(handle)) && "Cannot rebuild a BLAS that has not been added!");
+
+	SetBLASGeometry(BLAS, eastl::move(geometries));
+	uint32_t vertexCount, indexCount;
+	CountBLASGeometry(BLAS, vertexCount, indexCount);
+
+	// A refit of a BLAS whose build is still queued is merged into the build
+	const BLASUpdate update = updatePolicy.OnGeometryChanged(BLAS.updateState, vertexCount, indexCount, changedFraction, !BLAS.compacted);
+	if (update == BLASUpdate::Refit)
 	{
-		D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc {
-			.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES,
-			.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE,
-			.Triangles {
-				.IndexFormat = DXGI_FORMAT_R32_UINT,
-				.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT,
-				.IndexCount = static_cast<uint32_t>(geometry.indices.sizeInBytes) / sizeof(uint32_t),
-				.VertexCount = static_cast<uint32_t>(geometry.vertices.sizeInBytes) / sizeof(Vertex),
-				.IndexBuffer = geometry.indices.GetGPUAddress(),
-				.VertexBuffer {
-					.StartAddress = geometry.vertices.GetGPUAddress(),
-					.StrideInBytes = sizeof(Vertex)
-				}
+		buildScheduler.Queue(handle, true, BLAS.updateScratchSize, BLAS.numTriangles);
+	}
+	else
+	{
+		ComputeBLASPrebuildInfo(BLAS);
+		buildScheduler.Queue(handle, false, BLAS.buildScratchSize, BLAS.numTriangles);
+	}
+}
+
+void AccelerationStructureManager::RemoveBLAS(BLASHandle& handle)
+{
+	buildScheduler.Remove(handle);
+	RemovePendingInstances([handle](const PendingInstance& pending) { return pending.BLAS == handle; });
+
+	// Handles are reused, so queries in flight are invalidated in place to keep their slots
+	eastl::erase_if(compactionCandidates, [handle](const CompactionCandidate& candidate) { return candidate.handle == handle; });
+	for (auto& query : compactionQueries)
+	{
+		if (query.handle == handle) query.handle = BLASHandle();
+	}
+
+	auto& BLAS = BLAccelerationStructures[handle];
+	ASPool.Free(BLAS.ASMemory);
+
+	BLAccelerationStructures.Remove(handle);
+}
+
+void AccelerationStructureManager::BuildQueuedBLAS(DXDescriptorHeap* descriptorHeap)
+{
+	// The renderer waits for every frame to finish, so nothing uses the retired buffers anymore
+	for (auto& buffer : retiredBuffers)
+	{
+		buffer.Release();
+	}
+	retiredBuffers.clear();
+	for (auto& allocation : retiredAllocations)
+	{
+		ASPool.Free(allocation);
+	}
+	retiredAllocations.clear();
+	frame++;
+
+	PIXBeginEvent(context.graphicsCommands.Get(), PIX_COLOR_DEFAULT, L"Build BLAS");
+	context.graphicsCommands->SetDescriptorHeaps(1, descriptorHeap->GetAddressOf());
+
+	// Moved structures are read by the compaction and the refits below
+	if (EvacuatePoolBlock())
+	{
+		D3D12_RESOURCE_BARRIER barrier {
+			.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+			.UAV {
+				.pResource = nullptr
 			}
 		};
-		BLAS.geometryDescriptions.push_back(geometryDesc);
-		BLAS.geometryInstances.push_back(geometry);
+		context.graphicsCommands->ResourceBarrier(1, &barrier);
 	}
+	bool recorded = CompactBLAS();
 
-	// Compute the prebuild info for the BLAS
-	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO BLASPrebuildInfo {};
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS BLASInputs {
-		.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
-		.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE,
-		.NumDescs = static_cast<uint32_t>(BLAS.geometryDescriptions.size()),
-		.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
-		.pGeometryDescs = BLAS.geometryDescriptions.data()
-	};
-	context.device->GetRaytracingAccelerationStructurePrebuildInfo(&BLASInputs,
-		&BLASPrebuildInfo);
-	UNTITLED_ASSERT(BLASPrebuildInfo.ResultDataMaxSizeInBytes > 0);
+	buildScheduler.Plan(MAX_SCRATCHBUFFER_SIZE, MAX_BLAS_BUILD_TRIANGLES_PER_FRAME, plannedBuilds);
+	for (const auto& build : plannedBuilds)
+	{
+		auto& BLAS = BLAccelerationStructures[build.handle];
+		UNTITLED_ASSERT((BLAS.built || !build.update) && "Cannot refit a BLAS that has not been built!");
 
-	requiredScratchSize = eastl::max(
-		eastl::max(BLASPrebuildInfo.ScratchDataSizeInBytes, BLASPrebuildInfo.UpdateScratchDataSizeInBytes),
-		requiredScratchSize);
+		// Compacted structures and the ones whose geometry grew can be too small to be built into again
+		if (!build.update && BLAS.ASMemory.sizeInBytes < BLAS.resultSize)
+		{
+			ReplaceBLASMemory(BLAS, ASPool.Allocate(BLAS.resultSize));
+		}
 
-	// Allocate the acceleration structure
-	auto bufferDesc = DXUtils::ResourceDescBuffer(BLASPrebuildInfo.ResultDataMaxSizeInBytes,
-		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-	BLAS.ASBuffer = context.allocator->CreateDeviceLocalBuffer(&bufferDesc, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
-	DXUtils::SetName(BLAS.ASBuffer.GetResource(), L"BLAS");
+		// Refits keep the preference of the build they update
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS BLASInputs {
+			.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
+			.Flags = build.update ? GetBLASBuildFlags(BLAS.updateState.fastBuilt) | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE :
+				GetBLASBuildFlags(BLAS.updateState.preferFastBuild),
+			.NumDescs = static_cast<uint32_t>(BLAS.geometryDescriptions.size()),
+			.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
+			.pGeometryDescs = BLAS.geometryDescriptions.data()
+		};
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC BLASBuildDesc {
+			.DestAccelerationStructureData = BLAS.ASMemory.GetGPUAddress(),
+			.Inputs = BLASInputs,
+			.SourceAccelerationStructureData = build.update ? BLAS.ASMemory.GetGPUAddress() : 0,
+			.ScratchAccelerationStructureData = scratchBuffer.GetGPUAddress() + build.scratchOffset
+		};
+		context.graphicsCommands->BuildRaytracingAccelerationStructure(&BLASBuildDesc, 0, nullptr);
+		if (!build.update)
+		{
+			uint32_t vertexCount, indexCount;
+			CountBLASGeometry(BLAS, vertexCount, indexCount);
+			updatePolicy.OnBuilt(BLAS.updateState, vertexCount, indexCount);
 
-	BLAS.built = false;
-	return handle;
+			// A build writes an uncompacted structure, also into compacted memory that is still large enough
+			BLAS.compacted = false;
+		}
+		BLAS.built = true;
+		BLAS.lastBuildFrame = frame;
+		compactionCandidates.push_back({ build.handle, frame });
+		recorded = true;
+	}
+
+	// Every build has its own scratch region and destination, so the GPU can overlap them.
+	// A single barrier makes them and the compacting copies visible to the TLAS build, which reuses the scratch buffer.
+	// The bounds of the instances may have changed, so the TLAS has to be refit at least.
+	if (recorded)
+	{
+		pendingTLASUpdate = eastl::max(pendingTLASUpdate, TLASUpdate::Refit);
+		D3D12_RESOURCE_BARRIER barrier {
+			.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+			.UAV {
+				.pResource = nullptr
+			}
+		};
+		context.graphicsCommands->ResourceBarrier(1, &barrier);
+	}
+
+	QueryCompactedSizes();
+	PIXEndEvent(context.graphicsCommands.Get());
+
+	RelocateInstances();
+
+	// Instances of the structures built this frame become active, which a refit of the TLAS can't handle
+	for (const auto& pending : pendingInstances)
+	{
+		auto& BLAS = BLAccelerationStructures[pending.BLAS];
+		if (BLAS.built)
+		{
+			auto& instance = BLInstanceDescriptorsCPU[pending.instance];
+			instance.AccelerationStructure = BLAS.ASMemory.GetGPUAddress();
+			MarkInstanceChanged(instance, TLASUpdate::Rebuild);
+		}
+	}
+	RemovePendingInstances([this](const PendingInstance& pending) { return BLAccelerationStructures[pending.BLAS].built; });
 }
 
-void AccelerationStructureManager::BuildBLAS(BLASHandle handle, DXDescriptorHeap* descriptorHeap)
+BLASInstanceHandle AccelerationStructureManager::AddBLASInstance(BLASHandle handle, DirectX::XMMATRIX transform /*= MATRIX_IDENTITY*/, 
+	uint32_t instanceID /*= 0*/)
 {
-	UNTITLED_ASSERT(requiredScratchSize < MAX_SCRATCHBUFFER_SIZE && "Required scratch buffer size exceeds fixed size scratch buffer limit!");
-
-	// Build bottom level acceleration structure
+	UNTITLED_ASSERT(instanceID < (1 << 24) && "Instance IDs are limited to 24 bits!");
 	auto& BLAS = BLAccelerationStructures[handle];
-	UNTITLED_ASSERT(!BLAS.built && "BLAS is already built!");
 
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS BLASInputs {
-		.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
+	auto instanceHandle = BLInstanceDescriptorsCPU.Insert(D3D12_RAYTRACING_INSTANCE_DESC {
+			.InstanceID = instanceID,
+			.InstanceMask = 0xFF,
+			.InstanceContributionToHitGroupIndex = BLAS.instanceContributionToHitGroupIndex,
+			.AccelerationStructure = BLAS.built ? BLAS.ASMemory.GetGPUAddress() : 0
+		});
+
+	DirectX::XMStoreFloat3x4(reinterpret_cast<DirectX::XMFLOAT3X4*>(BLInstanceDescriptorsCPU[instanceHandle].Transform), transform);
+	MarkInstanceChanged(BLInstanceDescriptorsCPU[instanceHandle], TLASUpdate::Rebuild);
+	if (!BLAS.built)
+	{
+		pendingInstances.push_back({ instanceHandle, handle });
+	}
+	return instanceHandle;
+}
+
+void AccelerationStructureManager::SetBLASInstanceTransform(BLASInstanceHandle handle, DirectX::XMMATRIX transform)
+{
+	auto& instance = BLInstanceDescriptorsCPU[handle];
+	DirectX::XMStoreFloat3x4(reinterpret_cast<DirectX::XMFLOAT3X4*>(instance.Transform), transform);
+	MarkInstanceChanged(instance, TLASUpdate::Refit);
+}
+
+void AccelerationStructureManager::RemoveBLASInstance(BLASInstanceHandle& handle)
+{
+	RemovePendingInstances([handle](const PendingInstance& pending) { return pending.instance == handle; });
+
+	// The last instance moves into the slot of the removed one
+	const uint32_t index = static_cast<uint32_t>(&BLInstanceDescriptorsCPU[handle] - BLInstanceDescriptorsCPU.data());
+	BLInstanceDescriptorsCPU.Remove(handle);
+	if (index < BLInstanceDescriptorsCPU.size())
+	{
+		dirtyInstanceDescriptors.Mark(index);
+	}
+	pendingTLASUpdate = TLASUpdate::Rebuild;
+}
+
+void AccelerationStructureManager::BuildTLAS(DXDescriptorHeap* descriptorHeap)
+{
+	if (pendingTLASUpdate == TLASUpdate::None) return;
+
+	const bool refit = pendingTLASUpdate == TLASUpdate::Refit && numTLASRefits < MAX_TLAS_REFITS;
+	numTLASRefits = refit ? numTLASRefits + 1 : 0;
+	pendingTLASUpdate = TLASUpdate::None;
+
+	// Copy the bottom level instance descriptors that changed since the copy of this frame was last used to the GPU,
+	// descriptors beyond the end have been removed
+	const uint32_t numInstances = static_cast<uint32_t>(BLInstanceDescriptorsCPU.size());
+	const uint64_t copyOffset = static_cast<uint64_t>(context.backBufferIndex) * MAX_NUM_TOTAL_BLAS_INSTANCES;
+	dirtyInstanceDescriptors.Consume(context.backBufferIndex, [&](uint32_t first, uint32_t count)
+	{
+		if (first >= numInstances) return;
+		count = eastl::min(count, numInstances - first);
+		memcpy(mappedInstanceDescriptors + copyOffset + first, BLInstanceDescriptorsCPU.data() + first, 
+			count * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+	});
+
+	// Build or refit the top level acceleration structure
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS TLASInputs {
+		.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL,
 		.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE,
-		.NumDescs = static_cast<uint32_t>(BLAS.geometryDescriptions.size()),
+		.NumDescs = numInstances,
 		.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
-		.pGeometryDescs = BLAS.geometryDescriptions.data()
+		.InstanceDescs = BLInstanceDescriptorsGPU.GetGPUAddress() + copyOffset * sizeof(D3D12_RAYTRACING_INSTANCE_DESC)
 	};
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC BLASBuildDesc {
-		.DestAccelerationStructureData = BLAS.ASBuffer.GetGPUAddress(),
-		.Inputs = BLASInputs,
+
+	// The number of instances only changes with a rebuild, the buffer grows when it has become too small for them
+	if (!refit)
+	{
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO TLASPrebuildInfo {};
+		context.device->GetRaytracingAccelerationStructurePrebuildInfo(&TLASInputs, &TLASPrebuildInfo);
+		UNTITLED_ASSERT(TLASPrebuildInfo.ScratchDataSizeInBytes <= MAX_SCRATCHBUFFER_SIZE && "Required scratch buffer size exceeds fixed size scratch buffer limit!");
+		ResizeTLAS(TLASPrebuildInfo.ResultDataMaxSizeInBytes);
+	}
+	else
+	{
+		TLASInputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+	}
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC TLASBuildDesc {
+		.DestAccelerationStructureData = TLAccelerationStructure.ASBuffer.GetGPUAddress(),
+		.Inputs = TLASInputs,
+		.SourceAccelerationStructureData = refit ? TLAccelerationStructure.ASBuffer.GetGPUAddress() : 0,
 		.ScratchAccelerationStructureData = scratchBuffer.GetGPUAddress()
 	};
 
-	PIXBeginEvent(context.graphicsCommands.Get(), PIX_COLOR_DEFAULT, L"Build BLAS");
+	PIXBeginEvent(context.graphicsCommands.Get(), PIX_COLOR_DEFAULT, refit ? L"Refit TLAS" : L"Build TLAS");
 	context.graphicsCommands->SetDescriptorHeaps(1, descriptorHeap->GetAddressOf());
-	context.graphicsCommands->BuildRaytracingAccelerationStructure(&BLASBuildDesc, 0, nullptr);
+	context.graphicsCommands->BuildRaytracingAccelerationStructure(&TLASBuildDesc, 0, nullptr);
 
-	// Since a single scratch resource is used to build all BLAS,
-	// it is necessary to insert barriers between builds. This could
-	// be optimized away by allocating multiple scratch buffers to allow
-	// the GPU to schedule multiple builds simultaneously.
 	D3D12_RESOURCE_BARRIER barrier {
 		.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
 		.UAV {
-			.pResource = BLAS.ASBuffer.GetResource()
+			.pResource = TLAccelerationStructure.ASBuffer.GetResource()
 		}
 	};
 	context.graphicsCommands->ResourceBarrier(1, &barrier);
 	PIXEndEvent(context.graphicsCommands.Get());
-
-	BLAS.built = true;
 }
 
-void AccelerationStructureManager::RebuildBLAS(BLASHandle handle, eastl::vector<AccelerationStructureGeometry>&& geometries, 
-	DXDescriptorHeap* descriptorHeap)
+AccelerationStructureStats AccelerationStructureManager::GetStats() const
 {
-	auto& BLAS = BLAccelerationStructures[handle];
-	UNTITLED_ASSERT(BLAS.built && "Cannot rebuild a BLAS that has not been built!");
+	AccelerationStructureStats stats {
+		.numBLAS = static_cast<uint32_t>(BLAccelerationStructures.size()),
+		.numCompactedBLAS = 0,
+		.memoryUsage = 0,
+		.uncompactedMemoryUsage = 0,
+		.updates = updatePolicy.GetStats(),
+		.pool = ASPool.GetStats(),
+		.TLASMemoryUsage = TLAccelerationStructure.ASBuffer.sizeInBytes
+	};
+	for (auto BLAS = BLAccelerationStructures.cbegin(); BLAS != BLAccelerationStructures.cend(); ++BLAS)
+	{
+		stats.numCompactedBLAS += BLAS->compacted ? 1 : 0;
+		stats.memoryUsage += BLAS->ASMemory.sizeInBytes;
+		stats.uncompactedMemoryUsage += BLAS->resultSize;
+	}
+	return stats;
+}
 
+void AccelerationStructureManager::SetBLASGeometry(BottomLevelAccelerationStructure& BLAS, eastl::vector<AccelerationStructureGeometry>&& geometries)
+{
 	BLAS.geometryDescriptions.clear();
 	BLAS.geometryInstances.clear();
+	BLAS.numTriangles = 0;
 
 	for (auto& geometry : geometries)
 	{
@@ -148,7 +380,7 @@ void AccelerationStructureManager::RebuildBLAS(BLASHandle handle, eastl::vector<
 			.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE,
 			.Triangles {
 				.IndexFormat = DXGI_FORMAT_R32_UINT,
-				.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT,
+				.VertexFormat = DXGI_FORMAT_R16G16B16A16_FLOAT,
 				.IndexCount = static_cast<uint32_t>(geometry.indices.sizeInBytes) / sizeof(uint32_t),
 				.VertexCount = static_cast<uint32_t>(geometry.vertices.sizeInBytes) / sizeof(Vertex),
 				.IndexBuffer = geometry.indices.GetGPUAddress(),
@@ -160,86 +392,187 @@ void AccelerationStructureManager::RebuildBLAS(BLASHandle handle, eastl::vector<
 		};
 		BLAS.geometryDescriptions.push_back(geometryDesc);
 		BLAS.geometryInstances.push_back(geometry);
+		BLAS.numTriangles += geometryDesc.Triangles.IndexCount / 3;
 	}
+}
 
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS BLASInputs {
-		.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
-		.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE,
-		.NumDescs = static_cast<uint32_t>(BLAS.geometryDescriptions.size()),
-		.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
-		.pGeometryDescs = BLAS.geometryDescriptions.data()
-	};
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC BLASBuildDesc {
-		.DestAccelerationStructureData = BLAS.ASBuffer.GetGPUAddress(),
-		.Inputs = BLASInputs,
-		.SourceAccelerationStructureData = BLAS.ASBuffer.GetGPUAddress(),
-		.ScratchAccelerationStructureData = scratchBuffer.GetGPUAddress()
-	};
+void AccelerationStructureManager::ComputeBLASPrebuildInfo(BottomLevelAccelerationStructure& BLAS)
+{
+	// The sizes cover both build preferences, so a structure can switch between them in place
+	BLAS.buildScratchSize = 0;
+	BLAS.updateScratchSize = 0;
+	BLAS.resultSize = 0;
+	for (bool fastBuild : { false, true })
+	{
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO BLASPrebuildInfo {};
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS BLASInputs {
+			.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL,
+			.Flags = GetBLASBuildFlags(fastBuild),
+			.NumDescs = static_cast<uint32_t>(BLAS.geometryDescriptions.size()),
+			.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
+			.pGeometryDescs = BLAS.geometryDescriptions.data()
+		};
+		context.device->GetRaytracingAccelerationStructurePrebuildInfo(&BLASInputs,
+			&BLASPrebuildInfo);
+		BLAS.buildScratchSize = eastl::max(BLAS.buildScratchSize, BLASPrebuildInfo.ScratchDataSizeInBytes);
+		BLAS.updateScratchSize = eastl::max(BLAS.updateScratchSize, BLASPrebuildInfo.UpdateScratchDataSizeInBytes);
+		BLAS.resultSize = eastl::max(BLAS.resultSize, BLASPrebuildInfo.ResultDataMaxSizeInBytes);
+	}
+	UNTITLED_ASSERT(BLAS.resultSize > 0);
+	UNTITLED_ASSERT(BLAS.buildScratchSize <= MAX_SCRATCHBUFFER_SIZE && "Required scratch buffer size exceeds fixed size scratch buffer limit!");
+}
 
-	PIXBeginEvent(context.graphicsCommands.Get(), PIX_COLOR_DEFAULT, L"Rebuild BLAS");
-	context.graphicsCommands->SetDescriptorHeaps(1, descriptorHeap->GetAddressOf());
-	context.graphicsCommands->BuildRaytracingAccelerationStructure(&BLASBuildDesc, 0, nullptr);
+void AccelerationStructureManager::ResizeTLAS(uint64_t size)
+{
+	DXDeviceLocalBuffer& buffer = TLAccelerationStructure.ASBuffer;
+	if (size <= buffer.sizeInBytes) return;
 
-	// Since a single scratch resource is used to build all BLAS,
-	// it is necessary to insert barriers between builds. This could
-	// be optimized away by allocating multiple scratch buffers to allow
-	// the GPU to schedule multiple builds simultaneously.
-	D3D12_RESOURCE_BARRIER barrier {
-		.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
-		.UAV {
-			.pResource = BLAS.ASBuffer.GetResource()
-		}
-	};
-	context.graphicsCommands->ResourceBarrier(1, &barrier);
-	PIXEndEvent(context.graphicsCommands.Get());
+	// The old buffer may still be in use by the previous frame, it grows geometrically so it's rarely replaced
+	if (buffer.sizeInBytes > 0)
+	{
+		retiredBuffers.push_back(buffer);
+	}
+	auto bufferDesc = DXUtils::ResourceDescBuffer(eastl::max(size, buffer.sizeInBytes * 2), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	buffer = context.allocator->CreateDeviceLocalBuffer(&bufferDesc, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE);
+	DXUtils::SetName(buffer.GetResource(), L"TLAS");
 }
 
-BLASInstanceHandle AccelerationStructureManager::AddBLASInstance(BLASHandle handle, DirectX::XMMATRIX transform /*= MATRIX_IDENTITY*/)
+void AccelerationStructureManager::ReplaceBLASMemory(BottomLevelAccelerationStructure& BLAS, AccelerationStructureAllocation allocation)
 {
-	auto& BLAS = BLAccelerationStructures[handle];
+	// A structure can move more than once in a frame, the instances still point to where it was at its start
+	auto relocation = eastl::find_if(relocations.begin(), relocations.end(), 
+		[&BLAS](const auto& relocation) { return relocation.second == BLAS.ASMemory.GetGPUAddress(); });
+	if (relocation != relocations.end())
+	{
+		relocation->second = allocation.GetGPUAddress();
+	}
+	else
+	{
+		relocations.push_back(eastl::make_pair(BLAS.ASMemory.GetGPUAddress(), allocation.GetGPUAddress()));
+	}
+	retiredAllocations.push_back(BLAS.ASMemory);
+	BLAS.ASMemory = allocation;
+}
 
-	auto instanceHandle = BLInstanceDescriptorsCPU.Insert(D3D12_RAYTRACING_INSTANCE_DESC {
-			.InstanceMask = 0xFF,
-			.InstanceContributionToHitGroupIndex = BLAS.instanceContributionToHitGroupIndex,
-			.AccelerationStructure = BLAS.ASBuffer.GetGPUAddress()
-		});
+bool AccelerationStructureManager::EvacuatePoolBlock()
+{
+	const uint32_t block = ASPool.GetEvacuationBlock();
+	if (block == INVALID_AS_POOL_BLOCK) return false;
 
-	DirectX::XMStoreFloat3x4(reinterpret_cast<DirectX::XMFLOAT3X4*>(BLInstanceDescriptorsCPU[instanceHandle].Transform), transform);
-	return instanceHandle;
+	// The block empties over a few frames and is released once the memory retired here is freed
+	bool recorded = false;
+	uint64_t movedBytes = 0;
+	for (auto& BLAS : BLAccelerationStructures)
+	{
+		if (BLAS.ASMemory.block != block) continue;
+		if (movedBytes >= MAX_AS_POOL_MOVE_BYTES_PER_FRAME) break;
+
+		AccelerationStructureAllocation allocation;
+		if (!ASPool.TryAllocateElsewhere(BLAS.ASMemory.sizeInBytes, block, allocation)) break;
+
+		// Structures that haven't been built yet have nothing to copy
+		if (BLAS.built)
+		{
+			context.graphicsCommands->CopyRaytracingAccelerationStructure(allocation.GetGPUAddress(), BLAS.ASMemory.GetGPUAddress(),
+				D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_CLONE);
+			recorded = true;
+		}
+		movedBytes += BLAS.ASMemory.sizeInBytes;
+		ReplaceBLASMemory(BLAS, allocation);
+	}
+	return recorded;
 }
 
-void AccelerationStructureManager::BuildTLAS(DXDescriptorHeap* descriptorHeap)
+bool AccelerationStructureManager::CompactBLAS()
 {
-	UNTITLED_ASSERT(requiredScratchSize < MAX_SCRATCHBUFFER_SIZE && "Required scratch buffer size exceeds fixed size scratch buffer limit!");
+	if (compactionQueries.empty()) return false;
 
-	// Copy the bottom level instance descriptors to the GPU
-	BLInstanceDescriptorsGPU.SetData(BLInstanceDescriptorsCPU.data(),
-		BLInstanceDescriptorsCPU.size() * sizeof(D3D12_RAYTRACING_INSTANCE_DESC));
+	// The sizes have been written by the previous frame
+	bool recorded = false;
+	const auto* sizes = compactedSizes.StartBufferRead<D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC>();
+	for (size_t i = 0; i < compactionQueries.size(); ++i)
+	{
+		const CompactionCandidate& query = compactionQueries[i];
+		if (query.handle == BLASHandle()) continue;
 
-	// Build the top level acceleration structure
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS TLASInputs {
-		.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL,
-		.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE,
-		.NumDescs = static_cast<uint32_t>(BLInstanceDescriptorsCPU.size()),
-		.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY,
-		.InstanceDescs = BLInstanceDescriptorsGPU.GetGPUAddress()
-	};
-	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC TLASBuildDesc {
-		.DestAccelerationStructureData = TLAccelerationStructure.ASBuffer.GetGPUAddress(),
-		.Inputs = TLASInputs,
-		.ScratchAccelerationStructureData = scratchBuffer.GetGPUAddress()
-	};
+		// Structures that have been queued for a refit since the query stay as they are
+		auto& BLAS = BLAccelerationStructures[query.handle];
+		const uint64_t compactedSize = sizes[i].CompactedSizeInBytes;
+		if (BLAS.lastBuildFrame != query.buildFrame || buildScheduler.IsQueued(query.handle) || 
+			compactedSize == 0 || compactedSize >= BLAS.ASMemory.sizeInBytes) continue;
 
-	PIXBeginEvent(context.graphicsCommands.Get(), PIX_COLOR_DEFAULT, L"Build TLAS");
-	context.graphicsCommands->SetDescriptorHeaps(1, descriptorHeap->GetAddressOf());
-	context.graphicsCommands->BuildRaytracingAccelerationStructure(&TLASBuildDesc, 0, nullptr);
+		const AccelerationStructureAllocation compactedMemory = ASPool.Allocate(compactedSize);
+		context.graphicsCommands->CopyRaytracingAccelerationStructure(compactedMemory.GetGPUAddress(), BLAS.ASMemory.GetGPUAddress(),
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+		ReplaceBLASMemory(BLAS, compactedMemory);
+		BLAS.compacted = true;
+		recorded = true;
+	}
+	compactedSizes.EndBufferRead();
 
-	D3D12_RESOURCE_BARRIER barrier {
-		.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV,
-		.UAV {
-			.pResource = TLAccelerationStructure.ASBuffer.GetResource()
+	compactionQueries.clear();
+	return recorded;
+}
+
+void AccelerationStructureManager::QueryCompactedSizes()
+{
+	// Candidates are in the order they were built, the ones that have been built again since are skipped
+	eastl::fixed_vector<D3D12_GPU_VIRTUAL_ADDRESS, MAX_BLAS_COMPACTIONS_PER_FRAME, false> sources;
+	while (!compactionCandidates.empty() && sources.size() < MAX_BLAS_COMPACTIONS_PER_FRAME &&
+		frame - compactionCandidates.front().buildFrame >= BLAS_COMPACTION_DELAY_FRAMES)
+	{
+		const CompactionCandidate candidate = compactionCandidates.front();
+		compactionCandidates.pop_front();
+
+		auto& BLAS = BLAccelerationStructures[candidate.handle];
+		if (BLAS.lastBuildFrame != candidate.buildFrame || BLAS.compacted || buildScheduler.IsQueued(candidate.handle)) continue;
+
+		// Structures that were built for speed or refit are built for tracing first and compacted after that build
+		if (updatePolicy.OnIdle(BLAS.updateState))
+		{
+			buildScheduler.Queue(candidate.handle, false, BLAS.buildScratchSize, BLAS.numTriangles);
+			continue;
 		}
+
+		compactionQueries.push_back(candidate);
+		sources.push_back(BLAS.ASMemory.GetGPUAddress());
+	}
+	if (sources.empty()) return;
+
+	ID3D12Resource* sizeBuffer = compactedSizes.outputBuffer.GetResource();
+	auto barrier = DXUtils::ResourceBarrierTransition(sizeBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	context.graphicsCommands->ResourceBarrier(1, &barrier);
+
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildInfoDesc {
+		.DestBuffer = compactedSizes.outputBuffer.GetGPUAddress(),
+		.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE
 	};
+	context.graphicsCommands->EmitRaytracingAccelerationStructurePostbuildInfo(&postbuildInfoDesc, 
+		static_cast<uint32_t>(sources.size()), sources.data());
+
+	barrier = DXUtils::ResourceBarrierTransition(sizeBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
 	context.graphicsCommands->ResourceBarrier(1, &barrier);
-	PIXEndEvent(context.graphicsCommands.Get());
-}
\ No newline at end of file
+	context.graphicsCommands->CopyBufferRegion(compactedSizes.GetResource(), 0, sizeBuffer, 0, 
+		sources.size() * sizeof(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC));
+	barrier = DXUtils::ResourceBarrierTransition(sizeBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+	context.graphicsCommands->ResourceBarrier(1, &barrier);
+}
+
+void AccelerationStructureManager::RelocateInstances()
+{
+	if (relocations.empty()) return;
+
+	// A single pass over the instances, looking up the moved structures by their old address
+	eastl::sort(relocations.begin(), relocations.end());
+	for (auto& instance : BLInstanceDescriptorsCPU)
+	{
+		auto relocation = eastl::lower_bound(relocations.begin(), relocations.end(), instance.AccelerationStructure,
+			[](const auto& relocation, D3D12_GPU_VIRTUAL_ADDRESS address) { return relocation.first < address; });
+		if (relocation != relocations.end() && relocation->first == instance.AccelerationStructure)
+		{
+			instance.AccelerationStructure = relocation->second;
+			MarkInstanceChanged(instance, TLASUpdate::Refit);
+		}
+	}
+	relocations.clear();
+}
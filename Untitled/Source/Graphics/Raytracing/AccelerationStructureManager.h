@@ -1,7 +1,11 @@
 #pragma once
 
+#include "Core/DirtyRanges.h"
 #include "Core/SparseArray.h"
 #include "Graphics/DX/DXBuffer.h"
+#include "Graphics/Raytracing/AccelerationStructurePool.h"
+#include "Graphics/Raytracing/BLASBuildScheduler.h"
+#include "Graphics/Raytracing/BLASUpdatePolicy.h"
 
 // Here we define some reasonable default sizes to allow for 
 // fixed size stack allocated containers. The containers
@@ -13,9 +17,27 @@ constexpr size_t MAX_NUM_TOTAL_BLAS_INSTANCES = 16384;
 
 // Since we need to create geometry dynamically at runtime we
 // will simply provide a scratch buffer with a fixed size that should
-// be big enough to hold any chunk of voxels (64MB)
+// be big enough to hold any chunk of voxels (64MB). The BLAS builds of
+// a frame suballocate their scratch memory from it.
 constexpr size_t MAX_SCRATCHBUFFER_SIZE = 67'108'864;
 
+// BLAS builds beyond this many triangles are spread over the next frames
+constexpr uint64_t MAX_BLAS_BUILD_TRIANGLES_PER_FRAME = 2'097'152;
+
+// BLASes that haven't been built or refit for this many frames are no
+// longer edited and get compacted, a limited number of them per frame
+constexpr uint64_t BLAS_COMPACTION_DELAY_FRAMES = 120;
+constexpr size_t MAX_BLAS_COMPACTIONS_PER_FRAME = 64;
+
+// BLASes moved out of a mostly empty pool block per frame, see AccelerationStructurePool
+constexpr uint64_t MAX_AS_POOL_MOVE_BYTES_PER_FRAME = 16'777'216;
+
+// Refits degrade the TLAS, it's rebuilt after this many of them in a row
+constexpr uint32_t MAX_TLAS_REFITS = 32;
+
+// Runs of changed instance descriptors this close together are uploaded as one
+constexpr uint32_t MAX_INSTANCE_UPLOAD_GAP = 4;
+
 constexpr DirectX::XMMATRIX MATRIX_IDENTITY = {
 	{ 1.0f, 0.0f, 0.0f, 0.0f },
 	{ 0.0f, 1.0f, 0.0f, 0.0f },
@@ -39,41 +61,62 @@ struct alignas(16) TopLevelAccelerationStructure
 struct alignas(16) BottomLevelAccelerationStructure
 {
 	uint32_t instanceContributionToHitGroupIndex;
-	DXDeviceLocalBuffer ASBuffer;
+	AccelerationStructureAllocation ASMemory;
 	DirectX::XMMATRIX transform;
 	eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescriptions;
 	eastl::vector<AccelerationStructureGeometry> geometryInstances;
+	uint64_t buildScratchSize;
+	uint64_t updateScratchSize;
+	uint64_t resultSize;
+	uint32_t numTriangles;
+	BLASUpdateState updateState;
+	uint64_t lastBuildFrame;
 	bool built;
+	// Compacted structures are built again at full size once they are edited
+	bool compacted;
 };
-using BLASHandle = SparseHandle<BottomLevelAccelerationStructure>;
 using BLASInstanceHandle = SparseHandle<D3D12_RAYTRACING_INSTANCE_DESC>;
 
+struct AccelerationStructureStats
+{
+	uint32_t numBLAS;
+	uint32_t numCompactedBLAS;
+	// Memory of the bottom level structures and the memory they'd take without compaction
+	size_t memoryUsage;
+	size_t uncompactedMemoryUsage;
+	BLASUpdateStats updates;
+	AccelerationStructurePoolStats pool;
+	size_t TLASMemoryUsage;
+};
+
 class AccelerationStructureManager
 {
 public:
 	AccelerationStructureManager(GraphicsContext& context_);
 	~AccelerationStructureManager();
 
+	// New structures and updates are queued and recorded by BuildQueuedBLAS. Updates are refits or builds
+	// depending on how much changed, changedFraction is the part of the vertices that has been rewritten.
 	[[nodiscard]] BLASHandle AddBLAS(eastl::vector<AccelerationStructureGeometry>&& geometries);
-	void BuildBLAS(BLASHandle handle, DXDescriptorHeap* descriptorHeap);
+	void RebuildBLAS(BLASHandle handle, eastl::vector<AccelerationStructureGeometry>&& geometries, float changedFraction = 1.0f);
 
-	void RebuildBLAS(BLASHandle handle, eastl::vector<AccelerationStructureGeometry>&& geometries, DXDescriptorHeap* descriptorHeap);
+	// Records the queued builds that fit into the scratch buffer and the budget of this frame,
+	// along with the compaction of the structures that haven't changed for a while
+	void BuildQueuedBLAS(DXDescriptorHeap* descriptorHeap);
 
-	[[nodiscard]] BLASInstanceHandle AddBLASInstance(BLASHandle handle, DirectX::XMMATRIX transform = MATRIX_IDENTITY);
+	// The instance ID is available to the shaders through InstanceID().
+	// Instances of a BLAS that hasn't been built yet stay inactive until it is built.
+	[[nodiscard]] BLASInstanceHandle AddBLASInstance(BLASHandle handle, DirectX::XMMATRIX transform = MATRIX_IDENTITY, uint32_t instanceID = 0);
+	void SetBLASInstanceTransform(BLASInstanceHandle handle, DirectX::XMMATRIX transform);
+	void RemoveBLASInstance(BLASInstanceHandle& handle);
+
+	// Skips the TLAS if nothing changed since the last frame, refits it if only transforms or
+	// BLASes changed and rebuilds it when instances have been added or removed
 	void BuildTLAS(DXDescriptorHeap* descriptorHeap);
 
-	inline void RemoveBLASInstance(BLASInstanceHandle& handle)
-	{
-		BLInstanceDescriptorsCPU.Remove(handle);
-	}
+	void RemoveBLAS(BLASHandle& handle);
 
-	inline void RemoveBLAS(BLASHandle& handle)
-	{
-		auto& BLAS = BLAccelerationStructures[handle];
-		BLAS.ASBuffer.allocation->Release();
-
-		BLAccelerationStructures.Remove(handle);
-	}
+	AccelerationStructureStats GetStats() const;
 
 	inline SparseArray<BottomLevelAccelerationStructure, MAX_NUM_BLAS>& GetBLAS()
 	{
@@ -91,11 +134,77 @@ private:
 	SparseArray<BottomLevelAccelerationStructure, MAX_NUM_BLAS> BLAccelerationStructures;
 
 	SparseArray<D3D12_RAYTRACING_INSTANCE_DESC, MAX_NUM_TOTAL_BLAS_INSTANCES> BLInstanceDescriptorsCPU;
+
+	// Persistently mapped with a copy of the descriptors per frame in flight, 
+	// every copy is only written where the descriptors changed since it was last used
 	DXUploadBuffer BLInstanceDescriptorsGPU;
+	D3D12_RAYTRACING_INSTANCE_DESC* mappedInstanceDescriptors;
+	DirtyRanges<MAX_NUM_TOTAL_BLAS_INSTANCES, MAX_FRAMES_IN_FLIGHT, MAX_INSTANCE_UPLOAD_GAP> dirtyInstanceDescriptors;
+
+	// Instances waiting for their BLAS to be built
+	struct PendingInstance
+	{
+		BLASInstanceHandle instance;
+		BLASHandle BLAS;
+	};
+	eastl::vector<PendingInstance> pendingInstances;
 
-	TopLevelAccelerationStructure TLAccelerationStructure;
+	// Sized for the instances by its builds
+	TopLevelAccelerationStructure TLAccelerationStructure {};
+
+	enum class TLASUpdate : uint8_t
+	{
+		None,
+		Refit,
+		Rebuild
+	};
+	TLASUpdate pendingTLASUpdate = TLASUpdate::Rebuild;
+	uint32_t numTLASRefits = 0;
 	
-	uint64_t requiredScratchSize = 0;
+	BLASBuildScheduler buildScheduler;
+	BLASUpdatePolicy updatePolicy;
+	eastl::vector<BLASBuildScheduler::PlannedBuild> plannedBuilds;
 	DXDeviceLocalBuffer scratchBuffer;
+	uint64_t frame = 0;
+
+	// Built structures wait for the compaction delay, their compacted sizes are read back a frame later
+	struct CompactionCandidate
+	{
+		BLASHandle handle;
+		uint64_t buildFrame;
+	};
+	eastl::deque<CompactionCandidate> compactionCandidates;
+	eastl::vector<CompactionCandidate> compactionQueries;
+	DXReadBackBuffer compactedSizes;
+
+	// The bottom level structures are placed in the pool instead of buffers of their own
+	AccelerationStructurePool ASPool;
+
+	// Memory replaced this frame is released once the GPU is done with it,
+	// the instances move over to the new addresses
+	eastl::vector<DXDeviceLocalBuffer> retiredBuffers;
+	eastl::vector<AccelerationStructureAllocation> retiredAllocations;
+	eastl::vector<eastl::pair<D3D12_GPU_VIRTUAL_ADDRESS, D3D12_GPU_VIRTUAL_ADDRESS>> relocations;
+
+	void SetBLASGeometry(BottomLevelAccelerationStructure& BLAS, eastl::vector<AccelerationStructureGeometry>&& geometries);
+	void ComputeBLASPrebuildInfo(BottomLevelAccelerationStructure& BLAS);
+	void ResizeTLAS(uint64_t size);
+	void ReplaceBLASMemory(BottomLevelAccelerationStructure& BLAS, AccelerationStructureAllocation allocation);
+	bool EvacuatePoolBlock();
+	bool CompactBLAS();
+	void QueryCompactedSizes();
+	void RelocateInstances();
+
+	inline void MarkInstanceChanged(const D3D12_RAYTRACING_INSTANCE_DESC& instance, TLASUpdate update)
+	{
+		dirtyInstanceDescriptors.Mark(static_cast<uint32_t>(&instance - BLInstanceDescriptorsCPU.data()));
+		pendingTLASUpdate = eastl::max(pendingTLASUpdate, update);
+	}
+
+	template<typename Predicate>
+	inline void RemovePendingInstances(Predicate predicate)
+	{
+		pendingInstances.erase(eastl::remove_if(pendingInstances.begin(), pendingInstances.end(), predicate), pendingInstances.end());
+	}
 };
 
@@ -0,0 +1,150 @@
+#include "PCH.h"
+#include "AccelerationStructurePool.h"
+
+#include "Core/Logging.h"
+#include "Graphics/DX/DXCommon.h"
+#include "Graphics/DX/DXUtils.h"
+#include "Graphics/Memory/ResourceAllocator.h"
+
+AccelerationStructurePool::AccelerationStructurePool(GraphicsContext& context_) :
+	context(context_)
+{
+}
+
+AccelerationStructurePool::~AccelerationStructurePool()
+{
+	for (auto& block : blocks)
+	{
+		if (block)
+		{
+			block->buffer.Release();
+		}
+	}
+}
+
+AccelerationStructureAllocation AccelerationStructurePool::Allocate(uint64_t size)
+{
+	// Blocks are tried in order, which keeps the later ones emptier so they can be released
+	AccelerationStructureAllocation allocation;
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		if (TryAllocate(size, i, allocation)) return allocation;
+	}
+
+	const bool allocated = TryAllocate(size, CreateBlock(eastl::max(size, AS_POOL_BLOCK_SIZE)), allocation);
+	UNTITLED_ASSERT(allocated && "New acceleration structure block is too small!");
+	return allocation;
+}
+
+bool AccelerationStructurePool::TryAllocateElsewhere(uint64_t size, uint32_t excludedBlock, AccelerationStructureAllocation& allocation)
+{
+	// Moving structures into an empty block would only pin that one instead
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		if (i != excludedBlock && blocks[i] && !blocks[i]->allocator.IsEmpty() && TryAllocate(size, i, allocation)) return true;
+	}
+	return false;
+}
+
+uint32_t AccelerationStructurePool::GetEvacuationBlock() const
+{
+	uint64_t reservedMemory = 0;
+	uint64_t usedMemory = 0;
+	uint32_t emptiest = INVALID_AS_POOL_BLOCK;
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		if (!blocks[i]) continue;
+
+		const TLSFAllocator& allocator = blocks[i]->allocator;
+		reservedMemory += allocator.GetSize();
+		usedMemory += allocator.GetUsedSize();
+
+		// Blocks of large structures hold nothing else
+		if (allocator.IsEmpty() || allocator.GetSize() > AS_POOL_BLOCK_SIZE) continue;
+		if (emptiest == INVALID_AS_POOL_BLOCK || allocator.GetUsedSize() < blocks[emptiest]->allocator.GetUsedSize())
+		{
+			emptiest = i;
+		}
+	}
+	return reservedMemory - usedMemory > AS_POOL_EVACUATION_THRESHOLD ? emptiest : INVALID_AS_POOL_BLOCK;
+}
+
+void AccelerationStructurePool::Free(AccelerationStructureAllocation& allocation)
+{
+	auto& block = blocks[allocation.block];
+	UNTITLED_ASSERT(block && "Acceleration structure block has already been released!");
+	block->allocator.Free(allocation.range);
+	allocation = {};
+
+	if (!block->allocator.IsEmpty()) return;
+
+	const bool spare = eastl::any_of(blocks.begin(), blocks.end(), [&block](const eastl::unique_ptr<Block>& other)
+	{
+		return other && other != block && other->allocator.IsEmpty();
+	});
+	if (spare)
+	{
+		block->buffer.Release();
+		block.reset();
+	}
+}
+
+AccelerationStructurePoolStats AccelerationStructurePool::GetStats() const
+{
+	AccelerationStructurePoolStats stats {
+		.numBlocks = 0,
+		.numAllocations = 0,
+		.reservedMemory = 0,
+		.usedMemory = 0,
+		.fragmentation = 0.0f
+	};
+
+	uint64_t largestFreeRanges = 0;
+	for (const auto& block : blocks)
+	{
+		if (!block) continue;
+
+		stats.numBlocks++;
+		stats.numAllocations += block->allocator.GetNumAllocations();
+		stats.reservedMemory += block->allocator.GetSize();
+		stats.usedMemory += block->allocator.GetUsedSize();
+		largestFreeRanges += block->allocator.GetLargestFreeRange();
+	}
+
+	const size_t freeMemory = stats.reservedMemory - stats.usedMemory;
+	stats.fragmentation = freeMemory > 0 ? 1.0f - static_cast<float>(largestFreeRanges) / freeMemory : 0.0f;
+	return stats;
+}
+
+bool AccelerationStructurePool::TryAllocate(uint64_t size, uint32_t block, AccelerationStructureAllocation& allocation)
+{
+	if (!blocks[block] || !blocks[block]->allocator.Allocate(size, allocation.range)) return false;
+
+	allocation.address = blocks[block]->buffer.GetGPUAddress() + allocation.range.offset;
+	allocation.sizeInBytes = size;
+	allocation.block = block;
+	return true;
+}
+
+uint32_t AccelerationStructurePool::CreateBlock(uint64_t size)
+{
+	const uint64_t blockSize = (size + ACCELERATION_STRUCTURE_ALIGNMENT - 1) & ~(ACCELERATION_STRUCTURE_ALIGNMENT - 1);
+	auto bufferDesc = DXUtils::ResourceDescBuffer(blockSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	auto block = eastl::make_unique<Block>(Block {
+		.buffer = context.allocator->CreateDeviceLocalBuffer(&bufferDesc, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE),
+		.allocator = TLSFAllocator(blockSize, ACCELERATION_STRUCTURE_ALIGNMENT)
+	});
+	DXUtils::SetName(block->buffer.GetResource(), L"AccelerationStructurePool");
+	UNTITLED_LOG_INFO("Created a %llu byte acceleration structure block\n", static_cast<unsigned long long>(blockSize));
+
+	for (uint32_t i = 0; i < blocks.size(); ++i)
+	{
+		if (!blocks[i])
+		{
+			blocks[i] = eastl::move(block);
+			return i;
+		}
+	}
+	blocks.push_back(eastl::move(block));
+	return static_cast<uint32_t>(blocks.size() - 1);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Graphics/DX/DXBuffer.h"
+#include "Graphics/Memory/TLSFAllocator.h"
+
+// Acceleration structures have to be placed at this alignment (D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT)
+constexpr uint64_t ACCELERATION_STRUCTURE_ALIGNMENT = 256;
+
+// Size of the buffers the structures are placed in (64MB), larger structures get a block of their own
+constexpr uint64_t AS_POOL_BLOCK_SIZE = 67'108'864;
+
+// Blocks are evacuated once the pool holds this much more memory than it uses
+constexpr uint64_t AS_POOL_EVACUATION_THRESHOLD = 2 * AS_POOL_BLOCK_SIZE;
+
+constexpr uint32_t INVALID_AS_POOL_BLOCK = eastl::numeric_limits<uint32_t>::max();
+
+struct GraphicsContext;
+
+// Range of a pool block holding an acceleration structure
+struct AccelerationStructureAllocation
+{
+	D3D12_GPU_VIRTUAL_ADDRESS address = 0;
+	uint64_t sizeInBytes = 0;
+	uint32_t block = 0;
+	TLSFAllocator::Allocation range;
+
+	inline D3D12_GPU_VIRTUAL_ADDRESS GetGPUAddress() const
+	{
+		return address;
+	}
+};
+
+struct AccelerationStructurePoolStats
+{
+	uint32_t numBlocks;
+	uint32_t numAllocations;
+	size_t reservedMemory;
+	size_t usedMemory;
+	// Part of the free memory of the blocks that is not in their largest free ranges
+	float fragmentation;
+};
+
+// Places acceleration structures in a few large buffers instead of creating a committed resource for each of them,
+// which would take a heap per structure and run into the allocation limits with thousands of chunks. Every block
+// suballocates its buffer with a TLSFAllocator. Empty blocks are released, except for one that is kept around so
+// streaming back and forth doesn't keep creating and releasing them. Structures that outlive their neighbors pin
+// blocks that are mostly free, the emptiest of those is evacuated by moving its structures to the other blocks.
+class AccelerationStructurePool
+{
+public:
+	AccelerationStructurePool(GraphicsContext& context_);
+	~AccelerationStructurePool();
+
+	AccelerationStructureAllocation Allocate(uint64_t size);
+
+	// Allocates from the non-empty blocks other than the excluded one without creating a block
+	bool TryAllocateElsewhere(uint64_t size, uint32_t excludedBlock, AccelerationStructureAllocation& allocation);
+
+	// Returns the block whose structures should be moved elsewhere, or INVALID_AS_POOL_BLOCK while the pool is dense enough
+	uint32_t GetEvacuationBlock() const;
+
+	// The GPU has to be done with the structure
+	void Free(AccelerationStructureAllocation& allocation);
+
+	AccelerationStructurePoolStats GetStats() const;
+
+private:
+	GraphicsContext& context;
+
+	struct Block
+	{
+		DXDeviceLocalBuffer buffer;
+		TLSFAllocator allocator;
+	};
+	// Released blocks leave their slot empty, so the indices of the others stay valid
+	eastl::vector<eastl::unique_ptr<Block>> blocks;
+
+	uint32_t CreateBlock(uint64_t size);
+	bool TryAllocate(uint64_t size, uint32_t block, AccelerationStructureAllocation& allocation);
+};
@@ -0,0 +1,72 @@
+#include "PCH.h"
+#include "BLASBuildScheduler.h"
+
+static uint64_t AlignScratch(uint64_t size)
+{
+	return (size + SCRATCH_ALIGNMENT - 1) & ~(SCRATCH_ALIGNMENT - 1);
+}
+
+void BLASBuildScheduler::Queue(BLASHandle handle, bool update, uint64_t scratchSize, uint32_t numTriangles)
+{
+	QueuedBuild* queued = Find(handle);
+	if (queued == nullptr)
+	{
+		queue.push_back({ handle, update, scratchSize, numTriangles });
+		return;
+	}
+
+	// Queued builds keep their place, so a BLAS that is refit every frame still gets built in order.
+	// The geometry may have grown in between, the larger scratch size covers both requests.
+	queued->update = queued->update && update;
+	queued->scratchSize = eastl::max(queued->scratchSize, scratchSize);
+	queued->numTriangles = numTriangles;
+}
+
+void BLASBuildScheduler::Remove(BLASHandle handle)
+{
+	queue.erase(eastl::remove_if(queue.begin(), queue.end(), [handle](const QueuedBuild& queued)
+	{
+		return queued.handle == handle;
+	}), queue.end());
+}
+
+bool BLASBuildScheduler::IsQueued(BLASHandle handle) const
+{
+	return eastl::any_of(queue.begin(), queue.end(), [handle](const QueuedBuild& queued)
+	{
+		return queued.handle == handle;
+	});
+}
+
+void BLASBuildScheduler::Plan(uint64_t scratchSize, uint64_t triangleBudget, eastl::vector<PlannedBuild>& builds)
+{
+	builds.clear();
+	plannedScratchSize = 0;
+	plannedTriangles = 0;
+
+	size_t numPlanned = 0;
+	for (; numPlanned < queue.size(); ++numPlanned)
+	{
+		const QueuedBuild& queued = queue[numPlanned];
+		UNTITLED_ASSERT(queued.scratchSize <= scratchSize && "BLAS requires more scratch memory than the scratch buffer holds!");
+
+		const uint64_t scratchEnd = plannedScratchSize + AlignScratch(queued.scratchSize);
+		if (scratchEnd > scratchSize || (numPlanned > 0 && plannedTriangles + queued.numTriangles > triangleBudget)) break;
+
+		builds.push_back({ queued.handle, queued.update, plannedScratchSize });
+		plannedScratchSize = scratchEnd;
+		plannedTriangles += queued.numTriangles;
+	}
+
+	// Everything that didn't fit moves to the front for the next frame
+	queue.erase(queue.begin(), queue.begin() + numPlanned);
+}
+
+BLASBuildScheduler::QueuedBuild* BLASBuildScheduler::Find(BLASHandle handle)
+{
+	for (QueuedBuild& queued : queue)
+	{
+		if (queued.handle == handle) return &queued;
+	}
+	return nullptr;
+}
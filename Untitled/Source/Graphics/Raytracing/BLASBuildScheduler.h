@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Core/SparseArray.h"
+
+struct BottomLevelAccelerationStructure;
+using BLASHandle = SparseHandle<BottomLevelAccelerationStructure>;
+
+// Scratch regions have to be aligned like acceleration structures (D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT)
+constexpr uint64_t SCRATCH_ALIGNMENT = 256;
+
+// Collects the builds and refits of bottom level acceleration structures, so all of them are recorded back to back
+// once per frame. Every build gets its own region of the scratch buffer, which lets the GPU overlap the builds with
+// a single barrier after them. Builds that don't fit into the scratch buffer or the triangle budget of a frame stay
+// queued for the next frames. Nothing in here touches the device, the sizes come from the prebuild info.
+class BLASBuildScheduler
+{
+public:
+	struct PlannedBuild
+	{
+		BLASHandle handle;
+		bool update;
+		uint64_t scratchOffset;
+	};
+
+	// A BLAS is queued at most once, a full build replaces a queued refit and a refit of a queued build is dropped
+	// since the build reads the latest geometry anyway
+	void Queue(BLASHandle handle, bool update, uint64_t scratchSize, uint32_t numTriangles);
+
+	// Removed structures must not be built anymore
+	void Remove(BLASHandle handle);
+
+	bool IsQueued(BLASHandle handle) const;
+
+	// Takes the builds in the order they were queued while their scratch regions fit into the scratch buffer and
+	// their triangles into the budget. The first build ignores the triangle budget, so large meshes still progress.
+	void Plan(uint64_t scratchSize, uint64_t triangleBudget, eastl::vector<PlannedBuild>& builds);
+
+	inline uint32_t GetNumQueued() const { return static_cast<uint32_t>(queue.size()); }
+
+	// Statistics of the last plan
+	inline uint64_t GetPlannedScratchSize() const { return plannedScratchSize; }
+	inline uint64_t GetPlannedTriangles() const { return plannedTriangles; }
+
+private:
+	struct QueuedBuild
+	{
+		BLASHandle handle;
+		bool update;
+		uint64_t scratchSize;
+		uint32_t numTriangles;
+	};
+
+	eastl::vector<QueuedBuild> queue;
+
+	uint64_t plannedScratchSize = 0;
+	uint64_t plannedTriangles = 0;
+
+	QueuedBuild* Find(BLASHandle handle);
+};
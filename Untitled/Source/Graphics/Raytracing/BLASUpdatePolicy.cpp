@@ -0,0 +1,44 @@
+#include "PCH.h"
+#include "BLASUpdatePolicy.h"
+
+BLASUpdate BLASUpdatePolicy::OnGeometryChanged(BLASUpdateState& state, uint32_t vertexCount, uint32_t indexCount, float changedFraction, bool refittable)
+{
+	if (vertexCount != state.vertexCount || indexCount != state.indexCount)
+	{
+		state.preferFastBuild = true;
+		stats.numTopologyBuilds++;
+		stats.numFastBuilds++;
+		return BLASUpdate::FastBuild;
+	}
+
+	// The delta adds up over refits, since every one of them stretches the bounds of the original build further
+	if (!refittable || state.numRefits + 1 > MAX_BLAS_REFITS || state.geometryDelta + changedFraction > MAX_BLAS_REFIT_DELTA)
+	{
+		state.preferFastBuild = true;
+		stats.numFastBuilds++;
+		return BLASUpdate::FastBuild;
+	}
+
+	state.numRefits++;
+	state.geometryDelta += changedFraction;
+	stats.numRefits++;
+	return BLASUpdate::Refit;
+}
+
+bool BLASUpdatePolicy::OnIdle(BLASUpdateState& state)
+{
+	if (!state.fastBuilt && state.numRefits == 0) return false;
+
+	state.preferFastBuild = false;
+	stats.numFastTraceBuilds++;
+	return true;
+}
+
+void BLASUpdatePolicy::OnBuilt(BLASUpdateState& state, uint32_t vertexCount, uint32_t indexCount) const
+{
+	state.vertexCount = vertexCount;
+	state.indexCount = indexCount;
+	state.numRefits = 0;
+	state.geometryDelta = 0.0f;
+	state.fastBuilt = state.preferFastBuild;
+}
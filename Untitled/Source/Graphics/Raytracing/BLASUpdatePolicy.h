@@ -0,0 +1,57 @@
+#pragma once
+
+// A BLAS can be refit at most this many times or until this part of its vertices has moved before it's built again
+constexpr uint32_t MAX_BLAS_REFITS = 16;
+constexpr float MAX_BLAS_REFIT_DELTA = 0.5f;
+
+enum class BLASUpdate : uint8_t
+{
+	Refit,
+	// Structures that are being edited are built for speed, they are built for tracing again once they are idle
+	FastBuild
+};
+
+// Geometry of a BLAS at its last full build and what changed since
+struct BLASUpdateState
+{
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t numRefits = 0;
+	float geometryDelta = 0.0f;
+	// Refits have to use the flags of the build
+	bool fastBuilt = false;
+	// Flags of the next full build
+	bool preferFastBuild = false;
+};
+
+struct BLASUpdateStats
+{
+	uint32_t numRefits;
+	uint32_t numFastBuilds;
+	// Fast builds because the vertex or index count changed, which refits don't support
+	uint32_t numTopologyBuilds;
+	uint32_t numFastTraceBuilds;
+};
+
+// Decides between refitting and rebuilding BLASes whose geometry changed. Refits are cheap but can only move
+// vertices and every one of them makes the structure trace slower, so structures that changed their topology
+// or have been refit too much are built again. Those builds prefer speed since more edits tend to follow, the
+// structure is built for tracing once it stops changing. Nothing in here touches the device.
+class BLASUpdatePolicy
+{
+public:
+	// changedFraction is the part of the vertices that has been rewritten, structures that can't be refit at all
+	// (compacted ones are too small for that) are always built
+	BLASUpdate OnGeometryChanged(BLASUpdateState& state, uint32_t vertexCount, uint32_t indexCount, float changedFraction, bool refittable);
+
+	// Called for structures that haven't changed for a while, returns whether they should be built for tracing
+	bool OnIdle(BLASUpdateState& state);
+
+	// Called when a full build has been recorded
+	void OnBuilt(BLASUpdateState& state, uint32_t vertexCount, uint32_t indexCount) const;
+
+	inline const BLASUpdateStats& GetStats() const { return stats; }
+
+private:
+	BLASUpdateStats stats {};
+};
@@ -57,6 +57,7 @@ void RaytracingPipeline::RaytraceScene(uint32_t width, uint32_t height, const In
 	constants.framecount++;
 
 	PIXBeginEvent(context.graphicsCommands.Get(), PIX_COLOR_DEFAULT, L"Raytrace Scene");
+	ASManager->BuildQueuedBLAS(&context.descriptorHeap);
 	ASManager->BuildTLAS(&context.descriptorHeap);
 
 	// Update the sun position
@@ -29,21 +29,20 @@ public:
 	inline BLASHandle AddBLAS(eastl::vector<AccelerationStructureGeometry>&& geometry)
 	{
 		BLASHandle handle = ASManager->AddBLAS(eastl::forward<eastl::vector<AccelerationStructureGeometry>>(geometry));
-		ASManager->BuildBLAS(handle, &context.descriptorHeap);
 
 		AddHitgroupEntry(handle);
 		return handle;
 	}
 
-	inline void RebuildBLAS(BLASHandle handle, eastl::vector<AccelerationStructureGeometry>&& geometries)
+	inline void RebuildBLAS(BLASHandle handle, eastl::vector<AccelerationStructureGeometry>&& geometries, float changedFraction = 1.0f)
 	{
-		ASManager->RebuildBLAS(handle, eastl::forward<eastl::vector<AccelerationStructureGeometry>>(geometries), &context.descriptorHeap);
+		ASManager->RebuildBLAS(handle, eastl::forward<eastl::vector<AccelerationStructureGeometry>>(geometries), changedFraction);
 		RepopulateHitgroups();
 	}
 
-	inline BLASInstanceHandle AddBLASInstance(BLASHandle handle, DirectX::XMMATRIX transform = MATRIX_IDENTITY)
+	inline BLASInstanceHandle AddBLASInstance(BLASHandle handle, DirectX::XMMATRIX transform = MATRIX_IDENTITY, uint32_t instanceID = 0)
 	{
-		return ASManager->AddBLASInstance(handle, transform);
+		return ASManager->AddBLASInstance(handle, transform, instanceID);
 	}
 
 	inline void RemoveBLAS(BLASHandle& handle)
@@ -52,10 +51,15 @@ public:
 		RepopulateHitgroups();
 	}
 
+	inline void SetBLASInstanceTransform(BLASInstanceHandle handle, DirectX::XMMATRIX transform) { ASManager->SetBLASInstanceTransform(handle, transform); }
 	inline void RemoveBLASInstance(BLASInstanceHandle& handle) { ASManager->RemoveBLASInstance(handle); }
 
+	inline const RaytracingCamera& GetCamera() const { return camera; }
+	inline AccelerationStructureStats GetAccelerationStructureStats() const { return ASManager->GetStats(); }
+
 	inline void BuildTLAS()
 	{
+		ASManager->BuildQueuedBLAS(&context.descriptorHeap);
 		ASManager->BuildTLAS(&context.descriptorHeap);
 	}
 
@@ -30,10 +30,14 @@ struct RaytracingConstants
 	int framecount;
 };
 
+// Voxel mesh vertex packed into 8 bytes. The position is stored as three half floats,
+// which represent every lattice point of a chunk exactly and can be read directly by the
+// BLAS build as DXGI_FORMAT_R16G16B16A16_FLOAT. The fourth half is ignored by the build
+// and holds the face index in the lowest 3 bits and the block type in the upper 13 bits.
 struct Vertex
 {
-	XMVECTOR position;
-	XMVECTOR normal;
+	UINT positionXY;
+	UINT positionZData;
 };
 
 
@@ -362,4 +362,10 @@ DXDeviceLocalBuffer Renderer::CreateIndexBuffer(const uint32_t* indices, const s
 
 	buffer.CreateSRV(sizeof(uint32_t), &context.descriptorHeap);
 	return buffer;
+}
+
+void Renderer::UpdateBuffer(DXDeviceLocalBuffer& buffer, const void* data, const uint64_t size, 
+	eastl::span<const DXBufferRegion> regions)
+{
+	context.allocator->UpdateDeviceLocalBuffer(buffer, D3D12_RESOURCE_STATE_GENERIC_READ, data, size, regions);
 }
\ No newline at end of file
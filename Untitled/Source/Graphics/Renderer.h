@@ -28,6 +28,9 @@ public:
 	[[nodiscard]] DXDeviceLocalBuffer CreateVertexBuffer(const Vertex* vertices, size_t size);
 	[[nodiscard]] DXDeviceLocalBuffer CreateIndexBuffer(const uint32_t* indices, size_t size);
 
+	// Overwrites regions of a vertex or index buffer, the source offsets of the regions are relative to data
+	void UpdateBuffer(DXDeviceLocalBuffer& buffer, const void* data, uint64_t size, eastl::span<const DXBufferRegion> regions);
+
 private:
 	HWND hwnd;
 	RECT windowRect;
@@ -2,8 +2,16 @@
 
 // Common
 #include <assert.h>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
+#include <immintrin.h>
+#include <new>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 
 // Windows
 #define WIN32_LEAN_AND_MEAN
@@ -17,7 +25,9 @@
 #pragma comment(lib, "dxgi.lib")
 #include <d3d12.h>
 #include <dxgi1_6.h>
+#include <DirectXCollision.h>
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 
 // DXC
 #pragma comment(lib, "dxcompiler.lib")
@@ -36,6 +46,8 @@
 #include <EASTL/chrono.h>
 #include <EASTL/deque.h>
 #include <EASTL/fixed_vector.h>
+#include <EASTL/functional.h>
+#include <EASTL/span.h>
 #include <EASTL/string.h>
 #include <EASTL/unique_ptr.h>
 #include <EASTL/vector.h>